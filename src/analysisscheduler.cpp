@@ -0,0 +1,65 @@
+#include "analysisscheduler.h"
+
+#include <cassert>
+
+AnalysisScheduler::AnalysisScheduler(double rate, size_t hop) : _hop(hop)
+{
+    assert(hop > 0 || rate > 0.0);
+    _period = std::chrono::duration_cast<ClockType::duration>(
+            std::chrono::duration<double>(rate > 0.0 ? 1.0 / rate : 0.0));
+}
+
+bool AnalysisScheduler::isSampleDriven() const
+{
+    return _hop > 0;
+}
+
+size_t AnalysisScheduler::getHop() const
+{
+    return _hop;
+}
+
+AnalysisScheduler::ClockType::duration AnalysisScheduler::getPeriod() const
+{
+    return _period;
+}
+
+AnalysisScheduler::TimePointType AnalysisScheduler::getDeadline() const
+{
+    return _deadline;
+}
+
+void AnalysisScheduler::start(TimePointType now)
+{
+    _deadline = now + _period;
+    _skippedPeriods = 0;
+}
+
+bool AnalysisScheduler::isDue(TimePointType now, size_t newFrames) const
+{
+    if (isSampleDriven()) {
+        return newFrames >= _hop;
+    }
+    return now >= _deadline;
+}
+
+void AnalysisScheduler::advance(TimePointType now)
+{
+    if (isSampleDriven()) {
+        return;
+    }
+
+    _deadline += _period;
+    if (_deadline <= now) {
+        // the analysis took longer than a period (or the thread was not scheduled), so keep the
+        // phase and drop the analyses that are already late
+        uint64_t missed = (now - _deadline) / _period + 1;
+        _deadline += missed * _period;
+        _skippedPeriods += missed;
+    }
+}
+
+uint64_t AnalysisScheduler::getSkippedPeriods() const
+{
+    return _skippedPeriods;
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+
+/// Decides when QPitchCore analyses the buffered samples.
+///
+/// In the fixed-rate mode the analyses are due at regular deadlines, independently of how often
+/// the audio backend delivers samples.  In the hop mode an analysis is due every time a given
+/// number of new samples has arrived.
+class AnalysisScheduler
+{
+public:
+    using ClockType = std::chrono::steady_clock;
+    using TimePointType = std::chrono::time_point<ClockType>;
+
+    /// Constructor.
+    ///
+    /// \param[in] rate the number of analyses per second in the fixed-rate mode
+    /// \param[in] hop the number of new samples between two analyses, or 0 for the fixed-rate mode
+    AnalysisScheduler(double rate = 60.0, size_t hop = 0);
+
+    /// true in the hop mode.
+    bool isSampleDriven() const;
+
+    /// Number of new samples between two analyses in the hop mode.
+    size_t getHop() const;
+
+    /// The time between two analyses in the fixed-rate mode.
+    ClockType::duration getPeriod() const;
+
+    /// The time the next analysis is due in the fixed-rate mode.
+    TimePointType getDeadline() const;
+
+    /// Start scheduling from the given time.  The first analysis is due one period later.
+    void start(TimePointType now);
+
+    /// Whether an analysis is due.
+    ///
+    /// \param[in] now the current time
+    /// \param[in] newFrames the number of samples that arrived since the last analysis
+    bool isDue(TimePointType now, size_t newFrames) const;
+
+    /// Move on to the next analysis, when the current one starts.  In the fixed-rate mode,
+    /// periods that were missed altogether are skipped instead of being caught up in a burst.
+    void advance(TimePointType now);
+
+    /// Number of periods skipped since the scheduler started.
+    uint64_t getSkippedPeriods() const;
+
+private:
+    /// Number of new samples between two analyses, or 0 for the fixed-rate mode
+    size_t _hop;
+
+    /// The time between two analyses
+    ClockType::duration _period;
+
+    /// The time the next analysis is due
+    TimePointType _deadline;
+
+    /// Number of periods skipped
+    uint64_t _skippedPeriods = 0;
+};
@@ -0,0 +1,637 @@
+#include "audiosource.h"
+
+#include <QFileInfo>
+#include <QtAssert>
+#include <QtDebug>
+#include <QtEndian>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+
+#ifndef _WIN32
+#include <cerrno>
+#include <poll.h>
+#include <unistd.h>
+#endif
+
+const char *audioSourceKindName(AudioSourceKind kind)
+{
+    switch (kind) {
+    case AudioSourceKind::PortAudio:
+        return "portaudio";
+    case AudioSourceKind::WavFile:
+        return "wav";
+    case AudioSourceKind::Stdin:
+        return "stdin";
+    case AudioSourceKind::Generator:
+        return "generator";
+    }
+    return "unknown";
+}
+
+const char *pcmFormatName(PcmFormat format)
+{
+    switch (format) {
+    case PcmFormat::Float32:
+        return "f32";
+    case PcmFormat::Int16:
+        return "s16";
+    }
+    return "unknown";
+}
+
+std::unique_ptr<AudioSource> AudioSource::create(const AudioSourceOptions &options)
+{
+    switch (options.kind) {
+    case AudioSourceKind::PortAudio:
+        return std::make_unique<PortAudioSource>(options.listDevices);
+    case AudioSourceKind::WavFile:
+        return std::make_unique<WavFileSource>(options.path, options.realTime, options.loop);
+    case AudioSourceKind::Stdin:
+        return std::make_unique<RawPcmSource>(options.pcmFormat, options.sampleFrequency,
+                                              options.realTime);
+    case AudioSourceKind::Generator:
+        return std::make_unique<GeneratorSource>(options.signal, options.realTime);
+    }
+    throw AudioSourceException("unknown audio source");
+}
+
+// ** PORTAUDIO ** //
+
+PortAudioSource::PortAudioSource(bool listDevices)
+    : _stream(nullptr), _listDevices(listDevices), _callback(nullptr), _userData(nullptr)
+{
+    PaError err = Pa_Initialize();
+    if (err != paNoError) {
+        throw AudioSourceException(std::string("PortAudio error: ") + Pa_GetErrorText(err));
+    }
+}
+
+PortAudioSource::~PortAudioSource()
+{
+    Q_ASSERT(_stream == nullptr);
+    Pa_Terminate();
+}
+
+uint32_t PortAudioSource::getSampleFrequency(uint32_t preferred) const
+{
+    return preferred;
+}
+
+void PortAudioSource::start(uint32_t sampleFrequency, AudioSourceCallback callback,
+                            void *userData)
+{
+    // The stream should not have been started.
+    Q_ASSERT(_stream == nullptr);
+
+    _callback = callback;
+    _userData = userData;
+
+    // Parameters of the input audio stream
+    PaStreamParameters inputParameters;
+
+    // Walking every device can take a while with some host APIs, so the list is only logged on
+    // demand, once.
+    if (_listDevices) {
+        logDevices();
+        _listDevices = false;
+    }
+
+    // Prefer the default device.  On Linux, the default host API is ALSA; and on modern Linux
+    // distributions, the default output device is usually "pipewire" which bridges with the
+    // PipeWire sound server.
+    //
+    // TODO: Allow the user to specify a device at runtime via the GUI.
+    inputParameters.device = Pa_GetDefaultInputDevice();
+    if (inputParameters.device == paNoDevice) {
+        throw AudioSourceException("PortAudio error: no default input device");
+    }
+    qDebug("Selected device: %d", inputParameters.device);
+
+    // ** CONFIGURE THE INPUT AUDIO STREAM ** //
+    inputParameters.channelCount = 1; // mono input
+    inputParameters.sampleFormat = paFloat32; // what the callback expects
+    inputParameters.suggestedLatency = 1.0 / 60.0; // Try to get 60 fps.
+    inputParameters.hostApiSpecificStreamInfo = nullptr;
+
+    // ** OPEN AN AUDIO INPUT STREAM ** //
+
+    // We don't specify the buffer size.  Pa_OpenStream promises that by doing so, "the stream
+    // callback will receive an optimal (and possibly varying) number of frames based on host
+    // requirements and the requested latency settings", and "the use of non-zero framesPerBuffer
+    // for a callback stream may introduce an additional layer of buffering which could introduce
+    // additional latency". Meanwhile, since QPitchCore accumulates the samples in a ring,
+    // we are quite flexible about the buffer size, and we can even handle variable-sized
+    // buffers with ease. Therefore, not specifying the buffer size will allow us to run at the
+    // maximum possible FPS.  On a machine with Linux and PipeWire, we receive about 395 callbacks
+    // per second, with the number of frames per callback ranging from 7 to 183.
+    unsigned long framesPerBuffer = paFramesPerBufferUnspecified;
+    PaError err = Pa_OpenStream(&_stream, &inputParameters,
+                                nullptr, // no output
+                                sampleFrequency, // sample rate (default 44100 Hz)
+                                framesPerBuffer, // frames per buffer (not specified)
+                                paClipOff, // disable clipping
+                                paCallback, // callback
+                                this // pointer to user data
+    );
+
+    if (err != paNoError) {
+        _stream = nullptr;
+        throw AudioSourceException(std::string("PortAudio error: ") + Pa_GetErrorText(err));
+    }
+
+    // ** START PORTAUDIO STREAM ** //
+    err = Pa_StartStream(_stream);
+    if (err != paNoError) {
+        Pa_CloseStream(_stream);
+        _stream = nullptr;
+        throw AudioSourceException(std::string("PortAudio error: ") + Pa_GetErrorText(err));
+    }
+
+    const PaDeviceInfo *deviceInfo = Pa_GetDeviceInfo(inputParameters.device);
+    _deviceName = QString(deviceInfo->name);
+    _hostApiName = QString(Pa_GetHostApiInfo(deviceInfo->hostApi)->name);
+
+    qDebug() << " - suggestedLatency = " << inputParameters.suggestedLatency;
+}
+
+void PortAudioSource::logDevices()
+{
+    qInfo("Default input device: %d", Pa_GetDefaultInputDevice());
+    for (int i = 0, end = Pa_GetHostApiCount(); i != end; ++i) {
+        const PaHostApiInfo *hostAPIInfo = Pa_GetHostApiInfo(i);
+        qInfo("Host API %d: %s", i, hostAPIInfo->name);
+        for (int j = 0, end = hostAPIInfo->deviceCount; j != end; ++j) {
+            PaDeviceIndex deviceIndex = Pa_HostApiDeviceIndexToDeviceIndex(i, j);
+            const PaDeviceInfo *info = Pa_GetDeviceInfo(deviceIndex);
+            if (!info) {
+                qInfo("  %d: [%d] no info", j, deviceIndex);
+            } else if (info->maxInputChannels > 0) {
+                qInfo("  %d: [%d] %s (%d channels, %lf Hz, %lf ms to %lf ms)", j, deviceIndex,
+                      info->name, info->maxInputChannels, info->defaultSampleRate,
+                      info->defaultLowInputLatency * 1000, info->defaultHighInputLatency * 1000);
+            } else {
+                qInfo("  %d: [%d] %s (no input)", j, deviceIndex, info->name);
+            }
+        }
+    }
+}
+
+void PortAudioSource::stop()
+{
+    // ** ENSURE THAT THE STREAM IS STARTED ** //
+    Q_ASSERT(_stream != nullptr);
+
+    // ** STOP PORTAUDIO STREAM ** //
+    PaError err = Pa_StopStream(_stream);
+    if (err != paNoError) {
+        throw AudioSourceException(std::string("PortAudio error: ") + Pa_GetErrorText(err));
+    }
+
+    // ** CLOSE PORTAUDIO STREAM ** //
+    err = Pa_CloseStream(_stream);
+    _stream = nullptr;
+    if (err != paNoError) {
+        throw AudioSourceException(std::string("PortAudio error: ") + Pa_GetErrorText(err));
+    }
+}
+
+bool PortAudioSource::isStarted() const
+{
+    return _stream != nullptr;
+}
+
+QString PortAudioSource::getDeviceName() const
+{
+    return _deviceName;
+}
+
+QString PortAudioSource::getHostApiName() const
+{
+    return _hostApiName;
+}
+
+int PortAudioSource::paCallback(const void *input, void * /*output*/, unsigned long frameCount,
+                                const PaStreamCallbackTimeInfo *timeInfo,
+                                PaStreamCallbackFlags statusFlags, void *userData)
+{
+    Q_ASSERT(input != nullptr);
+    Q_ASSERT(userData != nullptr);
+
+    PortAudioSource *source = static_cast<PortAudioSource *>(userData);
+    return source->_callback((const float *)input, frameCount, timeInfo, statusFlags,
+                             source->_userData);
+}
+
+// ** BLOCKS READ BY A THREAD ** //
+
+const size_t BlockAudioSource::BLOCK_FRAMES = 256;
+
+BlockAudioSource::BlockAudioSource(bool realTime)
+    : _realTime(realTime),
+      _sampleFrequency(0),
+      _callback(nullptr),
+      _userData(nullptr),
+      _stopRequested(false)
+{
+}
+
+BlockAudioSource::~BlockAudioSource()
+{
+    // The subclass must have stopped the thread: it calls read().
+    Q_ASSERT(!_thread.joinable());
+}
+
+void BlockAudioSource::start(uint32_t sampleFrequency, AudioSourceCallback callback,
+                             void *userData)
+{
+    Q_ASSERT(!_thread.joinable());
+
+    _sampleFrequency = sampleFrequency;
+    _callback = callback;
+    _userData = userData;
+    _stopRequested = false;
+    _thread = std::thread(&BlockAudioSource::run, this);
+}
+
+void BlockAudioSource::stop()
+{
+    {
+        std::lock_guard<std::mutex> locker(_mutex);
+        _stopRequested = true;
+        _cond.notify_one();
+    }
+    if (_thread.joinable()) {
+        _thread.join();
+    }
+}
+
+bool BlockAudioSource::isStarted() const
+{
+    return _thread.joinable();
+}
+
+bool BlockAudioSource::isRealTime() const
+{
+    return _realTime;
+}
+
+bool BlockAudioSource::isStopRequested() const
+{
+    return _stopRequested.load(std::memory_order_relaxed);
+}
+
+void BlockAudioSource::run()
+{
+    using Clock = std::chrono::steady_clock;
+    auto toSeconds = [](Clock::time_point time) {
+        return std::chrono::duration<double>(time.time_since_epoch()).count();
+    };
+
+    std::vector<float> block(BLOCK_FRAMES);
+    Clock::time_point start = Clock::now();
+    uint64_t delivered = 0;
+
+    while (!_stopRequested) {
+        size_t count = read(block.data(), block.size());
+        if (count == 0) {
+            break;
+        }
+
+        // A device delivers a block once its last sample was captured.
+        Clock::time_point firstSampleTime = start;
+        if (_realTime) {
+            firstSampleTime += std::chrono::duration_cast<Clock::duration>(
+                    std::chrono::duration<double>((double)delivered / _sampleFrequency));
+            Clock::time_point due = start
+                    + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(
+                            (double)(delivered + count) / _sampleFrequency));
+            std::unique_lock<std::mutex> locker(_mutex);
+            if (_cond.wait_until(locker, due, [this]() { return _stopRequested.load(); })) {
+                break;
+            }
+        }
+
+        Clock::time_point now = Clock::now();
+        PaStreamCallbackTimeInfo timeInfo;
+        timeInfo.currentTime = toSeconds(now);
+        timeInfo.inputBufferAdcTime = _realTime ? toSeconds(firstSampleTime) : toSeconds(now);
+        timeInfo.outputBufferDacTime = 0.0;
+
+        int result = _callback(block.data(), count, &timeInfo, 0, _userData);
+        delivered += count;
+        if (result != paContinue) {
+            break;
+        }
+    }
+}
+
+// ** WAV FILE ** //
+
+namespace {
+
+/// The format tags of the fmt chunk that we read
+enum WavFormatTag : uint16_t {
+    WAV_FORMAT_PCM = 0x0001,
+    WAV_FORMAT_IEEE_FLOAT = 0x0003,
+    WAV_FORMAT_EXTENSIBLE = 0xFFFE,
+};
+
+} // namespace
+
+WavFileSource::WavFileSource(const QString &path, bool realTime, bool loop)
+    : BlockAudioSource(realTime),
+      _file(path),
+      _frames(nullptr),
+      _numFrames(0),
+      _frameBytes(0),
+      _bitsPerSample(0),
+      _isFloat(false),
+      _sampleFrequency(0),
+      _loop(loop),
+      _position(0)
+{
+    auto fail = [&path](const char *reason) {
+        return AudioSourceException(QString("%1: %2").arg(path, reason).toStdString());
+    };
+
+    if (!_file.open(QIODevice::ReadOnly)) {
+        throw AudioSourceException(
+                QString("%1: %2").arg(path, _file.errorString()).toStdString());
+    }
+    const qint64 fileSize = _file.size();
+    const uchar *data = _file.map(0, fileSize);
+    if (data == nullptr) {
+        throw fail("cannot map the file");
+    }
+
+    // ** RIFF HEADER ** //
+    if (fileSize < 12 || memcmp(data, "RIFF", 4) != 0 || memcmp(data + 8, "WAVE", 4) != 0) {
+        throw fail("not a WAV file");
+    }
+
+    // ** CHUNKS ** //
+    uint16_t formatTag = 0;
+    uint16_t channels = 0;
+    uint16_t blockAlign = 0;
+    bool hasFormat = false;
+    qint64 offset = 12;
+    while (offset + 8 <= fileSize) {
+        const uchar *chunk = data + offset;
+        uint32_t chunkSize = qFromLittleEndian<quint32>(chunk + 4);
+        // a truncated last chunk ends with the file
+        qint64 available = std::min<qint64>(chunkSize, fileSize - offset - 8);
+
+        if (memcmp(chunk, "fmt ", 4) == 0) {
+            if (available < 16) {
+                throw fail("truncated fmt chunk");
+            }
+            formatTag = qFromLittleEndian<quint16>(chunk + 8);
+            channels = qFromLittleEndian<quint16>(chunk + 10);
+            _sampleFrequency = qFromLittleEndian<quint32>(chunk + 12);
+            blockAlign = qFromLittleEndian<quint16>(chunk + 20);
+            _bitsPerSample = qFromLittleEndian<quint16>(chunk + 22);
+            if (formatTag == WAV_FORMAT_EXTENSIBLE && available >= 26) {
+                // the first two bytes of the sub-format GUID are the actual format tag
+                formatTag = qFromLittleEndian<quint16>(chunk + 32);
+            }
+            hasFormat = true;
+        } else if (memcmp(chunk, "data", 4) == 0) {
+            if (!hasFormat) {
+                throw fail("data chunk before the fmt chunk");
+            }
+            _frames = chunk + 8;
+            _frameBytes = blockAlign;
+            _numFrames = (blockAlign > 0) ? available / blockAlign : 0;
+            break;
+        }
+
+        // chunks are padded to an even size; in 64 bits, so that a huge size cannot wrap around
+        qint64 nextOffset = offset + 8 + (qint64)chunkSize + (chunkSize & 1);
+        if (nextOffset <= offset) {
+            throw fail("invalid chunk size");
+        }
+        offset = nextOffset;
+    }
+
+    if (!hasFormat || _frames == nullptr) {
+        throw fail("no fmt or data chunk");
+    }
+
+    // ** SUPPORTED FORMATS ** //
+    _isFloat = (formatTag == WAV_FORMAT_IEEE_FLOAT);
+    bool supported = (formatTag == WAV_FORMAT_PCM
+                      && (_bitsPerSample == 8 || _bitsPerSample == 16 || _bitsPerSample == 24
+                          || _bitsPerSample == 32))
+            || (_isFloat && (_bitsPerSample == 32 || _bitsPerSample == 64));
+    if (!supported) {
+        throw fail("unsupported sample format");
+    }
+    if (channels == 0 || _sampleFrequency == 0 || blockAlign < channels * (_bitsPerSample / 8)) {
+        throw fail("invalid fmt chunk");
+    }
+
+    qInfo("[WavFileSource] %s: %zu frames of %u channels at %u Hz, %u-bit %s", qPrintable(path),
+          _numFrames, channels, _sampleFrequency, _bitsPerSample, _isFloat ? "float" : "integer");
+}
+
+WavFileSource::~WavFileSource()
+{
+    stop();
+}
+
+uint32_t WavFileSource::getSampleFrequency(uint32_t /*preferred*/) const
+{
+    return _sampleFrequency;
+}
+
+QString WavFileSource::getDeviceName() const
+{
+    return QFileInfo(_file.fileName()).fileName();
+}
+
+QString WavFileSource::getHostApiName() const
+{
+    return isRealTime() ? "WAV file" : "WAV file (as fast as possible)";
+}
+
+size_t WavFileSource::getNumFrames() const
+{
+    return _numFrames;
+}
+
+size_t WavFileSource::readSamples(size_t first, float *dst, size_t count) const
+{
+    if (first >= _numFrames) {
+        return 0;
+    }
+
+    count = std::min(count, _numFrames - first);
+    for (size_t i = 0; i < count; ++i) {
+        dst[i] = sampleAt(first + i);
+    }
+    return count;
+}
+
+float WavFileSource::sampleAt(size_t frame) const
+{
+    const uchar *sample = _frames + frame * _frameBytes;
+    if (_isFloat) {
+        if (_bitsPerSample == 32) {
+            return qFromLittleEndian<float>(sample);
+        }
+        return (float)qFromLittleEndian<double>(sample);
+    }
+    switch (_bitsPerSample) {
+    case 8:
+        // unsigned, unlike all the others
+        return (sample[0] - 128) / 128.0f;
+    case 16:
+        return qFromLittleEndian<qint16>(sample) / 32768.0f;
+    case 24:
+        // sign-extend through the top byte of a 32-bit integer
+        return (int32_t)((uint32_t)sample[0] << 8 | (uint32_t)sample[1] << 16
+                         | (uint32_t)sample[2] << 24)
+                / 2147483648.0f;
+    default:
+        return qFromLittleEndian<qint32>(sample) / 2147483648.0f;
+    }
+}
+
+size_t WavFileSource::read(float *dst, size_t count)
+{
+    if (_position >= _numFrames) {
+        if (!_loop || _numFrames == 0) {
+            return 0;
+        }
+        _position = 0;
+    }
+
+    count = readSamples(_position, dst, count);
+    _position += count;
+    return count;
+}
+
+// ** RAW SAMPLES ON THE STANDARD INPUT ** //
+
+RawPcmSource::RawPcmSource(PcmFormat format, uint32_t sampleFrequency, bool realTime)
+    : BlockAudioSource(realTime),
+      _format(format),
+      _sampleBytes(format == PcmFormat::Float32 ? 4 : 2),
+      _sampleFrequency(sampleFrequency),
+      _bytes(BLOCK_FRAMES * _sampleBytes),
+      _numBytes(0)
+{
+}
+
+RawPcmSource::~RawPcmSource()
+{
+    stop();
+}
+
+uint32_t RawPcmSource::getSampleFrequency(uint32_t preferred) const
+{
+    return (_sampleFrequency > 0) ? _sampleFrequency : preferred;
+}
+
+QString RawPcmSource::getDeviceName() const
+{
+    return "stdin";
+}
+
+QString RawPcmSource::getHostApiName() const
+{
+    return QString("Raw PCM (%1)").arg(pcmFormatName(_format));
+}
+
+size_t RawPcmSource::read(float *dst, size_t count)
+{
+    count = std::min(count, _bytes.size() / _sampleBytes);
+
+    // read at least one whole sample, and whatever else is available up to count
+    while (_numBytes < _sampleBytes) {
+#ifndef _WIN32
+        // wait with a timeout, to notice stop() while the pipe is idle
+        pollfd pfd = { STDIN_FILENO, POLLIN, 0 };
+        int ready = poll(&pfd, 1, 100);
+        if (isStopRequested()) {
+            return 0;
+        }
+        if (ready == 0 || (ready < 0 && errno == EINTR)) {
+            continue;
+        }
+        ssize_t n = ::read(STDIN_FILENO, _bytes.data() + _numBytes,
+                           count * _sampleBytes - _numBytes);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+#else
+        // blocks until the samples come: stop() waits for them or for the end of the input
+        size_t n = fread(_bytes.data() + _numBytes, 1, count * _sampleBytes - _numBytes, stdin);
+#endif
+        if (n <= 0) {
+            // the end of the input, or an error
+            return 0;
+        }
+        _numBytes += n;
+    }
+
+    size_t numSamples = _numBytes / _sampleBytes;
+    const char *bytes = _bytes.data();
+    for (size_t i = 0; i < numSamples; ++i) {
+        if (_format == PcmFormat::Float32) {
+            dst[i] = qFromLittleEndian<float>(bytes + i * 4);
+        } else {
+            dst[i] = qFromLittleEndian<qint16>(bytes + i * 2) / 32768.0f;
+        }
+    }
+
+    // keep the bytes of a partial sample for the next read
+    size_t used = numSamples * _sampleBytes;
+    memmove(_bytes.data(), bytes + used, _numBytes - used);
+    _numBytes -= used;
+    return numSamples;
+}
+
+// ** SYNTHETIC SIGNAL ** //
+
+GeneratorSource::GeneratorSource(const SignalParameters &parameters, bool realTime)
+    : BlockAudioSource(realTime), _parameters(parameters)
+{
+}
+
+GeneratorSource::~GeneratorSource()
+{
+    stop();
+}
+
+uint32_t GeneratorSource::getSampleFrequency(uint32_t preferred) const
+{
+    return preferred;
+}
+
+void GeneratorSource::start(uint32_t sampleFrequency, AudioSourceCallback callback,
+                            void *userData)
+{
+    if (!_generator || _generator->getSampleFrequency() != sampleFrequency) {
+        _generator = std::make_unique<SignalGenerator>(_parameters, sampleFrequency);
+    }
+    BlockAudioSource::start(sampleFrequency, callback, userData);
+}
+
+QString GeneratorSource::getDeviceName() const
+{
+    return QString("%1 Hz signal").arg(_parameters.frequency);
+}
+
+QString GeneratorSource::getHostApiName() const
+{
+    return isRealTime() ? "Generator" : "Generator (as fast as possible)";
+}
+
+size_t GeneratorSource::read(float *dst, size_t count)
+{
+    _generator->generate(dst, count);
+    return count;
+}
@@ -0,0 +1,323 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "signalgenerator.h"
+
+#include <portaudio.h>
+
+#include <QFile>
+#include <QString>
+
+/// An exception thrown when an audio source cannot be opened or fails.
+class AudioSourceException : public std::runtime_error
+{
+public:
+    AudioSourceException(const std::string &msg) : std::runtime_error(msg) { }
+};
+
+/// The backends of AudioSource.
+enum class AudioSourceKind {
+    /// The default input device, through PortAudio (PortAudioSource).
+    PortAudio = 0,
+    /// A WAV file, replayed from memory (WavFileSource).
+    WavFile,
+    /// Headerless mono samples read from the standard input (RawPcmSource).
+    Stdin,
+    /// A synthetic signal with a known pitch (GeneratorSource).
+    Generator,
+};
+
+/// Return the name of an audio source kind, as accepted on the command line.
+const char *audioSourceKindName(AudioSourceKind kind);
+
+/// Sample formats of RawPcmSource, little-endian.
+enum class PcmFormat {
+    Float32 = 0,
+    Int16,
+};
+
+/// Return the name of a raw sample format, as accepted on the command line.
+const char *pcmFormatName(PcmFormat format);
+
+/// Which audio source to create, and how.  Chosen on the command line.
+struct AudioSourceOptions
+{
+    AudioSourceKind kind = AudioSourceKind::PortAudio;
+
+    /// The WAV file
+    QString path;
+
+    /// The format of the raw samples
+    PcmFormat pcmFormat = PcmFormat::Float32;
+
+    /// The sample rate of the raw samples, or 0 to use the one of the settings
+    uint32_t sampleFrequency = 0;
+
+    /// Deliver the samples of a file, a pipe or the generator at their sample rate rather than as
+    /// fast as possible
+    bool realTime = true;
+
+    /// Start the WAV file over when it ends
+    bool loop = false;
+
+    /// Log the host APIs and the devices of PortAudio when the stream is opened
+    bool listDevices = false;
+
+    /// The synthetic signal
+    SignalParameters signal;
+};
+
+/// Called from the thread of an audio source with each block of mono samples.  The same as the
+/// PortAudio stream callback, without the output buffer.
+///
+/// \return paContinue, or paComplete to stop delivering samples
+using AudioSourceCallback = int (*)(const float *input, unsigned long frameCount,
+                                    const PaStreamCallbackTimeInfo *timeInfo,
+                                    PaStreamCallbackFlags statusFlags, void *userData);
+
+/// Where QPitchCore gets its samples from.
+///
+/// A source delivers blocks of mono float samples to a callback, from a thread of its own, from
+/// start() to stop().  It may be started again after it was stopped.
+class AudioSource
+{
+public:
+    /// Create the source described by options.
+    ///
+    /// \throw AudioSourceException if the source cannot be opened
+    static std::unique_ptr<AudioSource> create(const AudioSourceOptions &options);
+
+    virtual ~AudioSource() = default;
+
+    /// The sample rate the source delivers, given the one of the settings.
+    virtual uint32_t getSampleFrequency(uint32_t preferred) const = 0;
+
+    /// Start delivering samples to callback.
+    ///
+    /// \param[in] sampleFrequency the result of getSampleFrequency()
+    /// \throw AudioSourceException if the source cannot be started
+    virtual void start(uint32_t sampleFrequency, AudioSourceCallback callback,
+                       void *userData) = 0;
+
+    /// Stop delivering samples.  The callback is not called any more once this returns.
+    virtual void stop() = 0;
+
+    /// Whether the source was started and not stopped since.
+    virtual bool isStarted() const = 0;
+
+    /// A human-readable name of the device, valid once started.
+    virtual QString getDeviceName() const = 0;
+
+    /// A human-readable name of the host API, valid once started.
+    virtual QString getHostApiName() const = 0;
+};
+
+/// The default input device, through PortAudio.
+class PortAudioSource : public AudioSource
+{
+public:
+    /// Constructor.  Initializes PortAudio.
+    ///
+    /// \param[in] listDevices log the host APIs and the devices when the stream is first opened
+    explicit PortAudioSource(bool listDevices = false);
+
+    /// Destructor.  Terminates PortAudio.
+    ~PortAudioSource() override;
+
+    uint32_t getSampleFrequency(uint32_t preferred) const override;
+    void start(uint32_t sampleFrequency, AudioSourceCallback callback, void *userData) override;
+    void stop() override;
+    bool isStarted() const override;
+    QString getDeviceName() const override;
+    QString getHostApiName() const override;
+
+    /// Log the host APIs of PortAudio and their devices.
+    static void logDevices();
+
+private:
+    /// Forward the input samples to the callback.
+    static int paCallback(const void *input, void *output, unsigned long frameCount,
+                          const PaStreamCallbackTimeInfo *timeInfo,
+                          PaStreamCallbackFlags statusFlags, void *userData);
+
+    /// Handle to the PortAudio stream
+    PaStream *_stream;
+
+    /// Whether logDevices() is still to be called when the stream is opened
+    bool _listDevices;
+
+    AudioSourceCallback _callback;
+    void *_userData;
+
+    QString _deviceName;
+    QString _hostApiName;
+};
+
+/// A source that reads blocks of samples in a thread of its own, at their sample rate or as
+/// fast as possible.
+///
+/// Subclasses must call stop() in their destructor, since the thread calls read().
+class BlockAudioSource : public AudioSource
+{
+public:
+    /// Number of samples delivered at once, at most
+    static const size_t BLOCK_FRAMES;
+
+public:
+    ~BlockAudioSource() override;
+
+    void start(uint32_t sampleFrequency, AudioSourceCallback callback, void *userData) override;
+    void stop() override;
+    bool isStarted() const override;
+
+protected:
+    /// Constructor.
+    ///
+    /// \param[in] realTime deliver the samples at their sample rate
+    explicit BlockAudioSource(bool realTime);
+
+    /// Read at most count samples.  Called from the thread of the source.
+    ///
+    /// \return the number of samples read, or 0 at the end of the input or when stop() is called
+    virtual size_t read(float *dst, size_t count) = 0;
+
+    /// Whether the samples are delivered at their sample rate.
+    bool isRealTime() const;
+
+    /// Whether stop() was called, for read() to give up waiting.
+    bool isStopRequested() const;
+
+private:
+    /// Main loop of the thread.
+    void run();
+
+    bool _realTime;
+    uint32_t _sampleFrequency;
+    AudioSourceCallback _callback;
+    void *_userData;
+
+    std::mutex _mutex;
+    std::condition_variable _cond;
+    std::atomic<bool> _stopRequested;
+
+    std::thread _thread;
+};
+
+/// A WAV file, mapped into memory and replayed from its first channel.
+///
+/// 8, 16, 24 and 32-bit integer and 32 and 64-bit float samples are supported.  The file plays
+/// at its own sample rate, whatever the settings say.
+class WavFileSource : public BlockAudioSource
+{
+public:
+    /// Constructor.  Maps and parses the file.
+    ///
+    /// \param[in] realTime deliver the samples at their sample rate rather than as fast as possible
+    /// \param[in] loop start over at the end of the file rather than stop
+    /// \throw AudioSourceException if the file cannot be read or is not a supported WAV file
+    WavFileSource(const QString &path, bool realTime, bool loop);
+    ~WavFileSource() override;
+
+    uint32_t getSampleFrequency(uint32_t preferred) const override;
+    QString getDeviceName() const override;
+    QString getHostApiName() const override;
+
+    /// Number of frames in the file.
+    size_t getNumFrames() const;
+
+    /// Convert the first channel of count frames from frame first on, without moving the position
+    /// of the stream.  Only reads the mapping, so it may be called from several threads at once.
+    ///
+    /// \return the number of samples converted, less than count at the end of the file
+    size_t readSamples(size_t first, float *dst, size_t count) const;
+
+protected:
+    size_t read(float *dst, size_t count) override;
+
+private:
+    /// The sample of the first channel of a frame, in [-1, 1].
+    float sampleAt(size_t frame) const;
+
+    QFile _file;
+
+    /// The first frame, in the mapping of the file
+    const uchar *_frames;
+    size_t _numFrames;
+
+    /// Bytes per frame, all channels included
+    size_t _frameBytes;
+    uint16_t _bitsPerSample;
+    bool _isFloat;
+    uint32_t _sampleFrequency;
+
+    bool _loop;
+
+    /// The next frame to deliver.  Kept when the source is stopped and started again.
+    size_t _position;
+};
+
+/// Headerless mono samples read from the standard input, as piped by arecord or sox for example.
+class RawPcmSource : public BlockAudioSource
+{
+public:
+    /// Constructor.
+    ///
+    /// \param[in] sampleFrequency the sample rate of the samples, or 0 to use the one of the
+    ///            settings
+    /// \param[in] realTime deliver the samples at their sample rate rather than as soon as they
+    ///            are read
+    RawPcmSource(PcmFormat format, uint32_t sampleFrequency, bool realTime);
+    ~RawPcmSource() override;
+
+    uint32_t getSampleFrequency(uint32_t preferred) const override;
+    QString getDeviceName() const override;
+    QString getHostApiName() const override;
+
+protected:
+    size_t read(float *dst, size_t count) override;
+
+private:
+    PcmFormat _format;
+    size_t _sampleBytes;
+    uint32_t _sampleFrequency;
+
+    /// Bytes read so far, including those of a partial sample
+    std::vector<char> _bytes;
+    size_t _numBytes;
+};
+
+/// A synthetic signal, generated at the sample rate of the settings.
+class GeneratorSource : public BlockAudioSource
+{
+public:
+    /// Constructor.
+    ///
+    /// \param[in] realTime deliver the samples at their sample rate rather than as fast as possible
+    GeneratorSource(const SignalParameters &parameters, bool realTime);
+    ~GeneratorSource() override;
+
+    uint32_t getSampleFrequency(uint32_t preferred) const override;
+    void start(uint32_t sampleFrequency, AudioSourceCallback callback, void *userData) override;
+    QString getDeviceName() const override;
+    QString getHostApiName() const override;
+
+protected:
+    size_t read(float *dst, size_t count) override;
+
+private:
+    SignalParameters _parameters;
+
+    /// Created when started, at the sample rate of the stream.  Not reset by a restart at the
+    /// same rate, so that the signal goes on.
+    std::unique_ptr<SignalGenerator> _generator;
+};
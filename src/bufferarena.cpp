@@ -0,0 +1,90 @@
+#include "bufferarena.h"
+
+#include <cstdlib>
+#include <new>
+
+#ifdef _WIN32
+#include <malloc.h>
+#endif
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+
+const size_t BufferArena::ALIGNMENT = 64;
+const size_t BufferArena::HUGE_PAGE_SIZE = 2 << 20;
+
+std::atomic<bool> BufferArena::_hugePagesEnabled{ false };
+
+/// Allocate size bytes aligned to alignment (a power of two, multiple of sizeof(void *)).
+static unsigned char *allocateAligned(size_t size, size_t alignment)
+{
+#ifdef _WIN32
+    return (unsigned char *)_aligned_malloc(size, alignment);
+#else
+    void *memory = nullptr;
+    if (posix_memalign(&memory, alignment, size) != 0) {
+        return nullptr;
+    }
+    return (unsigned char *)memory;
+#endif
+}
+
+static void freeAligned(unsigned char *memory)
+{
+#ifdef _WIN32
+    _aligned_free(memory);
+#else
+    free(memory);
+#endif
+}
+
+BufferArena::BufferArena(size_t capacity)
+{
+    _capacity = alignedSize(capacity);
+    _used = 0;
+    _hugePages = false;
+
+#ifdef __linux__
+    if (_hugePagesEnabled.load(std::memory_order_relaxed) && _capacity >= HUGE_PAGE_SIZE) {
+        // whole huge pages, so that the arena shares none with other allocations
+        size_t size = (_capacity + HUGE_PAGE_SIZE - 1) & ~(HUGE_PAGE_SIZE - 1);
+        _memory = allocateAligned(size, HUGE_PAGE_SIZE);
+        if (_memory == nullptr) {
+            throw std::bad_alloc();
+        }
+        // only a hint: the kernel falls back to small pages if it has no huge ones
+        _hugePages = madvise(_memory, size, MADV_HUGEPAGE) == 0;
+        return;
+    }
+#endif
+
+    _memory = allocateAligned(_capacity > 0 ? _capacity : ALIGNMENT, ALIGNMENT);
+    if (_memory == nullptr) {
+        throw std::bad_alloc();
+    }
+}
+
+BufferArena::~BufferArena()
+{
+    freeAligned(_memory);
+}
+
+size_t BufferArena::getCapacity() const
+{
+    return _capacity;
+}
+
+bool BufferArena::usesHugePages() const
+{
+    return _hugePages;
+}
+
+void BufferArena::setHugePages(bool enabled)
+{
+    _hugePagesEnabled.store(enabled, std::memory_order_relaxed);
+}
+
+bool BufferArena::getHugePages()
+{
+    return _hugePagesEnabled.load(std::memory_order_relaxed);
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+
+/// One aligned allocation carved into the buffers of an object, and freed with it.
+///
+/// The buffers of a pitch detection context are allocated and freed together, so a single block
+/// saves the allocator calls and keeps them next to each other.  The buffers are aligned for the
+/// widest SIMD registers, which is at least the alignment of fftw_malloc(), so FFTW plans made on
+/// fftw_malloc() buffers may be executed on them.
+///
+/// Large arenas may be backed by transparent huge pages (see setHugePages()), which cuts the TLB
+/// misses of the large zero-padded IFFT.
+class BufferArena
+{
+public:
+    /// Alignment of every buffer, in bytes
+    static const size_t ALIGNMENT;
+
+    /// Size of a huge page, and alignment of the arenas that use them
+    static const size_t HUGE_PAGE_SIZE;
+
+    /// Allocate the arena.  Throws std::bad_alloc if memory is short.
+    ///
+    /// \param[in] capacity the sum of the alignedSize() of the buffers, in bytes
+    explicit BufferArena(size_t capacity);
+
+    ~BufferArena();
+
+    BufferArena(const BufferArena &) = delete;
+    BufferArena &operator=(const BufferArena &) = delete;
+
+    /// Take the next buffer of count elements of T out of the arena.
+    template <class T>
+    T *allocate(size_t count)
+    {
+        size_t size = alignedSize(count * sizeof(T));
+        assert(_used + size <= _capacity);
+        T *buffer = reinterpret_cast<T *>(_memory + _used);
+        _used += size;
+        return buffer;
+    }
+
+    /// The room that a buffer of the given size takes in an arena.
+    static size_t alignedSize(size_t bytes) { return (bytes + ALIGNMENT - 1) & ~(ALIGNMENT - 1); }
+
+    /// The size of the arena, in bytes.
+    size_t getCapacity() const;
+
+    /// Whether the arena asked the operating system for huge pages.
+    bool usesHugePages() const;
+
+    /// Back the arenas of at least HUGE_PAGE_SIZE bytes created from now on with transparent huge
+    /// pages, where the operating system supports them (Linux).  Off by default.
+    static void setHugePages(bool enabled);
+
+    static bool getHugePages();
+
+private:
+    unsigned char *_memory;
+    size_t _capacity;
+    size_t _used;
+    bool _hugePages;
+
+    static std::atomic<bool> _hugePagesEnabled;
+};
@@ -0,0 +1,252 @@
+#include "callbacktelemetry.h"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <limits>
+
+#include <portaudio.h>
+
+// ** CALLBACK TELEMETRY QUEUE ** //
+
+CallbackTelemetryQueue::CallbackTelemetryQueue(size_t capacity)
+    : _mask(std::bit_ceil(std::max<size_t>(capacity, 1)) - 1), _head(0), _dropped(0), _tail(0)
+{
+    _records = std::make_unique<CallbackRecord[]>(_mask + 1);
+}
+
+size_t CallbackTelemetryQueue::getCapacity() const
+{
+    return _mask + 1;
+}
+
+bool CallbackTelemetryQueue::push(const CallbackRecord &record)
+{
+    // only the producer writes _head
+    uint64_t head = _head.load(std::memory_order_relaxed);
+    if (head - _tail.load(std::memory_order_acquire) > _mask) {
+        _dropped.store(_dropped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        return false;
+    }
+
+    // the slot is ours until _head is published
+    _records[head & _mask] = record;
+    _head.store(head + 1, std::memory_order_release);
+    return true;
+}
+
+bool CallbackTelemetryQueue::pop(CallbackRecord &record)
+{
+    // only the consumer writes _tail
+    uint64_t tail = _tail.load(std::memory_order_relaxed);
+    if (tail == _head.load(std::memory_order_acquire)) {
+        return false;
+    }
+
+    // the slot is ours until _tail is published
+    record = _records[tail & _mask];
+    _tail.store(tail + 1, std::memory_order_release);
+    return true;
+}
+
+uint64_t CallbackTelemetryQueue::getDropped() const
+{
+    return _dropped.load(std::memory_order_relaxed);
+}
+
+// ** HISTOGRAM ** //
+
+Histogram::Histogram(double low, double high, size_t numBins)
+    : _low(low), _binWidth((high - low) / numBins), _bins(numBins)
+{
+    reset();
+}
+
+void Histogram::add(double value)
+{
+    if (value < _low) {
+        _below++;
+    } else {
+        size_t bin = (size_t)((value - _low) / _binWidth);
+        if (bin < _bins.size()) {
+            _bins[bin]++;
+        } else {
+            _above++;
+        }
+    }
+
+    _count++;
+    _sum += value;
+    _min = std::min(_min, value);
+    _max = std::max(_max, value);
+}
+
+void Histogram::reset()
+{
+    std::fill(_bins.begin(), _bins.end(), 0);
+    _below = 0;
+    _above = 0;
+    _count = 0;
+    _sum = 0.0;
+    _min = std::numeric_limits<double>::infinity();
+    _max = -std::numeric_limits<double>::infinity();
+}
+
+uint64_t Histogram::getCount() const
+{
+    return _count;
+}
+
+double Histogram::getMin() const
+{
+    return (_count > 0) ? _min : 0.0;
+}
+
+double Histogram::getMax() const
+{
+    return (_count > 0) ? _max : 0.0;
+}
+
+double Histogram::getMean() const
+{
+    return (_count > 0) ? _sum / _count : 0.0;
+}
+
+uint64_t Histogram::getBinCount(size_t bin) const
+{
+    return _bins[bin];
+}
+
+size_t Histogram::getNumBins() const
+{
+    return _bins.size();
+}
+
+uint64_t Histogram::getBelow() const
+{
+    return _below;
+}
+
+uint64_t Histogram::getAbove() const
+{
+    return _above;
+}
+
+double Histogram::getQuantile(double q) const
+{
+    if (_count == 0) {
+        return 0.0;
+    }
+
+    // the rank of the quantile, counting from 1
+    uint64_t rank = std::max<uint64_t>((uint64_t)std::ceil(q * _count), 1);
+
+    uint64_t cumulative = _below;
+    if (cumulative >= rank) {
+        return _low;
+    }
+    for (size_t bin = 0; bin < _bins.size(); ++bin) {
+        cumulative += _bins[bin];
+        if (cumulative >= rank) {
+            return std::min(_low + (bin + 1) * _binWidth, _max);
+        }
+    }
+    return _max;
+}
+
+// ** CALLBACK STATISTICS ** //
+
+CallbackStatistics::CallbackStatistics(double sampleFrequency)
+    : _sampleFrequency(sampleFrequency),
+      // +/- 10 ms by 0.25 ms
+      _jitter(-10e-3, 10e-3, 80),
+      // 0 - 1 ms by 25 us
+      _duration(0.0, 1e-3, 40),
+      _hasPrevious(false),
+      _previousCallbackTime(0.0),
+      _previousFrameCount(0)
+{
+    reset();
+}
+
+void CallbackStatistics::add(const CallbackRecord &record)
+{
+    if (_hasPrevious) {
+        double interval = record.callbackTime - _previousCallbackTime;
+        _jitter.add(interval - _previousFrameCount / _sampleFrequency);
+    }
+    _hasPrevious = true;
+    _previousCallbackTime = record.callbackTime;
+    _previousFrameCount = record.frameCount;
+
+    _duration.add(record.duration);
+
+    _callbacks++;
+    _frames += record.frameCount;
+    if (record.statusFlags & paInputOverflow) {
+        _inputOverflows++;
+    }
+    if (record.statusFlags & paInputUnderflow) {
+        _inputUnderflows++;
+    }
+    if (!record.coreKeptUp) {
+        _lateCallbacks++;
+    }
+}
+
+void CallbackStatistics::addSkippedFrames(uint64_t frames)
+{
+    _skippedFrames += frames;
+}
+
+void CallbackStatistics::reset()
+{
+    _jitter.reset();
+    _duration.reset();
+    _callbacks = 0;
+    _frames = 0;
+    _inputOverflows = 0;
+    _inputUnderflows = 0;
+    _lateCallbacks = 0;
+    _skippedFrames = 0;
+}
+
+const Histogram &CallbackStatistics::getJitter() const
+{
+    return _jitter;
+}
+
+const Histogram &CallbackStatistics::getDuration() const
+{
+    return _duration;
+}
+
+uint64_t CallbackStatistics::getCallbacks() const
+{
+    return _callbacks;
+}
+
+uint64_t CallbackStatistics::getFrames() const
+{
+    return _frames;
+}
+
+uint64_t CallbackStatistics::getInputOverflows() const
+{
+    return _inputOverflows;
+}
+
+uint64_t CallbackStatistics::getInputUnderflows() const
+{
+    return _inputUnderflows;
+}
+
+uint64_t CallbackStatistics::getLateCallbacks() const
+{
+    return _lateCallbacks;
+}
+
+uint64_t CallbackStatistics::getSkippedFrames() const
+{
+    return _skippedFrames;
+}
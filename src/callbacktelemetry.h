@@ -0,0 +1,190 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <vector>
+
+/// What the audio callback reports about one call.  Fixed-size, so that it can be queued without
+/// allocating.
+struct CallbackRecord
+{
+    /// The time the callback was called, as reported by PortAudio, in seconds
+    double callbackTime;
+
+    /// The time the ADC captured the first sample, as reported by PortAudio, in seconds
+    double adcTime;
+
+    /// The time spent in the callback, in seconds
+    double duration;
+
+    /// Number of frames delivered
+    uint32_t frameCount;
+
+    /// The PaStreamCallbackFlags of the call
+    uint32_t statusFlags;
+
+    /// Number of frames that were waiting for an analysis when the callback was called
+    uint64_t pendingFrames;
+
+    /// Whether the QPitchCore thread kept up with the samples delivered so far
+    bool coreKeptUp;
+};
+
+/// A wait-free single-producer, single-consumer queue of callback records.
+///
+/// Unlike SampleRing, a full queue drops the new records (and counts them) rather than the old
+/// ones: the consumer drains every record, so nothing is overwritten under its feet.  The producer
+/// index and the consumer index live on separate cache lines.
+class CallbackTelemetryQueue
+{
+public: // ** CONSTANTS ** //
+    /// Size of a cache line, to keep the indices of the two threads apart
+    static constexpr size_t CACHE_LINE_SIZE = 64;
+
+public: // ** PUBLIC METHODS ** //
+    /// Constructor.
+    ///
+    /// \param[in] capacity the maximum number of queued records, rounded up to a power of two
+    explicit CallbackTelemetryQueue(size_t capacity = 1024);
+
+    CallbackTelemetryQueue(const CallbackTelemetryQueue &) = delete;
+    CallbackTelemetryQueue &operator=(const CallbackTelemetryQueue &) = delete;
+
+    /// Maximum number of queued records.
+    size_t getCapacity() const;
+
+    /// Queue a record, or drop it if the queue is full.  Wait-free; call from the producer only.
+    ///
+    /// \return false if the record was dropped
+    bool push(const CallbackRecord &record);
+
+    /// Dequeue the oldest record.  Call from the consumer only.
+    ///
+    /// \return false if the queue is empty
+    bool pop(CallbackRecord &record);
+
+    /// Number of records dropped since the queue was created.
+    uint64_t getDropped() const;
+
+private:
+    /// The records
+    std::unique_ptr<CallbackRecord[]> _records;
+
+    /// _capacity - 1
+    size_t _mask;
+
+    /// Number of records pushed (producer)
+    alignas(CACHE_LINE_SIZE) std::atomic<uint64_t> _head;
+
+    /// Number of records dropped (producer)
+    std::atomic<uint64_t> _dropped;
+
+    /// Number of records popped (consumer)
+    alignas(CACHE_LINE_SIZE) std::atomic<uint64_t> _tail;
+};
+
+/// A histogram with evenly spaced bins, plus the values below and above its range.
+class Histogram
+{
+public:
+    /// Constructor.
+    ///
+    /// \param[in] low the lower edge of the first bin
+    /// \param[in] high the upper edge of the last bin
+    /// \param[in] numBins the number of bins
+    Histogram(double low, double high, size_t numBins);
+
+    /// Count a value.
+    void add(double value);
+
+    /// Forget all the values.
+    void reset();
+
+    uint64_t getCount() const;
+    double getMin() const;
+    double getMax() const;
+    double getMean() const;
+
+    /// Number of values in a bin.
+    uint64_t getBinCount(size_t bin) const;
+    size_t getNumBins() const;
+
+    /// Number of values below the lower edge, or at or above the upper edge.
+    uint64_t getBelow() const;
+    uint64_t getAbove() const;
+
+    /// An upper bound of the given quantile: the upper edge of the bin that contains it (or the
+    /// maximum if it is above the range).
+    ///
+    /// \param[in] q the quantile, in [0, 1]
+    double getQuantile(double q) const;
+
+private:
+    double _low;
+    double _binWidth;
+    std::vector<uint64_t> _bins;
+    uint64_t _below;
+    uint64_t _above;
+
+    uint64_t _count;
+    double _sum;
+    double _min;
+    double _max;
+};
+
+/// Histograms and counters of the audio callback, built from its records.
+class CallbackStatistics
+{
+public:
+    /// Constructor.
+    ///
+    /// \param[in] sampleFrequency the sample rate of the stream, to know when callbacks are due
+    explicit CallbackStatistics(double sampleFrequency = 44100.0);
+
+    /// Account for one record.
+    void add(const CallbackRecord &record);
+
+    /// Account for frames that were never part of an analysed frame.
+    void addSkippedFrames(uint64_t frames);
+
+    /// Forget the statistics, except the time of the last callback.
+    void reset();
+
+    /// Deviation of the time between two callbacks from the duration of the frames of the
+    /// first one, in seconds.
+    const Histogram &getJitter() const;
+
+    /// Time spent in the callback, in seconds.
+    const Histogram &getDuration() const;
+
+    uint64_t getCallbacks() const;
+    uint64_t getFrames() const;
+    uint64_t getInputOverflows() const;
+    uint64_t getInputUnderflows() const;
+
+    /// Number of callbacks that found that the QPitchCore thread had not kept up.
+    uint64_t getLateCallbacks() const;
+
+    /// Number of frames that were never part of an analysed frame.
+    uint64_t getSkippedFrames() const;
+
+private:
+    double _sampleFrequency;
+
+    Histogram _jitter;
+    Histogram _duration;
+
+    uint64_t _callbacks;
+    uint64_t _frames;
+    uint64_t _inputOverflows;
+    uint64_t _inputUnderflows;
+    uint64_t _lateCallbacks;
+    uint64_t _skippedFrames;
+
+    /// Whether there was a callback before, to measure the interval from
+    bool _hasPrevious;
+    double _previousCallbackTime;
+    uint32_t _previousFrameCount;
+};
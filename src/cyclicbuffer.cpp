@@ -1,7 +1,7 @@
 #include "cyclicbuffer.h"
 
 #include <cstring>
-#include <QtAssert>
+#include <cassert>
 
 CyclicBuffer::CyclicBuffer(size_t capacity) : _capacity(capacity)
 {
@@ -46,7 +46,7 @@ size_t CyclicBuffer::copyLastBytes(unsigned char *dst, size_t len) const
         memcpy(dst, &_buffer[_cursor - truncatedLen], truncatedLen);
     } else {
         // If truncatedLen > _cursor, we must have more than _cursor bytes.
-        Q_ASSERT(_filledOnce);
+        assert(_filledOnce);
         size_t rightLen = truncatedLen - _cursor;
         size_t rightStart = _capacity - rightLen;
         memcpy(dst, &_buffer[rightStart], rightLen);
@@ -0,0 +1,53 @@
+#include "detectorpool.h"
+
+#include <algorithm>
+#include <cassert>
+
+template <class Real>
+const size_t PitchDetectorPool<Real>::MAX_IDLE_DETECTORS = 2;
+
+template <class Real>
+std::unique_ptr<PitchDetector<Real>>
+PitchDetectorPool<Real>::acquire(const PitchDetectorConfig &config, bool *reused)
+{
+    auto it = std::find_if(_idle.begin(), _idle.end(),
+                           [&config](const Entry &entry) { return entry.config == config; });
+    if (reused != nullptr) {
+        *reused = it != _idle.end();
+    }
+
+    if (it != _idle.end()) {
+        std::unique_ptr<PitchDetector<Real>> detector = std::move(it->detector);
+        _idle.erase(it);
+        detector->reset();
+        return detector;
+    }
+    return PitchDetector<Real>::create(config.engine, config.sampleFrequency, config.fftFrameSize,
+                                       config.zeroPaddingFactor, config.peakInterpolation);
+}
+
+template <class Real>
+void PitchDetectorPool<Real>::release(const PitchDetectorConfig &config,
+                                      std::unique_ptr<PitchDetector<Real>> detector)
+{
+    assert(detector);
+    _idle.push_back(Entry{ config, std::move(detector) });
+    if (_idle.size() > MAX_IDLE_DETECTORS) {
+        _idle.erase(_idle.begin(), _idle.end() - MAX_IDLE_DETECTORS);
+    }
+}
+
+template <class Real>
+size_t PitchDetectorPool<Real>::getIdleCount() const
+{
+    return _idle.size();
+}
+
+template <class Real>
+void PitchDetectorPool<Real>::clear()
+{
+    _idle.clear();
+}
+
+template class PitchDetectorPool<double>;
+template class PitchDetectorPool<float>;
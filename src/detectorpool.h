@@ -0,0 +1,62 @@
+#pragma once
+
+#include "pitchdetection.h"
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+/// Everything a pitch detector is created from.
+struct PitchDetectorConfig
+{
+    PitchDetectorEngine engine;
+    uint32_t sampleFrequency;
+    size_t fftFrameSize;
+    int zeroPaddingFactor;
+    PeakInterpolation peakInterpolation;
+
+    bool operator==(const PitchDetectorConfig &other) const = default;
+};
+
+/// Pitch detectors that were used recently, kept for when their configuration is chosen again.
+///
+/// A detector owns megabytes of buffers and FFTW plans that took a while to measure, so when the
+/// options go back to a previous configuration the pool hands out the detector of that
+/// configuration instead of allocating and planning again: its memory is warm and its plans are
+/// the measured ones.  The least recently released detectors are freed beyond
+/// MAX_IDLE_DETECTORS.
+///
+/// Not thread-safe: the pool belongs to the thread that runs the detectors.
+template <class Real>
+class PitchDetectorPool
+{
+public:
+    /// Number of detectors kept besides the ones in use
+    static const size_t MAX_IDLE_DETECTORS;
+
+    /// Take the detector of the configuration out of the pool, or create one.
+    ///
+    /// \param[out] reused set to whether the detector came from the pool, if not nullptr
+    std::unique_ptr<PitchDetector<Real>> acquire(const PitchDetectorConfig &config,
+                                                 bool *reused = nullptr);
+
+    /// Give a detector created from config back to the pool.  It is reset() when it is acquired
+    /// again.  The detector must not be null: a detector dropped by its owner is not reused.
+    void release(const PitchDetectorConfig &config, std::unique_ptr<PitchDetector<Real>> detector);
+
+    /// Number of detectors in the pool.
+    size_t getIdleCount() const;
+
+    /// Free every detector in the pool.
+    void clear();
+
+private:
+    struct Entry
+    {
+        PitchDetectorConfig config;
+        std::unique_ptr<PitchDetector<Real>> detector;
+    };
+
+    /// The idle detectors, the most recently released last
+    std::vector<Entry> _idle;
+};
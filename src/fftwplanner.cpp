@@ -0,0 +1,128 @@
+#include "fftwplanner.h"
+
+#include "pitchdetection.h"
+
+#include "fftwtraits.h"
+
+std::mutex &FFTWPlanner::mutex()
+{
+    static std::mutex plannerMutex;
+    return plannerMutex;
+}
+
+template <class Real>
+std::string &FFTWPlanner::wisdomPath()
+{
+    static std::string path;
+    return path;
+}
+
+template <class Real>
+bool FFTWPlanner::loadWisdom(const std::string &path)
+{
+    std::lock_guard<std::mutex> plannerLocker(mutex());
+    wisdomPath<Real>() = path;
+    return FFTWTraits<Real>::importWisdom(path.c_str());
+}
+
+template <class Real>
+bool FFTWPlanner::saveWisdom()
+{
+    std::lock_guard<std::mutex> plannerLocker(mutex());
+    const std::string &path = wisdomPath<Real>();
+    if (path.empty()) {
+        return false;
+    }
+    return FFTWTraits<Real>::exportWisdom(path.c_str());
+}
+
+template bool FFTWPlanner::loadWisdom<double>(const std::string &path);
+template bool FFTWPlanner::loadWisdom<float>(const std::string &path);
+template bool FFTWPlanner::saveWisdom<double>();
+template bool FFTWPlanner::saveWisdom<float>();
+
+template <class Real>
+PlanRefiner<Real>::PlanRefiner(bool patient, double timeLimit)
+    : _patient(patient), _timeLimit(timeLimit), _stopRequested(false)
+{
+    _thread = std::thread(&PlanRefiner<Real>::run, this);
+}
+
+template <class Real>
+PlanRefiner<Real>::~PlanRefiner()
+{
+    {
+        std::lock_guard<std::mutex> locker(_mutex);
+        _stopRequested = true;
+        _pending.reset();
+        _cond.notify_one();
+    }
+    _thread.join();
+}
+
+template <class Real>
+void PlanRefiner<Real>::request(size_t fftFrameSize, size_t outFrameSize,
+                                std::shared_ptr<PitchDetectionPlanSlot<Real>> slot)
+{
+    std::lock_guard<std::mutex> locker(_mutex);
+    _pending = Request{ fftFrameSize, outFrameSize, std::move(slot) };
+    _cond.notify_one();
+}
+
+template <class Real>
+bool PlanRefiner<Real>::isPatient() const
+{
+    return _patient;
+}
+
+template <class Real>
+void PlanRefiner<Real>::run()
+{
+    std::unique_lock<std::mutex> locker(_mutex);
+    while (true) {
+        _cond.wait(locker, [this]() { return _stopRequested || _pending.has_value(); });
+        if (_stopRequested) {
+            break;
+        }
+
+        Request request = std::move(_pending.value());
+        _pending.reset();
+        locker.unlock();
+
+        if (refine(request, FFTW_MEASURE) && _patient) {
+            // only go on if no other context has been requested in the meantime
+            locker.lock();
+            bool superseded = _stopRequested || _pending.has_value();
+            locker.unlock();
+            if (!superseded) {
+                refine(request, FFTW_PATIENT);
+            }
+        }
+
+        locker.lock();
+    }
+}
+
+template <class Real>
+bool PlanRefiner<Real>::refine(const Request &request, unsigned rigor)
+{
+    // the slot is only referenced by us if the context has been destroyed
+    if (request.slot.use_count() == 1) {
+        return false;
+    }
+
+    std::unique_ptr<PitchDetectionPlans<Real>> plans = PitchDetectionPlans<Real>::create(
+            request.fftFrameSize, request.outFrameSize,
+            rigor == FFTW_PATIENT ? PlanSource::Patient : PlanSource::Measure, 1, _timeLimit);
+
+    if (!plans) {
+        return false;
+    }
+
+    request.slot->offer(std::move(plans));
+    FFTWPlanner::saveWisdom<Real>();
+    return request.slot.use_count() > 1;
+}
+
+template class PlanRefiner<double>;
+template class PlanRefiner<float>;
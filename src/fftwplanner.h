@@ -0,0 +1,103 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+
+template <class Real>
+struct PitchDetectionPlanSlot;
+
+/// Global state of the FFTW planner.
+///
+/// Only fftw_execute and its new-array variants are thread-safe in FFTW.  Every other call into
+/// FFTW (creating or destroying plans, importing or exporting wisdom) must hold the planner mutex.
+class FFTWPlanner
+{
+public:
+    /// The mutex serializing all calls into the FFTW planner.
+    static std::mutex &mutex();
+
+    /// Load FFTW wisdom of the precision of Real from a file and remember the file for
+    /// saveWisdom().
+    ///
+    /// \return true if the wisdom was loaded, false if the file is missing or invalid
+    template <class Real>
+    static bool loadWisdom(const std::string &path);
+
+    /// Save the accumulated FFTW wisdom of the precision of Real to the file given to
+    /// loadWisdom().
+    ///
+    /// \return true if the wisdom was saved
+    template <class Real>
+    static bool saveWisdom();
+
+private:
+    /// The wisdom file of the precision of Real, empty until loadWisdom() is called
+    template <class Real>
+    static std::string &wisdomPath();
+};
+
+/// Background thread that replaces the FFTW_ESTIMATE plans of pitch detection contexts with
+/// measured ones.
+///
+/// Measuring plans takes from a fraction of a second to several seconds, so contexts start with
+/// plans from the wisdom or FFTW_ESTIMATE, and the refiner builds FFTW_MEASURE (and optionally
+/// FFTW_PATIENT) plans for the same sizes in the background.  The finished plans are offered to
+/// the context through its plan slot, and the context swaps them in between frames.  The wisdom
+/// file is saved after each measured plan, so the next start (or the next time the same sizes are
+/// chosen) gets measured plans immediately.
+template <class Real>
+class PlanRefiner
+{
+public:
+    /// Constructor.  Starts the worker thread.
+    ///
+    /// \param[in] patient also build FFTW_PATIENT plans after the FFTW_MEASURE ones
+    /// \param[in] timeLimit upper bound in seconds for each planning step
+    explicit PlanRefiner(bool patient = false, double timeLimit = 2.0);
+
+    /// Destructor.  Waits for the current planning step to finish and stops the worker thread.
+    ~PlanRefiner();
+
+    /// Request measured plans for a context.  A pending request that has not been started yet is
+    /// replaced, since only the latest context matters.
+    ///
+    /// \param[in] fftFrameSize the frame size of the context
+    /// \param[in] outFrameSize the size of the IFFT of the context
+    /// \param[in] slot the plan slot of the context
+    void request(size_t fftFrameSize, size_t outFrameSize,
+                 std::shared_ptr<PitchDetectionPlanSlot<Real>> slot);
+
+    /// Whether FFTW_PATIENT plans are built after the FFTW_MEASURE ones.
+    bool isPatient() const;
+
+private:
+    struct Request
+    {
+        size_t fftFrameSize;
+        size_t outFrameSize;
+        std::shared_ptr<PitchDetectionPlanSlot<Real>> slot;
+    };
+
+    /// Main loop of the worker thread.
+    void run();
+
+    /// Build plans at the given FFTW rigor and offer them to the slot.
+    ///
+    /// \return false if the context no longer exists
+    bool refine(const Request &request, unsigned rigor);
+
+    bool _patient;
+    double _timeLimit;
+
+    std::mutex _mutex;
+    std::condition_variable _cond;
+    std::optional<Request> _pending;
+    bool _stopRequested;
+
+    std::thread _thread;
+};
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <cstddef>
+#include <fftw3.h>
+
+/// Thin wrappers that select the double (fftw_*) or single precision (fftwf_*) FFTW API from the
+/// real type, so that the analysis code can be written once for both precisions.
+template <class Real>
+struct FFTWTraits;
+
+template <>
+struct FFTWTraits<double>
+{
+    using Complex = fftw_complex;
+    using Plan = fftw_plan;
+
+    /// Name of the wisdom file, which is specific to the precision.
+    static constexpr const char *WISDOM_FILE_NAME = "fftw-wisdom";
+
+    static double *allocReal(size_t n) { return (double *)fftw_malloc(sizeof(double) * n); }
+    static Complex *allocComplex(size_t n) { return (Complex *)fftw_malloc(sizeof(Complex) * n); }
+    static void free(void *p) { fftw_free(p); }
+
+    static Plan planR2C(int n, double *in, Complex *out, unsigned flags)
+    {
+        return fftw_plan_dft_r2c_1d(n, in, out, flags);
+    }
+    static Plan planC2R(int n, Complex *in, double *out, unsigned flags)
+    {
+        return fftw_plan_dft_c2r_1d(n, in, out, flags);
+    }
+    /// howMany r2c transforms of size n, of consecutive arrays of n reals to consecutive arrays
+    /// of n / 2 + 1 complex numbers.
+    static Plan planManyR2C(int n, int howMany, double *in, Complex *out, unsigned flags)
+    {
+        return fftw_plan_many_dft_r2c(1, &n, howMany, in, nullptr, 1, n, out, nullptr, 1,
+                                      n / 2 + 1, flags);
+    }
+    /// howMany c2r transforms of size n, of consecutive arrays of n / 2 + 1 complex numbers to
+    /// consecutive arrays of n reals.
+    static Plan planManyC2R(int n, int howMany, Complex *in, double *out, unsigned flags)
+    {
+        return fftw_plan_many_dft_c2r(1, &n, howMany, in, nullptr, 1, n / 2 + 1, out, nullptr,
+                                      1, n, flags);
+    }
+    static void executeR2C(Plan plan, double *in, Complex *out)
+    {
+        fftw_execute_dft_r2c(plan, in, out);
+    }
+    static void executeC2R(Plan plan, Complex *in, double *out)
+    {
+        fftw_execute_dft_c2r(plan, in, out);
+    }
+    static void destroyPlan(Plan plan) { fftw_destroy_plan(plan); }
+
+    static bool importWisdom(const char *path) { return fftw_import_wisdom_from_filename(path); }
+    static bool exportWisdom(const char *path) { return fftw_export_wisdom_to_filename(path); }
+    static void setTimeLimit(double seconds) { fftw_set_timelimit(seconds); }
+};
+
+template <>
+struct FFTWTraits<float>
+{
+    using Complex = fftwf_complex;
+    using Plan = fftwf_plan;
+
+    /// Name of the wisdom file, which is specific to the precision.
+    static constexpr const char *WISDOM_FILE_NAME = "fftwf-wisdom";
+
+    static float *allocReal(size_t n) { return (float *)fftwf_malloc(sizeof(float) * n); }
+    static Complex *allocComplex(size_t n) { return (Complex *)fftwf_malloc(sizeof(Complex) * n); }
+    static void free(void *p) { fftwf_free(p); }
+
+    static Plan planR2C(int n, float *in, Complex *out, unsigned flags)
+    {
+        return fftwf_plan_dft_r2c_1d(n, in, out, flags);
+    }
+    static Plan planC2R(int n, Complex *in, float *out, unsigned flags)
+    {
+        return fftwf_plan_dft_c2r_1d(n, in, out, flags);
+    }
+    /// howMany r2c transforms of size n, of consecutive arrays of n reals to consecutive arrays
+    /// of n / 2 + 1 complex numbers.
+    static Plan planManyR2C(int n, int howMany, float *in, Complex *out, unsigned flags)
+    {
+        return fftwf_plan_many_dft_r2c(1, &n, howMany, in, nullptr, 1, n, out, nullptr, 1,
+                                       n / 2 + 1, flags);
+    }
+    /// howMany c2r transforms of size n, of consecutive arrays of n / 2 + 1 complex numbers to
+    /// consecutive arrays of n reals.
+    static Plan planManyC2R(int n, int howMany, Complex *in, float *out, unsigned flags)
+    {
+        return fftwf_plan_many_dft_c2r(1, &n, howMany, in, nullptr, 1, n / 2 + 1, out, nullptr,
+                                       1, n, flags);
+    }
+    static void executeR2C(Plan plan, float *in, Complex *out)
+    {
+        fftwf_execute_dft_r2c(plan, in, out);
+    }
+    static void executeC2R(Plan plan, Complex *in, float *out)
+    {
+        fftwf_execute_dft_c2r(plan, in, out);
+    }
+    static void destroyPlan(Plan plan) { fftwf_destroy_plan(plan); }
+
+    static bool importWisdom(const char *path) { return fftwf_import_wisdom_from_filename(path); }
+    static bool exportWisdom(const char *path) { return fftwf_export_wisdom_to_filename(path); }
+    static void setTimeLimit(double seconds) { fftwf_set_timelimit(seconds); }
+};
+
+/// The real type used by the analysis, selected with the QPITCH_SINGLE_PRECISION CMake option.
+#ifdef QPITCH_SINGLE_PRECISION
+using AnalysisReal = float;
+#else
+using AnalysisReal = double;
+#endif
@@ -3,6 +3,7 @@
 #include <QString>
 #include <QDebug>
 #include <QtLogging>
+#include <algorithm>
 
 FPSProfiler::FPSProfiler(const char *title, bool printLog) : title(title), printLog(printLog) { }
 
@@ -36,3 +37,49 @@ double FPSProfiler::getFPS()
 {
     return curFPS;
 }
+
+DurationProfiler::DurationProfiler(double reportIntervalS) : reportIntervalS(reportIntervalS) { }
+
+bool DurationProfiler::record(double durationS)
+{
+    TimePointType now = ClockType::now();
+
+    if (!started) {
+        started = true;
+        intervalStart = now;
+    }
+
+    count++;
+    total += durationS;
+    max = std::max(max, durationS);
+
+    double elapsedS = std::chrono::duration<double>(now - intervalStart).count();
+    if (elapsedS < reportIntervalS) {
+        return false;
+    }
+
+    reportedCount = count;
+    reportedAverage = total / count;
+    reportedMax = max;
+
+    intervalStart = now;
+    count = 0;
+    total = 0.0;
+    max = 0.0;
+    return true;
+}
+
+uint64_t DurationProfiler::getCount() const
+{
+    return reportedCount;
+}
+
+double DurationProfiler::getAverage() const
+{
+    return reportedAverage;
+}
+
+double DurationProfiler::getMax() const
+{
+    return reportedMax;
+}
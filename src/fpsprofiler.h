@@ -1,6 +1,7 @@
 #pragma once
 
 #include <chrono>
+#include <cstdint>
 
 class FPSProfiler
 {
@@ -21,3 +22,38 @@ private:
     uint64_t tickCount = 0;
     double curFPS = 0.0;
 };
+
+/// Accumulates the durations of a repeated operation over fixed reporting intervals.
+class DurationProfiler
+{
+public:
+    DurationProfiler(double reportIntervalS = 5.0);
+
+    /// Record the duration of one operation.
+    ///
+    /// \return true if a reporting interval has just completed, in which case the getters return
+    /// the statistics of that interval
+    bool record(double durationS);
+
+    uint64_t getCount() const;
+    double getAverage() const;
+    double getMax() const;
+
+private:
+    using ClockType = std::chrono::steady_clock;
+    using TimePointType = std::chrono::time_point<ClockType>;
+
+    double reportIntervalS;
+    bool started = false;
+    TimePointType intervalStart;
+
+    // statistics of the current interval
+    uint64_t count = 0;
+    double total = 0.0;
+    double max = 0.0;
+
+    // statistics of the last completed interval
+    uint64_t reportedCount = 0;
+    double reportedAverage = 0.0;
+    double reportedMax = 0.0;
+};
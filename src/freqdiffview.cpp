@@ -1,37 +1,40 @@
 #include "freqdiffview.h"
 
 #include <QPainter>
+#include <QRegion>
 
-FreqDiffView::FreqDiffView(QWidget *parent) : QWidget(parent) { }
+const double FreqDiffView::DIRTY_MARGIN = 2.0;
+
+FreqDiffView::FreqDiffView(QWidget *parent) : QWidget(parent), _staticLayerValid(false)
+{
+    // the background covers the whole widget
+    setAttribute(Qt::WA_OpaquePaintEvent);
+}
 
 void FreqDiffView::setEstimatedNote(std::optional<EstimatedNote> estimatedNote)
 {
+    // two thin strips, rather than everything between them
+    QRegion dirtyRegion = QRegion(lineRect(_estimatedNote)) + QRegion(lineRect(estimatedNote));
     _estimatedNote = estimatedNote;
+    if (!dirtyRegion.isEmpty()) {
+        update(dirtyRegion);
+    }
 }
 
-void FreqDiffView::paintEvent(QPaintEvent *event)
+void FreqDiffView::paintEvent(QPaintEvent * /* event */)
 {
+    // The window may have moved to a screen with another device pixel ratio.
+    if (!_staticLayerValid || _staticLayer.devicePixelRatio() != devicePixelRatioF()) {
+        renderStaticLayer();
+    }
+
     QPainter painter(this);
+    painter.drawPixmap(0, 0, _staticLayer);
     painter.setRenderHint(QPainter::Antialiasing);
 
     QRectF rect = QWidget::rect();
     QPointF center = rect.center();
 
-    QBrush brushBg(Qt::BrushStyle::SolidPattern);
-    brushBg.setColor(qRgb(255, 255, 128));
-
-    painter.setPen(Qt::NoPen);
-    painter.setBrush(brushBg);
-    painter.drawRect(rect);
-
-    QPen penCenter;
-    penCenter.setColor(QColor::fromRgb(qRgb(0, 0, 0)));
-    penCenter.setStyle(Qt::PenStyle::SolidLine);
-    penCenter.setWidthF(1.0);
-
-    painter.setPen(penCenter);
-    painter.drawLine(QPointF(center.x(), rect.top()), QPointF(center.x(), rect.bottom()));
-
     if (_estimatedNote) {
         const EstimatedNote &estimatedNote = _estimatedNote.value();
         double estX = center.x() + rect.width() * estimatedNote.currentPitchDeviation;
@@ -46,7 +49,52 @@ void FreqDiffView::paintEvent(QPaintEvent *event)
     }
 }
 
+void FreqDiffView::resizeEvent(QResizeEvent *event)
+{
+    _staticLayerValid = false;
+    QWidget::resizeEvent(event);
+}
+
 QSize FreqDiffView::minimumSizeHint() const
 {
     return QSize(100, 50);
 }
+
+void FreqDiffView::renderStaticLayer()
+{
+    const qreal devicePixelRatio = devicePixelRatioF();
+    _staticLayer = QPixmap(size() * devicePixelRatio);
+    _staticLayer.setDevicePixelRatio(devicePixelRatio);
+
+    // every pixel, as the widget is opaque
+    _staticLayer.fill(QColor::fromRgb(qRgb(255, 255, 128)));
+
+    QPainter painter(&_staticLayer);
+    painter.setRenderHint(QPainter::Antialiasing);
+
+    QRectF rect = QWidget::rect();
+    QPointF center = rect.center();
+
+    QPen penCenter;
+    penCenter.setColor(QColor::fromRgb(qRgb(0, 0, 0)));
+    penCenter.setStyle(Qt::PenStyle::SolidLine);
+    penCenter.setWidthF(1.0);
+
+    painter.setPen(penCenter);
+    painter.drawLine(QPointF(center.x(), rect.top()), QPointF(center.x(), rect.bottom()));
+    painter.end();
+
+    _staticLayerValid = true;
+}
+
+QRect FreqDiffView::lineRect(const std::optional<EstimatedNote> &estimatedNote) const
+{
+    if (!estimatedNote) {
+        return QRect();
+    }
+    QRectF rect = QWidget::rect();
+    double estX = rect.center().x() + rect.width() * estimatedNote->currentPitchDeviation;
+    return QRectF(QPointF(estX - DIRTY_MARGIN, rect.top()),
+                  QPointF(estX + DIRTY_MARGIN, rect.bottom()))
+            .toAlignedRect();
+}
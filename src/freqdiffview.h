@@ -2,9 +2,15 @@
 
 #include "notes.h"
 
+#include <QPixmap>
+#include <QRect>
 #include <QWidget>
 #include <QSize>
 
+/// The deviation from the closest note, as a red line off the center.
+///
+/// The background and the center line are rendered once into a pixmap for each size, and a new
+/// estimated note only repaints the old and the new line.
 class FreqDiffView : public QWidget
 {
     Q_OBJECT
@@ -15,8 +21,24 @@ public:
 
 protected:
     virtual void paintEvent(QPaintEvent *event) override;
+    virtual void resizeEvent(QResizeEvent *event) override;
     QSize minimumSizeHint() const override;
 
 private:
+    /// Pixels around the line repainted with it, for the antialiasing
+    static const double DIRTY_MARGIN;
+
+    /// Render the background and the center line into _staticLayer.
+    void renderStaticLayer();
+
+    /// The area of the line of a note.
+    QRect lineRect(const std::optional<EstimatedNote> &estimatedNote) const;
+
     std::optional<EstimatedNote> _estimatedNote;
+
+    /// The background and the center line, at the device pixel ratio of the widget
+    QPixmap _staticLayer;
+
+    /// Set to false when _staticLayer must be rendered again
+    bool _staticLayerValid;
 };
@@ -78,16 +78,112 @@ $ make</pre>
 */
 
 #include <QApplication>
+#include <QCommandLineParser>
 
+#include "audiosource.h"
 #include "qpitch.h"
 
 int main(int argc, char *argv[])
 {
     // ** CREATE QT APPLICATION ** //
     QApplication app(argc, argv);
+    QApplication::setApplicationName("qpitch");
+
+    // ** PARSE THE COMMAND LINE ** //
+    // The audio source can be replaced by a WAV file or by raw samples on the standard input, to
+    // run repeatable tests without a sound card (use QT_QPA_PLATFORM=offscreen without a display).
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Simple chromatic tuner");
+    parser.addHelpOption();
+    QCommandLineOption sourceOption("source",
+                                    "Where the samples come from: portaudio (the default input "
+                                    "device), wav (--file), stdin (raw mono samples) or "
+                                    "generator (--signal).",
+                                    "source", audioSourceKindName(AudioSourceKind::PortAudio));
+    QCommandLineOption fileOption("file", "The WAV file to analyse.  Implies --source wav.",
+                                  "path");
+    QCommandLineOption formatOption("format", "The format of the samples on stdin: f32 or s16.",
+                                    "format", pcmFormatName(PcmFormat::Float32));
+    QCommandLineOption rateOption(
+            "rate", "The sample rate of the samples on stdin.  Defaults to the settings.", "Hz");
+    QCommandLineOption fastOption(
+            "fast", "Deliver the samples of the file or stdin as fast as possible, rather than "
+                    "at their sample rate.");
+    QCommandLineOption loopOption("loop", "Start the WAV file over when it ends.");
+    QCommandLineOption listDevicesOption(
+            "list-devices", "Log the PortAudio host APIs and devices when the stream opens.");
+    QCommandLineOption signalOption(
+            "signal",
+            "The synthetic signal, as comma-separated key=value pairs: freq, amp, harmonics, "
+            "rolloff, inharmonicity, sweep=<Hz>:<s>, vibrato=<Hz>:<cents>, decay=<s>, pluck=<s>, "
+            "noise=<white|pink>:<SNR dB>, seed.  Implies --source generator.",
+            "spec");
+    parser.addOptions({ sourceOption, fileOption, formatOption, rateOption, fastOption, loopOption,
+                        listDevicesOption, signalOption });
+    parser.process(app);
+
+    AudioSourceOptions sourceOptions;
+    {
+        QString source = parser.value(sourceOption);
+        if (!parser.isSet(sourceOption) && parser.isSet(fileOption)) {
+            source = audioSourceKindName(AudioSourceKind::WavFile);
+        } else if (!parser.isSet(sourceOption) && parser.isSet(signalOption)) {
+            source = audioSourceKindName(AudioSourceKind::Generator);
+        }
+        bool found = false;
+        for (AudioSourceKind kind : { AudioSourceKind::PortAudio, AudioSourceKind::WavFile,
+                                      AudioSourceKind::Stdin, AudioSourceKind::Generator }) {
+            if (source == audioSourceKindName(kind)) {
+                sourceOptions.kind = kind;
+                found = true;
+            }
+        }
+        if (!found) {
+            qCritical("Unknown audio source: %s", qPrintable(source));
+            return 1;
+        }
+        if (sourceOptions.kind == AudioSourceKind::WavFile && !parser.isSet(fileOption)) {
+            qCritical("--source wav needs --file");
+            return 1;
+        }
+        sourceOptions.path = parser.value(fileOption);
+
+        QString format = parser.value(formatOption);
+        if (format == pcmFormatName(PcmFormat::Float32)) {
+            sourceOptions.pcmFormat = PcmFormat::Float32;
+        } else if (format == pcmFormatName(PcmFormat::Int16)) {
+            sourceOptions.pcmFormat = PcmFormat::Int16;
+        } else {
+            qCritical("Unknown sample format: %s", qPrintable(format));
+            return 1;
+        }
+
+        if (parser.isSet(rateOption)) {
+            bool ok = false;
+            sourceOptions.sampleFrequency = parser.value(rateOption).toUInt(&ok);
+            if (!ok || sourceOptions.sampleFrequency == 0) {
+                qCritical("Invalid sample rate: %s", qPrintable(parser.value(rateOption)));
+                return 1;
+            }
+        }
+
+        std::string error;
+        std::optional<SignalParameters> signal =
+                SignalParameters::parse(parser.value(signalOption).toStdString(), &error);
+        if (!signal) {
+            qCritical("%s", error.c_str());
+            return 1;
+        }
+        sourceOptions.signal = *signal;
+
+        sourceOptions.realTime = !parser.isSet(fastOption);
+        sourceOptions.loop = parser.isSet(loopOption);
+        sourceOptions.listDevices = parser.isSet(listDevicesOption);
+    }
 
     // ** OPEN MAIN WINDOW ** //
-    QPitch *qpitch = new QPitch();
+    // The audio input is opened in the background: errors are reported by QPitch.
+    QPitch *qpitch = new QPitch(sourceOptions);
     qpitch->show();
 
     // ** GIVE CONTROL TO QT ** //
@@ -1,29 +1,31 @@
 #include "notes.h"
 
-#include <QString>
+#include <cassert>
+#include <cmath>
 
 // ** MUSICAL NOTATIONS ** //
-const QString NoteLabel[6][12] = {
-    { "A", QString("A%1").arg(QChar(0x266F)), "B", "C", QString("C%1").arg(QChar(0x266F)), "D",
-      QString("D%1").arg(QChar(0x266F)), "E", "F", QString("F%1").arg(QChar(0x266F)), "G",
-      QString("G%1").arg(QChar(0x266F)) }, /* US  */
-    { "A", QString("B%1").arg(QChar(0x266D)), "B", "C", QString("D%1").arg(QChar(0x266D)), "D",
-      QString("E%1").arg(QChar(0x266D)), "E", "F", QString("G%1").arg(QChar(0x266D)), "G",
-      QString("A%1").arg(QChar(0x266D)) }, /* US alternate */
-    { "La", QString("La%1").arg(QChar(0x266F)), "Si", "Do", QString("Do%1").arg(QChar(0x266F)),
-      "Re", QString("Re%1").arg(QChar(0x266F)), "Mi", "Fa", QString("Fa%1").arg(QChar(0x266F)),
-      "Sol", QString("Sol%1").arg(QChar(0x266F)) }, /* French */
-    { "La", QString("Si%1").arg(QChar(0x266D)), "Si", "Do", QString("Re%1").arg(QChar(0x266D)),
-      "Re", QString("Mi%1").arg(QChar(0x266D)), "Mi", "Fa", QString("Sol%1").arg(QChar(0x266D)),
-      "Sol", QString("La%1").arg(QChar(0x266D)) }, /* French alternate */
-    { "A", "B", "H", "C", QString("C%1").arg(QChar(0x266F)), "D", QString("D%1").arg(QChar(0x266F)),
-      "E", "F", QString("F%1").arg(QChar(0x266F)), "G",
-      QString("G%1").arg(QChar(0x266F)) }, /* German */
-    { "A", "B", "H", "C", QString("D%1").arg(QChar(0x266D)), "D", QString("E%1").arg(QChar(0x266D)),
-      "E", "F", QString("G%1").arg(QChar(0x266D)), "G",
-      QString("A%1").arg(QChar(0x266D)) } /* German alternate */
+// The labels are UTF-8, with the sharp and flat signs.
+#define SHARP "\xE2\x99\xAF" /* U+266F */
+#define FLAT "\xE2\x99\xAD"  /* U+266D */
+
+static const char *const NoteLabel[6][12] = {
+    { "A", "A" SHARP, "B", "C", "C" SHARP, "D", "D" SHARP, "E", "F", "F" SHARP, "G",
+      "G" SHARP }, /* US  */
+    { "A", "B" FLAT, "B", "C", "D" FLAT, "D", "E" FLAT, "E", "F", "G" FLAT, "G",
+      "A" FLAT }, /* US alternate */
+    { "La", "La" SHARP, "Si", "Do", "Do" SHARP, "Re", "Re" SHARP, "Mi", "Fa", "Fa" SHARP, "Sol",
+      "Sol" SHARP }, /* French */
+    { "La", "Si" FLAT, "Si", "Do", "Re" FLAT, "Re", "Mi" FLAT, "Mi", "Fa", "Sol" FLAT, "Sol",
+      "La" FLAT }, /* French alternate */
+    { "A", "B", "H", "C", "C" SHARP, "D", "D" SHARP, "E", "F", "F" SHARP, "G",
+      "G" SHARP }, /* German */
+    { "A", "B", "H", "C", "D" FLAT, "D", "E" FLAT, "E", "F", "G" FLAT, "G",
+      "A" FLAT } /* German alternate */
 };
 
+#undef SHARP
+#undef FLAT
+
 // ** NOTE RATIOS ** //
 const double TuningParameters::D_NOTE = pow(2.0, 1.0 / 12.0);
 const double TuningParameters::D_NOTE_LOG = 1.0 / 12.0;
@@ -47,11 +49,11 @@ void TuningParameters::setParameters(double fundamentalFrequency, TuningNotation
     }
 }
 
-const QString &TuningParameters::getNoteLabel(int seq, bool alternative) const
+const char *TuningParameters::getNoteLabel(int seq, bool alternative) const
 {
-    Q_ASSERT(0 <= seq && seq < 12);
+    assert(0 <= seq && seq < 12);
     int row = (int)_tuningNotation * 2 + (int)alternative;
-    Q_ASSERT(0 <= row && row < 6);
+    assert(0 <= row && row < 6);
     return NoteLabel[row][seq];
 }
 
@@ -110,6 +112,8 @@ std::optional<EstimatedNote> TuningParameters::estimateNote(const double estimat
     result.currentPitchDeviation =
             (logOctaveNormalizedFreq - _noteScale[minPitchDeviationIndex]) / D_NOTE_LOG;
     result.noteFrequency = _noteFrequency[minPitchDeviationIndex] * pow(2.0, octaveDeviation);
+    // the reference octave runs from A4 to G#5: the octave numbers change at C
+    result.octave = 4 + octaveDeviation + (minPitchDeviationIndex >= 3 ? 1 : 0);
 
     return result;
 }
@@ -2,7 +2,6 @@
 
 #include <cstdlib>
 #include <optional>
-#include <QString>
 
 enum class TuningNotation {
     US = 0,
@@ -21,6 +20,9 @@ struct EstimatedNote
     double currentPitchDeviation;
 
     double noteFrequency;
+
+    /// Octave of the note in scientific pitch notation, where the reference is A4
+    int octave;
 };
 
 class TuningParameters
@@ -30,7 +32,11 @@ public:
 
     void setParameters(double fundamentalFrequency, TuningNotation tuningNotation);
 
-    const QString &getNoteLabel(int seq, bool alternative) const;
+    /// The label of a note of the scale in the current notation, in UTF-8.
+    ///
+    /// \param[in] seq the note, from 0 (A) to 11 (G sharp)
+    /// \param[in] alternative use flats rather than sharps
+    const char *getNoteLabel(int seq, bool alternative) const;
 
     /// This method implements a simple pitch detection algorithm to
     /// identify the note corresponding to the frequency estimated as
@@ -1,95 +1,558 @@
 #include "pitchdetection.h"
 
-#include <QtAssert>
+#include "fftwplanner.h"
+#include "slidingdft.h"
+#include "squaredifference.h"
+
+#include <cassert>
+#include <chrono>
 #include <cstring>
 #include <algorithm>
 #include <cmath>
 
-const int PitchDetectionContext::ZERO_PADDING_FACTOR = 80;
+template <class Real>
+const int PitchDetectionContext<Real>::DEFAULT_ZERO_PADDING_FACTOR = 80;
+template <class Real>
+const int PitchDetectionContext<Real>::SINC_NEWTON_ITERATIONS = 8;
+template <class Real>
+const double PitchDetectionContext<Real>::PEAK_HEIGHT_THRESHOLD = 0.99;
+template <class Real>
+const size_t PitchDetectionContext<Real>::MAX_BATCH_FRAMES = 16;
+template <class Real>
+const size_t PitchDetectionContext<Real>::MAX_BATCH_BYTES = 4 << 20;
+
+const char *planSourceName(PlanSource source)
+{
+    switch (source) {
+    case PlanSource::Estimate:
+        return "estimate";
+    case PlanSource::Wisdom:
+        return "wisdom";
+    case PlanSource::Measure:
+        return "measured";
+    case PlanSource::Patient:
+        return "patient";
+    }
+    return "unknown";
+}
+
+const char *pitchDetectorEngineName(PitchDetectorEngine engine)
+{
+    switch (engine) {
+    case PitchDetectorEngine::Autocorrelation:
+        return "autocorrelation";
+    case PitchDetectorEngine::Yin:
+        return "YIN";
+    case PitchDetectorEngine::McLeod:
+        return "McLeod";
+    case PitchDetectorEngine::SlidingDft:
+        return "sliding DFT";
+    }
+    return "unknown";
+}
+
+double parabolicPeakOffset(double left, double center, double right)
+{
+    double curvature = left - 2.0 * center + right;
+    if (!(curvature < 0.0)) {
+        // not a maximum (or not a number)
+        return 0.0;
+    }
+    return std::clamp(0.5 * (left - right) / curvature, -1.0, 1.0);
+}
+
+double parabolicPeakHeight(double left, double center, double right)
+{
+    double offset = parabolicPeakOffset(left, center, right);
+    return center - 0.25 * (left - right) * offset;
+}
+
+template <class Real>
+size_t findFirstAutocorrelationPeak(const Real *r, size_t firstLag, size_t searchEnd,
+                                    double threshold)
+{
+    const SimdKernels<Real> &kernels = SimdKernels<Real>::best();
+    firstLag = std::max<size_t>(firstLag, 1);
+    auto peakHeightAt = [r](size_t lag) {
+        return parabolicPeakHeight(r[lag - 1], r[lag], r[lag + 1]);
+    };
+
+    // the positive local maxima are rare, so let the kernel skip the samples between them
+    double maxHeight = 0.0;
+    for (size_t l = kernels.findLocalMaximum(r, firstLag, searchEnd); l < searchEnd;
+         l = kernels.findLocalMaximum(r, l + 1, searchEnd)) {
+        maxHeight = std::max(maxHeight, peakHeightAt(l));
+    }
+
+    if (!(maxHeight > 0.0)) {
+        return 0;
+    }
+
+    for (size_t l = kernels.findLocalMaximum(r, firstLag, searchEnd); l < searchEnd;
+         l = kernels.findLocalMaximum(r, l + 1, searchEnd)) {
+        if (peakHeightAt(l) >= threshold * maxHeight) {
+            return l;
+        }
+    }
+    return 0;
+}
+
+template size_t findFirstAutocorrelationPeak<double>(const double *r, size_t firstLag,
+                                                     size_t searchEnd, double threshold);
+template size_t findFirstAutocorrelationPeak<float>(const float *r, size_t firstLag,
+                                                    size_t searchEnd, double threshold);
+
+template <class Real>
+std::unique_ptr<PitchDetectionPlans<Real>>
+PitchDetectionPlans<Real>::create(size_t fftFrameSize, size_t outFrameSize, PlanSource rigor,
+                                  size_t howMany, double timeLimit)
+{
+    assert(howMany >= 1);
+
+    // FFTW_MEASURE and FFTW_PATIENT overwrite the arrays while planning, so plan on scratch
+    // buffers with the same sizes and alignment as the ones of the context
+    Real *inTime = Traits::allocReal(fftFrameSize * howMany);
+    typename Traits::Complex *midFreq = Traits::allocComplex((fftFrameSize / 2 + 1) * howMany);
+    typename Traits::Complex *midFreq2 = Traits::allocComplex((outFrameSize / 2 + 1) * howMany);
+    Real *outTimeAutocorr = Traits::allocReal(outFrameSize * howMany);
+
+    auto plans = std::make_unique<PitchDetectionPlans<Real>>();
+    plans->fft = nullptr;
+    plans->ifft = nullptr;
+
+    // each plan gets half of the time limit, and the planner mutex is released between them
+    double planTimeLimit = timeLimit < 0.0 ? FFTW_NO_TIMELIMIT : timeLimit / 2.0;
+    auto planLocked = [&](auto plan) {
+        std::lock_guard<std::mutex> plannerLocker(FFTWPlanner::mutex());
+        Traits::setTimeLimit(planTimeLimit);
+        typename Traits::Plan result = plan();
+        Traits::setTimeLimit(FFTW_NO_TIMELIMIT);
+        return result;
+    };
+
+    auto planWith = [&](unsigned flags) {
+        if (howMany == 1) {
+            plans->fft = planLocked([&]() {
+                return Traits::planR2C(fftFrameSize, inTime, midFreq, flags); // FFT
+            });
+            plans->ifft = planLocked([&]() {
+                return Traits::planC2R(outFrameSize, midFreq2, outTimeAutocorr,
+                                       flags); // IFFT zero-padded
+            });
+        } else {
+            plans->fft = planLocked([&]() {
+                return Traits::planManyR2C(fftFrameSize, howMany, inTime, midFreq, flags);
+            });
+            plans->ifft = planLocked([&]() {
+                return Traits::planManyC2R(outFrameSize, howMany, midFreq2, outTimeAutocorr,
+                                           flags);
+            });
+        }
+        return plans->fft != nullptr && plans->ifft != nullptr;
+    };
+
+    auto discardPlans = [&]() {
+        std::lock_guard<std::mutex> plannerLocker(FFTWPlanner::mutex());
+        if (plans->fft != nullptr) {
+            Traits::destroyPlan(plans->fft);
+            plans->fft = nullptr;
+        }
+        if (plans->ifft != nullptr) {
+            Traits::destroyPlan(plans->ifft);
+            plans->ifft = nullptr;
+        }
+    };
+
+    std::chrono::steady_clock::time_point planningStart = std::chrono::steady_clock::now();
+    bool planned;
+    switch (rigor) {
+    default:
+    case PlanSource::Estimate:
+    case PlanSource::Wisdom:
+        // use measured plans from the wisdom if there are any, without measuring anything
+        plans->source = PlanSource::Wisdom;
+        planned = planWith(FFTW_MEASURE | FFTW_WISDOM_ONLY);
+        if (!planned) {
+            discardPlans();
+            plans->source = PlanSource::Estimate;
+            planned = planWith(FFTW_ESTIMATE);
+        }
+        break;
+
+    case PlanSource::Measure:
+        plans->source = PlanSource::Measure;
+        planned = planWith(FFTW_MEASURE);
+        break;
+
+    case PlanSource::Patient:
+        plans->source = PlanSource::Patient;
+        planned = planWith(FFTW_PATIENT);
+        break;
+    }
+
+    if (!planned) {
+        discardPlans();
+    }
 
-PitchDetectionContext::PitchDetectionContext(uint32_t sampleFrequency, size_t fftFrameSize)
+    Traits::free(inTime);
+    Traits::free(midFreq);
+    Traits::free(midFreq2);
+    Traits::free(outTimeAutocorr);
+    plans->planningTime =
+            std::chrono::duration<double>(std::chrono::steady_clock::now() - planningStart)
+                    .count();
+
+    if (!planned) {
+        return nullptr;
+    }
+    return plans;
+}
+
+template <class Real>
+PitchDetectionPlans<Real>::~PitchDetectionPlans()
 {
+    std::lock_guard<std::mutex> plannerLocker(FFTWPlanner::mutex());
+    if (fft != nullptr) {
+        Traits::destroyPlan(fft);
+    }
+    if (ifft != nullptr) {
+        Traits::destroyPlan(ifft);
+    }
+}
+
+template <class Real>
+PitchDetectionPlanSlot<Real>::~PitchDetectionPlanSlot()
+{
+    delete pending.exchange(nullptr);
+    delete retired.exchange(nullptr);
+}
+
+template <class Real>
+void PitchDetectionPlanSlot<Real>::offer(std::unique_ptr<PitchDetectionPlans<Real>> plans)
+{
+    delete retired.exchange(nullptr, std::memory_order_acq_rel);
+    delete pending.exchange(plans.release(), std::memory_order_acq_rel);
+}
+
+template <class Real>
+std::unique_ptr<PitchDetectionPlans<Real>> PitchDetectionPlanSlot<Real>::take()
+{
+    if (pending.load(std::memory_order_relaxed) == nullptr) {
+        return nullptr;
+    }
+    // only the context retires plans, so there is room for the ones it would replace
+    if (retired.load(std::memory_order_acquire) != nullptr) {
+        return nullptr;
+    }
+    return std::unique_ptr<PitchDetectionPlans<Real>>(
+            pending.exchange(nullptr, std::memory_order_acq_rel));
+}
+
+template <class Real>
+void PitchDetectionPlanSlot<Real>::retire(std::unique_ptr<PitchDetectionPlans<Real>> plans)
+{
+    assert(retired.load(std::memory_order_relaxed) == nullptr);
+    retired.store(plans.release(), std::memory_order_release);
+}
+
+template <class Real>
+PitchDetectionContext<Real>::PitchDetectionContext(uint32_t sampleFrequency, size_t fftFrameSize,
+                                             int zeroPaddingFactor,
+                                             PeakInterpolation peakInterpolation)
+{
+    assert(zeroPaddingFactor >= 1);
+
     _sampleFrequency = sampleFrequency;
     _fftFrameSize = fftFrameSize;
-    size_t outFrameSize = fftFrameSize * ZERO_PADDING_FACTOR;
+    _zeroPaddingFactor = zeroPaddingFactor;
+    _peakInterpolation = peakInterpolation;
+    _kernels = &SimdKernels<Real>::best();
+    size_t outFrameSize = fftFrameSize * zeroPaddingFactor;
 
     // ** INITIALIZE FFT STRUCTURES ** //
-    _window = (double *)fftw_malloc(sizeof(double) * fftFrameSize);
-    _fftwInTime = (double *)fftw_malloc(sizeof(double) * fftFrameSize);
-    _fftwMidFreq = (fftw_complex *)fftw_malloc(sizeof(fftw_complex) * fftFrameSize);
-    _fftwMidFreq2 = (fftw_complex *)fftw_malloc(sizeof(fftw_complex) * outFrameSize);
-    _fftwOutTimeAutocorr = (double *)fftw_malloc(sizeof(double) * outFrameSize);
+    // One arena for the five buffers.  The r2c FFT only writes the first fftFrameSize / 2 + 1
+    // complex samples, and the c2r IFFT only reads the first outFrameSize / 2 + 1.
+    const size_t spectrumSize = fftFrameSize / 2 + 1;
+    const size_t paddedSpectrumSize = outFrameSize / 2 + 1;
+    _arena = std::make_unique<BufferArena>(
+            2 * BufferArena::alignedSize(fftFrameSize * sizeof(Real))
+            + BufferArena::alignedSize(spectrumSize * sizeof(Complex))
+            + BufferArena::alignedSize(paddedSpectrumSize * sizeof(Complex))
+            + BufferArena::alignedSize(outFrameSize * sizeof(Real)));
+    _window = _arena->allocate<Real>(fftFrameSize);
+    _fftwInTime = _arena->allocate<Real>(fftFrameSize);
+    _fftwMidFreq = _arena->allocate<Complex>(spectrumSize);
+    _fftwMidFreq2 = _arena->allocate<Complex>(paddedSpectrumSize);
+    _fftwOutTimeAutocorr = _arena->allocate<Real>(outFrameSize);
+
+    // start with plans from the wisdom, or estimated ones, and let PlanRefiner measure better
+    // plans in the background
+    _plans = PitchDetectionPlans<Real>::create(fftFrameSize, outFrameSize, PlanSource::Estimate);
+    _planSlot = std::make_shared<PitchDetectionPlanSlot<Real>>();
 
-    _fftwPlanFFT =
-            fftw_plan_dft_r2c_1d(fftFrameSize, _fftwInTime, _fftwMidFreq, FFTW_ESTIMATE); // FFT
-    _fftwPlanIFFT = fftw_plan_dft_c2r_1d(outFrameSize, _fftwMidFreq2, _fftwOutTimeAutocorr,
-                                         FFTW_ESTIMATE); // IFFT zero-padded
+    // the batches are only used by offline analysis, and created by the first runBatch()
+    _batchFrames = 0;
+    _batchInTime = nullptr;
+    _batchMidFreq = nullptr;
+    _batchMidFreq2 = nullptr;
+    _batchOutTimeAutocorr = nullptr;
 
     generateHanningWindow(_window, fftFrameSize);
 }
 
-PitchDetectionContext::~PitchDetectionContext()
+template <class Real>
+PitchDetectionContext<Real>::~PitchDetectionContext()
 {
     // ** DESTROY FFTW STRUCTURES ** //
-    fftw_destroy_plan(_fftwPlanFFT);
-    fftw_destroy_plan(_fftwPlanIFFT);
-    fftw_free(_window);
-    fftw_free(_fftwInTime);
-    fftw_free(_fftwMidFreq);
-    fftw_free(_fftwMidFreq2);
-    fftw_free(_fftwOutTimeAutocorr);
+    _plans.reset();
+    _batchPlans.reset();
+    _arena.reset();
+    if (_batchInTime != nullptr) {
+        Traits::free(_batchInTime);
+        Traits::free(_batchMidFreq);
+        Traits::free(_batchMidFreq2);
+        Traits::free(_batchOutTimeAutocorr);
+    }
+}
+
+template <class Real>
+std::unique_ptr<PitchDetector<Real>>
+PitchDetector<Real>::create(PitchDetectorEngine engine, uint32_t sampleFrequency,
+                            size_t fftFrameSize, int zeroPaddingFactor,
+                            PeakInterpolation peakInterpolation)
+{
+    switch (engine) {
+    default:
+    case PitchDetectorEngine::Autocorrelation:
+        return std::make_unique<PitchDetectionContext<Real>>(sampleFrequency, fftFrameSize,
+                                                             zeroPaddingFactor, peakInterpolation);
+    case PitchDetectorEngine::Yin:
+        return std::make_unique<YinDetector<Real>>(sampleFrequency, fftFrameSize);
+    case PitchDetectorEngine::McLeod:
+        return std::make_unique<McLeodDetector<Real>>(sampleFrequency, fftFrameSize);
+    case PitchDetectorEngine::SlidingDft:
+        return std::make_unique<SlidingDftDetector<Real>>(sampleFrequency, fftFrameSize);
+    }
+}
+
+template <class Real>
+void PitchDetector<Real>::slideSamples(const float *inputSamples, size_t inputSize,
+                                       size_t /*newSamples*/)
+{
+    loadSamples(inputSamples, inputSize);
 }
 
-size_t PitchDetectionContext::getFFTFrameSize() const
+template <class Real>
+void PitchDetector<Real>::reset()
+{
+    // nothing is kept between frames
+}
+
+template <class Real>
+void PitchDetector<Real>::runBatch(const float *samples, size_t hop, size_t numFrames,
+                                   double *frequencies)
+{
+    const size_t frameSize = getFFTFrameSize();
+    for (size_t i = 0; i < numFrames; ++i) {
+        if (i == 0) {
+            loadSamples(samples, frameSize);
+        } else {
+            slideSamples(samples + i * hop, frameSize, std::min(hop, frameSize));
+        }
+        frequencies[i] = runPitchDetectionAlgorithm();
+    }
+}
+
+template <class Real>
+PitchDetectorEngine PitchDetectionContext<Real>::getEngine() const
+{
+    return PitchDetectorEngine::Autocorrelation;
+}
+
+template <class Real>
+size_t PitchDetectionContext<Real>::getFFTFrameSize() const
 {
     return _fftFrameSize;
 }
 
-size_t PitchDetectionContext::getOutFrameSize() const
+template <class Real>
+size_t PitchDetectionContext<Real>::getOutFrameSize() const
+{
+    return _fftFrameSize * _zeroPaddingFactor;
+}
+
+template <class Real>
+int PitchDetectionContext<Real>::getZeroPaddingFactor() const
+{
+    return _zeroPaddingFactor;
+}
+
+template <class Real>
+PeakInterpolation PitchDetectionContext<Real>::getPeakInterpolation() const
+{
+    return _peakInterpolation;
+}
+
+template <class Real>
+bool PitchDetectionContext<Real>::hasPlans() const
+{
+    return _plans != nullptr;
+}
+
+template <class Real>
+PlanSource PitchDetectionContext<Real>::getPlanSource() const
+{
+    return _plans->source;
+}
+
+template <class Real>
+double PitchDetectionContext<Real>::getPlanningTime() const
 {
-    return _fftFrameSize * ZERO_PADDING_FACTOR;
+    return _plans->planningTime;
 }
 
-void PitchDetectionContext::loadSamples(float *samples, size_t inputSize)
+template <class Real>
+std::shared_ptr<PitchDetectionPlanSlot<Real>> PitchDetectionContext<Real>::getPlanSlot() const
+{
+    return _planSlot;
+}
+
+template <class Real>
+void PitchDetectionContext<Real>::loadSamples(const float *samples, size_t inputSize)
 {
     size_t numCopy = std::min(inputSize, _fftFrameSize);
-    for (size_t i = 0; i < numCopy; i++) {
-        _fftwInTime[i] = samples[i] * _window[i];
-    }
+    _kernels->windowSamples(samples, _window, _fftwInTime, numCopy);
     if (inputSize < _fftFrameSize) {
         std::fill(&_fftwInTime[inputSize], &_fftwInTime[_fftFrameSize], 0);
     }
 }
 
-double *PitchDetectionContext::getInputBuffer()
+template <class Real>
+Real *PitchDetectionContext<Real>::getInputBuffer()
 {
     return _fftwInTime;
 }
 
-fftw_complex *PitchDetectionContext::getFreq2Buffer()
+template <class Real>
+typename PitchDetectionContext<Real>::Complex *PitchDetectionContext<Real>::getFreq2Buffer()
 {
     return _fftwMidFreq2;
 }
 
-double *PitchDetectionContext::getAutoCorrBuffer()
+template <class Real>
+Real *PitchDetectionContext<Real>::getAutoCorrBuffer()
 {
     return _fftwOutTimeAutocorr;
 }
 
-double PitchDetectionContext::runPitchDetectionAlgorithm()
+template <class Real>
+double PitchDetectionContext<Real>::runPitchDetectionAlgorithm()
 {
+    // ** SWITCH TO BETTER PLANS BETWEEN FRAMES ** //
+    if (std::unique_ptr<PitchDetectionPlans<Real>> newPlans = _planSlot->take()) {
+        _plans.swap(newPlans);
+        _planSlot->retire(std::move(newPlans));
+    }
+
     // ** ENSURE THAT FFTW STRUCTURES ARE VALID ** //
-    Q_ASSERT(_fftwPlanFFT != nullptr);
-    Q_ASSERT(_fftwPlanIFFT != nullptr);
-    Q_ASSERT(_fftwInTime != nullptr);
-    Q_ASSERT(_fftwMidFreq != nullptr);
-    Q_ASSERT(_fftwMidFreq2 != nullptr);
-    Q_ASSERT(_fftwOutTimeAutocorr != nullptr);
+    assert(_plans);
+    assert(_fftwInTime != nullptr);
+    assert(_fftwMidFreq != nullptr);
+    assert(_fftwMidFreq2 != nullptr);
+    assert(_fftwOutTimeAutocorr != nullptr);
 
     // ** COMPUTE THE AUTOCORRELATION ** //
     // compute the FFT of the input signal
-    fftw_execute(_fftwPlanFFT);
+    Traits::executeR2C(_plans->fft, _fftwInTime, _fftwMidFreq);
+
+    // compute |.|^2 of the signal, zero-padded
+    computePowerSpectrum(_fftwMidFreq, _fftwMidFreq2);
+
+    // compute the IFFT to obtain the autocorrelation in time domain
+    Traits::executeC2R(_plans->ifft, _fftwMidFreq2, _fftwOutTimeAutocorr);
+
+    return findPeakFrequency(_fftwMidFreq, _fftwOutTimeAutocorr);
+}
+
+template <class Real>
+size_t PitchDetectionContext<Real>::getBatchFrames() const
+{
+    const size_t outFrameSize = getOutFrameSize();
+    const size_t frameBytes = _fftFrameSize * sizeof(Real)
+            + (_fftFrameSize / 2 + 1 + outFrameSize / 2 + 1) * sizeof(Complex)
+            + outFrameSize * sizeof(Real);
+    return std::clamp<size_t>(MAX_BATCH_BYTES / frameBytes, 1, MAX_BATCH_FRAMES);
+}
+
+template <class Real>
+void PitchDetectionContext<Real>::createBatch()
+{
+    const size_t outFrameSize = getOutFrameSize();
+    const size_t batchFrames = getBatchFrames();
+
+    // the batch plans are not refined by PlanRefiner, so they come from the wisdom or are
+    // estimated
+    _batchPlans = PitchDetectionPlans<Real>::create(_fftFrameSize, outFrameSize,
+                                                    PlanSource::Estimate, batchFrames);
+    if (!_batchPlans) {
+        return;
+    }
+
+    _batchFrames = batchFrames;
+    _batchInTime = Traits::allocReal(_fftFrameSize * batchFrames);
+    _batchMidFreq = Traits::allocComplex((_fftFrameSize / 2 + 1) * batchFrames);
+    _batchMidFreq2 = Traits::allocComplex((outFrameSize / 2 + 1) * batchFrames);
+    _batchOutTimeAutocorr = Traits::allocReal(outFrameSize * batchFrames);
 
+    // the rows after the last frame of a partial batch are transformed too: start them from
+    // zeros rather than from uninitialized memory, which may hold NaNs or denormals
+    std::fill_n(_batchInTime, _fftFrameSize * batchFrames, Real(0));
+    std::fill_n(&_batchMidFreq2[0][0], 2 * (outFrameSize / 2 + 1) * batchFrames, Real(0));
+}
+
+template <class Real>
+void PitchDetectionContext<Real>::runBatch(const float *samples, size_t hop, size_t numFrames,
+                                           double *frequencies)
+{
+    if (!_batchPlans) {
+        createBatch();
+        if (!_batchPlans) {
+            PitchDetector<Real>::runBatch(samples, hop, numFrames, frequencies);
+            return;
+        }
+    }
+
+    const size_t outFrameSize = getOutFrameSize();
+    const size_t specSize = _fftFrameSize / 2 + 1;
+    const size_t paddedSpecSize = outFrameSize / 2 + 1;
+
+    for (size_t first = 0; first < numFrames; first += _batchFrames) {
+        // the rows after the last frame of a partial batch are transformed but ignored
+        const size_t count = std::min(_batchFrames, numFrames - first);
+
+        for (size_t f = 0; f < count; ++f) {
+            _kernels->windowSamples(samples + (first + f) * hop, _window,
+                                    _batchInTime + f * _fftFrameSize, _fftFrameSize);
+        }
+
+        Traits::executeR2C(_batchPlans->fft, _batchInTime, _batchMidFreq);
+        for (size_t f = 0; f < count; ++f) {
+            computePowerSpectrum(_batchMidFreq + f * specSize,
+                                 _batchMidFreq2 + f * paddedSpecSize);
+        }
+        Traits::executeC2R(_batchPlans->ifft, _batchMidFreq2, _batchOutTimeAutocorr);
+
+        for (size_t f = 0; f < count; ++f) {
+            frequencies[first + f] = findPeakFrequency(_batchMidFreq + f * specSize,
+                                                       _batchOutTimeAutocorr + f * outFrameSize);
+        }
+    }
+}
+
+template <class Real>
+void PitchDetectionContext<Real>::computePowerSpectrum(const Complex *spectrum,
+                                                       Complex *power) const
+{
     /*
      * compute the transform of the autocorrelation given in time domain by
      *
@@ -107,20 +570,18 @@ double PitchDetectionContext::runPitchDetectionAlgorithm()
      */
 
     // compute |.|^2 of the signal
-    for (unsigned int k = 0; k < (_fftFrameSize / 2 + 1); ++k) {
-        _fftwMidFreq2[k][0] = (_fftwMidFreq[k][0] * _fftwMidFreq[k][0])
-                + (_fftwMidFreq[k][1] * _fftwMidFreq[k][1]);
-        _fftwMidFreq2[k][1] = 0.0;
-    }
+    _kernels->powerSpectrum(&spectrum[0][0], &power[0][0], _fftFrameSize / 2 + 1);
 
-    // pad the FFT with zeros to increase resolution
-    memset(&(_fftwMidFreq2[_fftFrameSize / 2 + 1][0]), 0,
-           ((ZERO_PADDING_FACTOR - 1) * _fftFrameSize + _fftFrameSize / 2 - 1)
-                   * sizeof(fftw_complex));
-
-    // compute the IFFT to obtain the autocorrelation in time domain
-    fftw_execute(_fftwPlanIFFT);
+    // pad the FFT with zeros to increase resolution (nothing to do without padding)
+    size_t outFrameSize = getOutFrameSize();
+    memset(&(power[_fftFrameSize / 2 + 1][0]), 0,
+           (outFrameSize / 2 - _fftFrameSize / 2) * sizeof(Complex));
+}
 
+template <class Real>
+double PitchDetectionContext<Real>::findPeakFrequency(const Complex *spectrum,
+                                                      const Real *autocorr) const
+{
     // find the maximum of the autocorrelation (rejecting the first peak)
     /*
      * the main problem with autocorrelation techniques is that a peak may also
@@ -128,29 +589,90 @@ double PitchDetectionContext::runPitchDetectionAlgorithm()
      * anything better =(
      */
 
+    // only lags up to half the frame are meaningful
+    const size_t searchEnd = getOutFrameSize() / 2 + 1;
+
     // search for a minimum in the autocorrelation to reject the peak centered around 0
-    unsigned int l;
-    for (l = 0; (l < ((ZERO_PADDING_FACTOR / 2) * _fftFrameSize + 1))
-         && ((_fftwOutTimeAutocorr[l + 1] < _fftwOutTimeAutocorr[l])
-             || (_fftwOutTimeAutocorr[l + 1] > 0.0));
-         ++l) { };
+    size_t l = _kernels->findDescentEnd(autocorr, 0, searchEnd);
 
     // search for the maximum
-    double maxAutoCorrelation = 0.0;
-    unsigned int maxAutoCorrelation_index = 0;
-    for (; l < ((ZERO_PADDING_FACTOR / 2) * _fftFrameSize + 1); ++l) {
-        if (_fftwOutTimeAutocorr[l] > maxAutoCorrelation) {
-            maxAutoCorrelation = _fftwOutTimeAutocorr[l];
-            maxAutoCorrelation_index = l;
-        }
+    size_t maxAutoCorrelation_index = 0;
+    if (_peakInterpolation == PeakInterpolation::None) {
+        maxAutoCorrelation_index = _kernels->findMaximum(autocorr, l, searchEnd);
+    } else {
+        /*
+         * with a coarse lag resolution the sample closest to a later peak may be higher than the
+         * sample closest to the first one, so compare the interpolated heights of the local
+         * maxima instead (they are rare, so this costs little more than the plain scan)
+         *
+         * the peaks at multiples of the period are only slightly lower than the first one (by the
+         * autocorrelation of the window), which is less than the interpolation error of their
+         * heights for high notes, so take the first peak that is nearly as high as the maximum
+         */
+        maxAutoCorrelation_index =
+                findFirstAutocorrelationPeak(autocorr, l, searchEnd, PEAK_HEIGHT_THRESHOLD);
+    }
+
+    // refine the lag of the maximum between the samples of the autocorrelation
+    double peakLag = maxAutoCorrelation_index;
+    if (maxAutoCorrelation_index > 0) {
+        peakLag = refinePeakLag(spectrum, autocorr, maxAutoCorrelation_index);
     }
 
     // compute the frequency of the maximum considering the padding factor
-    return ((ZERO_PADDING_FACTOR / 2) * (2.0 * _sampleFrequency)
-            / (double)maxAutoCorrelation_index);
+    return (_zeroPaddingFactor * _sampleFrequency / peakLag);
+}
+
+template <class Real>
+double PitchDetectionContext<Real>::refinePeakLag(const Complex *spectrum, const Real *autocorr,
+                                                  size_t index) const
+{
+    const Real *r = autocorr;
+    double left = r[index - 1];
+    double center = r[index];
+    double right = r[index + 1];
+
+    switch (_peakInterpolation) {
+    default:
+    case PeakInterpolation::None:
+        return index;
+
+    case PeakInterpolation::Parabolic:
+        return index + parabolicPeakOffset(left, center, right);
+
+    case PeakInterpolation::Gaussian:
+        if (left > 0.0 && center > 0.0 && right > 0.0) {
+            return index + parabolicPeakOffset(log(left), log(center), log(right));
+        }
+        return index + parabolicPeakOffset(left, center, right);
+
+    case PeakInterpolation::Sinc:
+        break;
+    }
+
+    /*
+     * the autocorrelation is band-limited, so between its samples it is exactly the periodic sinc
+     * interpolation of the samples: start from the parabolic estimate and stay within the samples
+     * around the peak (t is measured in input samples)
+     */
+    const double padding = _zeroPaddingFactor;
+    // the Nyquist bin of the input is only the Nyquist bin of the IFFT without padding
+    const size_t nyquistBin = (_zeroPaddingFactor == 1) ? _fftFrameSize / 2 : _fftFrameSize;
+    auto power = [spectrum](size_t k) {
+        // the c2r IFFT may have overwritten the power spectrum, so use the FFT output
+        return (double)spectrum[k][0] * spectrum[k][0]
+                + (double)spectrum[k][1] * spectrum[k][1];
+    };
+
+    double t = refineBandLimitedPeak(power, _fftFrameSize / 2 + 1, nyquistBin, _fftFrameSize,
+                                     (index + parabolicPeakOffset(left, center, right)) / padding,
+                                     (index - 1) / padding, (index + 1) / padding,
+                                     SINC_NEWTON_ITERATIONS);
+    return t * padding;
 }
 
-void PitchDetectionContext::generateHanningWindow(double *buffer, size_t size)
+template <class Real>
+void PitchDetectionContext<Real>::generateHanningWindow(Real *buffer, size_t size)
 {
     if (size <= 1) {
         // Pathological case.  Just make it a rect window.
@@ -166,3 +688,12 @@ void PitchDetectionContext::generateHanningWindow(double *buffer, size_t size)
         buffer[i] = y;
     }
 }
+
+template struct PitchDetectionPlans<double>;
+template struct PitchDetectionPlans<float>;
+template struct PitchDetectionPlanSlot<double>;
+template struct PitchDetectionPlanSlot<float>;
+template class PitchDetector<double>;
+template class PitchDetector<float>;
+template class PitchDetectionContext<double>;
+template class PitchDetectionContext<float>;
@@ -1,64 +1,444 @@
 #pragma once
 
+#include "bufferarena.h"
+#include "fftwtraits.h"
+#include "simdkernels.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
 #include <cstdint>
-#include <fftw3.h>
+#include <memory>
+
+/// Method used to refine the position of the autocorrelation peak between two lags.
+enum class PeakInterpolation {
+    /// Take the lag of the highest sample as is.
+    None = 0,
+    /// Fit a parabola through the peak and its two neighbours.
+    Parabolic,
+    /// Fit a parabola through the logarithm of the peak and its two neighbours.
+    Gaussian,
+    /// Band-limited (periodic sinc) reconstruction of the autocorrelation around the peak.
+    Sinc,
+};
+
+/// Where the FFTW plans of a PitchDetectionContext come from, from the fastest to plan to the
+/// fastest to execute.
+enum class PlanSource {
+    /// Planned with FFTW_ESTIMATE, without measuring anything.
+    Estimate = 0,
+    /// Found in the FFTW wisdom (measured in an earlier run).
+    Wisdom,
+    /// Planned with FFTW_MEASURE.
+    Measure,
+    /// Planned with FFTW_PATIENT.
+    Patient,
+};
+
+/// Return a human-readable name of a plan source.
+const char *planSourceName(PlanSource source);
+
+/// The pitch detection methods that can be selected at run time.
+enum class PitchDetectorEngine {
+    /// First peak of the autocorrelation (PitchDetectionContext).
+    Autocorrelation = 0,
+    /// Cumulative mean normalized difference function of YIN (YinDetector).
+    Yin,
+    /// Normalized square difference function of McLeod and Wyvill (McLeodDetector).
+    McLeod,
+    /// Autocorrelation from a spectrum updated sample by sample (SlidingDftDetector).
+    SlidingDft,
+};
+
+/// Return a human-readable name of a pitch detection engine.
+const char *pitchDetectorEngineName(PitchDetectorEngine engine);
+
+/// Offset of the vertex of the parabola through (-1, left), (0, center) and (1, right), or 0 if the
+/// parabola has no maximum.
+double parabolicPeakOffset(double left, double center, double right);
+
+/// Height of the vertex of the parabola through (-1, left), (0, center) and (1, right).
+double parabolicPeakHeight(double left, double center, double right);
 
-class PitchDetectionContext
+/// Find the first local maximum of an autocorrelation whose interpolated height reaches a fraction
+/// of the highest one.
+///
+/// \param[in] r the autocorrelation
+/// \param[in] firstLag the first lag after the peak around the zero lag
+/// \param[in] searchEnd the end of the search (r must have one more sample)
+/// \param[in] threshold the fraction of the highest peak that the chosen peak must reach
+/// \return the index of the peak, or 0 if there is none
+template <class Real>
+size_t findFirstAutocorrelationPeak(const Real *r, size_t firstLag, size_t searchEnd,
+                                    double threshold);
+
+/// Refine the lag of a peak of a band-limited autocorrelation given by its power spectrum.
+///
+/// Between its samples, the autocorrelation is exactly the cosine series of the power spectrum
+///
+/// r(t) = sum( c[k] * R[k] * cos(w[k] * t) ),   w[k] = 2 * pi * k / N
+///
+/// (with c[k] = 1 for the DC and Nyquist terms and 2 otherwise, as in the c2r IFFT), so we look for
+/// the zero of r'(t) with Newton's method, staying within the given bounds.
+///
+/// \param[in] power returns R[k] for k in [1, numBins)
+/// \param[in] nyquistBin the index of the Nyquist bin (if it is below numBins)
+/// \param[in] fftFrameSize N, the size of the transform of the power spectrum
+/// \param[in] t the initial estimate, in samples
+/// \return the refined lag, in samples
+template <class PowerAt>
+double refineBandLimitedPeak(PowerAt power, size_t numBins, size_t nyquistBin,
+                             size_t fftFrameSize, double t, double lowerBound, double upperBound,
+                             int iterations)
 {
+    const double w1 = 2.0 * M_PI / fftFrameSize;
+
+    for (int iteration = 0; iteration < iterations; ++iteration) {
+        // rotate e^(j * w[k] * t) bin by bin instead of calling sin() and cos() for each bin
+        double stepRe = cos(w1 * t);
+        double stepIm = sin(w1 * t);
+        double zRe = 1.0;
+        double zIm = 0.0;
+        double derivative1 = 0.0;
+        double derivative2 = 0.0;
+        for (size_t k = 1; k < numBins; ++k) {
+            double nextRe = zRe * stepRe - zIm * stepIm;
+            zIm = zRe * stepIm + zIm * stepRe;
+            zRe = nextRe;
+
+            double weight = (k == nyquistBin) ? 1.0 : 2.0;
+            double wk = w1 * k;
+            double ck = weight * power(k) * wk;
+            derivative1 -= ck * zIm;
+            derivative2 -= ck * wk * zRe;
+        }
+
+        if (!(derivative2 < 0.0)) {
+            // not a maximum: keep the current estimate
+            break;
+        }
+
+        double step = derivative1 / derivative2;
+        t = std::clamp(t - step, lowerBound, upperBound);
+        if (std::fabs(step) < 1e-9) {
+            break;
+        }
+    }
+
+    return t;
+}
+
+/// The FFTW plans used by a PitchDetectionContext.
+///
+/// The plans are created on scratch buffers and executed on the buffers of the context with the
+/// new-array execute functions, so that they can be built on another thread (see PlanRefiner)
+/// and swapped into a running context.
+template <class Real>
+struct PitchDetectionPlans
+{
+    using Traits = FFTWTraits<Real>;
+
+    /// Create the plans for the given sizes.  Holds the FFTW planner mutex around each call to
+    /// the planner only, so that a measured plan does not lock out the other contexts for the
+    /// whole planning run.
+    ///
+    /// \param[in] fftFrameSize the size of the r2c FFT
+    /// \param[in] outFrameSize the size of the c2r IFFT
+    /// \param[in] rigor PlanSource::Estimate to use the wisdom if available and FFTW_ESTIMATE
+    ///            otherwise; PlanSource::Measure or PlanSource::Patient to measure the plans
+    /// \param[in] howMany the number of frames transformed by each execution.  The frames of a
+    ///            batch are consecutive in the buffers: fftFrameSize reals, fftFrameSize / 2 + 1
+    ///            complex numbers, outFrameSize / 2 + 1 complex numbers and outFrameSize reals.
+    /// \param[in] timeLimit upper bound in seconds for measuring both plans, shared equally
+    ///            between them, or FFTW_NO_TIMELIMIT
+    /// \return the plans, or nullptr if FFTW could not create them
+    static std::unique_ptr<PitchDetectionPlans<Real>> create(size_t fftFrameSize,
+                                                             size_t outFrameSize,
+                                                             PlanSource rigor,
+                                                             size_t howMany = 1,
+                                                             double timeLimit = FFTW_NO_TIMELIMIT);
+
+    /// Destructor.  Destroys the plans holding the FFTW planner mutex.
+    ~PitchDetectionPlans();
+
+    /// Plan to compute the FFT of a given signal
+    typename Traits::Plan fft;
+
+    /// Plan to compute the IFFT of a given signal (with additional zero-padding, or truncated)
+    typename Traits::Plan ifft;
+
+    /// How the plans were obtained
+    PlanSource source;
+
+    /// Time spent creating the plans, in seconds
+    double planningTime;
+};
+
+/// Hands over plans built on another thread to a PitchDetectionContext.
+///
+/// The slot is shared between the context and the thread building the plans, so that the plans
+/// can be dropped safely if the context is destroyed before they are ready.  The plans replaced
+/// by the context go back through the slot, so that they are destroyed by the thread building
+/// the plans instead of taking the FFTW planner mutex in the middle of a frame.
+template <class Real>
+struct PitchDetectionPlanSlot
+{
+    ~PitchDetectionPlanSlot();
+
+    /// Offer plans to the context, replacing any plans it has not picked up yet, and destroy the
+    /// plans it retired.
+    void offer(std::unique_ptr<PitchDetectionPlans<Real>> plans);
+
+    /// Take the offered plans, if any.  Wait-free.  Nothing is taken until the plans retired
+    /// last have been destroyed by the thread building the plans.
+    std::unique_ptr<PitchDetectionPlans<Real>> take();
+
+    /// Hand back the plans replaced by the ones just taken.  Wait-free.
+    void retire(std::unique_ptr<PitchDetectionPlans<Real>> plans);
+
+    /// Plans offered but not yet taken
+    std::atomic<PitchDetectionPlans<Real> *> pending{ nullptr };
+
+    /// Plans replaced by the context, not destroyed yet
+    std::atomic<PitchDetectionPlans<Real> *> retired{ nullptr };
+};
+
+/// Interface of the pitch detection engines.
+///
+/// A detector analyses one frame of fftFrameSize samples at a time: loadSamples() followed by
+/// runPitchDetectionAlgorithm().  All the engines work on FFTW plans of the shape created by
+/// PitchDetectionPlans, so that PlanRefiner can measure better plans for any of them, and expose
+/// a power spectrum and a lag-domain function for visualization.
+template <class Real>
+class PitchDetector
+{
+public: // ** TYPES ** //
+    using Traits = FFTWTraits<Real>;
+    using Complex = typename Traits::Complex;
+
+public: // ** PUBLIC METHODS ** //
+    /// Create a detector of the given engine.
+    ///
+    /// \param[in] zeroPaddingFactor only used by PitchDetectorEngine::Autocorrelation
+    /// \param[in] peakInterpolation only used by PitchDetectorEngine::Autocorrelation
+    static std::unique_ptr<PitchDetector<Real>> create(PitchDetectorEngine engine,
+                                                       uint32_t sampleFrequency,
+                                                       size_t fftFrameSize, int zeroPaddingFactor,
+                                                       PeakInterpolation peakInterpolation);
+
+    virtual ~PitchDetector() = default;
+
+    virtual PitchDetectorEngine getEngine() const = 0;
+
+    /// Number of samples analysed in each frame.
+    virtual size_t getFFTFrameSize() const = 0;
+
+    /// Load a frame of samples.  Missing samples are taken as zeros.
+    virtual void loadSamples(const float *inputSamples, size_t inputSize) = 0;
+
+    /// Load a frame of samples of which only the last newSamples are new since the previous
+    /// frame.  Engines that keep state between frames only process the new samples; by default
+    /// the whole frame is loaded.
+    virtual void slideSamples(const float *inputSamples, size_t inputSize, size_t newSamples);
+
+    /// Forget the previous frames, so that the next slideSamples() loads its frame whole.  For
+    /// detectors that are reused on another stream (see PitchDetectorPool).
+    virtual void reset();
+
+    /// Estimate the pitch of the loaded frame.
+    ///
+    /// \return the estimated frequency in Hz, or 0 if there is nothing to estimate
+    virtual double runPitchDetectionAlgorithm() = 0;
+
+    /// Estimate the pitch of numFrames frames at once, hop samples apart, for offline analysis.
+    /// The frequencies are the ones that loadSamples() and runPitchDetectionAlgorithm() would
+    /// give frame by frame, which is what the default implementation does (sliding from one
+    /// frame to the next).  Whether the buffers for visualization are updated is unspecified.
+    ///
+    /// \param[in] samples the first frame; the last one ends at
+    ///            samples + (numFrames - 1) * hop + getFFTFrameSize()
+    /// \param[out] frequencies the estimated frequency of each frame, in Hz
+    virtual void runBatch(const float *samples, size_t hop, size_t numFrames,
+                          double *frequencies);
+
+    /// Whether FFTW could create the plans of the detector.  The other methods must not be
+    /// called if it could not.
+    virtual bool hasPlans() const = 0;
+
+    /// Where the plans currently in use come from.
+    virtual PlanSource getPlanSource() const = 0;
+
+    /// Time spent creating the plans currently in use, in seconds.
+    virtual double getPlanningTime() const = 0;
+
+    /// The slot through which better plans can be offered while the detector is running.  The
+    /// offered plans are adopted at the beginning of the next runPitchDetectionAlgorithm().
+    virtual std::shared_ptr<PitchDetectionPlanSlot<Real>> getPlanSlot() const = 0;
+
+    /// The power spectrum of the last frame, in the real part of getFFTFrameSize() / 2 + 1 bins.
+    virtual Complex *getFreq2Buffer() = 0;
+
+    /// The lag-domain function of the last frame, over lags from 0 to getFFTFrameSize() with
+    /// getOutFrameSize() / getFFTFrameSize() samples per lag.
+    virtual Real *getAutoCorrBuffer() = 0;
+
+    /// Number of samples in getAutoCorrBuffer(), which is also the size of the IFFT of the plans
+    /// passed to PitchDetectionPlans::create().
+    virtual size_t getOutFrameSize() const = 0;
+};
+
+/// Autocorrelation-based pitch detection.
+///
+/// The analysis runs in the precision of Real: double (fftw_*) or float (fftwf_*).  The refinement
+/// of the peak is always computed in double.
+template <class Real>
+class PitchDetectionContext : public PitchDetector<Real>
+{
+public: // ** TYPES ** //
+    using Traits = FFTWTraits<Real>;
+    using Complex = typename Traits::Complex;
+
 public: // ** CONSTANTS ** //
-    /// Number of times that the FFT is zero-padded to increase frequency resolution
-    static const int ZERO_PADDING_FACTOR;
+    /// Default number of times that the FFT is zero-padded to increase frequency resolution
+    static const int DEFAULT_ZERO_PADDING_FACTOR;
+
+    /// Maximum number of Newton iterations used by PeakInterpolation::Sinc
+    static const int SINC_NEWTON_ITERATIONS;
+
+    /// Fraction of the highest autocorrelation peak that an earlier peak must reach to be chosen
+    /// when the peak is interpolated
+    static const double PEAK_HEIGHT_THRESHOLD;
+
+    /// Maximum number of frames transformed by each execution of the plans of runBatch()
+    static const size_t MAX_BATCH_FRAMES;
+
+    /// Upper bound of the buffers of runBatch(), in bytes.  Large frames (with a large
+    /// zero-padding factor) are transformed fewer at a time, down to one.
+    static const size_t MAX_BATCH_BYTES;
 
 public: // ** PUBLIC METHODS ** //
-    PitchDetectionContext(uint32_t sampleFrequency, size_t fftFrameSize);
-    virtual ~PitchDetectionContext();
+    /// Constructor.
+    ///
+    /// \param[in] sampleFrequency the sample rate of the input signal
+    /// \param[in] fftFrameSize the number of samples analysed in each frame
+    /// \param[in] zeroPaddingFactor how many times the power spectrum is zero-padded before the
+    ///            IFFT.  The lag resolution of the autocorrelation is 1 / zeroPaddingFactor
+    ///            samples.
+    /// \param[in] peakInterpolation how the lag of the autocorrelation peak is refined
+    PitchDetectionContext(uint32_t sampleFrequency, size_t fftFrameSize,
+                          int zeroPaddingFactor = DEFAULT_ZERO_PADDING_FACTOR,
+                          PeakInterpolation peakInterpolation = PeakInterpolation::None);
+    ~PitchDetectionContext() override;
 
-    size_t getFFTFrameSize() const;
-    size_t getOutFrameSize() const;
+    PitchDetectorEngine getEngine() const override;
+    size_t getFFTFrameSize() const override;
+    size_t getOutFrameSize() const override;
+    int getZeroPaddingFactor() const;
+    PeakInterpolation getPeakInterpolation() const;
 
-    void loadSamples(float *inputSamples, size_t inputSize);
+    bool hasPlans() const override;
+    PlanSource getPlanSource() const override;
+    double getPlanningTime() const override;
+    std::shared_ptr<PitchDetectionPlanSlot<Real>> getPlanSlot() const override;
 
-    double *getInputBuffer();
-    fftw_complex *getFreq2Buffer();
-    double *getAutoCorrBuffer();
+    void loadSamples(const float *inputSamples, size_t inputSize) override;
+
+    Real *getInputBuffer();
+    Complex *getFreq2Buffer() override;
+    Real *getAutoCorrBuffer() override;
 
     /// Estimate the pitch of the input signal finding the first peak of the autocorrlation.
     ///
     /// \return the frequency value corresponding to the maximum of the autocorrelation
-    double runPitchDetectionAlgorithm();
+    double runPitchDetectionAlgorithm() override;
+
+    /// Window the frames into consecutive buffers and run the FFTs and the IFFTs of up to
+    /// getBatchFrames() frames with each execution of fftw_plan_many_dft_r2c and _c2r plans,
+    /// then search the peaks of the whole batch.  The plans and the buffers of the batches are
+    /// created by the first call; the ones of the single frames are left untouched.
+    void runBatch(const float *samples, size_t hop, size_t numFrames,
+                  double *frequencies) override;
+
+    /// Number of frames transformed at once by runBatch().
+    size_t getBatchFrames() const;
 
     /// Generate a Hanning window.
-    static void generateHanningWindow(double *buffer, size_t size);
+    static void generateHanningWindow(Real *buffer, size_t size);
 
 private:
+    /// Compute the power spectrum of the FFT of a frame, zero-padded for the IFFT.
+    void computePowerSpectrum(const Complex *spectrum, Complex *power) const;
+
+    /// Find the first peak of the autocorrelation of a frame.
+    ///
+    /// \param[in] spectrum the FFT of the frame, for PeakInterpolation::Sinc
+    /// \param[in] autocorr the zero-padded autocorrelation of the frame
+    /// \return the frequency of the peak
+    double findPeakFrequency(const Complex *spectrum, const Real *autocorr) const;
+
+    /// Refine the position of the autocorrelation peak found at the given index.
+    ///
+    /// \return the fractional index of the peak in the autocorrelation buffer
+    double refinePeakLag(const Complex *spectrum, const Real *autocorr, size_t index) const;
+
+    /// Create the plans and the buffers of runBatch().
+    void createBatch();
+
     // ** PITCH DETECTION PARAMETERS ** //
 
     /// PortAudio stream
     double _sampleFrequency;
 
+    /// Number of times that the power spectrum is zero-padded before the IFFT
+    int _zeroPaddingFactor;
+
+    /// Method used to refine the lag of the autocorrelation peak
+    PeakInterpolation _peakInterpolation;
+
     // ** FFTW STRUCTURES ** //
 
-    /// Plan to compute the FFT of a given signal
-    fftw_plan _fftwPlanFFT;
+    /// Plans to compute the FFT and the zero-padded IFFT
+    std::unique_ptr<PitchDetectionPlans<Real>> _plans;
 
-    /// Plan to compute the IFFT of a given signal (with additional zero-padding
-    fftw_plan _fftwPlanIFFT;
+    /// Slot for replacement plans built on another thread
+    std::shared_ptr<PitchDetectionPlanSlot<Real>> _planSlot;
 
     /// Number of frames in the time-domain input
     size_t _fftFrameSize;
 
+    /// The window, the power spectrum and the peak search, for the instruction set of the
+    /// processor
+    const SimdKernels<Real> *_kernels;
+
+    /// The memory of the five buffers below
+    std::unique_ptr<BufferArena> _arena;
+
     /// The window to apply to the input signal
-    double *_window;
+    Real *_window;
 
     /// External buffer used to store the input signal in the time domain
-    double *_fftwInTime;
+    Real *_fftwInTime;
 
     /// Buffer used to store the intermediate signal in the frequency domain
-    fftw_complex *_fftwMidFreq;
+    Complex *_fftwMidFreq;
 
     /// Buffer used to store the intermediate signal in the frequency domain for auto-correlation
-    fftw_complex *_fftwMidFreq2;
+    Complex *_fftwMidFreq2;
 
     /// Buffer used to store the output signal in the time domain for the auto-correlation
-    double *_fftwOutTimeAutocorr;
+    Real *_fftwOutTimeAutocorr;
+
+    // ** BATCHES ** //
+
+    /// Plans of _batchFrames frames, created by the first runBatch()
+    std::unique_ptr<PitchDetectionPlans<Real>> _batchPlans;
+
+    /// Number of frames transformed at once by runBatch()
+    size_t _batchFrames;
+
+    /// The buffers of runBatch(), with the frames of a batch one after the other
+    Real *_batchInTime;
+    Complex *_batchMidFreq;
+    Complex *_batchMidFreq2;
+    Real *_batchOutTimeAutocorr;
 };
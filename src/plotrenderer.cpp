@@ -0,0 +1,329 @@
+#include "plotrenderer.h"
+
+#include "simdkernels.h"
+#include "texthelper.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+
+const double PlotRenderer::X_MARGIN = 10;
+const double PlotRenderer::Y_MARGIN = 5;
+const double PlotRenderer::LABEL_SPACING = 3;
+const double PlotRenderer::MINOR_TICK_HEIGHT = 3;
+const double PlotRenderer::MIDDLE_TICK_HEIGHT = 5;
+const double PlotRenderer::MAJOR_TICK_HEIGHT = 7;
+
+PlotRenderer::PlotRenderer()
+    : _scaleRange(0.0),
+      _curveValid(false),
+      _staticLayerValid(false),
+      _renderProfilingEnabled(false),
+      _staticLayerRenders(0)
+{
+    const char *profEnv = getenv("QPITCH_PAINT_PROFILING");
+    if (profEnv != nullptr && strcmp(profEnv, "1") == 0) {
+        _renderProfilingEnabled = true;
+    }
+
+    _style.title = "No title";
+    _style.linePen = QPen(Qt::GlobalColor::darkGreen, 1.0);
+    _style.markerPen = QPen(Qt::GlobalColor::red, 1.0);
+
+    _marker = std::nullopt;
+}
+
+void PlotRenderer::setStyle(const PlotStyle &style)
+{
+    _style = style;
+    _staticLayerValid = false;
+}
+
+void PlotRenderer::setScaleRange(double scaleRange)
+{
+    // set with every frame, but only changes with the sample rate or the frame size
+    if (scaleRange != _scaleRange) {
+        _scaleRange = scaleRange;
+        _staticLayerValid = false;
+    }
+}
+
+void PlotRenderer::setData(std::span<const double> newData)
+{
+    _data = newData;
+    _curveValid = false;
+}
+
+void PlotRenderer::setMarker(std::optional<double> marker)
+{
+    _marker = marker;
+}
+
+void PlotRenderer::render(QImage &image)
+{
+    std::chrono::time_point<std::chrono::steady_clock> renderStart =
+            std::chrono::steady_clock::now();
+
+    // not laid out yet
+    if (_style.size.isEmpty()) {
+        image = QImage();
+        return;
+    }
+
+    // ** DRAW BOX, AXIS, SCALES AND TITLE ** //
+    if (!_staticLayerValid) {
+        renderStaticLayer();
+    }
+
+    // The image goes back and forth with the GUI thread, and keeps its pixels between frames.
+    if (image.size() != _staticLayer.size()
+        || image.devicePixelRatio() != _staticLayer.devicePixelRatio()) {
+        image = QImage(_staticLayer.size(), QImage::Format_ARGB32_Premultiplied);
+        image.setDevicePixelRatio(_staticLayer.devicePixelRatio());
+    }
+
+    QPainter painter;
+
+    painter.begin(&image);
+    painter.setCompositionMode(QPainter::CompositionMode_Source);
+    painter.drawImage(0, 0, _staticLayer);
+    painter.setCompositionMode(QPainter::CompositionMode_SourceOver);
+    painter.setRenderHint(QPainter::Antialiasing);
+
+    // ** DRAW CURVE ** //
+    drawCurve(painter, _plotAreaRc, 0.01);
+
+    // ** DRAW MARKER ** //
+    if (_marker.has_value()) {
+        double markerValue = _marker.value();
+        painter.setPen(_style.markerPen);
+        double markerX =
+                std::lerp(_plotAreaRc.left(), _plotAreaRc.right(), markerValue / _scaleRange);
+        painter.drawLine(QPointF(markerX, _plotAreaRc.top()),
+                         QPointF(markerX, _plotAreaRc.bottom()));
+    }
+
+    painter.end();
+
+    // ** PROFILE ** //
+    double renderDuration =
+            std::chrono::duration<double>(std::chrono::steady_clock::now() - renderStart).count();
+    if (_renderProfilingEnabled && _renderProfiler.record(renderDuration)) {
+        qInfo("[PlotRenderer %s] %llu renders, %.1lf us per render (max %.1lf us), static layer "
+              "rendered %llu times",
+              qPrintable(_style.title), (unsigned long long)_renderProfiler.getCount(),
+              _renderProfiler.getAverage() * 1e6, _renderProfiler.getMax() * 1e6,
+              (unsigned long long)_staticLayerRenders);
+        _staticLayerRenders = 0;
+    }
+}
+
+void PlotRenderer::renderStaticLayer()
+{
+    const qreal devicePixelRatio = _style.devicePixelRatio;
+    _staticLayer = QImage(_style.size * devicePixelRatio, QImage::Format_ARGB32_Premultiplied);
+    _staticLayer.setDevicePixelRatio(devicePixelRatio);
+    _staticLayer.fill(Qt::transparent);
+
+    QPainter painter;
+
+    painter.begin(&_staticLayer);
+    // unlike a widget, an image does not give its painter the font of the widget
+    painter.setFont(_style.font);
+    painter.setRenderHint(QPainter::Antialiasing);
+
+    // ** FONT-RELATED STUFF ** //
+    QFont titleFont = painter.font();
+    QFont scaleFont = painter.font();
+    scaleFont.setPointSizeF(scaleFont.pointSizeF() - 2.0);
+
+    TextHelper textHelper(painter);
+
+    QFontMetricsF titleFontMetrics(titleFont);
+    QFontMetricsF scaleFontMetrics(scaleFont);
+
+    double titleFontHeight = titleFontMetrics.height();
+    double scaleFontHeight = scaleFontMetrics.height();
+
+    // ** COMPUTE SIZES ** //
+    QRectF rc(QPointF(0.0, 0.0), QSizeF(_style.size));
+    QRectF marginedRc = rc.marginsRemoved(QMarginsF(X_MARGIN, Y_MARGIN, X_MARGIN, Y_MARGIN));
+    _plotAreaRc = marginedRc.marginsRemoved(
+            QMarginsF(0.0, titleFontHeight + LABEL_SPACING, 0.0, scaleFontHeight + LABEL_SPACING));
+
+    // ** DRAW BOX ** //
+    drawAxisBox(painter, _plotAreaRc);
+
+    // ** DRAW AXIS AND SCALES ** //
+    drawLinearAxis(painter, _plotAreaRc);
+
+    // ** DRAW TITLE ** //
+    painter.setPen(QPen(_style.palette.text(), 0, Qt::SolidLine));
+    textHelper.drawTextCenteredUp(
+            QPointF(_plotAreaRc.center().x(), _plotAreaRc.top() - LABEL_SPACING), _style.title);
+
+    painter.end();
+
+    _staticLayerValid = true;
+    // the plot area may have moved
+    _curveValid = false;
+    ++_staticLayerRenders;
+}
+
+void PlotRenderer::drawAxisBox(QPainter &painter, const QRectF &rc)
+{
+    // Draw the box with filling
+    painter.setPen(QPen(_style.palette.dark(), 1.0, Qt::SolidLine));
+    painter.setBrush(_style.palette.light());
+    painter.drawRect(rc);
+
+    // plot the x-axis
+    painter.setPen(QPen(_style.palette.dark(), 1.0, Qt::DashLine));
+    painter.drawLine(QPointF(rc.left(), rc.center().y()), QPointF(rc.right(), rc.center().y()));
+}
+
+void PlotRenderer::drawLinearAxis(QPainter &painter, const QRectF &rc)
+{
+    painter.save();
+    QFont scaleFont = painter.font();
+    scaleFont.setPointSize(scaleFont.pointSize() - 2);
+    painter.setFont(scaleFont);
+
+    TextHelper textHelper(painter);
+
+    QPen penTick(_style.palette.dark(), 1.0, Qt::SolidLine);
+    QPen penLabel(_style.palette.text().color());
+
+    auto drawTickAndLabel = [&](double xTick, int level, int maxLevel, double value) {
+        double tickHeight = level == 0 ? MAJOR_TICK_HEIGHT
+                : level == 1           ? MIDDLE_TICK_HEIGHT
+                                       : MINOR_TICK_HEIGHT;
+        painter.setPen(penTick);
+        painter.drawLine(QPointF(xTick, rc.bottom()), QPointF(xTick, rc.bottom() - tickHeight));
+
+        if (level <= maxLevel) {
+            QPointF textPoint(xTick, rc.bottom() + LABEL_SPACING);
+            painter.setPen(penLabel);
+            textHelper.drawTextCenteredDown(textPoint, QString("%1").arg(value));
+        }
+    };
+
+    // axis range
+    const double xAxisRange = _scaleRange;
+
+    if (0 < xAxisRange && xAxisRange < INFINITY) {
+        // xAxisRange = b * 10^p for some b where 1 <= b < 10
+        double p = std::floor(std::log10(xAxisRange));
+        double b1 = pow(10.0, p);
+
+        // Check if 1 <= b < 2
+        bool between1And2 = xAxisRange < b1 * 2;
+
+        double majorUnit;
+        double maxLevel;
+        if (!between1And2) {
+            // We usually keep one significant figure for the distance between major ticks.
+            // So if xAxisRange = 63, then major ticks will be at 0, 10, 20, 30, 40, 50 and 60.
+            majorUnit = b1;
+            maxLevel = 1;
+        } else {
+            // But if b == 1, we only make the major ticks one order of magnitude finer.
+            // So if xAxisRange = 13, we place major ticks at 0, 1, 2, 3, 4, ..., 9, 10, 11, 12, 13.
+            // In this way, we may have at most 20 major ticks, from 0 to 19.
+            majorUnit = b1 / 10.0;
+            maxLevel = 0;
+        }
+
+        for (int mi = 0; mi < 200; mi++) {
+            double value = majorUnit * mi / 10.0;
+
+            if (value > xAxisRange) {
+                break;
+            }
+
+            int level = mi % 10 == 0 ? 0 : mi % 5 == 0 ? 1 : 2;
+            double xTick = std::lerp(rc.left(), rc.right(), value / xAxisRange);
+            drawTickAndLabel(xTick, level, maxLevel, value);
+        }
+    }
+
+    painter.restore();
+}
+
+void PlotRenderer::drawCurve(QPainter &painter, const QRectF &rc, const double autoScaleThreshold)
+{
+    // enable antialiasing and plot signal samples
+    painter.setPen(_style.linePen);
+
+    if (_data.empty()) {
+        painter.drawLine(rc.topLeft(), rc.bottomRight());
+        painter.drawLine(rc.bottomLeft(), rc.topRight());
+        return;
+    }
+
+    if (!_curveValid) {
+        buildCurve(rc, autoScaleThreshold);
+    }
+
+    painter.drawPolyline(_curvePoints.data(), _curvePoints.size());
+}
+
+void PlotRenderer::buildCurve(const QRectF &rc, const double autoScaleThreshold)
+{
+    const SimdKernels<double> &kernels = SimdKernels<double>::best();
+    const size_t numSamples = _data.size();
+
+    // one column per device pixel, so that the envelope stays sharp on high density screens
+    const size_t numColumns =
+            std::max<size_t>(1, (size_t)std::ceil(rc.width() * _style.devicePixelRatio));
+    const bool decimate = numSamples > 2 * numColumns;
+
+    // find min and max of the signal in order to autoscale the signal up to 16 times
+    double minValue, maxValue;
+    if (decimate) {
+        _columnMinimum.resize(numColumns);
+        _columnMaximum.resize(numColumns);
+        for (size_t c = 0; c < numColumns; c++) {
+            // at least two samples per column
+            size_t begin = c * numSamples / numColumns;
+            size_t end = (c + 1) * numSamples / numColumns;
+            kernels.findMinMax(&_data[begin], end - begin, &_columnMinimum[c], &_columnMaximum[c]);
+        }
+        double unused;
+        kernels.findMinMax(_columnMinimum.data(), numColumns, &minValue, &unused);
+        kernels.findMinMax(_columnMaximum.data(), numColumns, &unused, &maxValue);
+    } else {
+        kernels.findMinMax(_data.data(), numSamples, &minValue, &maxValue);
+    }
+
+    // find the actual limit value and disable plot if it is below a given threshold
+    double limitValue = std::max(std::fabs(maxValue), std::fabs(minValue));
+
+    // y-axis is upside-down so use a negative scale factor to mirror the plot
+    double scaleFactor = -(0.95 * rc.height() / 2) / std::max(limitValue, autoScaleThreshold);
+
+    double xLeft = rc.left();
+    double xRight = rc.right();
+    double yMiddle = rc.center().y();
+    if (decimate) {
+        // A vertical span per column, drawn up and down in turn, so that the segments
+        // between the columns follow the upper and the lower edges of the envelope.
+        _curvePoints.resize(2 * numColumns);
+        for (size_t c = 0; c < numColumns; c++) {
+            double x = std::lerp(xLeft, xRight, (double)(c * numSamples / numColumns) / numSamples);
+            double yMin = yMiddle + _columnMinimum[c] * scaleFactor;
+            double yMax = yMiddle + _columnMaximum[c] * scaleFactor;
+            _curvePoints[2 * c] = QPointF(x, c % 2 == 0 ? yMin : yMax);
+            _curvePoints[2 * c + 1] = QPointF(x, c % 2 == 0 ? yMax : yMin);
+        }
+    } else {
+        _curvePoints.resize(numSamples);
+        for (size_t k = 0; k < numSamples; k++) {
+            _curvePoints[k].setX(std::lerp(xLeft, xRight, (double)k / numSamples));
+            _curvePoints[k].setY(yMiddle + _data[k] * scaleFactor);
+        }
+    }
+
+    _curveValid = true;
+}
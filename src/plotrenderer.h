@@ -0,0 +1,134 @@
+#pragma once
+
+#include "fpsprofiler.h"
+
+#include <QFont>
+#include <QImage>
+#include <QPainter>
+#include <QPalette>
+#include <QPen>
+#include <QSize>
+#include <QString>
+
+#include <optional>
+#include <span>
+#include <vector>
+
+/// The look of a plot, copied from its PlotView on the GUI thread for a PlotRenderer.
+struct PlotStyle
+{
+    enum class ScaleKind {
+        Linear,
+        Logarithmic,
+    };
+
+    QString title;
+    ScaleKind scaleKind = ScaleKind::Linear;
+    QPen linePen;
+    QPen markerPen;
+    QPalette palette;
+    QFont font;
+
+    /// Size of the widget, in device-independent pixels
+    QSize size;
+
+    /// Device pixel ratio of the widget
+    qreal devicePixelRatio = 1.0;
+};
+
+/// This class draws an oscilloscope-like plot of signals in the time domain or the frequency
+/// domain into a QImage.  It does not touch any widget, so it can run on any thread.
+///
+/// The box, the scale and the title only change with the style or the scale range, so they are
+/// rendered once into an image, and each frame only draws the curve and the marker over a copy of
+/// it.  Set QPITCH_PAINT_PROFILING=1 to log the render times.
+///
+/// Series longer than twice the width of the plot in device pixels are reduced to the minimum
+/// and the maximum of the samples of each pixel column, so that drawing a whole frame costs about
+/// as much as drawing a few hundred samples.  The curve is kept until the data or the style
+/// change.
+class PlotRenderer
+{
+public:
+    PlotRenderer();
+
+    void setStyle(const PlotStyle &style);
+    void setScaleRange(double scaleRange);
+    /// Set the samples to plot, without copying them.  They must stay valid and unchanged until
+    /// the next call.
+    void setData(std::span<const double> newData);
+    void setMarker(std::optional<double> marker);
+
+    /// Render a frame.
+    ///
+    /// \param[in,out] image the frame, only allocated again when the size of the plot changes
+    void render(QImage &image);
+
+private:
+    /// Horizontal margin in pixels
+    static const double X_MARGIN;
+
+    /// Vertical margin in pixels
+    static const double Y_MARGIN;
+
+    /// Pixel distance of the labels from the axis
+    static const double LABEL_SPACING;
+
+    /// Pixel height of the minor ticks
+    static const double MINOR_TICK_HEIGHT;
+
+    /// Pixel height of the minor ticks
+    static const double MIDDLE_TICK_HEIGHT;
+
+    /// Pixel height of the major ticks
+    static const double MAJOR_TICK_HEIGHT;
+
+    /// Render the box, the scale and the title into _staticLayer, and compute _plotAreaRc.
+    void renderStaticLayer();
+
+    void drawAxisBox(QPainter &painter, const QRectF &rc);
+    void drawLinearAxis(QPainter &painter, const QRectF &rc);
+    void drawCurve(QPainter &painter, const QRectF &rc, const double autoScaleThreshold);
+
+    /// Compute _curvePoints from _data, reduced to one vertical span per pixel column if needed.
+    void buildCurve(const QRectF &rc, const double autoScaleThreshold);
+
+    PlotStyle _style;
+    double _scaleRange;
+    std::span<const double> _data;
+    std::optional<double> _marker;
+
+    // ** CURVE ** //
+
+    /// The curve in device-independent coordinates
+    std::vector<QPointF> _curvePoints;
+
+    /// Set to false when _curvePoints must be computed again
+    bool _curveValid;
+
+    /// Minimum and maximum of the samples of each pixel column
+    std::vector<double> _columnMinimum;
+    std::vector<double> _columnMaximum;
+
+    // ** STATIC LAYER ** //
+
+    /// The box, the scale and the title, at the device pixel ratio of the widget
+    QImage _staticLayer;
+
+    /// Set to false when _staticLayer must be rendered again
+    bool _staticLayerValid;
+
+    /// The area of the curve, inside the box
+    QRectF _plotAreaRc;
+
+    // ** RENDER PROFILING ** //
+
+    /// Set to true to log the render times
+    bool _renderProfilingEnabled;
+
+    /// Time spent in render()
+    DurationProfiler _renderProfiler;
+
+    /// Number of renderStaticLayer() calls since the last report
+    uint64_t _staticLayerRenders;
+};
@@ -1,66 +1,54 @@
 #pragma once
 
+#include "plotrenderer.h"
+
+#include <QImage>
 #include <QString>
 #include <QWidget>
 #include <QPaintEvent>
 #include <QPen>
 
-#include <optional>
-
 /// This class implements an oscilloscope-like widget for the visualization of signals in the time
 /// domain or the frequency domain.
+///
+/// The widget only holds the look of the plot: the frames are rendered by a PlotRenderer on the
+/// RenderWorker thread, and paintEvent() blits the last one.
 class PlotView : public QWidget
 {
     Q_OBJECT
 
 public:
-    enum class ScaleKind {
-        Linear,
-        Logarithmic,
-    };
+    using ScaleKind = PlotStyle::ScaleKind;
 
     explicit PlotView(QWidget *parent = nullptr);
 
     void setTitle(const QString &title);
     void setScaleKind(ScaleKind scaleKind);
-    void setScaleRange(double scaleRange);
     void setLinePen(const QPen &pen);
     void setMarkerPen(const QPen &pen);
-    void setData(const std::vector<double> &newData);
-    void setMarker(std::optional<double> marker);
-
-protected:
-    virtual void paintEvent(QPaintEvent *event) override;
-
-private:
-    /// Horizontal margin in pixels
-    static const double X_MARGIN;
 
-    /// Vertical margin in pixels
-    static const double Y_MARGIN;
+    /// The look of the plot, including the size, the palette and the font of the widget.
+    PlotStyle getStyle() const;
 
-    /// Pixel distance of the labels from the axis
-    static const double LABEL_SPACING;
+    /// Set the frame to show, without copying it.  It must stay valid and unchanged until the
+    /// next call.
+    void setImage(const QImage *image);
 
-    /// Pixel height of the minor ticks
-    static const double MINOR_TICK_HEIGHT;
+signals:
+    /// Emitted when getStyle() changed, and the frames must be rendered again.
+    void styleChanged();
 
-    /// Pixel height of the minor ticks
-    static const double MIDDLE_TICK_HEIGHT;
-
-    /// Pixel height of the major ticks
-    static const double MAJOR_TICK_HEIGHT;
-
-    void drawAxisBox(QPainter &painter, const QRectF &rc);
-    void drawLinearAxis(QPainter &painter, const QRectF &rc);
-    void drawCurve(QPainter &painter, const QRectF &rc, const double autoScaleThreshold);
+protected:
+    virtual void paintEvent(QPaintEvent *event) override;
+    virtual void resizeEvent(QResizeEvent *event) override;
+    virtual void changeEvent(QEvent *event) override;
 
+private:
     QString _title;
     ScaleKind _scaleKind;
-    double _scaleRange;
     QPen _linePen;
     QPen _markerPen;
-    std::vector<double> _data;
-    std::vector<QPointF> _dataPoints;
-    std::optional<double> _marker;
+
+    /// The last frame rendered, or nullptr before the first one
+    const QImage *_image;
 };
@@ -27,6 +27,7 @@
 
 #include <cmath>
 
+#include <QPaintEvent>
 #include <QPainter>
 #include <QPainterPath>
 
@@ -41,31 +42,142 @@ const double QLogView::CARET_BORDER = 5.0;
 const double QLogView::CURSOR_WIDTH = 6.0;
 const double QLogView::CURSOR_HEIGHT = QLogView::BAR_HEIGHT - 1.0;
 const double QLogView::ACCEPTED_DEVIATION = 0.025;
+const double QLogView::DIRTY_MARGIN = 2.0;
 
-QLogView::QLogView(QWidget *parent) : QWidget(parent) { }
+QLogView::QLogView(QWidget *parent) : QWidget(parent), _staticLayerValid(false), _scaleWidth(0.0)
+{
+}
 
 void QLogView::setTuningParameters(std::shared_ptr<TuningParameters> tuningParameters)
 {
+    // the labels may have changed, even if the object is the same
     _tuningParameters = tuningParameters;
+    _staticLayerValid = false;
     update();
 }
 
 void QLogView::setEstimatedNote(std::optional<EstimatedNote> estimatedNote)
 {
+    if (!_staticLayerValid) {
+        // the geometry is not known yet, and the whole widget will be painted anyway
+        _estimatedNote = estimatedNote;
+        update();
+        return;
+    }
+
+    QRegion dirtyRegion = cursorRegion(_estimatedNote) + cursorRegion(estimatedNote);
+    std::optional<int> oldPitch, newPitch;
+    if (_estimatedNote) {
+        oldPitch = _estimatedNote->currentPitch;
+    }
+    if (estimatedNote) {
+        newPitch = estimatedNote->currentPitch;
+    }
+    if (oldPitch != newPitch) {
+        dirtyRegion += labelRegion(_estimatedNote) + labelRegion(estimatedNote);
+    }
+
     _estimatedNote = estimatedNote;
+    if (!dirtyRegion.isEmpty()) {
+        update(dirtyRegion);
+    }
 }
 
-void QLogView::paintEvent(QPaintEvent * /* event */)
+void QLogView::paintEvent(QPaintEvent *event)
 {
     Q_ASSERT(_tuningParameters);
 
+    // ** DRAW THE BAR, THE TICKS AND THE LABELS ** //
+    // The window may have moved to a screen with another device pixel ratio.
+    if (!_staticLayerValid || _staticLayer.devicePixelRatio() != devicePixelRatioF()) {
+        renderStaticLayer();
+    }
+
     // ** INITIALIZE PAINTER ** //
     QPainter painter;
 
     // setup the painter
     painter.begin(this);
+
+    // The labels of the identified note come from the other layer.
+    QRegion activeRegion = labelRegion(_estimatedNote) & event->region();
+    painter.setClipRegion(event->region() - activeRegion);
+    painter.drawPixmap(0, 0, _staticLayer);
+    if (!activeRegion.isEmpty()) {
+        painter.setClipRegion(activeRegion);
+        painter.drawPixmap(0, 0, _activeLabelLayer);
+    }
+    painter.setClipping(false);
+
     painter.setRenderHint(QPainter::Antialiasing);
+    painter.translate(_scaleOrigin);
+
+    // ** DRAW THE CURSOR IF REQUIRED ** //
+
+    if (_estimatedNote) {
+        const EstimatedNote &estimatedNote = _estimatedNote.value();
+
+        // draw the cursor
+        painter.setPen(QPen(palette().text(), 1.0, Qt::SolidLine));
+        double xCursor = _scaleWidth / 24.0
+                + _scaleWidth / 12.0
+                        * (estimatedNote.currentPitch + estimatedNote.currentPitchDeviation);
+        // TODO: Make sure this color contrasts well against palette().base()
+        QColor cursorColor(
+                (int)(0xAA + 0x55 * (1.0 - 2.0 * fabs(estimatedNote.currentPitchDeviation))), 0x00,
+                0x00);
+        painter.setBrush(cursorColor);
+
+        if (estimatedNote.currentPitchDeviation < -ACCEPTED_DEVIATION) {
+            // draw a right arrow if the pitch is lower than the reference
+            QPolygonF rightArrow;
+            rightArrow << QPointF(xCursor - CURSOR_WIDTH / 2, -CURSOR_HEIGHT)
+                       << QPointF(xCursor - CURSOR_WIDTH / 2, BAR_HEIGHT)
+                       << QPointF(xCursor + CURSOR_WIDTH / 2, 0)
+                       << QPointF(xCursor - CURSOR_WIDTH / 2, -CURSOR_HEIGHT);
+            painter.drawPolygon(rightArrow);
+        } else if (estimatedNote.currentPitchDeviation > ACCEPTED_DEVIATION) {
+            // draw a left arrow if the pitch is higher than the reference
+            QPolygonF leftArrow;
+            leftArrow << QPointF(xCursor + CURSOR_WIDTH / 2, -CURSOR_HEIGHT)
+                      << QPointF(xCursor + CURSOR_WIDTH / 2, BAR_HEIGHT)
+                      << QPointF(xCursor - CURSOR_WIDTH / 2, 0)
+                      << QPointF(xCursor + CURSOR_WIDTH / 2, -CURSOR_HEIGHT);
+            painter.drawPolygon(leftArrow);
+        } else {
+            // draw a rectangular cursor
+            painter.drawRect(QRectF(QPointF(xCursor - CURSOR_WIDTH / 2, -CURSOR_HEIGHT),
+                                    QSizeF(CURSOR_WIDTH, 2 * CURSOR_HEIGHT)));
+            painter.drawLine(QPointF(xCursor, -CURSOR_HEIGHT), QPointF(xCursor, CURSOR_HEIGHT));
+        }
+    }
+
+    painter.end();
+}
+
+void QLogView::resizeEvent(QResizeEvent *event)
+{
+    _staticLayerValid = false;
+    QWidget::resizeEvent(event);
+}
 
+void QLogView::changeEvent(QEvent *event)
+{
+    switch (event->type()) {
+    case QEvent::PaletteChange:
+    case QEvent::FontChange:
+    case QEvent::StyleChange:
+        _staticLayerValid = false;
+        update();
+        break;
+    default:
+        break;
+    }
+    QWidget::changeEvent(event);
+}
+
+void QLogView::renderStaticLayer()
+{
     // ** Prepare some common properties. ** //
 
     // Apply the side margin size.
@@ -73,11 +185,37 @@ void QLogView::paintEvent(QPaintEvent * /* event */)
     QPointF center = rect().center();
     QMarginsF margins(SIDE_MARGIN, 0.0, SIDE_MARGIN, 0.0);
     QRectF marginedRect = widgetRect.marginsRemoved(margins);
-    double scaleWidth = marginedRect.width();
+    _scaleWidth = marginedRect.width();
+    _scaleOrigin = QPointF(marginedRect.left(), center.y());
 
-    painter.translate(QPointF(marginedRect.left(), center.y()));
+    // ** RENDER BOTH LAYERS ** //
+    // TODO: Automatically pick a color or let the user pick one,
+    // and ensure it contrasts well with both palette().base() and palette().windowText().
+    const QPen penLabel(palette().windowText().color());
+    const QPen penActiveLabel(QColorConstants::Red);
 
-    QRectF barRect(QPointF(0.0, -BAR_HEIGHT), QSizeF(scaleWidth, 2.0 * BAR_HEIGHT));
+    const qreal devicePixelRatio = devicePixelRatioF();
+    for (QPixmap *layer : { &_staticLayer, &_activeLabelLayer }) {
+        *layer = QPixmap(size() * devicePixelRatio);
+        layer->setDevicePixelRatio(devicePixelRatio);
+        layer->fill(Qt::transparent);
+
+        QPainter painter;
+        painter.begin(layer);
+        // unlike a widget, a pixmap does not give its painter the font of the widget
+        painter.setFont(font());
+        painter.setRenderHint(QPainter::Antialiasing);
+        painter.translate(_scaleOrigin);
+        drawScale(painter, layer == &_staticLayer ? penLabel : penActiveLabel);
+        painter.end();
+    }
+
+    _staticLayerValid = true;
+}
+
+void QLogView::drawScale(QPainter &painter, const QPen &penLabel)
+{
+    QRectF barRect(QPointF(0.0, -BAR_HEIGHT), QSizeF(_scaleWidth, 2.0 * BAR_HEIGHT));
 
     // ** DRAW THE BAR AND THE TICKS ** //
 
@@ -88,7 +226,7 @@ void QLogView::paintEvent(QPaintEvent * /* event */)
 
     // plot ticks
     for (unsigned int k = 0; k <= 120; ++k) {
-        double xTick = scaleWidth / 120.0 * k;
+        double xTick = _scaleWidth / 120.0 * k;
         double tickHeight;
 
         if ((k + 5) % 10 == 0) {
@@ -114,62 +252,51 @@ void QLogView::paintEvent(QPaintEvent * /* event */)
     TextHelper textHelper(painter);
 
     // plot labels
-    QPen penLabel(palette().windowText().color());
-    // TODO: Automatically pick a color or let the user pick one,
-    // and ensure it contrasts well with both palette().base() and palette().windowText().
-    QPen penActiveLabel(QColorConstants::Red);
+    painter.setPen(penLabel);
 
     for (unsigned int k = 0; k < 12; ++k) {
-        double xTick = scaleWidth / 24.0 + scaleWidth / 12.0 * k;
-        const QString &labelAbove = _tuningParameters->getNoteLabel(k, false);
-        const QString &labelBelow = _tuningParameters->getNoteLabel(k, true);
-        painter.setPen(_estimatedNote && k == _estimatedNote->currentPitch ? penActiveLabel
-                                                                           : penLabel);
+        double xTick = _scaleWidth / 24.0 + _scaleWidth / 12.0 * k;
+        QString labelAbove = QString::fromUtf8(_tuningParameters->getNoteLabel(k, false));
+        QString labelBelow = QString::fromUtf8(_tuningParameters->getNoteLabel(k, true));
+        QPointF pointAbove(xTick, -BAR_HEIGHT - LABEL_OFFSET);
+        QPointF pointBelow(xTick, BAR_HEIGHT + LABEL_OFFSET);
         // label above the bar
-        textHelper.drawTextCenteredUp(QPointF(xTick, -BAR_HEIGHT - LABEL_OFFSET), labelAbove);
+        textHelper.drawTextCenteredUp(pointAbove, labelAbove);
         // label below the bar
-        textHelper.drawTextCenteredDown(QPointF(xTick, BAR_HEIGHT + LABEL_OFFSET), labelBelow);
-    }
-
-    // ** DRAW THE CURSOR IF REQUIRED ** //
+        textHelper.drawTextCenteredDown(pointBelow, labelBelow);
 
-    if (_estimatedNote) {
-        const EstimatedNote &estimatedNote = _estimatedNote.value();
-
-        // draw the cursor
-        painter.setPen(QPen(palette().text(), 1.0, Qt::SolidLine));
-        double xCursor = scaleWidth / 24.0
-                + scaleWidth / 12.0
-                        * (estimatedNote.currentPitch + estimatedNote.currentPitchDeviation);
-        // TODO: Make sure this color contrasts well against palette().base()
-        QColor cursorColor(
-                (int)(0xAA + 0x55 * (1.0 - 2.0 * fabs(estimatedNote.currentPitchDeviation))), 0x00,
-                0x00);
-        painter.setBrush(cursorColor);
+        // where they were drawn, from their baselines
+        QRectF rectAbove = fontMetrics.boundingRect(labelAbove).translated(
+                pointAbove - textHelper.toBottomCenter(labelAbove) + _scaleOrigin);
+        QRectF rectBelow = fontMetrics.boundingRect(labelBelow).translated(
+                pointBelow - textHelper.toTopCenter(labelBelow) + _scaleOrigin);
+        QMarginsF margin(DIRTY_MARGIN, DIRTY_MARGIN, DIRTY_MARGIN, DIRTY_MARGIN);
+        _labelRegions[k] = QRegion(rectAbove.marginsAdded(margin).toAlignedRect())
+                + QRegion(rectBelow.marginsAdded(margin).toAlignedRect());
+    }
+}
 
-        double cursorHeight = BAR_HEIGHT - 1;
+QRegion QLogView::cursorRegion(const std::optional<EstimatedNote> &estimatedNote) const
+{
+    if (!estimatedNote) {
+        return QRegion();
+    }
+    double xCursor = _scaleOrigin.x() + _scaleWidth / 24.0
+            + _scaleWidth / 12.0
+                    * (estimatedNote->currentPitch + estimatedNote->currentPitchDeviation);
+    // the arrows and the rectangle all fit in the bar
+    QRectF cursorRect(QPointF(xCursor - CURSOR_WIDTH / 2, _scaleOrigin.y() - BAR_HEIGHT),
+                      QPointF(xCursor + CURSOR_WIDTH / 2, _scaleOrigin.y() + BAR_HEIGHT));
+    return QRegion(cursorRect
+                           .marginsAdded(QMarginsF(DIRTY_MARGIN, DIRTY_MARGIN, DIRTY_MARGIN,
+                                                   DIRTY_MARGIN))
+                           .toAlignedRect());
+}
 
-        if (estimatedNote.currentPitchDeviation < -ACCEPTED_DEVIATION) {
-            // draw a right arrow if the pitch is lower than the reference
-            QPolygonF rightArrow;
-            rightArrow << QPointF(xCursor - CURSOR_WIDTH / 2, -CURSOR_HEIGHT)
-                       << QPointF(xCursor - CURSOR_WIDTH / 2, BAR_HEIGHT)
-                       << QPointF(xCursor + CURSOR_WIDTH / 2, 0)
-                       << QPointF(xCursor - CURSOR_WIDTH / 2, -CURSOR_HEIGHT);
-            painter.drawPolygon(rightArrow);
-        } else if (estimatedNote.currentPitchDeviation > ACCEPTED_DEVIATION) {
-            // draw a left arrow if the pitch is higher than the reference
-            QPolygonF leftArrow;
-            leftArrow << QPointF(xCursor + CURSOR_WIDTH / 2, -CURSOR_HEIGHT)
-                      << QPointF(xCursor + CURSOR_WIDTH / 2, BAR_HEIGHT)
-                      << QPointF(xCursor - CURSOR_WIDTH / 2, 0)
-                      << QPointF(xCursor + CURSOR_WIDTH / 2, -CURSOR_HEIGHT);
-            painter.drawPolygon(leftArrow);
-        } else {
-            // draw a rectangular cursor
-            painter.drawRect(QRectF(QPointF(xCursor - CURSOR_WIDTH / 2, -CURSOR_HEIGHT),
-                                    QSizeF(CURSOR_WIDTH, 2 * CURSOR_HEIGHT)));
-            painter.drawLine(QPointF(xCursor, -CURSOR_HEIGHT), QPointF(xCursor, CURSOR_HEIGHT));
-        }
+QRegion QLogView::labelRegion(const std::optional<EstimatedNote> &estimatedNote) const
+{
+    if (!estimatedNote || estimatedNote->currentPitch < 0 || estimatedNote->currentPitch >= 12) {
+        return QRegion();
     }
+    return _labelRegions[estimatedNote->currentPitch];
 }
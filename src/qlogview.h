@@ -26,12 +26,18 @@
 
 #include <QWidget>
 #include <QPicture>
+#include <QPixmap>
+#include <QRegion>
 
 /// Note scale visualization.
 ///
 /// A linear note scale is displayed using the chosen musical notation. A moving cursor gives a
 /// rough indication of the detected note. The identified note is highlighted and when the pitch
 /// deviation is smaller than 2.5% a red square is drawn around the note label.
+///
+/// The bar, the ticks and the labels only change with the size, the palette and the tuning
+/// parameters, so they are rendered once into a pixmap.  A new estimated note only repaints the
+/// old and the new cursor, and the labels of the old and the new note when it changes.
 class QLogView : public QWidget
 {
     Q_OBJECT
@@ -42,7 +48,7 @@ public: /* methods */
     /// \param[in] parent handle to the parent widget
     QLogView(QWidget *parent = 0);
 
-    /// Set the TuningParameters object
+    /// Set the TuningParameters object.  Call it again when the object is changed.
     void setTuningParameters(std::shared_ptr<TuningParameters> tuningParameters);
 
 public slots:
@@ -55,6 +61,16 @@ protected: /* methods */
     /// \param[in] event the details of the repaint event
     virtual void paintEvent(QPaintEvent *event);
 
+    /// Function called when the widget is resized.
+    ///
+    /// \param[in] event the details of the resize event
+    virtual void resizeEvent(QResizeEvent *event);
+
+    /// Function called when the palette, the font or the style change.
+    ///
+    /// \param[in] event the details of the change
+    virtual void changeEvent(QEvent *event);
+
 private: /* static constants */
     // ** WIDGETS SIZES ** //
     /// Percent width of the horizontal border
@@ -87,6 +103,25 @@ private: /* static constants */
     /// Pitch deviation where the cursor becomes a rectangle
     static const double ACCEPTED_DEVIATION;
 
+    /// Pixels around the cursor and the labels repainted with them, for the antialiasing
+    static const double DIRTY_MARGIN;
+
+private: /* methods */
+    /// Render _staticLayer and _activeLabelLayer, and compute the geometry of the scale.
+    void renderStaticLayer();
+
+    /// Draw the bar, the ticks and the labels, with the origin at the left end of the bar.
+    ///
+    /// \param[in] painter the painter to draw with
+    /// \param[in] penLabel the pen of the labels
+    void drawScale(QPainter &painter, const QPen &penLabel);
+
+    /// The area of the cursor of a note, in widget coordinates.
+    QRegion cursorRegion(const std::optional<EstimatedNote> &estimatedNote) const;
+
+    /// The area of the labels of a note, in widget coordinates.
+    QRegion labelRegion(const std::optional<EstimatedNote> &estimatedNote) const;
+
 private: /* members */
     // ** PITCH DETECTION PARAMETERS ** //
 
@@ -94,4 +129,24 @@ private: /* members */
     std::shared_ptr<TuningParameters> _tuningParameters;
 
     std::optional<EstimatedNote> _estimatedNote;
+
+    // ** STATIC LAYER ** //
+
+    /// The bar, the ticks and the labels, at the device pixel ratio of the widget
+    QPixmap _staticLayer;
+
+    /// The same with every label in the color of the active note
+    QPixmap _activeLabelLayer;
+
+    /// Set to false when the layers must be rendered again
+    bool _staticLayerValid;
+
+    /// Left end of the bar, in widget coordinates
+    QPointF _scaleOrigin;
+
+    /// Width of the bar
+    double _scaleWidth;
+
+    /// Area of the labels above and below the bar of each note, in widget coordinates
+    QRegion _labelRegions[12];
 };
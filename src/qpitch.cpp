@@ -27,19 +27,37 @@
 #include "qaboutdlg.h"
 #include "qsettingsdlg.h"
 #include "qpitchcore.h"
-#include "fpsprofiler.h"
+#include "renderworker.h"
 
+#include <QMessageBox>
+#include <QScreen>
 #include <QSettings>
 #include <QTimer>
 
-// ** CONSTANTS ** //
-const int QPitch::PLOT_BUFFER_SIZE = 551; // 44100 * 0.05 / 4 = 551.25
-// size computed to have a time range of 50 ms with an integer downsample ratio
-// sample rate = 44100 Hz --> downsample ratio = 4
-// sample rate = 22050 Hz --> downsample ratio = 2
+#include <algorithm>
+#include <chrono>
+#include <cmath>
 
-QPitch::QPitch(QMainWindow *parent) : QMainWindow(parent)
+// ** CONSTANTS ** //
+// lags of the autocorrelation: 12.5 ms at 44100 Hz, down to 80 Hz.  The frame and the spectrum
+// are shown whole, reduced to the width of the plots by PlotRenderer.
+const int QPitch::PLOT_BUFFER_SIZE = 551; // 44100 * 0.0125 = 551.25
+const double QPitch::RATE_INTERVAL = 1.0;
+const double QPitch::DEFAULT_DISPLAY_RATE = 60.0;
+
+QPitch::QPitch(const AudioSourceOptions &sourceOptions, QMainWindow *parent)
+    : QMainWindow(parent),
+      _renderWorker(nullptr),
+      _sourceKind(sourceOptions.kind),
+      _firstFrameDisplayed(false),
+      _frameTimer(nullptr),
+      _lastFrameNumber(0),
+      _rateFirstFrameNumber(0),
+      _rateDisplayedFrames(0),
+      _rateTotalAge(0.0)
 {
+    _startupTimer.start();
+
     _ui = std::make_unique<Ui::QPitch>();
 
     // ** SETUP THE MAIN WINDOW ** //
@@ -55,14 +73,20 @@ QPitch::QPitch(QMainWindow *parent) : QMainWindow(parent)
     QPitchCoreOptions pitchCoreOptions{
         .sampleFrequency = _settings.sampleFrequency,
         .fftFrameSize = _settings.fftFrameSize,
+        .pitchDetectorEngine = _settings.pitchDetectorEngine,
+        .zeroPaddingFactor = (int)_settings.zeroPaddingFactor,
+        .peakInterpolation = _settings.peakInterpolation,
+        .analysisRate = (double)_settings.analysisRate,
+        .analysisHop = _settings.analysisHop,
         .tuningParameters = *_tuningParameters,
     };
 
-    try {
-        _hQPitchCore = new QPitchCore(this, PLOT_BUFFER_SIZE, std::move(pitchCoreOptions));
-    } catch (QPaSoundInputException &e) {
-        e.report();
-    }
+    // The FFTW wisdom, the audio source and the FFTW plans are loaded, opened and made by the
+    // QPitchCore thread, while the window shows up.
+    _hQPitchCore = new QPitchCore(this, PLOT_BUFFER_SIZE, std::move(pitchCoreOptions),
+                                  sourceOptions, QPitchSettings::wisdomFilePath());
+
+    qInfo("[QPitch] QPitchCore created in %.3lf ms", _startupTimer.nsecsElapsed() / 1e6);
 
     // ** INITIALIZE CUSTOM WIDGETS ** //
 
@@ -92,6 +116,21 @@ QPitch::QPitch(QMainWindow *parent) : QMainWindow(parent)
 
     _ui->widget_qlogview->setTuningParameters(_tuningParameters);
 
+    // ** START THE RENDER WORKER ** //
+    // The plots are rendered off the GUI thread, which only blits them.
+    _renderWorker = new RenderWorker(this, _hQPitchCore);
+    const std::pair<PlotView *, RenderWorker::Plot> plots[] = {
+        { _ui->widget_plotSamples, RenderWorker::PlotSamples },
+        { _ui->widget_plotSpectrum, RenderWorker::PlotSpectrum },
+        { _ui->widget_plotAutoCorr, RenderWorker::PlotAutoCorr },
+    };
+    for (auto [view, plot] : plots) {
+        _renderWorker->setStyle(plot, view->getStyle());
+        connect(view, &PlotView::styleChanged, this,
+                [this, view, plot]() { _renderWorker->setStyle(plot, view->getStyle()); });
+    }
+    _renderWorker->start();
+
     // ** SETUP THE CONNECTIONS ** //
     // File menu
     connect(_ui->action_preferences, &QAction::triggered, this, &QPitch::showPreferencesDialog);
@@ -101,16 +140,31 @@ QPitch::QPitch(QMainWindow *parent) : QMainWindow(parent)
     connect(_ui->action_aboutQt, &QAction::triggered, qApp, &QApplication::aboutQt);
 
     // Internal connections
-    connect(_hQPitchCore, &QPitchCore::visualizationDataUpdated, this,
-            &QPitch::onVisualizationDataUpdated);
+    connect(_hQPitchCore, &QPitchCore::audioSourceStarted, this, &QPitch::onAudioSourceStarted);
+    connect(_hQPitchCore, &QPitchCore::audioSourceFailed, this, &QPitch::onAudioSourceFailed);
 
-    connect(_hQPitchCore, &QPitchCore::portAudioStreamStarted, this,
-            &QPitch::onPortAudioStreamStarted);
+    // ** SETUP THE STATUS BAR ** //
+    _sb_labelDeviceInfo.setIndent(10);
+    _ui->statusbar->addWidget(&_sb_labelDeviceInfo, 1);
+    _sb_labelStartup.setText("Starting the audio input...");
+    _ui->statusbar->addPermanentWidget(&_sb_labelStartup);
 
     // ** START THE QPITCH CORE THREAD ** //
     Q_ASSERT(_hQPitchCore != nullptr);
     _hQPitchCore->start();
 
+    // ** PACE THE DISPLAY ** //
+    // The UI takes the last frame analysed at the display rate, whatever the analysis rate: the
+    // frames in between are never drawn, and nothing queues up when the UI is slow.
+    _frameTimer = new QTimer(this);
+    _frameTimer->setTimerType(Qt::PreciseTimer);
+    connect(_frameTimer, &QTimer::timeout, this, &QPitch::onFrameTimer);
+    updateDisplayRate();
+    _frameTimer->start();
+    _rateTimer.start();
+    _ui->lineEdit_fps->setToolTip("Frames analysed / frames displayed per second, and the "
+                                  "average age of the frames displayed");
+
     // ** REMOVE MAXIMIZE BUTTON ** //
     Qt::WindowFlags flags = windowFlags();
     flags &= ~Qt::WindowMaximizeButtonHint;
@@ -121,6 +175,9 @@ QPitch::~QPitch()
 {
     // ** ENSURE THAT THE DATA ARE VALID ** //
     Q_ASSERT(_hQPitchCore != nullptr);
+
+    // The worker reads from QPitchCore, which is deleted with the other children.
+    _renderWorker->stop();
 }
 
 void QPitch::closeEvent(QCloseEvent * /* event */)
@@ -154,15 +211,36 @@ void QPitch::setApplicationSettings()
 {
     // ** UPDATE NOTE SCALE ** //
     _tuningParameters->setParameters(_settings.fundamentalFrequency, _settings.tuningNotation);
+    _ui->widget_qlogview->setTuningParameters(_tuningParameters);
 
     // ** INTIALIZE QPITCH CORE ** //
     QPitchCoreOptions pitchCoreOptions{
         .sampleFrequency = _settings.sampleFrequency,
         .fftFrameSize = _settings.fftFrameSize,
+        .pitchDetectorEngine = _settings.pitchDetectorEngine,
+        .zeroPaddingFactor = (int)_settings.zeroPaddingFactor,
+        .peakInterpolation = _settings.peakInterpolation,
+        .analysisRate = (double)_settings.analysisRate,
+        .analysisHop = _settings.analysisHop,
         .tuningParameters = *_tuningParameters,
     };
 
     _hQPitchCore->setOptions(std::move(pitchCoreOptions));
+
+    updateDisplayRate();
+}
+
+void QPitch::updateDisplayRate()
+{
+    double rate = _settings.displayRate;
+    if (rate == 0) {
+        rate = screen()->refreshRate();
+        if (!(rate > 0)) {
+            rate = DEFAULT_DISPLAY_RATE;
+        }
+    }
+    _frameTimer->setInterval(std::max(1, (int)std::lround(1000.0 / rate)));
+    qInfo("[QPitch] Displaying at %.0lf Hz (every %d ms)", rate, _frameTimer->interval());
 }
 
 void QPitch::showAboutDialog()
@@ -174,15 +252,9 @@ void QPitch::showAboutDialog()
 
 void QPitch::updateQPitchGui()
 {
-    static FPSProfiler fp("updateQPitchGui");
-    fp.tick();
-
     // ** UPDATE WIDGETS ** //
-    _ui->widget_plotSamples->update();
-    _ui->widget_plotSpectrum->update();
-    _ui->widget_plotAutoCorr->update();
-    _ui->widget_qlogview->update();
-    _ui->widget_freqDiff->update();
+    // the plots repaint with their new images, and the note scale and the deviation only their
+    // cursors, from setEstimatedNote()
 
     // ** UPDATE LABELS ** //
     if (_estimatedNote) {
@@ -198,38 +270,92 @@ void QPitch::updateQPitchGui()
         _ui->lineEdit_frequency->clear();
         _ui->lineEdit_cents->clear();
     }
+}
 
-    _ui->lineEdit_fps->setText(QString("%1").arg(fp.getFPS()));
+void QPitch::onFrameTimer()
+{
+    // ** TAKE THE LAST FRAME RENDERED ** //
+    // Nothing to redraw if no frame was rendered since the last tick.
+    if (const RenderedFrame *frame = _renderWorker->takeRenderedFrame()) {
+        showRenderedFrame(*frame);
+    }
+
+    // The next one is rendered while this one is displayed.
+    _renderWorker->requestFrame();
+
+    // ** MEASURE THE RATES ** //
+    double elapsed = _rateTimer.nsecsElapsed() / 1e9;
+    if (elapsed < RATE_INTERVAL) {
+        return;
+    }
+    QString text = QString("%1 / %2")
+                           .arg((_lastFrameNumber - _rateFirstFrameNumber) / elapsed, 0, 'f', 0)
+                           .arg(_rateDisplayedFrames / elapsed, 0, 'f', 0);
+    if (_rateDisplayedFrames > 0) {
+        text += QString(", %1 ms").arg(1000.0 * _rateTotalAge / _rateDisplayedFrames, 0, 'f', 1);
+    }
+    _ui->lineEdit_fps->setText(text);
+
+    _rateTimer.start();
+    _rateFirstFrameNumber = _lastFrameNumber;
+    _rateDisplayedFrames = 0;
+    _rateTotalAge = 0.0;
 }
 
-void QPitch::onVisualizationDataUpdated(VisualizationData *visData)
+void QPitch::showRenderedFrame(const RenderedFrame &frame)
 {
-    {
-        QMutexLocker visDataLocker(&visData->mutex);
-
-        _ui->widget_plotSamples->setData(visData->plotSample);
-        _ui->widget_plotSamples->setScaleRange(visData->plotSampleRange);
-        _ui->widget_plotSpectrum->setData(visData->plotSpectrum);
-        _ui->widget_plotSpectrum->setScaleRange(visData->plotSpectrumRange);
-        _ui->widget_plotSpectrum->setMarker(visData->estimatedFrequency);
-        _ui->widget_plotAutoCorr->setData(visData->plotAutoCorr);
-        _ui->widget_plotAutoCorr->setScaleRange(visData->plotAutoCorrRange);
-        double estimatedPeriod = 1000.0
-                / visData->estimatedFrequency; // Period of the detected frequency, in milliseconds.
-        _ui->widget_plotAutoCorr->setMarker(estimatedPeriod);
-
-        _ui->widget_qlogview->setEstimatedNote(visData->estimatedNote);
-        _estimatedNote = visData->estimatedNote;
-        _ui->widget_freqDiff->setEstimatedNote(visData->estimatedNote);
+    // The plots blit straight from the frame, which stays unchanged until the next one is taken.
+    _ui->widget_plotSamples->setImage(&frame.plots[RenderWorker::PlotSamples]);
+    _ui->widget_plotSpectrum->setImage(&frame.plots[RenderWorker::PlotSpectrum]);
+    _ui->widget_plotAutoCorr->setImage(&frame.plots[RenderWorker::PlotAutoCorr]);
+
+    // Only the look of the plots changed.
+    if (frame.frameNumber == _lastFrameNumber) {
+        return;
     }
+
+    _ui->widget_qlogview->setEstimatedNote(frame.estimatedNote);
+    _estimatedNote = frame.estimatedNote;
+    _ui->widget_freqDiff->setEstimatedNote(frame.estimatedNote);
+
     updateQPitchGui();
+
+    // ** STAMP THE FRAME ** //
+    // Its age is the time since its samples were read, which includes the analysis, the rendering
+    // and the waits for the ticks.
+    _lastFrameNumber = frame.frameNumber;
+    ++_rateDisplayedFrames;
+    _rateTotalAge += std::chrono::duration<double>(std::chrono::steady_clock::now()
+                                                   - frame.analysisTime)
+                             .count();
+
+    if (!_firstFrameDisplayed) {
+        _firstFrameDisplayed = true;
+        _sb_labelStartup.hide();
+        qInfo("[QPitch] First reading displayed %.3lf ms after the startup",
+              _startupTimer.nsecsElapsed() / 1e6);
+    }
 }
 
-void QPitch::onPortAudioStreamStarted(QString device, QString hostApi)
+void QPitch::onAudioSourceStarted(QString device, QString hostApi)
 {
-    // ** SETUP THE STATUS BAR ** //
+    // ** UPDATE THE STATUS BAR ** //
     QString msg = QString("Device: %1, Host API: %2").arg(device).arg(hostApi);
     _sb_labelDeviceInfo.setText(msg);
-    _sb_labelDeviceInfo.setIndent(10);
-    _ui->statusbar->addWidget(&_sb_labelDeviceInfo, 1);
+    if (!_firstFrameDisplayed) {
+        _sb_labelStartup.setText("Waiting for samples...");
+    }
+    qInfo("[QPitch] Audio source started %.3lf ms after the startup",
+          _startupTimer.nsecsElapsed() / 1e6);
+}
+
+void QPitch::onAudioSourceFailed(QString message)
+{
+    _sb_labelStartup.setText("Audio input error");
+
+    // Files and pipes are used for unattended tests, with no one to close the dialog.
+    if (_sourceKind == AudioSourceKind::PortAudio) {
+        QMessageBox::critical(this, "QPitch", QString("Audio input error: %1.").arg(message));
+    }
+    QCoreApplication::exit(1);
 }
@@ -22,15 +22,19 @@
 
 #pragma once
 
+#include "audiosource.h"
 #include "qpitchsettings.h"
 #include "visualization_data.h"
 
+#include <QElapsedTimer>
 #include <QLabel>
 #include <QMainWindow>
 #include <memory>
 
 class QPitchCore;
 class QTimer;
+class RenderWorker;
+struct RenderedFrame;
 
 namespace Ui {
 class QPitch;
@@ -48,8 +52,13 @@ class QPitch : public QMainWindow
 public: /* methods */
     /// Constructor.
     ///
+    /// The window can be shown right away: the audio source is opened by the QPitchCore thread,
+    /// and the application exits if it cannot be.
+    ///
+    /// \param[in] sourceOptions where the samples come from
     /// \param[in] parent the parent widget
-    QPitch(QMainWindow *parent = 0);
+    QPitch(const AudioSourceOptions &sourceOptions = AudioSourceOptions(),
+           QMainWindow *parent = 0);
 
     /// Destructor. All resources are freed using smart pointers or Qt parent mechanism, but we must
     /// define the destructor body in .cpp where `Ui::QPitch` is complete. This is required for the
@@ -65,7 +74,14 @@ protected: /* methods */
 
 private: /* static constants */
     // ** BUFFER SIZE ** //
-    static const int PLOT_BUFFER_SIZE; /// Size of the buffers used for visualization
+    static const int PLOT_BUFFER_SIZE; /// Number of lags of the autocorrelation plot
+
+    // ** DISPLAY PACING ** //
+    /// Seconds over which the analysis and display rates are measured
+    static const double RATE_INTERVAL;
+
+    /// Display rate when the refresh rate of the screen is unknown
+    static const double DEFAULT_DISPLAY_RATE;
 
 private: /* members */
     // ** Configurations ** //
@@ -79,11 +95,56 @@ private: /* members */
     /// Handle to the working thread
     QPitchCore *_hQPitchCore;
 
+    /// Handle to the thread that renders the plots
+    RenderWorker *_renderWorker;
+
     // ** STATUS BAR ITEMS ** //
 
     /// Label with the device information
     QLabel _sb_labelDeviceInfo;
 
+    /// Label with the progress of the startup, hidden once the first frame is displayed
+    QLabel _sb_labelStartup;
+
+    // ** STARTUP ** //
+
+    /// Where the samples come from
+    AudioSourceKind _sourceKind;
+
+    /// Started by the constructor, to log the time to the first reading
+    QElapsedTimer _startupTimer;
+
+    /// Set to true once the first frame is displayed
+    bool _firstFrameDisplayed;
+
+    // ** DISPLAY PACING ** //
+
+    /// Takes the last frame rendered at the display rate
+    QTimer *_frameTimer;
+
+    /// Started at the beginning of the current measurement of the rates
+    QElapsedTimer _rateTimer;
+
+    /// VisualizationData::frameNumber of the last frame displayed
+    uint64_t _lastFrameNumber;
+
+    /// _lastFrameNumber at the beginning of the measurement
+    uint64_t _rateFirstFrameNumber;
+
+    /// Number of frames displayed since the beginning of the measurement
+    uint64_t _rateDisplayedFrames;
+
+    /// Sum of the ages of these frames when they were displayed, in seconds
+    double _rateTotalAge;
+
+private: /* methods */
+    /// Set the interval of _frameTimer from the display rate of the settings, or the refresh
+    /// rate of the screen.
+    void updateDisplayRate();
+
+    /// Show a frame rendered by the render worker.  It must stay unchanged until the next one.
+    void showRenderedFrame(const RenderedFrame &frame);
+
     // ** PITCH ESTIMATION ** //
 
     std::optional<EstimatedNote> _estimatedNote;
@@ -101,9 +162,13 @@ private slots:
     /// Update all the elements in the GUI.
     void updateQPitchGui();
 
-    /// Handle updated VisualizationData
-    void onVisualizationDataUpdated(VisualizationData *visData);
+    /// Take and show the last frame rendered, if there is a new one, request the next one, and
+    /// measure the rates.
+    void onFrameTimer();
+
+    /// Called when the audio source is started.
+    void onAudioSourceStarted(QString device, QString hostApi);
 
-    /// Called when the PortAudio stream is started.
-    void onPortAudioStreamStarted(QString device, QString hostApi);
+    /// Called when the audio source cannot be opened or started.  Exits the application.
+    void onAudioSourceFailed(QString message);
 };
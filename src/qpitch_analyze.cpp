@@ -0,0 +1,589 @@
+/// Headless batch pitch analysis of WAV files.
+///
+/// Runs the pitch detection of the tuner over recorded takes, without a display, and writes the
+/// frequency, the note and its deviation in cents for every analysis frame:
+///
+/// qpitch-analyze [--output frames.csv] [--format csv|json] [--jobs N] [--settings] take.wav...
+///
+/// The files are cut into chunks of --chunk seconds, which a pool of worker threads analyses in
+/// parallel.  Each worker owns its pitch detector, which transforms several frames of a chunk at
+/// once (PitchDetector::runBatch), and reads the samples straight from the mapping of the file,
+/// so the workers share nothing but the index of the next chunk; the results are written in the
+/// order of the files by the main thread as soon as every chunk of a file is done.
+/// The throughput, in seconds of audio per second, is reported on stderr.
+
+#include "audiosource.h"
+#include "fftwplanner.h"
+#include "fftwtraits.h"
+#include "notes.h"
+#include "pitchdetection.h"
+#include "qpitchsettings.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QLoggingCategory>
+
+// ** ANALYSIS PARAMETERS ** //
+
+/// Names of the peak interpolation methods on the command line, in the order of PeakInterpolation
+static const char *const PEAK_INTERPOLATION_NAMES[] = { "none", "parabolic", "gaussian", "sinc" };
+
+/// The name of an engine on the command line: "autocorrelation", "yin", "mcleod", "sliding-dft".
+static QString engineOptionName(PitchDetectorEngine engine)
+{
+    return QString(pitchDetectorEngineName(engine)).toLower().replace(' ', '-');
+}
+
+/// The analysis settings shared by all the workers.
+struct AnalysisOptions
+{
+    QPitchSettings settings;
+
+    /// Number of new samples between two analysis frames, or 0 for the analysis rate of the
+    /// settings at the sample rate of each file
+    size_t hop = 0;
+
+    /// Duration of the chunks handed to the workers, in seconds
+    double chunkDuration = 30.0;
+
+    /// Scale used to name the notes
+    TuningParameters tuningParameters{ 440.0, TuningNotation::US };
+};
+
+// ** FILES AND CHUNKS ** //
+
+/// The result of one analysis frame.
+struct FrameResult
+{
+    /// The estimated frequency, or 0 if there was no pitch
+    double frequency;
+
+    std::optional<EstimatedNote> note;
+};
+
+/// A file to analyse.
+struct InputFile
+{
+    QString path;
+    uint32_t sampleFrequency = 0;
+    size_t hop = 0;
+
+    /// Duration of the file, in seconds
+    double duration = 0.0;
+
+    /// Number of analysis frames: every full frame of fftFrameSize samples, hop samples apart
+    size_t numFrames = 0;
+
+    /// Range of the chunks of the file in BatchAnalyzer::_chunks
+    size_t firstChunk = 0;
+    size_t numChunks = 0;
+
+    /// Chunks not analysed yet.  Guarded by the mutex of the analyzer.
+    size_t pendingChunks = 0;
+
+    /// Why the file could not be analysed, if it could not
+    std::string error;
+};
+
+/// A run of consecutive analysis frames of a file, analysed by one worker.
+struct Chunk
+{
+    size_t file;
+    size_t firstFrame;
+    size_t numFrames;
+
+    /// Written by the worker, read and released by the main thread once the file is complete
+    std::vector<FrameResult> results;
+};
+
+// ** OUTPUT ** //
+
+/// Writes the frames of the files, as CSV or as JSON.
+class ResultWriter
+{
+public:
+    ResultWriter(FILE *stream, bool json, const AnalysisOptions &options)
+        : _stream(stream), _json(json), _options(options), _numFiles(0)
+    {
+    }
+
+    void begin()
+    {
+        fputs(_json ? "[\n" : "file,time,frequency,note,cents,note_frequency\n", _stream);
+    }
+
+    /// Write the frames of a complete file.
+    void write(const InputFile &file, const std::vector<Chunk> &chunks)
+    {
+        const size_t fftFrameSize = _options.settings.fftFrameSize;
+        QByteArray path = file.path.toUtf8();
+        if (_json) {
+            fprintf(_stream, "%s  {\"file\": %s, \"sample_frequency\": %u, \"frames\": [",
+                    _numFiles > 0 ? ",\n" : "", jsonString(path).constData(),
+                    file.sampleFrequency);
+        } else {
+            path = csvField(path);
+        }
+
+        size_t frame = 0;
+        for (size_t c = file.firstChunk; c < file.firstChunk + file.numChunks; ++c) {
+            for (const FrameResult &result : chunks[c].results) {
+                double time = (frame * file.hop + fftFrameSize / 2.0) / file.sampleFrequency;
+                QByteArray note = result.note ? noteName(*result.note) : QByteArray();
+                double cents = result.note ? result.note->currentPitchDeviation * 100.0 : 0.0;
+                double noteFrequency = result.note ? result.note->noteFrequency : 0.0;
+                if (_json) {
+                    fprintf(_stream,
+                            "%s\n    {\"time\": %.6f, \"frequency\": %.4f, \"note\": %s, "
+                            "\"cents\": %.2f, \"note_frequency\": %.4f}",
+                            frame > 0 ? "," : "", time, result.frequency,
+                            result.note ? jsonString(note).constData() : "null", cents,
+                            noteFrequency);
+                } else {
+                    fprintf(_stream, "%s,%.6f,%.4f,%s,%.2f,%.4f\n", path.constData(), time,
+                            result.frequency, note.constData(), cents, noteFrequency);
+                }
+                ++frame;
+            }
+        }
+
+        if (_json) {
+            fputs(frame > 0 ? "\n  ]}" : "]}", _stream);
+        }
+        ++_numFiles;
+    }
+
+    void end()
+    {
+        if (_json) {
+            fputs(_numFiles > 0 ? "\n]\n" : "]\n", _stream);
+        }
+        fflush(_stream);
+    }
+
+private:
+    /// The note in scientific pitch notation, e.g. "A4".
+    QByteArray noteName(const EstimatedNote &note) const
+    {
+        return QByteArray(_options.tuningParameters.getNoteLabel(note.currentPitch, false))
+                + QByteArray::number(note.octave);
+    }
+
+    static QByteArray jsonString(const QByteArray &text)
+    {
+        QByteArray quoted = "\"";
+        for (char c : text) {
+            if (c == '"' || c == '\\') {
+                quoted += '\\';
+                quoted += c;
+            } else if ((unsigned char)c < 0x20) {
+                quoted += QByteArray("\\u00") + QByteArray::number((unsigned char)c, 16)
+                                                        .rightJustified(2, '0');
+            } else {
+                quoted += c;
+            }
+        }
+        return quoted + "\"";
+    }
+
+    static QByteArray csvField(const QByteArray &text)
+    {
+        if (!text.contains(',') && !text.contains('"') && !text.contains('\n')) {
+            return text;
+        }
+        QByteArray quoted = text;
+        return "\"" + quoted.replace("\"", "\"\"") + "\"";
+    }
+
+    FILE *_stream;
+    bool _json;
+    const AnalysisOptions &_options;
+    size_t _numFiles;
+};
+
+// ** BATCH ANALYZER ** //
+
+/// Analyses the chunks of a list of files on a pool of worker threads.
+class BatchAnalyzer
+{
+public:
+    explicit BatchAnalyzer(const AnalysisOptions &options) : _options(options), _nextChunk(0) { }
+
+    /// Read the headers of the files and cut them into chunks.  The files that cannot be read are
+    /// reported by run().
+    void scan(const QStringList &paths)
+    {
+        size_t fftFrameSize = _options.settings.fftFrameSize;
+
+        for (const QString &path : paths) {
+            InputFile file;
+            file.path = path;
+            file.firstChunk = _chunks.size();
+
+            try {
+                WavFileSource source(path, false, false);
+                file.sampleFrequency = source.getSampleFrequency(0);
+                file.hop = (_options.hop > 0)
+                        ? _options.hop
+                        : std::max<size_t>(1, file.sampleFrequency
+                                                      / _options.settings.analysisRate);
+                file.duration = (double)source.getNumFrames() / file.sampleFrequency;
+                if (source.getNumFrames() >= fftFrameSize) {
+                    file.numFrames = (source.getNumFrames() - fftFrameSize) / file.hop + 1;
+                }
+            } catch (AudioSourceException &e) {
+                file.error = e.what();
+            }
+
+            if (file.numFrames > 0) {
+                size_t framesPerChunk = std::max<size_t>(
+                        1, (size_t)(_options.chunkDuration * file.sampleFrequency / file.hop));
+                for (size_t frame = 0; frame < file.numFrames; frame += framesPerChunk) {
+                    _chunks.push_back(Chunk{ _files.size(), frame,
+                                             std::min(framesPerChunk, file.numFrames - frame),
+                                             {} });
+                }
+            }
+            file.numChunks = _chunks.size() - file.firstChunk;
+            file.pendingChunks = file.numChunks;
+            _files.push_back(std::move(file));
+        }
+    }
+
+    /// Analyse the files on numWorkers threads, and write the results of each file in order as
+    /// soon as it is complete.
+    ///
+    /// \return the number of files that could not be analysed
+    size_t run(int numWorkers, ResultWriter &writer)
+    {
+        std::vector<std::thread> workers;
+        for (int i = 0; i < numWorkers; ++i) {
+            workers.emplace_back(&BatchAnalyzer::work, this);
+        }
+
+        size_t numErrors = 0;
+        writer.begin();
+        for (InputFile &file : _files) {
+            {
+                std::unique_lock<std::mutex> locker(_mutex);
+                _cond.wait(locker, [&file]() { return file.pendingChunks == 0; });
+            }
+
+            if (!file.error.empty()) {
+                fprintf(stderr, "qpitch-analyze: %s\n", file.error.c_str());
+                ++numErrors;
+            } else {
+                if (file.numFrames == 0) {
+                    fprintf(stderr, "qpitch-analyze: %s: shorter than one frame\n",
+                            qPrintable(file.path));
+                }
+                writer.write(file, _chunks);
+                _audioDuration += file.duration;
+            }
+
+            // the results of a file are only written once
+            for (size_t c = file.firstChunk; c < file.firstChunk + file.numChunks; ++c) {
+                std::vector<FrameResult>().swap(_chunks[c].results);
+            }
+        }
+        writer.end();
+
+        for (std::thread &worker : workers) {
+            worker.join();
+        }
+        return numErrors;
+    }
+
+    /// Seconds of audio in the files analysed by run().
+    double getAudioDuration() const
+    {
+        return _audioDuration;
+    }
+
+    /// Number of frames analysed by run().
+    uint64_t getNumFramesAnalysed() const
+    {
+        return _numFramesAnalysed.load(std::memory_order_relaxed);
+    }
+
+private:
+    /// Main loop of a worker: analyse chunks until there are none left.
+    void work()
+    {
+        const QPitchSettings &settings = _options.settings;
+        const size_t fftFrameSize = settings.fftFrameSize;
+
+        // the detector is only created again when the sample rate changes
+        std::unique_ptr<PitchDetector<AnalysisReal>> detector;
+        uint32_t detectorFrequency = 0;
+        std::vector<float> samples;
+        std::vector<double> frequencies;
+
+        size_t index;
+        while ((index = _nextChunk.fetch_add(1, std::memory_order_relaxed)) < _chunks.size()) {
+            Chunk &chunk = _chunks[index];
+            InputFile &file = _files[chunk.file];
+            std::string error;
+
+            try {
+                WavFileSource source(file.path, false, false);
+
+                if (!detector || detectorFrequency != file.sampleFrequency) {
+                    detector = PitchDetector<AnalysisReal>::create(
+                            settings.pitchDetectorEngine, file.sampleFrequency, fftFrameSize,
+                            settings.zeroPaddingFactor, settings.peakInterpolation);
+                    detectorFrequency = file.sampleFrequency;
+                }
+
+                // convert the samples of the whole chunk once, and analyse its frames in place,
+                // several at a time
+                size_t firstSample = chunk.firstFrame * file.hop;
+                size_t numSamples = (chunk.numFrames - 1) * file.hop + fftFrameSize;
+                samples.resize(numSamples);
+                if (source.readSamples(firstSample, samples.data(), numSamples) != numSamples) {
+                    throw AudioSourceException(
+                            QString("%1: file changed during the analysis").arg(file.path)
+                                    .toStdString());
+                }
+
+                frequencies.resize(chunk.numFrames);
+                detector->runBatch(samples.data(), file.hop, chunk.numFrames, frequencies.data());
+
+                chunk.results.resize(chunk.numFrames);
+                for (size_t i = 0; i < chunk.numFrames; ++i) {
+                    double frequency = frequencies[i];
+                    chunk.results[i] = FrameResult{
+                        frequency, _options.tuningParameters.estimateNote(frequency)
+                    };
+                }
+
+                _numFramesAnalysed.fetch_add(chunk.numFrames, std::memory_order_relaxed);
+            } catch (AudioSourceException &e) {
+                error = e.what();
+            }
+
+            std::lock_guard<std::mutex> locker(_mutex);
+            if (!error.empty()) {
+                file.error = error;
+            }
+            if (--file.pendingChunks == 0) {
+                _cond.notify_all();
+            }
+        }
+    }
+
+    const AnalysisOptions &_options;
+
+    std::vector<InputFile> _files;
+
+    /// The chunks of all the files, in the order of the files
+    std::vector<Chunk> _chunks;
+
+    /// The next chunk to hand to a worker
+    std::atomic<size_t> _nextChunk;
+
+    /// Only touched by the main thread
+    double _audioDuration = 0.0;
+
+    std::atomic<uint64_t> _numFramesAnalysed{ 0 };
+
+    /// Guards the completion of the files
+    std::mutex _mutex;
+    std::condition_variable _cond;
+};
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("qpitch-analyze");
+
+    QPitchSettings defaults;
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Pitch analysis of WAV files, without a display");
+    parser.addHelpOption();
+    parser.addPositionalArgument("files", "The WAV files to analyse (first channel).",
+                                 "file.wav...");
+    QCommandLineOption outputOption("output", "Write the frames to <file> instead of stdout.",
+                                    "file");
+    QCommandLineOption formatOption("format", "Write the frames as csv or json.", "format", "csv");
+    QCommandLineOption jobsOption("jobs", "Number of worker threads.  Defaults to the number of "
+                                          "cores.",
+                                  "N");
+    QCommandLineOption chunkOption("chunk", "Duration of the chunks of the files given to the "
+                                            "workers.",
+                                   "seconds", "30");
+    QCommandLineOption settingsOption("settings", "Start from the settings and the FFTW wisdom of "
+                                                  "the tuner rather than from the defaults.");
+    QCommandLineOption engineOption("engine", "The pitch detection engine: autocorrelation, yin, "
+                                              "mcleod or sliding-dft.",
+                                    "engine");
+    QCommandLineOption frameSizeOption("frame-size", "Number of samples in each analysis frame.",
+                                       "samples");
+    QCommandLineOption hopOption("hop", "Number of new samples between two analysis frames.  "
+                                        "Defaults to the analysis rate of the settings.",
+                                 "samples");
+    QCommandLineOption zeroPaddingOption("zero-padding", "Zero-padding factor of the "
+                                                         "autocorrelation.",
+                                         "factor");
+    QCommandLineOption interpolationOption("interpolation", "Peak interpolation of the "
+                                                            "autocorrelation: none, parabolic, "
+                                                            "gaussian or sinc.",
+                                           "method");
+    QCommandLineOption referenceOption("reference", "The frequency of A4.", "Hz");
+    QCommandLineOption wisdomOption("wisdom", "Load FFTW wisdom from <file> before planning.",
+                                    "file");
+    QCommandLineOption verboseOption("verbose", "Log each file opened and each plan created.");
+    parser.addOptions({ outputOption, formatOption, jobsOption, chunkOption, settingsOption,
+                        engineOption, frameSizeOption, hopOption, zeroPaddingOption,
+                        interpolationOption, referenceOption, wisdomOption, verboseOption });
+    parser.process(app);
+
+    if (!parser.isSet(verboseOption)) {
+        QLoggingCategory::setFilterRules("*.info=false\n*.debug=false");
+    }
+
+    // ** ANALYSIS OPTIONS ** //
+    AnalysisOptions options;
+    if (parser.isSet(settingsOption)) {
+        options.settings.load();
+        FFTWPlanner::loadWisdom<AnalysisReal>(QPitchSettings::wisdomFilePath().toStdString());
+    }
+    if (parser.isSet(wisdomOption)) {
+        FFTWPlanner::loadWisdom<AnalysisReal>(parser.value(wisdomOption).toStdString());
+    }
+
+    auto invalid = [](const QCommandLineOption &option, const QString &value) {
+        fprintf(stderr, "qpitch-analyze: invalid --%s: %s\n", qPrintable(option.names().first()),
+                qPrintable(value));
+        return 1;
+    };
+
+    if (parser.isSet(engineOption)) {
+        QString name = parser.value(engineOption).toLower();
+        bool found = false;
+        for (PitchDetectorEngine engine :
+             { PitchDetectorEngine::Autocorrelation, PitchDetectorEngine::Yin,
+               PitchDetectorEngine::McLeod, PitchDetectorEngine::SlidingDft }) {
+            if (name == engineOptionName(engine)) {
+                options.settings.pitchDetectorEngine = engine;
+                found = true;
+            }
+        }
+        if (!found) {
+            return invalid(engineOption, name);
+        }
+    }
+    if (parser.isSet(interpolationOption)) {
+        QString name = parser.value(interpolationOption).toLower();
+        bool found = false;
+        for (int i = 0; i <= (int)PeakInterpolation::Sinc; ++i) {
+            if (name == PEAK_INTERPOLATION_NAMES[i]) {
+                options.settings.peakInterpolation = (PeakInterpolation)i;
+                found = true;
+            }
+        }
+        if (!found) {
+            return invalid(interpolationOption, name);
+        }
+    }
+
+    bool ok = true;
+    if (parser.isSet(frameSizeOption)) {
+        options.settings.fftFrameSize = parser.value(frameSizeOption).toUInt(&ok);
+        if (!ok || options.settings.fftFrameSize < 64) {
+            return invalid(frameSizeOption, parser.value(frameSizeOption));
+        }
+    }
+    if (parser.isSet(hopOption)) {
+        options.hop = parser.value(hopOption).toUInt(&ok);
+        if (!ok || options.hop == 0) {
+            return invalid(hopOption, parser.value(hopOption));
+        }
+    } else if (options.settings.analysisHop > 0) {
+        options.hop = options.settings.analysisHop;
+    }
+    if (parser.isSet(zeroPaddingOption)) {
+        options.settings.zeroPaddingFactor = parser.value(zeroPaddingOption).toUInt(&ok);
+        if (!ok || options.settings.zeroPaddingFactor == 0) {
+            return invalid(zeroPaddingOption, parser.value(zeroPaddingOption));
+        }
+    }
+    if (parser.isSet(referenceOption)) {
+        options.settings.fundamentalFrequency = parser.value(referenceOption).toDouble(&ok);
+        if (!ok || options.settings.fundamentalFrequency <= 0.0) {
+            return invalid(referenceOption, parser.value(referenceOption));
+        }
+    }
+    options.chunkDuration = parser.value(chunkOption).toDouble(&ok);
+    if (!ok || options.chunkDuration <= 0.0) {
+        return invalid(chunkOption, parser.value(chunkOption));
+    }
+    options.tuningParameters.setParameters(options.settings.fundamentalFrequency,
+                                           options.settings.tuningNotation);
+
+    int numWorkers = std::max(1, (int)std::thread::hardware_concurrency());
+    if (parser.isSet(jobsOption)) {
+        numWorkers = parser.value(jobsOption).toInt(&ok);
+        if (!ok || numWorkers < 1) {
+            return invalid(jobsOption, parser.value(jobsOption));
+        }
+    }
+
+    QString format = parser.value(formatOption);
+    if (format != "csv" && format != "json") {
+        return invalid(formatOption, format);
+    }
+    if (parser.positionalArguments().isEmpty()) {
+        parser.showHelp(1);
+    }
+
+    FILE *stream = stdout;
+    if (parser.isSet(outputOption)) {
+        stream = fopen(qPrintable(parser.value(outputOption)), "w");
+        if (stream == nullptr) {
+            fprintf(stderr, "qpitch-analyze: cannot write %s\n",
+                    qPrintable(parser.value(outputOption)));
+            return 1;
+        }
+    }
+
+    // ** ANALYSIS ** //
+    std::chrono::time_point<std::chrono::steady_clock> start = std::chrono::steady_clock::now();
+
+    BatchAnalyzer analyzer(options);
+    analyzer.scan(parser.positionalArguments());
+
+    ResultWriter writer(stream, format == "json", options);
+    size_t numErrors = analyzer.run(numWorkers, writer);
+
+    double elapsed =
+            std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    if (stream != stdout) {
+        fclose(stream);
+    }
+
+    fprintf(stderr,
+            "qpitch-analyze: %lld files (%zu failed), %llu frames, %.1f s of audio in %.3f s: "
+            "%.1f s of audio per second on %d workers (%s, %u samples)\n",
+            (long long)parser.positionalArguments().size(), numErrors,
+            (unsigned long long)analyzer.getNumFramesAnalysed(), analyzer.getAudioDuration(),
+            elapsed, analyzer.getAudioDuration() / elapsed, numWorkers,
+            pitchDetectorEngineName(options.settings.pitchDetectorEngine),
+            options.settings.fftFrameSize);
+
+    return (numErrors > 0) ? 1 : 0;
+}
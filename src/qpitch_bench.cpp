@@ -0,0 +1,483 @@
+/// Microbenchmarks of the hot-path kernels of QPitch.
+///
+/// Every kernel is timed for every supported sample rate and frame size (and the vectorized ones
+/// for every instruction set of the processor), and the results are written as JSON so that they
+/// can be compared between releases:
+///
+/// qpitch_bench [--output results.json] [--min-time 0.2] [--filter substring] [--wisdom file]
+///
+/// Each benchmark runs its operation in batches until a batch lasts at least --min-time, then
+/// reports the median of several such batches.  Heap allocations are counted by replacing the
+/// global operator new; FFTW's own buffers use fftw_malloc() and are not counted.
+
+#include "cyclicbuffer.h"
+#include "fftwplanner.h"
+#include "fftwtraits.h"
+#include "notes.h"
+#include "pitchdetection.h"
+#include "samplering.h"
+#include "signalgenerator.h"
+#include "simdkernels.h"
+#include "visualization_data.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <new>
+#include <vector>
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+
+// ** ALLOCATION COUNTING ** //
+
+static std::atomic<uint64_t> allocationCount(0);
+
+void *operator new(size_t size)
+{
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    if (void *p = std::malloc(size == 0 ? 1 : size)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void *operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void *p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[](void *p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void *p, size_t) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[](void *p, size_t) noexcept
+{
+    std::free(p);
+}
+
+// ** BENCHMARK DRIVER ** //
+
+/// Sample rates accepted by QPitchSettings
+static const uint32_t SAMPLE_FREQUENCIES[] = { 22050, 44100 };
+
+/// Frame sizes accepted by QPitchSettings
+static const size_t FFT_FRAME_SIZES[] = { 4096, 8192 };
+
+/// Zero-padding factors offered by the settings dialog
+static const int ZERO_PADDING_FACTORS[] = { 1, 2, 4, 8, 80 };
+
+/// Plot size used by QPitch
+static const size_t PLOT_BUFFER_SIZE = 551;
+
+/// Number of samples appended by each simulated audio callback
+static const size_t CALLBACK_FRAMES = 512;
+
+/// Number of frames, one callback apart, analysed by each call of PitchDetector::runBatch
+static const size_t BATCH_FRAMES = 64;
+
+/// Number of batches whose median is reported
+static const int NUM_BATCHES = 5;
+
+static const char *peakInterpolationName(PeakInterpolation peakInterpolation)
+{
+    switch (peakInterpolation) {
+    case PeakInterpolation::None:
+        return "none";
+    case PeakInterpolation::Parabolic:
+        return "parabolic";
+    case PeakInterpolation::Gaussian:
+        return "gaussian";
+    case PeakInterpolation::Sinc:
+        return "sinc";
+    }
+    return "unknown";
+}
+
+/// A tone with three harmonics of decreasing amplitude.
+static std::vector<float> makeTone(double frequency, size_t size, uint32_t sampleFrequency)
+{
+    SignalParameters parameters;
+    parameters.frequency = frequency;
+    parameters.numHarmonics = 3;
+    SignalGenerator generator(parameters, sampleFrequency);
+    std::vector<float> samples(size);
+    generator.generate(samples.data(), samples.size());
+    return samples;
+}
+
+class Bench
+{
+public:
+    Bench(double minTime, QString filter) : _minTime(minTime), _filter(std::move(filter)) { }
+
+    /// Time op, which processes itemsPerOp items of the given unit each time it is called.
+    template <class Op>
+    void run(const QString &name, const QJsonObject &parameters, double itemsPerOp,
+             const char *itemUnit, Op op)
+    {
+        QString fullName = name;
+        for (auto it = parameters.begin(); it != parameters.end(); ++it) {
+            fullName += QString(" %1=%2").arg(it.key(), it.value().toVariant().toString());
+        }
+        if (!_filter.isEmpty() && !fullName.contains(_filter)) {
+            return;
+        }
+
+        // warm up, and find a batch size lasting at least _minTime
+        op();
+        uint64_t iterations = 1;
+        while (timeBatch(op, iterations) < _minTime && iterations < (uint64_t(1) << 40)) {
+            iterations *= 2;
+        }
+
+        // reserve before counting, for the results not to be counted as allocations of op
+        std::vector<double> nsPerOp;
+        nsPerOp.reserve(NUM_BATCHES);
+        uint64_t allocationsBefore = allocationCount.load(std::memory_order_relaxed);
+        for (int batch = 0; batch < NUM_BATCHES; ++batch) {
+            nsPerOp.push_back(timeBatch(op, iterations) * 1e9 / iterations);
+        }
+        uint64_t allocations = allocationCount.load(std::memory_order_relaxed) - allocationsBefore;
+        std::sort(nsPerOp.begin(), nsPerOp.end());
+        double median = nsPerOp[NUM_BATCHES / 2];
+
+        QJsonObject result;
+        result["name"] = name;
+        result["parameters"] = parameters;
+        result["iterations"] = (double)iterations;
+        result["ns_per_op"] = median;
+        result["ns_per_op_min"] = nsPerOp.front();
+        result["ns_per_op_max"] = nsPerOp.back();
+        result["item"] = itemUnit;
+        result["items_per_op"] = itemsPerOp;
+        result["items_per_second"] = itemsPerOp * 1e9 / median;
+        result["allocations_per_op"] = (double)allocations / (NUM_BATCHES * iterations);
+        _results.append(result);
+
+        fprintf(stderr, "%-90s %12.1f ns/op %14.0f %s/s\n", qPrintable(fullName), median,
+                itemsPerOp * 1e9 / median, itemUnit);
+    }
+
+    const QJsonArray &getResults() const { return _results; }
+
+private:
+    template <class Op>
+    static double timeBatch(Op &op, uint64_t iterations)
+    {
+        auto start = std::chrono::steady_clock::now();
+        for (uint64_t i = 0; i < iterations; ++i) {
+            op();
+        }
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    double _minTime;
+    QString _filter;
+    QJsonArray _results;
+};
+
+// ** BENCHMARKS ** //
+
+static void benchSignalGenerator(Bench &bench, uint32_t sampleFrequency)
+{
+    // a sine, and a noisy plucked string with all the features
+    const char *specs[] = { "freq=440",
+                            "freq=110,harmonics=12,inharmonicity=0.0004,vibrato=5:15,decay=2,"
+                            "pluck=3,noise=pink:20" };
+    std::vector<float> block(CALLBACK_FRAMES);
+    for (const char *spec : specs) {
+        std::string error;
+        SignalGenerator generator(*SignalParameters::parse(spec, &error), sampleFrequency);
+        QJsonObject parameters{ { "sample_frequency", (double)sampleFrequency },
+                                { "signal", spec },
+                                { "callback_frames", (double)CALLBACK_FRAMES } };
+        bench.run("SignalGenerator::generate", parameters, CALLBACK_FRAMES, "samples",
+                  [&]() { generator.generate(block.data(), block.size()); });
+    }
+}
+
+static void benchBuffers(Bench &bench, size_t fftFrameSize)
+{
+    QJsonObject parameters{ { "fft_frame_size", (double)fftFrameSize },
+                            { "callback_frames", (double)CALLBACK_FRAMES } };
+    std::vector<float> block = makeTone(440.0, CALLBACK_FRAMES, 44100);
+    std::vector<float> frame(fftFrameSize);
+
+    CyclicBuffer cyclicBuffer(fftFrameSize * sizeof(float));
+    bench.run("CyclicBuffer::append", parameters, CALLBACK_FRAMES, "samples", [&]() {
+        cyclicBuffer.append((const unsigned char *)block.data(), block.size() * sizeof(float));
+    });
+    bench.run("CyclicBuffer::copyLastBytes", parameters, fftFrameSize, "samples", [&]() {
+        cyclicBuffer.copyLastBytes((unsigned char *)frame.data(), fftFrameSize * sizeof(float));
+    });
+
+    // the ring holds two frames, like in QPitchCore
+    SampleRing<float> ring(2 * fftFrameSize);
+    bench.run("SampleRing::write", parameters, CALLBACK_FRAMES, "samples",
+              [&]() { ring.write(block.data(), block.size()); });
+    bench.run("SampleRing::copyLast", parameters, fftFrameSize, "samples",
+              [&]() { ring.copyLast(frame.data(), fftFrameSize); });
+    bench.run("SampleRing::viewLast", parameters, fftFrameSize, "samples", [&]() {
+        SampleRing<float>::View view = ring.viewLast(fftFrameSize);
+        volatile bool intact = ring.isIntact(view);
+        (void)intact;
+    });
+}
+
+static void benchSimdKernels(Bench &bench, size_t fftFrameSize)
+{
+    const char *precision = sizeof(AnalysisReal) == sizeof(float) ? "single" : "double";
+
+    // the window, the spectrum and an autocorrelation with the default 80x zero padding, which
+    // is searched over half its lags (A4 at 44100 Hz)
+    const size_t searchEnd = fftFrameSize * 40;
+    const double period = 80.0 * 44100 / 440.0;
+    std::vector<float> tone = makeTone(440.0, fftFrameSize, 44100);
+    std::vector<AnalysisReal> window(fftFrameSize, 0.5);
+    std::vector<AnalysisReal> frame(fftFrameSize);
+    std::vector<AnalysisReal> spectrum(2 * (fftFrameSize / 2 + 1), 0.25);
+    std::vector<AnalysisReal> power(spectrum.size());
+    std::vector<AnalysisReal> r(searchEnd + 1);
+    for (size_t l = 0; l <= searchEnd; ++l) {
+        r[l] = cos(2.0 * M_PI * l / period) * (1.0 - 0.5 * l / searchEnd);
+    }
+
+    for (SimdLevel level : { SimdLevel::Scalar, SimdLevel::Sse2, SimdLevel::Avx2,
+                             SimdLevel::Avx512, SimdLevel::Neon }) {
+        const SimdKernels<AnalysisReal> *kernels = SimdKernels<AnalysisReal>::forLevel(level);
+        if (kernels == nullptr) {
+            continue;
+        }
+        QJsonObject parameters{ { "simd", simdLevelName(level) },
+                                { "fft_frame_size", (double)fftFrameSize },
+                                { "precision", precision } };
+
+        bench.run("SimdKernels::windowSamples", parameters, fftFrameSize, "samples", [&]() {
+            kernels->windowSamples(tone.data(), window.data(), frame.data(), fftFrameSize);
+        });
+        bench.run("SimdKernels::powerSpectrum", parameters, fftFrameSize / 2 + 1, "bins", [&]() {
+            kernels->powerSpectrum(spectrum.data(), power.data(), fftFrameSize / 2 + 1);
+        });
+        bench.run("SimdKernels::findMaximum", parameters, searchEnd, "lags", [&]() {
+            size_t l = kernels->findDescentEnd(r.data(), 0, searchEnd);
+            volatile size_t index = kernels->findMaximum(r.data(), l, searchEnd);
+            (void)index;
+        });
+        bench.run("SimdKernels::findLocalMaximum", parameters, searchEnd, "lags", [&]() {
+            size_t l = kernels->findDescentEnd(r.data(), 0, searchEnd);
+            for (l = kernels->findLocalMaximum(r.data(), std::max<size_t>(l, 1), searchEnd);
+                 l < searchEnd; l = kernels->findLocalMaximum(r.data(), l + 1, searchEnd)) { }
+            volatile size_t end = l;
+            (void)end;
+        });
+    }
+}
+
+static void benchDetector(Bench &bench, QJsonObject parameters,
+                          std::unique_ptr<PitchDetector<AnalysisReal>> detector,
+                          uint32_t sampleFrequency, size_t fftFrameSize)
+{
+    parameters["plans"] = planSourceName(detector->getPlanSource());
+    parameters["out_frame_size"] = (double)detector->getOutFrameSize();
+
+    // A4 with harmonics: a peak in the middle of the search range
+    std::vector<float> tone = makeTone(440.0, fftFrameSize + BATCH_FRAMES * CALLBACK_FRAMES,
+                                       sampleFrequency);
+
+    bench.run("PitchDetector::loadSamples", parameters, fftFrameSize, "samples",
+              [&]() { detector->loadSamples(tone.data(), fftFrameSize); });
+    bench.run("PitchDetector::runPitchDetectionAlgorithm", parameters, fftFrameSize, "samples",
+              [&]() {
+                  volatile double frequency = detector->runPitchDetectionAlgorithm();
+                  (void)frequency;
+              });
+
+    // offline analysis; the first call creates the plans of the batches
+    std::vector<double> frequencies(BATCH_FRAMES);
+    detector->runBatch(tone.data(), CALLBACK_FRAMES, BATCH_FRAMES, frequencies.data());
+    bench.run("PitchDetector::runBatch", parameters, BATCH_FRAMES, "frames", [&]() {
+        detector->runBatch(tone.data(), CALLBACK_FRAMES, BATCH_FRAMES, frequencies.data());
+    });
+
+    if (detector->getEngine() == PitchDetectorEngine::SlidingDft) {
+        // Slide forwards, one callback at a time, through a tone with a whole number of periods
+        // in loopSize samples.  The tone is repeated so that the frame at loopSize is the frame
+        // at 0 again: wrapping around keeps the stream continuous, with the periodic resyncs of
+        // a real stream and nothing else.
+        const size_t loopSize = BATCH_FRAMES * CALLBACK_FRAMES;
+        double loopFrequency =
+                std::round(440.0 * loopSize / sampleFrequency) * sampleFrequency / loopSize;
+        std::vector<float> loop = makeTone(loopFrequency, loopSize, sampleFrequency);
+        std::vector<float> stream(fftFrameSize + loopSize);
+        for (size_t i = 0; i < stream.size(); ++i) {
+            stream[i] = loop[i % loopSize];
+        }
+
+        detector->loadSamples(stream.data(), fftFrameSize);
+        size_t offset = 0;
+        bench.run("PitchDetector::slideSamples", parameters, CALLBACK_FRAMES, "samples", [&]() {
+            offset = (offset + CALLBACK_FRAMES) % loopSize;
+            detector->slideSamples(stream.data() + offset, fftFrameSize, CALLBACK_FRAMES);
+        });
+    }
+}
+
+static void benchDetectors(Bench &bench, uint32_t sampleFrequency, size_t fftFrameSize)
+{
+    const char *precision = sizeof(AnalysisReal) == sizeof(float) ? "single" : "double";
+
+    for (int zeroPaddingFactor : ZERO_PADDING_FACTORS) {
+        for (PeakInterpolation peakInterpolation :
+             { PeakInterpolation::None, PeakInterpolation::Parabolic, PeakInterpolation::Gaussian,
+               PeakInterpolation::Sinc }) {
+            QJsonObject parameters{ { "engine", "autocorrelation" },
+                                    { "sample_frequency", (double)sampleFrequency },
+                                    { "fft_frame_size", (double)fftFrameSize },
+                                    { "zero_padding", zeroPaddingFactor },
+                                    { "interpolation", peakInterpolationName(peakInterpolation) },
+                                    { "precision", precision } };
+            benchDetector(bench, parameters,
+                          PitchDetector<AnalysisReal>::create(
+                                  PitchDetectorEngine::Autocorrelation, sampleFrequency,
+                                  fftFrameSize, zeroPaddingFactor, peakInterpolation),
+                          sampleFrequency, fftFrameSize);
+        }
+    }
+
+    for (PitchDetectorEngine engine : { PitchDetectorEngine::Yin, PitchDetectorEngine::McLeod,
+                                        PitchDetectorEngine::SlidingDft }) {
+        QJsonObject parameters{ { "engine", pitchDetectorEngineName(engine) },
+                                { "sample_frequency", (double)sampleFrequency },
+                                { "fft_frame_size", (double)fftFrameSize },
+                                { "precision", precision } };
+        benchDetector(bench, parameters,
+                      PitchDetector<AnalysisReal>::create(engine, sampleFrequency, fftFrameSize, 1,
+                                                          PeakInterpolation::None),
+                      sampleFrequency, fftFrameSize);
+    }
+}
+
+static void benchEstimateNote(Bench &bench)
+{
+    // frequencies spread over the range of the pitch detection
+    std::vector<double> frequencies(1024);
+    for (size_t i = 0; i < frequencies.size(); ++i) {
+        frequencies[i] = 40.0 * pow(2000.0 / 40.0, (double)i / frequencies.size());
+    }
+
+    TuningParameters tuningParameters(440.0, TuningNotation::US);
+    bench.run("TuningParameters::estimateNote", QJsonObject(), frequencies.size(), "notes", [&]() {
+        for (double frequency : frequencies) {
+            volatile bool found = tuningParameters.estimateNote(frequency).has_value();
+            (void)found;
+        }
+    });
+}
+
+static void benchVisualization(Bench &bench, uint32_t sampleFrequency, size_t fftFrameSize)
+{
+    QJsonObject parameters{ { "sample_frequency", (double)sampleFrequency },
+                            { "fft_frame_size", (double)fftFrameSize },
+                            { "plot_size", (double)PLOT_BUFFER_SIZE } };
+
+    std::vector<float> tone = makeTone(440.0, fftFrameSize, sampleFrequency);
+    std::unique_ptr<PitchDetector<AnalysisReal>> detector = PitchDetector<AnalysisReal>::create(
+            PitchDetectorEngine::Autocorrelation, sampleFrequency, fftFrameSize, 2,
+            PeakInterpolation::Sinc);
+    detector->loadSamples(tone.data(), tone.size());
+    detector->runPitchDetectionAlgorithm();
+
+    VisualizationData visualizationData(PLOT_BUFFER_SIZE);
+    bench.run("VisualizationData::popluateSamples", parameters, fftFrameSize, "samples", [&]() {
+        visualizationData.popluateSamples(tone.data(), tone.size(), sampleFrequency);
+    });
+    bench.run("VisualizationData::popluateSpectrum", parameters, fftFrameSize / 2 + 1, "bins",
+              [&]() {
+                  visualizationData.popluateSpectrum<AnalysisReal>(
+                          detector->getFreq2Buffer(), fftFrameSize, sampleFrequency);
+              });
+    bench.run("VisualizationData::popluateAutoCorr", parameters, detector->getOutFrameSize(),
+              "samples", [&]() {
+                  visualizationData.popluateAutoCorr<AnalysisReal>(
+                          detector->getAutoCorrBuffer(), detector->getOutFrameSize(),
+                          sampleFrequency,
+                          (double)detector->getOutFrameSize() / detector->getFFTFrameSize());
+              });
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("qpitch_bench");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Microbenchmarks of the QPitch hot-path kernels");
+    parser.addHelpOption();
+    QCommandLineOption outputOption("output", "Write the JSON results to <file> instead of stdout.",
+                                    "file");
+    QCommandLineOption minTimeOption("min-time", "Minimum duration of a batch, in seconds.",
+                                     "seconds", "0.2");
+    QCommandLineOption filterOption("filter", "Only run the benchmarks whose name contains <text>.",
+                                    "text");
+    QCommandLineOption wisdomOption("wisdom", "Load FFTW wisdom from <file> before planning.",
+                                    "file");
+    parser.addOptions({ outputOption, minTimeOption, filterOption, wisdomOption });
+    parser.process(app);
+
+    if (parser.isSet(wisdomOption)) {
+        FFTWPlanner::loadWisdom<AnalysisReal>(parser.value(wisdomOption).toStdString());
+    }
+
+    Bench bench(parser.value(minTimeOption).toDouble(), parser.value(filterOption));
+
+    benchEstimateNote(bench);
+    for (size_t fftFrameSize : FFT_FRAME_SIZES) {
+        benchBuffers(bench, fftFrameSize);
+        benchSimdKernels(bench, fftFrameSize);
+    }
+    for (uint32_t sampleFrequency : SAMPLE_FREQUENCIES) {
+        benchSignalGenerator(bench, sampleFrequency);
+        for (size_t fftFrameSize : FFT_FRAME_SIZES) {
+            benchDetectors(bench, sampleFrequency, fftFrameSize);
+            benchVisualization(bench, sampleFrequency, fftFrameSize);
+        }
+    }
+
+    QJsonObject document;
+    document["benchmark"] = "qpitch_bench";
+    document["precision"] = sizeof(AnalysisReal) == sizeof(float) ? "single" : "double";
+    document["min_time"] = parser.value(minTimeOption).toDouble();
+    document["results"] = bench.getResults();
+    QByteArray json = QJsonDocument(document).toJson();
+
+    if (parser.isSet(outputOption)) {
+        QFile file(parser.value(outputOption));
+        if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+            fprintf(stderr, "Cannot write %s\n", qPrintable(parser.value(outputOption)));
+            return 1;
+        }
+        file.write(json);
+    } else {
+        fwrite(json.constData(), 1, json.size(), stdout);
+    }
+
+    return 0;
+}
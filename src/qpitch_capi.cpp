@@ -0,0 +1,225 @@
+#include "qpitch_capi.h"
+
+#include "fftwtraits.h"
+#include "notes.h"
+#include "pitchdetection.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <optional>
+#include <vector>
+
+/// Number of analyses per second when the hop is not given, as in the tuner
+static const uint32_t DEFAULT_ANALYSIS_RATE = 60;
+
+/// Smallest frame that the detectors can analyse
+static const uint32_t MIN_FRAME_SIZE = 64;
+
+/// Size of qpitch_config in the first version of the API, which ends with notation
+static const size_t CONFIG_V1_SIZE =
+        offsetof(qpitch_config, notation) + sizeof(qpitch_config::notation);
+
+// ** DETECTOR ** //
+
+/// The state behind a qpitch_detector handle.
+struct qpitch_detector
+{
+    explicit qpitch_detector(const qpitch_config &config_)
+        : config(config_),
+          tuningParameters(config_.reference_frequency, (TuningNotation)config_.notation)
+    {
+        if (config.hop == 0) {
+            config.hop = std::max<uint32_t>(1, config.sample_frequency / DEFAULT_ANALYSIS_RATE);
+        }
+        detector = PitchDetector<AnalysisReal>::create(
+                (PitchDetectorEngine)config.engine, config.sample_frequency, config.frame_size,
+                config.zero_padding, (PeakInterpolation)config.interpolation);
+        // room for a frame and the hop that completes the next one, so that the samples only
+        // move once per frame at most
+        buffer.resize(config.frame_size + std::max(config.hop, config.frame_size));
+        reset();
+    }
+
+    void reset()
+    {
+        fill = 0;
+        sinceAnalysis = 0;
+        position = 0;
+        numAnalysed = 0;
+        hasEstimate = false;
+    }
+
+    /// Analyse the last frame_size samples of the buffer.
+    void analyse()
+    {
+        const size_t frameSize = config.frame_size;
+        const float *frame = buffer.data() + fill - frameSize;
+        size_t newSamples =
+                (numAnalysed == 0) ? frameSize : std::min<size_t>(config.hop, frameSize);
+        detector->slideSamples(frame, frameSize, newSamples);
+        double frequency = detector->runPitchDetectionAlgorithm();
+        ++numAnalysed;
+
+        estimate = qpitch_estimate();
+        estimate.frequency = frequency;
+        estimate.position = position;
+        if (std::optional<EstimatedNote> note = tuningParameters.estimateNote(frequency)) {
+            estimate.has_note = 1;
+            estimate.note = note->currentPitch;
+            estimate.octave = note->octave;
+            estimate.cents = note->currentPitchDeviation * 100.0;
+            estimate.note_frequency = note->noteFrequency;
+        }
+        hasEstimate = true;
+    }
+
+    /// The configuration, with the hop resolved
+    qpitch_config config;
+
+    TuningParameters tuningParameters;
+    std::unique_ptr<PitchDetector<AnalysisReal>> detector;
+
+    /// The last samples pushed, in [0, fill)
+    std::vector<float> buffer;
+    size_t fill;
+
+    /// Samples pushed since the last analysis
+    size_t sinceAnalysis;
+
+    /// Samples pushed since the creation or the last reset
+    uint64_t position;
+
+    uint64_t numAnalysed;
+
+    /// The estimate of the last frame, not pulled yet if hasEstimate
+    qpitch_estimate estimate;
+    bool hasEstimate;
+};
+
+// ** C API ** //
+
+void qpitch_config_init(qpitch_config *config, size_t struct_size)
+{
+    qpitch_config defaults;
+    defaults.sample_frequency = 44100;
+    defaults.frame_size = 4096;
+    defaults.hop = 0;
+    defaults.engine = QPITCH_ENGINE_AUTOCORRELATION;
+    defaults.zero_padding = 2;
+    defaults.interpolation = QPITCH_INTERPOLATION_SINC;
+    defaults.reference_frequency = 440.0;
+    defaults.notation = QPITCH_NOTATION_US;
+
+    // the struct of the caller may be the smaller one of an earlier version
+    size_t size = std::min(struct_size, sizeof(qpitch_config));
+    defaults.struct_size = size;
+    memcpy(config, &defaults, size);
+}
+
+qpitch_detector *qpitch_create(const qpitch_config *callerConfig)
+{
+    if (callerConfig == nullptr || callerConfig->struct_size < CONFIG_V1_SIZE
+        || callerConfig->struct_size > sizeof(qpitch_config)) {
+        return nullptr;
+    }
+
+    // default the members the caller does not know about
+    qpitch_config fullConfig;
+    qpitch_config_init(&fullConfig, sizeof(qpitch_config));
+    memcpy(&fullConfig, callerConfig, callerConfig->struct_size);
+    fullConfig.struct_size = sizeof(qpitch_config);
+    const qpitch_config *config = &fullConfig;
+
+    if (config->sample_frequency == 0 || config->frame_size < MIN_FRAME_SIZE
+        || config->zero_padding < 1 || config->engine < QPITCH_ENGINE_AUTOCORRELATION
+        || config->engine > QPITCH_ENGINE_SLIDING_DFT
+        || config->interpolation < QPITCH_INTERPOLATION_NONE
+        || config->interpolation > QPITCH_INTERPOLATION_SINC
+        || config->notation < QPITCH_NOTATION_US || config->notation > QPITCH_NOTATION_GERMAN
+        || !(config->reference_frequency > 0.0)) {
+        return nullptr;
+    }
+
+    // no exception may cross the C API
+    std::unique_ptr<qpitch_detector> detector;
+    try {
+        detector = std::make_unique<qpitch_detector>(*config);
+    } catch (...) {
+        return nullptr;
+    }
+    if (!detector->detector || !detector->detector->hasPlans()) {
+        return nullptr;
+    }
+    return detector.release();
+}
+
+void qpitch_destroy(qpitch_detector *detector)
+{
+    delete detector;
+}
+
+size_t qpitch_push(qpitch_detector *detector, const float *samples, size_t count)
+{
+    const size_t frameSize = detector->config.frame_size;
+    const size_t hop = detector->config.hop;
+    std::vector<float> &buffer = detector->buffer;
+    size_t numFrames = 0;
+
+    while (count > 0) {
+        if (detector->fill == buffer.size()) {
+            // keep the last frame, to be completed by the next hop
+            memmove(buffer.data(), buffer.data() + detector->fill - frameSize,
+                    frameSize * sizeof(float));
+            detector->fill = frameSize;
+        }
+
+        size_t n = std::min({ count, buffer.size() - detector->fill,
+                              hop - detector->sinceAnalysis });
+        std::copy_n(samples, n, buffer.data() + detector->fill);
+        detector->fill += n;
+        detector->sinceAnalysis += n;
+        detector->position += n;
+        samples += n;
+        count -= n;
+
+        if (detector->sinceAnalysis == hop) {
+            detector->sinceAnalysis = 0;
+            if (detector->fill >= frameSize) {
+                detector->analyse();
+                ++numFrames;
+            }
+        }
+    }
+
+    return numFrames;
+}
+
+int qpitch_pull(qpitch_detector *detector, qpitch_estimate *estimate)
+{
+    if (!detector->hasEstimate) {
+        return 0;
+    }
+    *estimate = detector->estimate;
+    detector->hasEstimate = false;
+    return 1;
+}
+
+void qpitch_reset(qpitch_detector *detector)
+{
+    detector->reset();
+}
+
+const char *qpitch_note_name(const qpitch_detector *detector, int note, int alternative)
+{
+    if (note < 0 || note >= 12) {
+        return nullptr;
+    }
+    return detector->tuningParameters.getNoteLabel(note, alternative != 0);
+}
+
+const char *qpitch_version(void)
+{
+    return "1.0.1";
+}
@@ -0,0 +1,169 @@
+#pragma once
+
+/// C API of qpitch_core, the pitch detection of QPitch without Qt.
+///
+/// A detector accumulates the samples pushed into it and analyses the last frame_size samples
+/// every hop new samples; the caller pulls the latest estimate when it wants to:
+///
+///     qpitch_config config;
+///     qpitch_config_init(&config, sizeof(config));
+///     config.sample_frequency = 48000;
+///     qpitch_detector *detector = qpitch_create(&config);
+///     ...
+///     qpitch_push(detector, samples, count);
+///     qpitch_estimate estimate;
+///     if (qpitch_pull(detector, &estimate) && estimate.has_note) { ... }
+///     ...
+///     qpitch_destroy(detector);
+///
+/// A detector may be used from any thread, but from one thread at a time.  qpitch_push() does
+/// not allocate memory: the buffers and the FFTW plans are created by qpitch_create().
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(_WIN32) && defined(QPITCH_CORE_SHARED)
+#ifdef QPITCH_CORE_BUILDING
+#define QPITCH_CORE_API __declspec(dllexport)
+#else
+#define QPITCH_CORE_API __declspec(dllimport)
+#endif
+#elif defined(__GNUC__)
+#define QPITCH_CORE_API __attribute__((visibility("default")))
+#else
+#define QPITCH_CORE_API
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/// Version of the C API, incremented when functions or members are added.
+#define QPITCH_CORE_API_VERSION 1
+
+/// The pitch detection methods, as PitchDetectorEngine.
+typedef enum qpitch_engine {
+    QPITCH_ENGINE_AUTOCORRELATION = 0,
+    QPITCH_ENGINE_YIN = 1,
+    QPITCH_ENGINE_MCLEOD = 2,
+    QPITCH_ENGINE_SLIDING_DFT = 3,
+} qpitch_engine;
+
+/// Refinement of the autocorrelation peak, as PeakInterpolation.
+typedef enum qpitch_interpolation {
+    QPITCH_INTERPOLATION_NONE = 0,
+    QPITCH_INTERPOLATION_PARABOLIC = 1,
+    QPITCH_INTERPOLATION_GAUSSIAN = 2,
+    QPITCH_INTERPOLATION_SINC = 3,
+} qpitch_interpolation;
+
+/// Names of the notes, as TuningNotation.
+typedef enum qpitch_notation {
+    QPITCH_NOTATION_US = 0,
+    QPITCH_NOTATION_FRENCH = 1,
+    QPITCH_NOTATION_GERMAN = 2,
+} qpitch_notation;
+
+/// A pitch detector, created by qpitch_create().
+typedef struct qpitch_detector qpitch_detector;
+
+/// How to create a detector.  Initialize with qpitch_config_init() before changing members.
+///
+/// Members are only ever added to the end.  A library of a later version defaults the members
+/// past the struct_size of a caller built against an earlier one.
+typedef struct qpitch_config {
+    /// sizeof(qpitch_config) of the caller, set by qpitch_config_init()
+    size_t struct_size;
+
+    /// Sample rate of the pushed samples, in Hz (44100)
+    uint32_t sample_frequency;
+
+    /// Number of samples analysed in each frame (4096)
+    uint32_t frame_size;
+
+    /// Number of new samples between two analyses, or 0 for the analysis rate of the tuner,
+    /// 60 per second (0)
+    uint32_t hop;
+
+    /// The pitch detection method (QPITCH_ENGINE_AUTOCORRELATION)
+    qpitch_engine engine;
+
+    /// Zero-padding factor of the autocorrelation (2)
+    uint32_t zero_padding;
+
+    /// Refinement of the autocorrelation peak (QPITCH_INTERPOLATION_SINC)
+    qpitch_interpolation interpolation;
+
+    /// The frequency of A4 that the scale is built on, in Hz (440)
+    double reference_frequency;
+
+    /// Names of the notes (QPITCH_NOTATION_US)
+    qpitch_notation notation;
+} qpitch_config;
+
+/// The result of an analysis.
+typedef struct qpitch_estimate {
+    /// The estimated frequency in Hz, or 0 if there is no pitch in the frame
+    double frequency;
+
+    /// Whether the frequency is within the range of the scale, [40, 2000] Hz.  The members below
+    /// are only set if it is.
+    int has_note;
+
+    /// The closest note, from 0 (A) to 11 (G sharp)
+    int note;
+
+    /// The octave of the note in scientific pitch notation (A4 is in octave 4)
+    int octave;
+
+    /// Deviation from the note, in cents, in [-50, 50]
+    double cents;
+
+    /// Frequency of the note, in Hz
+    double note_frequency;
+
+    /// Number of samples pushed up to the end of the analysed frame
+    uint64_t position;
+} qpitch_estimate;
+
+/// Fill a configuration with the defaults of the tuner.
+///
+/// \param[in] struct_size sizeof(qpitch_config) of the caller: no more than that is written
+QPITCH_CORE_API void qpitch_config_init(qpitch_config *config, size_t struct_size);
+
+/// Create a detector.
+///
+/// \return the detector, or NULL if the configuration is invalid, has a struct_size smaller
+///         than the first version of qpitch_config or larger than this one, or the detector
+///         could not be created
+QPITCH_CORE_API qpitch_detector *qpitch_create(const qpitch_config *config);
+
+/// Destroy a detector.  Does nothing if detector is NULL.
+QPITCH_CORE_API void qpitch_destroy(qpitch_detector *detector);
+
+/// Push mono samples, and analyse a frame every hop samples.
+///
+/// \return the number of frames analysed
+QPITCH_CORE_API size_t qpitch_push(qpitch_detector *detector, const float *samples, size_t count);
+
+/// Get the estimate of the last analysed frame, if there is one that was not pulled yet.
+///
+/// \return 1 if estimate was filled, 0 if no frame was analysed since the last call
+QPITCH_CORE_API int qpitch_pull(qpitch_detector *detector, qpitch_estimate *estimate);
+
+/// Forget the pushed samples, as if the detector had just been created.
+QPITCH_CORE_API void qpitch_reset(qpitch_detector *detector);
+
+/// The name of a note in the notation of the detector, in UTF-8 (e.g. "A", "Si", "C♯").
+///
+/// \param[in] alternative use flats rather than sharps
+/// \return the name, or NULL if note is not in [0, 11]
+QPITCH_CORE_API const char *qpitch_note_name(const qpitch_detector *detector, int note,
+                                             int alternative);
+
+/// The version of the library, e.g. "1.0.1".
+QPITCH_CORE_API const char *qpitch_version(void);
+
+#ifdef __cplusplus
+}
+#endif
@@ -2,3 +2,8 @@
 
 /// Annotate that a variable is guarded by a mutex `m`.
 #define QPITCH_GUARDED_BY(m)
+
+/// Annotate that a variable is read while another thread may write it, on purpose: the reader
+/// validates what it read afterwards and drops it if it was torn.  Each such race has a
+/// suppression in tsan.supp.
+#define QPITCH_BENIGN_RACE(reason)
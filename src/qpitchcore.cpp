@@ -22,34 +22,38 @@
 
 #include "qpitchcore.h"
 
-#include <QMessageBox>
 #include <QMutex>
 #include <QtDebug>
 #include <QMutexLocker>
+#include <QDeadlineTimer>
+#include <QDir>
+#include <QFileInfo>
+#include <algorithm>
 #include <chrono>
 #include <cmath>
 
-#ifdef _REFERENCE_SQUAREWAVE_INPUT
-#  include <cmath>
-#endif
-
 class QPitchCorePrivate
 {
 };
 
-QPitchCore::QPitchCore(QObject *parent, const unsigned int plotPlotSize, QPitchCoreOptions options)
+const double QPitchCore::CALLBACK_REPORT_INTERVAL = 5.0;
+const size_t QPitchCore::RING_MIN_FRAME_SIZE = 8192;
+
+QPitchCore::QPitchCore(QObject *parent, const unsigned int plotPlotSize, QPitchCoreOptions options,
+                       const AudioSourceOptions &sourceOptions, const QString &wisdomPath)
     : QThread(parent),
-      _bufferUpdated(false),
       _stopRequested(false),
       _options(options),
-      _stream(nullptr),
-      _buffer(0),
-      _visualizationData(plotPlotSize),
-      _callbackProfilingEnabled(false),
-      _callbackProfilingStarted(false),
-      _lastCallbackTime(0.0),
-      _lastAdcTime(0.0),
-      _callbackProfiler("QPitchCore callback", true)
+      _sourceOptions(sourceOptions),
+      _wisdomPath(wisdomPath),
+      _constructionTime(std::chrono::steady_clock::now()),
+      _numAnalysedFrames(0),
+      _wakeUpThreshold(0),
+      _wakeUps(0),
+      _visualizationData(VisualizationData(plotPlotSize)),
+      _lateFrameThreshold(0),
+      _callbackRecordsDropped(0),
+      _callbackProfilingEnabled(false)
 {
     {
         const char *profEnv = getenv("QPITCH_CORE_CALLBACK_PROFILING");
@@ -64,13 +68,27 @@ QPitchCore::QPitchCore(QObject *parent, const unsigned int plotPlotSize, QPitchC
     // ** INITIALIZE PRIVATE VARIABLES ** //
     _private = std::make_unique<QPitchCorePrivate>();
 
-    // ** INITIALIZE PORTAUDIO ** //
-    PaError err = Pa_Initialize();
-    if (err != paNoError) {
-        throw QPaSoundInputException(Pa_GetErrorText(err));
+    // ** START MEASURING FFTW PLANS IN THE BACKGROUND ** //
+    {
+        bool patient = false;
+        const char *patientEnv = getenv("QPITCH_FFTW_PATIENT");
+        if (patientEnv != nullptr && strcmp(patientEnv, "1") == 0) {
+            qDebug("[QPitchCore] FFTW_PATIENT planning enabled!");
+            patient = true;
+        }
+        _planRefiner = std::make_unique<PlanRefiner<AnalysisReal>>(patient);
     }
 
-    reconfigure();
+    // ** BACK THE LARGE BUFFERS WITH HUGE PAGES ** //
+    {
+        const char *hugePagesEnv = getenv("QPITCH_HUGE_PAGES");
+        if (hugePagesEnv != nullptr && strcmp(hugePagesEnv, "1") == 0) {
+            qDebug("[QPitchCore] Transparent huge pages enabled!");
+            BufferArena::setHugePages(true);
+        }
+    }
+
+    // The audio source and the pitch detection are set up by the thread, see startUp().
 
     Q_ASSERT(!_stopRequested);
 }
@@ -78,28 +96,47 @@ QPitchCore::QPitchCore(QObject *parent, const unsigned int plotPlotSize, QPitchC
 QPitchCore::~QPitchCore()
 {
     // ** ENSURE THAT THE STREAM IS STOPPED AND THE THREAD NOT RUNNING ** //
-    Q_ASSERT(_stream == nullptr);
+    Q_ASSERT(!_source || !_source->isStarted());
     Q_ASSERT(_stopRequested == true);
     Q_ASSERT(!this->isRunning());
 
-    // ** TERMINATE PORTAUDIO ** //
-    Pa_Terminate();
-
     // ** RELEASE RESOURCES ** //
+    // Closes the audio source (and terminates PortAudio).
+    _source.reset();
+    // Waits for the plan being measured, if any.
+    _planRefiner.reset();
 }
 
 void QPitchCore::setOptions(QPitchCoreOptions options)
 {
     QMutexLocker locker(&_mutex);
     _pendingOptions = options;
-    _cond.wakeOne();
+    wakeUp();
+}
+
+const VisualizationData *QPitchCore::takeVisualizationData()
+{
+    Q_ASSERT(QThread::currentThread() != this);
+
+    if (!_visualizationData.update()) {
+        return nullptr;
+    }
+    return &_visualizationData.getFrontBuffer();
 }
 
 void QPitchCore::requestStop()
 {
     QMutexLocker locker(&_mutex);
     _stopRequested = true;
+    wakeUp();
+}
+
+void QPitchCore::wakeUp()
+{
+    // the thread waits on _cond in the fixed-rate mode, and on _wakeUps in the hop mode
     _cond.wakeOne();
+    _wakeUps.fetch_add(1, std::memory_order_release);
+    _wakeUps.notify_one();
 }
 
 void QPitchCore::setCallbackProfilingEnabled(bool enabled)
@@ -113,114 +150,20 @@ void QPitchCore::startStream()
     Q_ASSERT(QThread::currentThread() == this);
 
     // The stream should not have been started.
-    Q_ASSERT(_stream == nullptr);
+    Q_ASSERT(!_source->isStarted());
 
-#ifdef _REFERENCE_SQUAREWAVE_INPUT
-    // create the artificial square wave with some harmonics :: 110.0 Hz
-    for (unsigned int k = 0; k < 4410; ++k) {
-        _referenceSineWave[k] =
-                ((sin(2 * M_PI * 110.0 * (double)k / sampleFrequency) >= 0.0) ? 1000 : -1000);
-    }
-    _referenceSineWave_index = 0;
-#endif
-
-    // Parameters of the input audio stream
-    PaStreamParameters inputParameters;
-
-    // We dump the host API and device list for debug purposes.
-    qDebug("Enumerating host APIs...");
-    for (int i = 0, end = Pa_GetHostApiCount(); i != end; ++i) {
-        const PaHostApiInfo *hostAPIInfo = Pa_GetHostApiInfo(i);
-        qDebug("Host API %d: %s", i, hostAPIInfo->name);
-        for (int j = 0, end = hostAPIInfo->deviceCount; j != end; ++j) {
-            PaDeviceIndex deviceIndex = Pa_HostApiDeviceIndexToDeviceIndex(i, j);
-            const PaDeviceInfo *info = Pa_GetDeviceInfo(deviceIndex);
-            if (info->maxInputChannels > 1) {
-                qDebug("  %d: [%d] %s (%d channels, %lf Hz, %lf ms to %lf ms)", j, deviceIndex,
-                       info->name, info->maxInputChannels, info->defaultSampleRate,
-                       info->defaultLowInputLatency * 1000, info->defaultHighInputLatency * 1000);
-            } else {
-                qDebug("  %d: [%d] %s (no input)", j, deviceIndex, info->name);
-            }
-        }
-    }
-
-    // Prefer the default device.  On Linux, the default host API is ALSA; and on modern Linux
-    // distributions, the default output device is usually "pipewire" which bridges with the
-    // PipeWire sound server.
-    //
-    // TODO: Allow the user to specify a device at runtime via the GUI.
-    inputParameters.device = -1;
-
-    // We list the devices for debug purpose.
-    qDebug("Enumerating PortAudio devices...");
-    for (int i = 0, end = Pa_GetDeviceCount(); i != end; ++i) {
-        PaDeviceInfo const *info = Pa_GetDeviceInfo(i);
-        if (!info) {
-            qDebug("  [%d] no info", i);
-            continue;
-        }
-        qDebug("  [%d] name: %s", i, info->name);
-    }
-
-    qDebug("Default device: %d", Pa_GetDefaultInputDevice());
-    qDebug("Selected device: %d", inputParameters.device);
-
-    // ** CONFIGURE THE INPUT AUDIO STREAM ** //
-    if (inputParameters.device == -1) {
-        inputParameters.device = Pa_GetDefaultInputDevice(); // default input device
-    }
-    inputParameters.channelCount = 1; // mono input
-    inputParameters.sampleFormat = PA_SAMPLE_FORMAT; // the one we specified
-    inputParameters.suggestedLatency = 1.0 / 60.0; // Try to get 60 fps.
-    inputParameters.hostApiSpecificStreamInfo = nullptr;
-
-    // ** OPEN AN AUDIO INPUT STREAM ** //
-
-    // We don't specify the buffer size.  Pa_OpenStream promises that by doing so, "the stream
-    // callback will receive an optimal (and possibly varying) number of frames based on host
-    // requirements and the requested latency settings", and "the use of non-zero framesPerBuffer
-    // for a callback stream may introduce an additional layer of buffering which could introduce
-    // additional latency". Meanwhile, since we are using a cyclic buffer to hold accumulated
-    // samples, we are quite flexible about the buffer size, and we can even handle variable-sized
-    // buffers with ease. Therefore, not specifying the buffer size will allow us to run at the
-    // maximum possible FPS.  On a machine with Linux and PipeWire, we receive about 395 callbacks
-    // per second, with the number of frames per callback ranging from 7 to 183.
-    //
-    // TODO: Allow the user to set (throttle) the frequency at which the QPitchCore processes the
-    // buffer and therefore the GUI refresh rate to the user's desired setting, such as 60 FPS.
-    unsigned long framesPerBuffer = paFramesPerBufferUnspecified;
-    PaError err = Pa_OpenStream(&_stream, &inputParameters,
-                                nullptr, // no output
-                                _options.sampleFrequency, // sample rate (default 44100 Hz)
-                                framesPerBuffer, // frames per buffer (not specified)
-                                paClipOff, // disable clipping
-                                paCallback, // callback
-                                this // pointer to user data
-    );
-
-    if (err != paNoError) {
-        throw QPaSoundInputException(Pa_GetErrorText(err));
-    }
-
-    // ** START PORTAUDIO STREAM ** //
-    err = Pa_StartStream(_stream);
-    if (err != paNoError) {
-        throw QPaSoundInputException(Pa_GetErrorText(err));
-    }
+    // ** START THE AUDIO SOURCE ** //
+    // The callbacks only accumulate samples.  How often the QPitchCore thread analyses them (and
+    // therefore the GUI refresh rate) is decided by _scheduler, independently of their cadence.
+    _source->start(_options.sampleFrequency, audioSourceCallback, this);
 
     // ** ENSURE THAT THE STREAM IS STARTED AND THE THREAD IS RUNNING ** //
-    Q_ASSERT(_stream != nullptr);
+    Q_ASSERT(_source->isStarted());
 
-    const PaDeviceInfo *deviceInfo = Pa_GetDeviceInfo(inputParameters.device);
-    QString device = QString(deviceInfo->name);
-    QString hostAPI =
-            QString(Pa_GetHostApiInfo(Pa_GetDeviceInfo(inputParameters.device)->hostApi)->name);
-    emit portAudioStreamStarted(device, hostAPI);
+    emit audioSourceStarted(_source->getDeviceName(), _source->getHostApiName());
 
     qDebug() << "QPitchCore::startStream";
     qDebug() << " - sampleFrequency  = " << _options.sampleFrequency;
-    qDebug() << " - suggestedLatency = " << inputParameters.suggestedLatency;
     qDebug() << " - fftFrameSize     = " << _options.fftFrameSize << "\n";
 }
 
@@ -230,36 +173,22 @@ void QPitchCore::stopStream()
     Q_ASSERT(QThread::currentThread() == this);
 
     // ** ENSURE THAT THE STREAM IS STARTED ** //
-    Q_ASSERT(_stream != nullptr);
+    Q_ASSERT(_source->isStarted());
 
-    // ** STOP PORTAUDIO STREAM ** //
-    PaError err = Pa_StopStream(_stream);
-    if (err != paNoError) {
-        throw QPaSoundInputException(Pa_GetErrorText(err));
-    }
-
-    // ** CLOSE PORTAUDIO STREAM ** //
-    err = Pa_CloseStream(_stream);
-    if (err != paNoError) {
-        throw QPaSoundInputException(Pa_GetErrorText(err));
-    }
-
-    // ** RELEASE PITCH DETECTION INSTANCE ** //
-    _pitchDetection.reset();
-
-    // ** RELEASE RESOURCES ** //
-    _stream = nullptr;
+    // ** STOP THE AUDIO SOURCE ** //
+    // The pitch detection instance is kept, for the pool to reuse it if the stream is restarted.
+    _source->stop();
 }
 
-int QPitchCore::paCallback(const void *input, void * /*output*/, unsigned long frameCount,
-                           const PaStreamCallbackTimeInfo *timeInfo,
-                           PaStreamCallbackFlags statusFlags, void *userData)
+int QPitchCore::audioSourceCallback(const SampleType *input, unsigned long frameCount,
+                                    const PaStreamCallbackTimeInfo *timeInfo,
+                                    PaStreamCallbackFlags statusFlags, void *userData)
 {
     Q_ASSERT(input != nullptr);
     Q_ASSERT(userData != nullptr);
 
     return (static_cast<QPitchCore *>(userData)->paStoreInputBufferCallback(
-            (const SampleType *)input, frameCount, timeInfo, statusFlags));
+            input, frameCount, timeInfo, statusFlags));
 }
 
 int QPitchCore::paStoreInputBufferCallback(const SampleType *input, unsigned long frameCount,
@@ -268,96 +197,130 @@ int QPitchCore::paStoreInputBufferCallback(const SampleType *input, unsigned lon
 {
     Q_ASSERT(QThread::currentThread() != this);
 
-    bool profilingEnabled = _callbackProfilingEnabled;
+    // Only record what happens here: formatting and logging belong to the QPitchCore thread.
+    std::chrono::time_point<std::chrono::steady_clock> callbackEnter =
+            std::chrono::steady_clock::now();
 
-    std::chrono::time_point<std::chrono::steady_clock> callbackEnter;
+    // Check whether the QPitchCore thread kept up with the samples delivered so far.
+    uint64_t pendingFrames = _ring->getUnread();
 
-    if (profilingEnabled) {
-        _callbackProfiler.tick();
+    // ** COPY BUFFER ** //
+    _ring->write(input, frameCount);
 
-        if (!_callbackProfilingStarted) {
-            _callbackProfilingStarted = true;
-        } else {
-            double callbackDiff = timeInfo->currentTime - _lastCallbackTime;
-            double adcDiff = timeInfo->inputBufferAdcTime - _lastAdcTime;
-            qDebug("[QPitchCore callback] Time profiling: callback: %lf (+%lf), ADC: %lf (+%lf), "
-                   "frames: %ld",
-                   timeInfo->currentTime, callbackDiff, timeInfo->inputBufferAdcTime, adcDiff,
-                   frameCount);
-        }
-
-        _lastCallbackTime = timeInfo->currentTime;
-        _lastAdcTime = timeInfo->inputBufferAdcTime;
-
-        callbackEnter = std::chrono::steady_clock::now();
+    // ** NOTIFY THE QPITCHCORE THREAD TO PROCESS THE BUFFER ** //
+    // Samples are accumulated into the ring, and the QPitchCore thread always processes the
+    // latest ones, so it only needs to be woken up when an analysis is due.  In the fixed-rate
+    // mode it wakes up by itself at the deadline.  In the hop mode the callback posts _wakeUps,
+    // which never takes a lock: the thread reads the counter before checking the ring, so a post
+    // between its check and its wait is not missed.  The scheduler itself may be replaced
+    // meanwhile, so the hop is read from _wakeUpThreshold.
+    uint64_t wakeUpThreshold = _wakeUpThreshold.load(std::memory_order_relaxed);
+    if (wakeUpThreshold > 0 && _ring->getUnread() >= wakeUpThreshold) {
+        _wakeUps.fetch_add(1, std::memory_order_release);
+        _wakeUps.notify_one();
     }
 
-    {
-        QMutexLocker bufferLocker(&_bufferMutex);
-
-        // ** COPY BUFFER ** //
-#ifdef _REFERENCE_SQUAREWAVE_INPUT
-        // ** USE THE REFERENCE SINE WAVE INPUT SIGNAL ** //
-        for (unsigned int k = 0; k < frameCount; ++k) {
-            _buffer[k] = _referenceSineWave[_referenceSineWave_index++];
-            if (_referenceSineWave_index >= 4410) {
-                _referenceSineWave_index = 0;
-            }
-        }
-#else
-        // ** READ THE REAL AUDIO SIGNAL ** //
-        _buffer.append((const unsigned char *)input, frameCount * sizeof(SampleType));
-#endif
-    }
+    // ** RECORD TELEMETRY ** //
+    CallbackRecord record;
+    record.callbackTime = timeInfo->currentTime;
+    record.adcTime = timeInfo->inputBufferAdcTime;
+    record.duration =
+            std::chrono::duration<double>(std::chrono::steady_clock::now() - callbackEnter)
+                    .count();
+    record.frameCount = frameCount;
+    record.statusFlags = statusFlags;
+    record.pendingFrames = pendingFrames;
+    record.coreKeptUp = pendingFrames < _lateFrameThreshold.load(std::memory_order_relaxed);
+    _callbackTelemetry.push(record);
 
-    // ** NOTIFY THE QPITCHCORE THREAD TO PROCESS THE BUFFER ** //
-    bool bufferWasUpdated = false;
-    {
-        QMutexLocker locker(&_mutex);
+    return paContinue;
+}
 
-        // Note that the callback can update the buffer faster than the QPitchCore thread can
-        // handle. This is normal.  Samples will be accumulated into the cyclic buffer, and the
-        // QPitchCore thread always processes the accumulated samples.  But for performance
-        // analysis, we record the old value of _bufferUpdated to see if the QPitchCore can keep up
-        // with the callback.
-        bufferWasUpdated = _bufferUpdated;
+bool QPitchCore::startUp()
+{
+    // This method is only callable by the QPitchCore thread itself.
+    Q_ASSERT(QThread::currentThread() == this);
 
-        _bufferUpdated = true;
-        _cond.wakeOne();
+    std::chrono::time_point<std::chrono::steady_clock> phaseStart = _constructionTime;
+    logStartupPhase("thread started", phaseStart);
+
+    // ** LOAD FFTW WISDOM ** //
+    // Plans measured in earlier runs are picked up by the pitch detection instead of estimated.
+    if (!_wisdomPath.isEmpty()) {
+        QDir().mkpath(QFileInfo(_wisdomPath).absolutePath());
+        bool wisdomLoaded = FFTWPlanner::loadWisdom<AnalysisReal>(_wisdomPath.toStdString());
+        qInfo("[QPitchCore] FFTW wisdom %s: %s", wisdomLoaded ? "loaded" : "not found",
+              qPrintable(_wisdomPath));
+        logStartupPhase("FFTW wisdom loaded", phaseStart);
     }
 
-    if (profilingEnabled) {
-        std::chrono::time_point<std::chrono::steady_clock> callbackExit =
-                std::chrono::steady_clock::now();
-        double callbackDuration =
-                std::chrono::duration<double>(callbackExit - callbackEnter).count();
-        qDebug("[QPitchCore callback] Callback duration: %lf", callbackDuration);
-
-        if (_bufferUpdated) {
-            // buffer is not processed since the last callback
-            qDebug("[QPitchCore callback] The QPitchCore thread failed to keep up with the "
-                   "callback!");
-        }
+    try {
+        // ** OPEN THE AUDIO SOURCE ** //
+        // Initializes PortAudio, or reads the whole WAV file.
+        _source = AudioSource::create(_sourceOptions);
+        qInfo("[QPitchCore] Audio source: %s", audioSourceKindName(_sourceOptions.kind));
+        logStartupPhase("audio source opened", phaseStart);
+
+        // ** CREATE THE PITCH DETECTION ** //
+        reconfigure();
+        logStartupPhase("pitch detection planned", phaseStart);
+
+        startStream();
+        logStartupPhase("stream started", phaseStart);
+    } catch (const AudioSourceException &e) {
+        qCritical("[QPitchCore] Audio input error: %s", e.what());
+        emit audioSourceFailed(QString::fromStdString(e.what()));
+        return false;
     }
 
-    return paContinue;
+    return true;
+}
+
+void QPitchCore::logStartupPhase(const char *phase,
+                                 std::chrono::time_point<std::chrono::steady_clock> &phaseStart)
+{
+    std::chrono::time_point<std::chrono::steady_clock> now = std::chrono::steady_clock::now();
+    qInfo("[QPitchCore] Startup: %s in %.3lf ms (%.3lf ms since the construction)", phase,
+          std::chrono::duration<double, std::milli>(now - phaseStart).count(),
+          std::chrono::duration<double, std::milli>(now - _constructionTime).count());
+    phaseStart = now;
 }
 
 void QPitchCore::run()
 {
-    startStream();
+    if (!startUp()) {
+        return;
+    }
 
     // ** ENSURE THAT FFTW STRUCTURES ARE VALID ** //
     Q_ASSERT(_pitchDetection);
 
     {
         QMutexLocker locker(&_mutex);
+        _scheduler.start(AnalysisScheduler::ClockType::now());
         while (true) {
-            // Wait until either the buffer is updated or _running is set to false.
-            while (!_stopRequested && !_pendingOptions && !_bufferUpdated) {
-                _cond.wait(&_mutex);
+            // Wait until either an analysis is due or _running is set to false.
+            while (!_stopRequested && !_pendingOptions && !isAnalysisDue()) {
+                if (_scheduler.isSampleDriven()) {
+                    // Read the counter with _mutex held, so that neither the callback nor the
+                    // GUI thread can post it unseen before the wait.
+                    uint32_t wakeUps = _wakeUps.load(std::memory_order_acquire);
+                    locker.unlock();
+                    if (_ring->getUnread() < _scheduler.getHop()) {
+                        _wakeUps.wait(wakeUps, std::memory_order_acquire);
+                    }
+                    locker.relock();
+                } else {
+                    _cond.wait(&_mutex,
+                               QDeadlineTimer(_scheduler.getDeadline(), Qt::PreciseTimer));
+                }
             }
 
+            // The callback takes _mutex to wake us up: never format or log while holding it.
+            locker.unlock();
+            drainCallbackTelemetry();
+            locker.relock();
+
             // lock the buffer
             if (_stopRequested) {
                 qDebug("Stop requested! Stop!");
@@ -365,109 +328,310 @@ void QPitchCore::run()
             }
 
             if (_pendingOptions) {
-                onOptionsChanged(locker);
+                if (!onOptionsChanged(locker)) {
+                    break;
+                }
+                _scheduler.start(AnalysisScheduler::ClockType::now());
+                continue;
             }
 
-            if (_bufferUpdated) {
+            _scheduler.advance(AnalysisScheduler::ClockType::now());
+
+            // Nothing to analyse if the stream delivered no samples during the last period.
+            if (_ring->getUnread() > 0) {
                 processBuffer(locker);
             }
         }
     }
 
-    stopStream();
+    // The stream is already stopped if it could not be restarted.
+    if (_source->isStarted()) {
+        stopStream();
+    }
 
     // TODO: Signal stopped event.
 }
 
-void QPitchCore::onOptionsChanged(QMutexLocker<QMutex> &locker)
+void QPitchCore::drainCallbackTelemetry()
 {
-    // Prevent deadlock with PortAudio's callback thread.
-    locker.unlock();
+    CallbackRecord record;
+    while (_callbackTelemetry.pop(record)) {
+        _callbackStatistics.add(record);
+    }
 
-    qDebug("Options changed.");
-    stopStream();
+    std::chrono::time_point<std::chrono::steady_clock> now = std::chrono::steady_clock::now();
+    double elapsed = std::chrono::duration<double>(now - _callbackReportStart).count();
+    if (elapsed < CALLBACK_REPORT_INTERVAL) {
+        return;
+    }
 
-    locker.relock();
-    // Note: The GUI thread may have modified _pendingOptions while we unlocked.
+    const CallbackStatistics &stats = _callbackStatistics;
+    uint64_t dropped = _callbackTelemetry.getDropped();
+    if (_callbackProfilingEnabled && stats.getCallbacks() > 0) {
+        const Histogram &jitter = stats.getJitter();
+        const Histogram &duration = stats.getDuration();
+        qInfo("[QPitchCore callback] %llu callbacks, %llu frames in %.1lf s; "
+              "jitter min %.3lf p50 %.3lf p99 %.3lf max %.3lf ms; "
+              "duration p50 %.1lf p99 %.1lf max %.1lf us; "
+              "%llu late, %llu frames skipped, %llu records dropped",
+              (unsigned long long)stats.getCallbacks(), (unsigned long long)stats.getFrames(),
+              elapsed, jitter.getMin() * 1e3, jitter.getQuantile(0.5) * 1e3,
+              jitter.getQuantile(0.99) * 1e3, jitter.getMax() * 1e3,
+              duration.getQuantile(0.5) * 1e6, duration.getQuantile(0.99) * 1e6,
+              duration.getMax() * 1e6, (unsigned long long)stats.getLateCallbacks(),
+              (unsigned long long)stats.getSkippedFrames(),
+              (unsigned long long)(dropped - _callbackRecordsDropped));
+    }
+
+    // Lost input is worth a warning even without profiling.
+    if (stats.getInputOverflows() > 0 || stats.getInputUnderflows() > 0) {
+        qWarning("[QPitchCore callback] %llu input overflows, %llu input underflows in %.1lf s",
+                 (unsigned long long)stats.getInputOverflows(),
+                 (unsigned long long)stats.getInputUnderflows(), elapsed);
+    }
+
+    _callbackStatistics.reset();
+    _callbackRecordsDropped = dropped;
+    _callbackReportStart = now;
+}
+
+bool QPitchCore::isAnalysisDue() const
+{
+    return _scheduler.isDue(AnalysisScheduler::ClockType::now(), _ring->getUnread());
+}
+
+bool QPitchCore::onOptionsChanged(QMutexLocker<QMutex> &locker)
+{
+    // Note: The GUI thread may modify _pendingOptions again once we unlock.
     // It doesn't matter, as long as we take the latest version.
     Q_ASSERT(_pendingOptions);
-    _options = std::move(_pendingOptions.value());
+    QPitchCoreOptions options = std::move(_pendingOptions.value());
     _pendingOptions.reset();
-    locker.unlock();
 
-    reconfigure();
+    // Prevent deadlock with PortAudio's callback thread.
+    locker.unlock();
 
-    startStream();
+    // ** CLASSIFY THE CHANGE ** //
+    // Only a new sample rate or a larger ring needs a new stream.  The rest is swapped between
+    // two frames, while the callback keeps filling the ring.
+    uint32_t sourceFrequency = _source->getSampleFrequency(options.sampleFrequency);
+    QPitchCoreOptionsChange change =
+            classifyOptionsChange(_options, options, sourceFrequency, _ring->getCapacity());
+
+    switch (change) {
+    case QPitchCoreOptionsChange::Tuning:
+        qDebug("Options changed: tuning.");
+        _options.tuningParameters = options.tuningParameters;
+        break;
+
+    case QPitchCoreOptionsChange::Analysis:
+        qDebug("Options changed: analysis.");
+        // keep the sample rate of the source, as reconfigure() set it
+        options.sampleFrequency = _options.sampleFrequency;
+        _options = std::move(options);
+        reconfigureAnalysis();
+        break;
+
+    case QPitchCoreOptionsChange::Stream:
+        qDebug("Options changed: stream.");
+        _options = std::move(options);
+        try {
+            // stopping may fail as well, in which case the source is no longer started
+            stopStream();
+            reconfigure();
+            startStream();
+        } catch (const AudioSourceException &e) {
+            qCritical("[QPitchCore] Audio input error: %s", e.what());
+            emit audioSourceFailed(QString::fromStdString(e.what()));
+            locker.relock();
+            return false;
+        }
+        break;
+    }
 
     locker.relock();
+    return true;
 }
 
 void QPitchCore::reconfigure()
 {
     // The stream must be stopped.
-    Q_ASSERT(_stream == nullptr);
+    Q_ASSERT(!_source->isStarted());
+
+    // ** MATCH THE SAMPLE RATE OF THE SOURCE ** //
+    // Files and pipes come at their own sample rate, whatever the settings say.
+    uint32_t sourceFrequency = _source->getSampleFrequency(_options.sampleFrequency);
+    if (sourceFrequency != _options.sampleFrequency) {
+        qInfo("[QPitchCore] Analysing at %u Hz, the sample rate of the audio source, instead of "
+              "%u Hz",
+              sourceFrequency, _options.sampleFrequency);
+        _options.sampleFrequency = sourceFrequency;
+    }
 
     // ** INITIALIZE BUFFERS ** //
-    _buffer = CyclicBuffer(_options.fftFrameSize * sizeof(SampleType));
-    _tmpSampleBuffer.clear();
-    _tmpSampleBuffer.resize(_options.fftFrameSize);
+    // Twice the frame size, so that the callback practically never overwrites the samples being
+    // read out of the ring.  At least for the largest frame size of the settings, which can then
+    // be selected without stopping the stream.
+    _ring = std::make_unique<SampleRing<SampleType>>(
+            2 * std::max(_options.fftFrameSize, RING_MIN_FRAME_SIZE));
+
+    // ** START OVER THE CALLBACK TELEMETRY ** //
+    // Records of the previous stream, if any, are discarded.
+    CallbackRecord record;
+    while (_callbackTelemetry.pop(record)) { }
+    _callbackStatistics = CallbackStatistics(_options.sampleFrequency);
+    _callbackRecordsDropped = _callbackTelemetry.getDropped();
+    _callbackReportStart = std::chrono::steady_clock::now();
+
+    reconfigureAnalysis();
+}
+
+void QPitchCore::reconfigureAnalysis()
+{
+    // ** SCHEDULE THE ANALYSES ** //
+    _scheduler = AnalysisScheduler(_options.analysisRate, _options.analysisHop);
+
+    // The QPitchCore thread is late when a whole hop, or two periods worth of samples, are
+    // waiting for it.
+    if (_scheduler.isSampleDriven()) {
+        _lateFrameThreshold = _scheduler.getHop();
+        _wakeUpThreshold = _scheduler.getHop();
+    } else {
+        _lateFrameThreshold =
+                (uint64_t)ceil(2.0 * _options.sampleFrequency / _options.analysisRate);
+        _wakeUpThreshold = 0;
+    }
+    if (_scheduler.isSampleDriven()) {
+        qInfo("[QPitchCore] Analysing every %zu new samples", _scheduler.getHop());
+    } else {
+        qInfo("[QPitchCore] Analysing at %.0lf Hz", _options.analysisRate);
+    }
 
     // ** CREATE THE PITCH DETECTION INSTANCE ** //
-    _pitchDetection = std::make_unique<PitchDetectionContext>(_options.sampleFrequency,
-                                                              _options.fftFrameSize);
+    // Going back to a recent configuration reuses its detector, with its buffers and its
+    // measured plans.
+    PitchDetectorConfig detectorConfig{ _options.pitchDetectorEngine, _options.sampleFrequency,
+                                        _options.fftFrameSize, _options.zeroPaddingFactor,
+                                        _options.peakInterpolation };
+    // stopStream() keeps the detector in use for this; there is none before the first stream.
+    if (_pitchDetection) {
+        _detectorPool.release(_pitchDetectionConfig, std::move(_pitchDetection));
+    }
+    bool reused = false;
+    _pitchDetection = _detectorPool.acquire(detectorConfig, &reused);
+    _pitchDetectionConfig = detectorConfig;
+    _detectionProfiler = DurationProfiler();
+
+    qInfo("[QPitchCore] %s engine, FFTW plans for %zu frames (IFFT of %zu, %s precision): %s, "
+          "planned in %.3lf ms%s",
+          pitchDetectorEngineName(_pitchDetection->getEngine()), _options.fftFrameSize,
+          _pitchDetection->getOutFrameSize(),
+          sizeof(AnalysisReal) == sizeof(float) ? "single" : "double",
+          planSourceName(_pitchDetection->getPlanSource()),
+          _pitchDetection->getPlanningTime() * 1000.0, reused ? " (reused)" : "");
+
+    // ** MEASURE BETTER PLANS IN THE BACKGROUND ** //
+    // Plans from the wisdom are already measured, unless we want FFTW_PATIENT ones.
+    if (_pitchDetection->getPlanSource() == PlanSource::Estimate || _planRefiner->isPatient()) {
+        _planRefiner->request(_options.fftFrameSize, _pitchDetection->getOutFrameSize(),
+                              _pitchDetection->getPlanSlot());
+    }
 }
 
 void QPitchCore::processBuffer(QMutexLocker<QMutex> &locker)
 {
-    Q_ASSERT(_bufferUpdated);
+    Q_ASSERT(_ring->getUnread() > 0);
     Q_ASSERT(_pitchDetection);
 
-    // No need to keep the lock when we copy the buffer contents.
+    // No need to keep the lock when we read the ring.
     locker.unlock();
 
-    size_t framesCopied;
-    {
-        QMutexLocker bufferLocker(&_bufferMutex);
-        // Dump the samples out of the cyclic buffer.
-        size_t bytesCopied = _buffer.copyLastBytes((unsigned char *)_tmpSampleBuffer.data(),
-                                                   _options.fftFrameSize * sizeof(SampleType));
-        framesCopied = bytesCopied / sizeof(SampleType);
-    }
+    // The last samples are contiguous in the ring, so we read them in place.
+    SampleRing<SampleType>::View frame = _ring->viewLast(_options.fftFrameSize);
 
-    {
-        locker.relock();
-        // This is for notifying the callback thread.
-        _bufferUpdated = false;
-        locker.unlock();
+    // Count the samples that were not in the previous frame, for the incremental engines.  The
+    // callback counts the new frames from here.
+    uint64_t newSamples = frame.end - _ring->getReadPosition();
+    _ring->markRead(frame.end);
+    if (newSamples > frame.size) {
+        // some samples came and went between two analyses
+        _callbackStatistics.addSkippedFrames(newSamples - frame.size);
     }
 
-    // Transfer the samples to _pitchDetection, converting sample format (float -> double) at the same time.
-    _pitchDetection->loadSamples(_tmpSampleBuffer.data(), framesCopied);
+    std::chrono::time_point<std::chrono::steady_clock> detectionStart =
+            std::chrono::steady_clock::now();
+    PlanSource previousPlanSource = _pitchDetection->getPlanSource();
+
+    // Transfer the samples to _pitchDetection, converting the sample format to AnalysisReal (and
+    // windowing them, for the autocorrelation).  The incremental engines only process the new
+    // samples at the end of the frame.
+    _pitchDetection->slideSamples(frame.data, frame.size,
+                                  (size_t)std::min<uint64_t>(newSamples, frame.size));
+
+    // If the callback lapped us while we were reading, load the latest frame from scratch.  The
+    // samples loaded are not used before they are validated here.
+    while (!_ring->isIntact(frame)) {
+        qDebug("[QPitchCore] The callback overwrote the frame being loaded, loading it again");
+        frame = _ring->viewLast(_options.fftFrameSize);
+        _ring->markRead(frame.end);
+        _pitchDetection->loadSamples(frame.data, frame.size);
+    }
 
     // Do pitch detection.
     double estimatedFrequency = _pitchDetection->runPitchDetectionAlgorithm();
+
+    double detectionDuration = std::chrono::duration<double>(std::chrono::steady_clock::now()
+                                                             - detectionStart)
+                                       .count();
+
+    if (_pitchDetection->getPlanSource() != previousPlanSource) {
+        qInfo("[QPitchCore] Switched from %s to %s FFTW plans (planned in %.3lf ms)",
+              planSourceName(previousPlanSource), planSourceName(_pitchDetection->getPlanSource()),
+              _pitchDetection->getPlanningTime() * 1000.0);
+    }
+
+    if (_detectionProfiler.record(detectionDuration)) {
+        qInfo("[QPitchCore] Pitch detection (%s): %llu frames, %.1lf us per frame (max %.1lf us), "
+              "%s plans, %llu analysis periods skipped",
+              pitchDetectorEngineName(_pitchDetection->getEngine()),
+              (unsigned long long)_detectionProfiler.getCount(),
+              _detectionProfiler.getAverage() * 1e6, _detectionProfiler.getMax() * 1e6,
+              planSourceName(_pitchDetection->getPlanSource()),
+              (unsigned long long)_scheduler.getSkippedPeriods());
+    }
     std::optional<EstimatedNote> estimatedNote =
             _options.tuningParameters.estimateNote(estimatedFrequency);
 
-    // Populate visualization data.
+    // Populate visualization data.  The back buffer is ours until it is published, however slow
+    // the render worker is.
     {
-        QMutexLocker visDataLocker(&_visualizationData.mutex);
-
-        _visualizationData.popluateSamples(_tmpSampleBuffer.data(), framesCopied,
-                                           _options.sampleFrequency);
-        _visualizationData.popluateSpectrum(_pitchDetection->getFreq2Buffer(),
-                                            _pitchDetection->getFFTFrameSize(),
-                                            _options.sampleFrequency);
-        _visualizationData.popluateAutoCorr(
+        VisualizationData &visData = _visualizationData.getBackBuffer();
+
+        // The oscilloscope shows the frame in place too.  The callback would have to deliver a
+        // whole frame during the detection to overwrite it, and a torn frame only shows once.
+        visData.popluateSamples(frame.data, frame.size, _options.sampleFrequency);
+        visData.popluateSpectrum<AnalysisReal>(_pitchDetection->getFreq2Buffer(),
+                                               _pitchDetection->getFFTFrameSize(),
+                                               _options.sampleFrequency);
+        visData.popluateAutoCorr<AnalysisReal>(
                 _pitchDetection->getAutoCorrBuffer(), _pitchDetection->getOutFrameSize(),
-                _options.sampleFrequency, PitchDetectionContext::ZERO_PADDING_FACTOR);
+                _options.sampleFrequency,
+                (double)_pitchDetection->getOutFrameSize() / _pitchDetection->getFFTFrameSize());
 
-        _visualizationData.estimatedFrequency = estimatedFrequency;
-        _visualizationData.estimatedNote =
-                _options.tuningParameters.estimateNote(_visualizationData.estimatedFrequency);
+        visData.estimatedFrequency = estimatedFrequency;
+        visData.estimatedNote = estimatedNote;
+        visData.frameNumber = ++_numAnalysedFrames;
+        visData.analysisTime = detectionStart;
+    }
+    // No signal: the render worker takes the last frame when it renders the next one.
+    _visualizationData.publish();
+
+    if (_numAnalysedFrames == 1) {
+        qInfo("[QPitchCore] Startup: first frame analysed %.3lf ms after the construction",
+              std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now()
+                                                        - _constructionTime)
+                      .count());
     }
-
-    emit visualizationDataUpdated(&_visualizationData);
 
     locker.relock();
 }
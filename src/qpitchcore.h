@@ -22,61 +22,33 @@
 
 #pragma once
 
+#include "analysisscheduler.h"
+#include "audiosource.h"
 #include "notes.h"
 #include "visualization_data.h"
-#include "cyclicbuffer.h"
+#include "triplebuffer.h"
+#include "samplering.h"
 #include "pitchdetection.h"
+#include "detectorpool.h"
+#include "fftwplanner.h"
 #include "qpitchannotations.h"
+#include "qpitchcoreoptions.h"
 #include "fpsprofiler.h"
+#include "callbacktelemetry.h"
 
-/// Definition used to feed the application with a reference squarewave
-/// TODO: This needs to be reimplemented.
-//#define _REFERENCE_SQUAREWAVE_INPUT
-
+#include <atomic>
+#include <chrono>
+#include <cstdint>
 #include <cstring>
-#include <iostream>
-#include <stdexcept>
+#include <memory>
 
 #include <portaudio.h>
 
-#include <QMessageBox>
 #include <QThread>
 #include <QMutex>
 #include <QMutexLocker>
 #include <QWaitCondition>
 
-/// An exception thrown when a PortAudio error occurs
-class QPaSoundInputException : public std::runtime_error
-{
-
-public: /* methods */
-    /// Default constructor.
-    ///
-    /// \param[in] msg the error message to display
-    QPaSoundInputException(const std::string &msg) : std::runtime_error(msg) { return; };
-
-    /// Report exception.
-    void report()
-    {
-        QMessageBox::critical(nullptr, "QPitch", QString("PortAudio error: %1.").arg(this->what()));
-        std::cerr << "PortAudio error: " << this->what() << "\n";
-    };
-};
-
-/// Options for the QPitchCore thread.
-///
-/// This contains options that are settable by the UI.  The acutal QPitchCore thread may keep a
-/// private copy of this in order to work safely concurrently.
-///
-/// Some fields may mirror that of QPitchSettings, while others can be run-time options such as the
-/// selected device (to be added).
-struct QPitchCoreOptions
-{
-    uint32_t sampleFrequency;
-    size_t fftFrameSize;
-    TuningParameters tuningParameters;
-};
-
 /// Private implementation.  Not visible from outside.
 class QPitchCorePrivate;
 
@@ -84,37 +56,49 @@ class QPitchCorePrivate;
 ///
 /// This class implements the main working thread for the QPitch application.
 ///
-/// The audio stream is acquired through the PortAudio library (cross-platform) using a callback
-/// function. The size of the internal buffer is set to the size suggested for robust
-/// non-interactive application, since the latency is not an issue in this application. In the
-/// current version the default audio input stream is used, thus the selection of the audio input is
-/// performed using the control panel of the operating system.
+/// The samples come from an AudioSource, chosen on the command line, through a callback function.
+/// By default it is the default audio input of the PortAudio library (cross-platform), thus the
+/// selection of the audio input is performed using the control panel of the operating system.  A
+/// WAV file, raw samples on the standard input or a synthetic signal (SignalGenerator) can be
+/// analysed instead, for repeatable tests.
 ///
-/// The pitch detection algorithm is based on the identification of the first peak in the
-/// autocorrelation of the signal, which is computed as the inverse FFT of the power spectral
-/// density of the signal (the squared module of the signal FFT). The FFT is computed using the
-/// FFTW3 library and prior to the inverse transform the signal is zero-padded to increase the
-/// resolution of the autocorrelation in order to have a better frequency identification.
+/// The pitch detection engine is selected at run time (see PitchDetector).  The default one is
+/// based on the identification of the first peak in the autocorrelation of the signal, which is
+/// computed as the inverse FFT of the power spectral density of the signal (the squared module of
+/// the signal FFT). The FFT is computed using the FFTW3 library and prior to the inverse
+/// transform the signal is zero-padded to increase the resolution of the autocorrelation in
+/// order to have a better frequency identification. The padding can be reduced at run time, in
+/// which case the lag of the peak is refined by interpolation instead.  The YIN and McLeod
+/// engines work on the squared difference function of the signal, restricted to the lags of the
+/// notes that can be displayed.
 class QPitchCore : public QThread
 {
     Q_OBJECT
 
-#ifdef _REFERENCE_SQUAREWAVE_INPUT
-public: /* members */
-    short int _referenceSineWave[4410]; /// Artificial sine-wave used for debug
-    unsigned int _referenceSineWave_index; /// Index incremented after each step to simulate time
-#endif
-
 private: /* sample format related */
+    /// The format of the samples delivered by AudioSource
     using SampleType = float;
-    const PaSampleFormat PA_SAMPLE_FORMAT = paFloat32;
+
+private: /* constants */
+    /// Seconds between two reports of the callback statistics
+    static const double CALLBACK_REPORT_INTERVAL;
+
+    /// Smallest frame size the ring is made for: the largest of the settings, so that the frame
+    /// size can change without replacing the ring
+    static const size_t RING_MIN_FRAME_SIZE;
 
 public: /* methods */
     /// Default constructor.
     ///
-    /// \param[in] plotPlot_size the number of sample in the buffer used for visualization
+    /// Returns right away: the FFTW wisdom, the audio source and the pitch detection are set up
+    /// by the thread once started, and audioSourceStarted() or audioSourceFailed() is emitted.
+    ///
+    /// \param[in] plotPlot_size the number of lags of the autocorrelation used for visualization
     /// \param[in] parent a QObject* with the handle of the parent
-    QPitchCore(QObject *parent, const unsigned int plotPlot_size, QPitchCoreOptions options);
+    /// \param[in] sourceOptions where the samples come from
+    /// \param[in] wisdomPath the FFTW wisdom file to load, or an empty string for none
+    QPitchCore(QObject *parent, const unsigned int plotPlot_size, QPitchCoreOptions options,
+               const AudioSourceOptions &sourceOptions, const QString &wisdomPath = QString());
 
     /// Default destructor.
     ~QPitchCore();
@@ -122,20 +106,27 @@ public: /* methods */
     /// Set options while QPitchCore is running.
     void setOptions(QPitchCoreOptions options);
 
+    /// Take the last visualization data published by the thread.  Only call from one other
+    /// thread, the render worker, which polls it at its own pace: the frames published in between
+    /// are dropped.
+    ///
+    /// \return the data, valid and unchanged until the next call, or nullptr if none was
+    ///         published since the last call
+    const VisualizationData *takeVisualizationData();
+
     /// Request the running QPitchCore thread to stop.
     void requestStop();
 
     /// Dummy callback function to call the real non-static callback that does the work.
     ///
-    /// \param[in] input Pointer to the interleaved input samples.
-    /// \param[out] output Pointer to the interleaved output samples.
+    /// \param[in] input Pointer to the input samples.
     /// \param[in] frameCount Number of sample frames to be processed.
     /// \param[in] timeInfo Time when the buffer is processed.
     /// \param[in] statusFlags Whether underflow or overflow occurred.
     /// \param[in] userData Pointer to user data.
-    static int paCallback(const void *input, void *output, unsigned long frameCount,
-                          const PaStreamCallbackTimeInfo *timeInfo,
-                          PaStreamCallbackFlags statusFlags, void *userData);
+    static int audioSourceCallback(const SampleType *input, unsigned long frameCount,
+                                   const PaStreamCallbackTimeInfo *timeInfo,
+                                   PaStreamCallbackFlags statusFlags, void *userData);
 
     /// Play the selected WAV file through the selected PortAudio device.
     ///
@@ -149,13 +140,11 @@ public slots:
     void setCallbackProfilingEnabled(bool enabled);
 
 signals:
-    /// Emitted when the port audio stream is started.
-    void portAudioStreamStarted(QString device, QString hostApi);
+    /// Emitted when the audio source is started.
+    void audioSourceStarted(QString device, QString hostApi);
 
-    /// Emitted when any part of the visualization data is updated.
-    ///
-    /// \param[in] visData a reference to the VisualizationData struct
-    void visualizationDataUpdated(VisualizationData *visData);
+    /// Emitted when the audio source cannot be opened or started.  The thread then finishes.
+    void audioSourceFailed(QString message);
 
 protected:
     /// Main loop of the thread.
@@ -172,12 +161,9 @@ private: /* members */
     /// The main Mutex, guarding boolean events fields.
     QMutex _mutex;
 
-    /// The main CondVar for responding to events.
+    /// The main CondVar for responding to events, in the fixed-rate mode.
     QWaitCondition _cond QPITCH_GUARDED_BY(_mutex);
 
-    /// Set to true when the input buffer is filled by the audio backend.
-    bool _bufferUpdated QPITCH_GUARDED_BY(_mutex);
-
     /// Set to true when the QPitchCore thread is requested to stop.
     bool _stopRequested QPITCH_GUARDED_BY(_mutex);
 
@@ -186,61 +172,125 @@ private: /* members */
     QPitchCoreOptions _options;
     std::optional<QPitchCoreOptions> _pendingOptions QPITCH_GUARDED_BY(_mutex);
 
-    // ** PORTAUDIO STREAM ** //
+    // ** AUDIO SOURCE ** //
 
-    /// Handle to the PortAudio stream
-    PaStream *_stream;
+    /// Where the samples come from, opened by startUp()
+    std::unique_ptr<AudioSource> _source;
 
-    // ** COMMUNICATION WITH PORTAUDIO CALLBACKS ** //
+    /// What _source is created from
+    AudioSourceOptions _sourceOptions;
 
-    /// A mutex dedicated to _buffer itself.
-    QMutex _bufferMutex;
+    /// The FFTW wisdom file loaded by startUp(), if not empty
+    QString _wisdomPath;
 
-    /// Buffer to store the input samples read in the callback
-    CyclicBuffer _buffer QPITCH_GUARDED_BY(_bufferMutex);
+    // ** STARTUP ** //
 
-    /// A temporary buffer for dumping samples from the cyclic buffer
-    std::vector<SampleType> _tmpSampleBuffer;
+    /// When the constructor was called, for the time of each phase of the startup
+    std::chrono::time_point<std::chrono::steady_clock> _constructionTime;
+
+    /// Number of frames analysed since the construction
+    uint64_t _numAnalysedFrames;
+
+    // ** COMMUNICATION WITH AUDIO SOURCE CALLBACKS ** //
+
+    /// Ring of the input samples written by the callback and read by the QPitchCore thread,
+    /// without locks.  The samples since its read position have not been analysed yet.
+    /// Replaced only while the stream is stopped.
+    std::unique_ptr<SampleRing<SampleType>> _ring;
+
+    // ** ANALYSIS SCHEDULING ** //
+
+    /// Decides when the buffer is analysed.  Only used by the QPitchCore thread.
+    AnalysisScheduler _scheduler;
+
+    /// Number of unread samples from which the callback wakes up the QPitchCore thread, or 0 in
+    /// the fixed-rate mode, where it wakes up by itself.  Mirrors _scheduler for the callback.
+    std::atomic<uint64_t> _wakeUpThreshold;
+
+    /// Posted (incremented and notified) to wake up the QPitchCore thread in the hop mode: by
+    /// the callback without any lock when a hop is waiting, and by wakeUp().
+    std::atomic<uint32_t> _wakeUps;
 
     // ** FFT ** //
 
-    std::unique_ptr<PitchDetectionContext> _pitchDetection;
+    std::unique_ptr<PitchDetector<AnalysisReal>> _pitchDetection;
+
+    /// The configuration _pitchDetection was created from
+    PitchDetectorConfig _pitchDetectionConfig{};
+
+    /// The detectors of the previous configurations, reused when the options go back to one
+    PitchDetectorPool<AnalysisReal> _detectorPool;
+
+    /// Builds measured FFTW plans for _pitchDetection in the background
+    std::unique_ptr<PlanRefiner<AnalysisReal>> _planRefiner;
+
+    /// Time spent in the pitch detection of each frame by the current engine
+    DurationProfiler _detectionProfiler;
 
     // ** TEMPORARY BUFFERS USED FOR VISUALIZATION ** //
 
-    /// Visualization data shared with the UI thread
-    VisualizationData _visualizationData;
+    /// Visualization data published to the render worker, without locks or copies
+    TripleBuffer<VisualizationData> _visualizationData;
 
-    // ** CALLBACK PROFILING ** //
+    // ** CALLBACK TELEMETRY ** //
 
-    /// Set to true to enable callback profiling
-    std::atomic<bool> _callbackProfilingEnabled;
+    /// Records pushed by the callback and drained by the QPitchCore thread
+    CallbackTelemetryQueue _callbackTelemetry;
+
+    /// Number of pending frames from which the callback considers the QPitchCore thread late
+    std::atomic<uint64_t> _lateFrameThreshold;
 
-    /// Set to true when the callback is called the first time after callback profiling is enabled
-    bool _callbackProfilingStarted;
+    /// Statistics of the drained records since the last report
+    CallbackStatistics _callbackStatistics;
 
-    /// The time the last callback was called, as reported by PortAudio
-    double _lastCallbackTime;
+    /// _callbackTelemetry.getDropped() at the last report
+    uint64_t _callbackRecordsDropped;
 
-    /// The time the ADC captured the first sample in the last callback, as reported by PortAudio
-    double _lastAdcTime;
+    /// The time of the last report
+    std::chrono::time_point<std::chrono::steady_clock> _callbackReportStart;
 
-    /// FPSProfiler for callback.
-    FPSProfiler _callbackProfiler;
+    /// Set to true to report the callback statistics
+    std::atomic<bool> _callbackProfilingEnabled;
 
 private: /* methods */
-    /// Start an input audio stream.
+    /// Load the wisdom, open the audio source, create the pitch detection and start the stream,
+    /// logging the time of each phase.
+    ///
+    /// \return false, after emitting audioSourceFailed(), if the audio source failed
+    bool startUp();
+
+    /// Log the end of a phase of the startup.
+    void logStartupPhase(const char *phase,
+                         std::chrono::time_point<std::chrono::steady_clock> &phaseStart);
+
+    /// Start the audio source.
     void startStream();
 
-    /// Stop the input audio stream.
+    /// Stop the audio source.
     void stopStream();
 
-    /// Called when options changed.
-    void onOptionsChanged(QMutexLocker<QMutex> &locker);
+    /// Called when options changed.  Only restarts the stream if the sample rate changed.
+    ///
+    /// \return false, after emitting audioSourceFailed(), if the stream could not be restarted
+    bool onOptionsChanged(QMutexLocker<QMutex> &locker);
 
-    /// Apply options.
+    /// Apply options.  The stream must be stopped.
     void reconfigure();
 
+    /// Apply the options of the pitch detection and of its scheduling.  May be called while the
+    /// stream is running, between two frames.
+    void reconfigureAnalysis();
+
+    /// Account for the records of the callback, and report them every CALLBACK_REPORT_INTERVAL.
+    /// Call without _mutex held, since it logs.
+    void drainCallbackTelemetry();
+
+    /// Wake up the QPitchCore thread after an event.  Call with _mutex held.
+    void wakeUp();
+
+    /// Whether the buffer should be analysed now.  Call with _mutex held.
+    bool isAnalysisDue() const;
+
     /// Process the updated buffer.
     void processBuffer(QMutexLocker<QMutex> &locker);
 };
@@ -0,0 +1,21 @@
+#include "qpitchcoreoptions.h"
+
+QPitchCoreOptionsChange classifyOptionsChange(const QPitchCoreOptions &from,
+                                              const QPitchCoreOptions &to,
+                                              uint32_t sourceFrequency, size_t ringCapacity)
+{
+    if (sourceFrequency != from.sampleFrequency) {
+        return QPitchCoreOptionsChange::Stream;
+    }
+    if (to.fftFrameSize != from.fftFrameSize || to.pitchDetectorEngine != from.pitchDetectorEngine
+        || to.zeroPaddingFactor != from.zeroPaddingFactor
+        || to.peakInterpolation != from.peakInterpolation || to.analysisRate != from.analysisRate
+        || to.analysisHop != from.analysisHop) {
+        // a larger frame than the ring was made for needs a new ring
+        if (2 * to.fftFrameSize > ringCapacity) {
+            return QPitchCoreOptionsChange::Stream;
+        }
+        return QPitchCoreOptionsChange::Analysis;
+    }
+    return QPitchCoreOptionsChange::Tuning;
+}
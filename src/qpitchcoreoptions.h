@@ -0,0 +1,48 @@
+#pragma once
+
+#include "notes.h"
+#include "pitchdetection.h"
+
+#include <cstddef>
+#include <cstdint>
+
+/// Options for the QPitchCore thread.
+///
+/// This contains options that are settable by the UI.  The acutal QPitchCore thread may keep a
+/// private copy of this in order to work safely concurrently.
+///
+/// Some fields may mirror that of QPitchSettings, while others can be run-time options such as the
+/// selected device (to be added).
+struct QPitchCoreOptions
+{
+    uint32_t sampleFrequency;
+    size_t fftFrameSize;
+    PitchDetectorEngine pitchDetectorEngine;
+    int zeroPaddingFactor;
+    PeakInterpolation peakInterpolation;
+    /// Number of analyses per second, unless analysisHop is set
+    double analysisRate;
+    /// Number of new samples between two analyses, or 0 to analyse at analysisRate
+    size_t analysisHop;
+    TuningParameters tuningParameters;
+};
+
+/// What a change of QPitchCoreOptions affects, from the least to the most disruptive.
+enum class QPitchCoreOptionsChange {
+    /// Only the tuning parameters (or nothing): applied to the next frame
+    Tuning,
+    /// The pitch detection or its scheduling: applied between two frames, while capturing
+    Analysis,
+    /// The sample rate, or a frame too large for the ring: the audio source is restarted
+    Stream,
+};
+
+/// Classify the change from one set of options to another.
+///
+/// \param[in] sourceFrequency the sample rate the audio source would deliver at
+///            to.sampleFrequency, which from.sampleFrequency already is
+/// \param[in] ringCapacity the number of samples the ring of the running stream holds: a frame
+///            larger than half of it needs a new ring, hence a new stream
+QPitchCoreOptionsChange classifyOptionsChange(const QPitchCoreOptions &from,
+                                              const QPitchCoreOptions &to,
+                                              uint32_t sourceFrequency, size_t ringCapacity);
@@ -1,5 +1,7 @@
 #include "qpitchsettings.h"
 
+#include <QDir>
+#include <QFileInfo>
 #include <QSettings>
 
 QPitchSettings::QPitchSettings()
@@ -13,6 +15,12 @@ void QPitchSettings::loadDefault()
     fftFrameSize = 4096;
     fundamentalFrequency = 440.0;
     tuningNotation = TuningNotation::US;
+    pitchDetectorEngine = PitchDetectorEngine::Autocorrelation;
+    zeroPaddingFactor = 2;
+    peakInterpolation = PeakInterpolation::Sinc;
+    analysisRate = 60;
+    analysisHop = 0;
+    displayRate = 0;
 }
 
 template <class T, class F>
@@ -56,6 +64,37 @@ void QPitchSettings::load()
         // restrict the fundamental TuningNotation to the range 0 (US) - 1 (French) - 2 (German)
         return v <= TuningNotation::GERMAN;
     });
+
+    loadValidateAndSet(settings, "analysis/engine", pitchDetectorEngine, [](auto v) {
+        // restrict the engine to the range 0 (Autocorrelation) - 3 (SlidingDft)
+        return v <= PitchDetectorEngine::SlidingDft;
+    });
+
+    loadValidateAndSet(settings, "analysis/zeropadding", zeroPaddingFactor, [](auto v) {
+        // restrict the zero-padding factor to the values offered by the settings dialog
+        return v == 1 || v == 2 || v == 4 || v == 8 || v == 80;
+    });
+
+    loadValidateAndSet(settings, "analysis/peakinterpolation", peakInterpolation, [](auto v) {
+        // restrict the peak interpolation to the range 0 (None) - 3 (Sinc)
+        return v <= PeakInterpolation::Sinc;
+    });
+
+    loadValidateAndSet(settings, "analysis/rate", analysisRate, [](auto v) {
+        // restrict the analysis rate to the values offered by the settings dialog
+        return v == 30 || v == 60 || v == 120 || v == 240;
+    });
+
+    loadValidateAndSet(settings, "analysis/hop", analysisHop, [](auto v) {
+        // restrict the hop to the values offered by the settings dialog (0 means fixed rate)
+        return v == 0 || v == 256 || v == 512 || v == 1024 || v == 2048;
+    });
+
+    loadValidateAndSet(settings, "display/rate", displayRate, [](auto v) {
+        // restrict the display rate to the values offered by the settings dialog (0 means the
+        // refresh rate of the screen)
+        return v == 0 || v == 30 || v == 60 || v == 120 || v == 144 || v == 240;
+    });
 }
 
 template <class T>
@@ -75,4 +114,17 @@ void QPitchSettings::store()
     storeSetting(settings, "audio/buffersize", fftFrameSize);
     storeSetting(settings, "audio/fundamentalfrequency", fundamentalFrequency);
     storeSetting(settings, "audio/tuningnotation", (int)tuningNotation);
+    storeSetting(settings, "analysis/engine", (int)pitchDetectorEngine);
+    storeSetting(settings, "analysis/zeropadding", zeroPaddingFactor);
+    storeSetting(settings, "analysis/peakinterpolation", (int)peakInterpolation);
+    storeSetting(settings, "analysis/rate", analysisRate);
+    storeSetting(settings, "analysis/hop", analysisHop);
+    storeSetting(settings, "display/rate", displayRate);
+}
+
+QString QPitchSettings::wisdomFilePath()
+{
+    QSettings settings("QPitch", "QPitch");
+    QDir settingsDir = QFileInfo(settings.fileName()).absoluteDir();
+    return settingsDir.filePath(FFTWTraits<AnalysisReal>::WISDOM_FILE_NAME);
 }
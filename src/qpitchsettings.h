@@ -1,6 +1,9 @@
 #pragma once
 
 #include "notes.h"
+#include "pitchdetection.h"
+
+#include <QString>
 
 /// Structure holding the application settings
 struct QPitchSettings
@@ -17,6 +20,24 @@ struct QPitchSettings
     /// Current tuning notation
     TuningNotation tuningNotation;
 
+    /// The pitch detection engine
+    PitchDetectorEngine pitchDetectorEngine;
+
+    /// Number of times the power spectrum is zero-padded before computing the autocorrelation
+    unsigned int zeroPaddingFactor;
+
+    /// Method used to refine the lag of the autocorrelation peak
+    PeakInterpolation peakInterpolation;
+
+    /// Number of analyses per second, unless analysisHop is set
+    unsigned int analysisRate;
+
+    /// Number of new samples between two analyses, or 0 to analyse at analysisRate
+    unsigned int analysisHop;
+
+    /// Number of frames displayed per second, or 0 for the refresh rate of the screen
+    unsigned int displayRate;
+
     // ** METHODS ** //
 
     /// Default constructor.  Use default values.
@@ -30,4 +51,7 @@ struct QPitchSettings
 
     /// Store the settings to QSettings.
     void store();
+
+    /// The file storing the FFTW wisdom of the analysis precision, next to the QSettings store.
+    static QString wisdomFilePath();
 };
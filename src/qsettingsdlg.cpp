@@ -37,6 +37,10 @@ QSettingsDlg::QSettingsDlg(const QPitchSettings &settings, QWidget *parent) : QD
     connect(_ui->buttonBox, &QDialogButtonBox::accepted, this, &QSettingsDlg::acceptSettings);
     connect(_ui->buttonBox->button(QDialogButtonBox::RestoreDefaults), &QPushButton::pressed, this,
             &QSettingsDlg::restoreDefaultSettings);
+    connect(_ui->comboBox_pitchDetector, &QComboBox::currentIndexChanged, this,
+            &QSettingsDlg::updatePitchDetectorOptions);
+    connect(_ui->comboBox_analysisHop, &QComboBox::currentIndexChanged, this,
+            &QSettingsDlg::updateSchedulingOptions);
 
     load(settings);
 }
@@ -65,7 +69,25 @@ void QSettingsDlg::load(const QPitchSettings &settings)
             _ui->comboBox_sampleFrequency->findText(QString::number(settings.sampleFrequency)));
     _ui->comboBox_frameSize->setCurrentIndex(
             _ui->comboBox_frameSize->findText(QString::number(settings.fftFrameSize)));
+    _ui->comboBox_pitchDetector->setCurrentIndex((int)settings.pitchDetectorEngine);
+    _ui->comboBox_zeroPadding->setCurrentIndex(
+            _ui->comboBox_zeroPadding->findText(QString::number(settings.zeroPaddingFactor)));
+    _ui->comboBox_peakInterpolation->setCurrentIndex((int)settings.peakInterpolation);
+    _ui->comboBox_analysisRate->setCurrentIndex(
+            _ui->comboBox_analysisRate->findText(QString::number(settings.analysisRate)));
+    // the first entry ("Off") is the fixed-rate mode
+    _ui->comboBox_analysisHop->setCurrentIndex(
+            settings.analysisHop == 0
+                    ? 0
+                    : _ui->comboBox_analysisHop->findText(QString::number(settings.analysisHop)));
+    // the first entry ("Screen") is the refresh rate of the screen
+    _ui->comboBox_displayRate->setCurrentIndex(
+            settings.displayRate == 0
+                    ? 0
+                    : _ui->comboBox_displayRate->findText(QString::number(settings.displayRate)));
     _ui->doubleSpinBox_fundamentalFrequency->setValue(settings.fundamentalFrequency);
+    updatePitchDetectorOptions();
+    updateSchedulingOptions();
 
     switch (settings.tuningNotation) {
     default:
@@ -88,6 +110,17 @@ void QSettingsDlg::dump(QPitchSettings &settings)
     // ** UPDATE THE APPLICATION SETTINGS ** //
     settings.sampleFrequency = _ui->comboBox_sampleFrequency->currentText().toUInt();
     settings.fftFrameSize = _ui->comboBox_frameSize->currentText().toUInt();
+    settings.pitchDetectorEngine =
+            (PitchDetectorEngine)_ui->comboBox_pitchDetector->currentIndex();
+    settings.zeroPaddingFactor = _ui->comboBox_zeroPadding->currentText().toUInt();
+    settings.peakInterpolation = (PeakInterpolation)_ui->comboBox_peakInterpolation->currentIndex();
+    settings.analysisRate = _ui->comboBox_analysisRate->currentText().toUInt();
+    settings.analysisHop = _ui->comboBox_analysisHop->currentIndex() == 0
+            ? 0
+            : _ui->comboBox_analysisHop->currentText().toUInt();
+    settings.displayRate = _ui->comboBox_displayRate->currentIndex() == 0
+            ? 0
+            : _ui->comboBox_displayRate->currentText().toUInt();
     settings.fundamentalFrequency = _ui->doubleSpinBox_fundamentalFrequency->value();
 
     settings.tuningNotation = TuningNotation::US;
@@ -100,3 +133,19 @@ void QSettingsDlg::dump(QPitchSettings &settings)
         settings.tuningNotation = TuningNotation::GERMAN;
     }
 }
+
+void QSettingsDlg::updatePitchDetectorOptions()
+{
+    // the zero-padding and the peak interpolation only apply to the autocorrelation (the sliding
+    // DFT always refines the peak of a short autocorrelation)
+    bool autocorrelation = _ui->comboBox_pitchDetector->currentIndex()
+            == (int)PitchDetectorEngine::Autocorrelation;
+    _ui->comboBox_zeroPadding->setEnabled(autocorrelation);
+    _ui->comboBox_peakInterpolation->setEnabled(autocorrelation);
+}
+
+void QSettingsDlg::updateSchedulingOptions()
+{
+    // the analysis rate only applies when there is no hop
+    _ui->comboBox_analysisRate->setEnabled(_ui->comboBox_analysisHop->currentIndex() == 0);
+}
@@ -41,10 +41,11 @@ class QSettingsDlg;
 /// of the sample frequency and of the size of the frame used to
 /// compute the FFT.
 ///
-/// The configuration of the pitch detection algorithm includes
-/// the selection of the fundamental frequency (A4 = 440Hz as the
-/// default) used to build the note scale and the selection of the
-/// tuning notation (US, French and German notation).
+/// The configuration of the pitch detection algorithm includes the
+/// detection method, the zero-padding of the autocorrelation and the interpolation
+/// used to refine its peak, how often the signal is analysed, the selection of the
+/// fundamental frequency (A4 = 440Hz as the default) used to build the note scale and
+/// the selection of the tuning notation (US, French and German notation).
 class QSettingsDlg : public QDialog
 {
     Q_OBJECT
@@ -70,6 +71,13 @@ public slots:
     /// Accept the application settings in the dialog.
     void acceptSettings();
 
+private slots:
+    /// Enable the options that apply to the selected detection method.
+    void updatePitchDetectorOptions();
+
+    /// Enable the options that apply to the selected analysis scheduling.
+    void updateSchedulingOptions();
+
 private: /* members */
     // ** Qt WIDGETS ** //
 
@@ -0,0 +1,133 @@
+#include "renderworker.h"
+
+#include "qpitchcore.h"
+#include "triplebuffer_impl.h"
+#include "visualization_data.h"
+
+#include <QMutexLocker>
+
+template class TripleBuffer<RenderedFrame>;
+
+static_assert(sizeof(RenderedFrame::plots) / sizeof(QImage) == RenderWorker::NUM_PLOTS);
+
+RenderWorker::RenderWorker(QObject *parent, QPitchCore *core)
+    : QThread(parent),
+      _stopRequested(false),
+      _frameRequested(false),
+      _core(core),
+      _visData(nullptr),
+      _renderedFrames(RenderedFrame())
+{
+    Q_ASSERT(_core != nullptr);
+}
+
+RenderWorker::~RenderWorker()
+{
+    // ** ENSURE THAT THE THREAD IS NOT RUNNING ** //
+    Q_ASSERT(!this->isRunning());
+}
+
+void RenderWorker::setStyle(Plot plot, const PlotStyle &style)
+{
+    QMutexLocker locker(&_mutex);
+    _pendingStyles[plot] = style;
+}
+
+void RenderWorker::requestFrame()
+{
+    QMutexLocker locker(&_mutex);
+    _frameRequested = true;
+    _cond.wakeOne();
+}
+
+const RenderedFrame *RenderWorker::takeRenderedFrame()
+{
+    Q_ASSERT(QThread::currentThread() != this);
+
+    if (!_renderedFrames.update()) {
+        return nullptr;
+    }
+    return &_renderedFrames.getFrontBuffer();
+}
+
+void RenderWorker::stop()
+{
+    {
+        QMutexLocker locker(&_mutex);
+        _stopRequested = true;
+        _cond.wakeOne();
+    }
+    wait();
+}
+
+void RenderWorker::run()
+{
+    QMutexLocker locker(&_mutex);
+    while (true) {
+        while (!_stopRequested && !_frameRequested) {
+            _cond.wait(&_mutex);
+        }
+        if (_stopRequested) {
+            break;
+        }
+        _frameRequested = false;
+
+        // ** TAKE THE NEW LOOKS ** //
+        // Copying a style only copies references to the shared data of Qt.
+        std::optional<PlotStyle> styles[NUM_PLOTS];
+        for (int plot = 0; plot < NUM_PLOTS; ++plot) {
+            styles[plot].swap(_pendingStyles[plot]);
+        }
+        locker.unlock();
+
+        bool styleChanged = false;
+        for (int plot = 0; plot < NUM_PLOTS; ++plot) {
+            if (styles[plot]) {
+                _renderers[plot].setStyle(*styles[plot]);
+                styleChanged = true;
+            }
+        }
+
+        // ** TAKE THE LAST FRAME ** //
+        // The snapshot stays unchanged until the next one is taken, so the renderers plot it in
+        // place.
+        const VisualizationData *visData = _core->takeVisualizationData();
+        if (visData != nullptr) {
+            _visData = visData;
+            _renderers[PlotSamples].setData(visData->plotSample);
+            _renderers[PlotSamples].setScaleRange(visData->plotSampleRange);
+            _renderers[PlotSpectrum].setData(visData->plotSpectrum);
+            _renderers[PlotSpectrum].setScaleRange(visData->plotSpectrumRange);
+            _renderers[PlotSpectrum].setMarker(visData->estimatedFrequency);
+            _renderers[PlotAutoCorr].setData(visData->plotAutoCorr);
+            _renderers[PlotAutoCorr].setScaleRange(visData->plotAutoCorrRange);
+            // Period of the detected frequency, in milliseconds.
+            _renderers[PlotAutoCorr].setMarker(1000.0 / visData->estimatedFrequency);
+        }
+
+        // Nothing to render again if nothing changed since the last request.
+        if (visData != nullptr || styleChanged) {
+            renderFrame();
+        }
+
+        locker.relock();
+    }
+}
+
+void RenderWorker::renderFrame()
+{
+    // The back buffer is ours until it is published, however slow the GUI thread is.
+    RenderedFrame &frame = _renderedFrames.getBackBuffer();
+
+    for (int plot = 0; plot < NUM_PLOTS; ++plot) {
+        _renderers[plot].render(frame.plots[plot]);
+    }
+
+    if (_visData != nullptr) {
+        frame.estimatedNote = _visData->estimatedNote;
+        frame.frameNumber = _visData->frameNumber;
+        frame.analysisTime = _visData->analysisTime;
+    }
+
+    _renderedFrames.publish();
+}
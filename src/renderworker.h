@@ -0,0 +1,123 @@
+#pragma once
+
+#include "notes.h"
+#include "plotrenderer.h"
+#include "qpitchannotations.h"
+#include "triplebuffer.h"
+
+#include <QImage>
+#include <QMutex>
+#include <QThread>
+#include <QWaitCondition>
+
+#include <chrono>
+#include <cstdint>
+#include <optional>
+
+class QPitchCore;
+class VisualizationData;
+
+/// A frame of the plots, rendered by RenderWorker from a frame of visualization data.
+struct RenderedFrame
+{
+    /// The plots, in the order of RenderWorker::Plot
+    QImage plots[3];
+
+    // ** FROM THE VISUALIZATION DATA ** //
+
+    /// Estimated note
+    std::optional<EstimatedNote> estimatedNote;
+
+    /// VisualizationData::frameNumber, or 0 if no frame was analysed yet
+    uint64_t frameNumber = 0;
+
+    /// VisualizationData::analysisTime
+    std::chrono::steady_clock::time_point analysisTime;
+};
+
+/// The thread that renders the plots of the main window, so that the GUI thread only blits them.
+///
+/// Each time the GUI thread requests a frame, the worker takes the last visualization data from
+/// QPitchCore, renders the three plots into the images of a RenderedFrame with QPainter on the
+/// raster engine, and publishes it through a TripleBuffer: the GUI thread reads the last one in
+/// place while the next one is rendered into other images.  A frame is also rendered when the
+/// look of a plot changed, so that a resized window does not wait for a new note.
+class RenderWorker : public QThread
+{
+    Q_OBJECT
+
+public: /* types */
+    /// The plots of the main window
+    enum Plot {
+        PlotSamples,
+        PlotSpectrum,
+        PlotAutoCorr,
+        NUM_PLOTS,
+    };
+
+public: /* methods */
+    /// Constructor.
+    ///
+    /// \param[in] parent a QObject* with the handle of the parent
+    /// \param[in] core where to take the visualization data from; the worker is its only reader
+    RenderWorker(QObject *parent, QPitchCore *core);
+
+    /// Destructor.  The thread must be stopped.
+    ~RenderWorker();
+
+    /// Set the look of a plot.  Called by the GUI thread.
+    void setStyle(Plot plot, const PlotStyle &style);
+
+    /// Render a frame, if there is new visualization data or a new look.  Called by the GUI
+    /// thread.
+    void requestFrame();
+
+    /// Take the last frame rendered.  Called by the GUI thread.
+    ///
+    /// \return the frame, which stays unchanged until the next call, or nullptr if none was
+    ///         rendered since the last call
+    const RenderedFrame *takeRenderedFrame();
+
+    /// Stop the thread and wait for it.  Called by the GUI thread.
+    void stop();
+
+protected:
+    /// Main loop of the thread.
+    virtual void run();
+
+private: /* methods */
+    /// Render the plots into the back buffer of _renderedFrames and publish it.
+    void renderFrame();
+
+private: /* members */
+    // ** THREAD SYNCHRONIZATION ** //
+
+    /// Guards the requests from the GUI thread
+    QMutex _mutex;
+
+    /// Wakes the worker up
+    QWaitCondition _cond QPITCH_GUARDED_BY(_mutex);
+
+    /// Set to true when the worker is requested to stop
+    bool _stopRequested QPITCH_GUARDED_BY(_mutex);
+
+    /// Set to true when the GUI thread requested a frame
+    bool _frameRequested QPITCH_GUARDED_BY(_mutex);
+
+    /// Looks of the plots not taken by the worker yet
+    std::optional<PlotStyle> _pendingStyles[NUM_PLOTS] QPITCH_GUARDED_BY(_mutex);
+
+    // ** RENDERING ** //
+
+    /// Where the visualization data come from
+    QPitchCore *_core;
+
+    /// One renderer per plot, used by the worker only
+    PlotRenderer _renderers[NUM_PLOTS];
+
+    /// The last visualization data taken, or nullptr.  Unchanged until the next one is taken.
+    const VisualizationData *_visData;
+
+    /// The frames handed to the GUI thread
+    TripleBuffer<RenderedFrame> _renderedFrames;
+};
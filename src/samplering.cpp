@@ -0,0 +1,201 @@
+#include "samplering.h"
+
+#include <cassert>
+#include <algorithm>
+#include <bit>
+
+#ifdef __linux__
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+template <class T>
+SampleRing<T>::SampleRing(size_t capacity)
+    : _samples(nullptr),
+      _mapping(nullptr),
+      _capacity(std::bit_ceil(std::max<size_t>(capacity, 1))),
+      _storageSize(_capacity),
+      _mask(_capacity - 1),
+      _claimed(0),
+      _written(0),
+      _read(0)
+{
+    if (!mapMirroredStorage()) {
+        // mirror the samples by writing them twice
+        _heapSamples = std::make_unique<T[]>(2 * _storageSize);
+        _samples = _heapSamples.get();
+    }
+}
+
+template <class T>
+SampleRing<T>::~SampleRing()
+{
+#ifdef __linux__
+    if (_mapping != nullptr) {
+        munmap(_mapping, 2 * _storageSize * sizeof(T));
+    }
+#endif
+}
+
+template <class T>
+bool SampleRing<T>::mapMirroredStorage()
+{
+#ifdef __linux__
+    // each half must be a whole number of pages (both are powers of two)
+    size_t pageSize = sysconf(_SC_PAGESIZE);
+    size_t storageSize = std::max(_capacity, pageSize / sizeof(T));
+    size_t halfBytes = storageSize * sizeof(T);
+    if (halfBytes % pageSize != 0) {
+        return false;
+    }
+
+    int fd = memfd_create("qpitch-samples", MFD_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+    if (ftruncate(fd, halfBytes) != 0) {
+        close(fd);
+        return false;
+    }
+
+    // reserve both halves, then map the memory over each of them
+    void *mapping = mmap(nullptr, 2 * halfBytes, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mapping == MAP_FAILED) {
+        close(fd);
+        return false;
+    }
+    char *first = static_cast<char *>(mapping);
+    bool mapped = mmap(first, halfBytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0)
+                    != MAP_FAILED
+            && mmap(first + halfBytes, halfBytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED,
+                    fd, 0)
+                    != MAP_FAILED;
+
+    // the mappings keep the memory alive
+    close(fd);
+
+    if (!mapped) {
+        munmap(mapping, 2 * halfBytes);
+        return false;
+    }
+
+    _mapping = mapping;
+    _samples = reinterpret_cast<T *>(mapping);
+    _storageSize = storageSize;
+    _mask = storageSize - 1;
+    return true;
+#else
+    return false;
+#endif
+}
+
+template <class T>
+size_t SampleRing<T>::getCapacity() const
+{
+    return _capacity;
+}
+
+template <class T>
+bool SampleRing<T>::isMirroredByMapping() const
+{
+    return _mapping != nullptr;
+}
+
+template <class T>
+void SampleRing<T>::write(const T *src, size_t count)
+{
+    // only the producer writes _written
+    uint64_t start = _written.load(std::memory_order_relaxed);
+    uint64_t end = start + count;
+
+    // the samples that do not fit would be overwritten by the following ones
+    if (count > _storageSize) {
+        src += count - _storageSize;
+        start = end - _storageSize;
+    }
+
+    // announce the samples about to be overwritten before touching them
+    _claimed.store(end, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    const bool mirrorByHand = (_mapping == nullptr);
+    for (uint64_t position = start; position < end; ++position) {
+        size_t index = position & _mask;
+        T sample = *src++;
+        std::atomic_ref<T>(_samples[index]).store(sample, std::memory_order_relaxed);
+        if (mirrorByHand) {
+            std::atomic_ref<T>(_samples[index + _storageSize])
+                    .store(sample, std::memory_order_relaxed);
+        }
+    }
+
+    _written.store(end, std::memory_order_release);
+}
+
+template <class T>
+typename SampleRing<T>::View SampleRing<T>::viewLast(size_t count) const
+{
+    uint64_t end = _written.load(std::memory_order_acquire);
+    size_t size = std::min<uint64_t>({ count, end, _capacity });
+    uint64_t first = end - size;
+
+    // the samples are contiguous from the first one thanks to the mirror
+    return View{ &_samples[first & _mask], size, first, end };
+}
+
+template <class T>
+bool SampleRing<T>::isIntact(const View &view) const
+{
+    // if the producer started overwriting any sample that was read, we see its claim
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return _claimed.load(std::memory_order_relaxed) <= view.first + _storageSize;
+}
+
+template <class T>
+size_t SampleRing<T>::copyLast(T *dst, size_t count, uint64_t *end) const
+{
+    while (true) {
+        View view = viewLast(count);
+        for (size_t i = 0; i < view.size; ++i) {
+            dst[i] = std::atomic_ref<T>(const_cast<T &>(view.data[i]))
+                             .load(std::memory_order_relaxed);
+        }
+
+        if (isIntact(view)) {
+            if (end != nullptr) {
+                *end = view.end;
+            }
+            return view.size;
+        }
+    }
+}
+
+template <class T>
+void SampleRing<T>::markRead(uint64_t position)
+{
+    assert(position <= _written.load(std::memory_order_acquire));
+    _read.store(position, std::memory_order_release);
+}
+
+template <class T>
+uint64_t SampleRing<T>::getWritePosition() const
+{
+    return _written.load(std::memory_order_acquire);
+}
+
+template <class T>
+uint64_t SampleRing<T>::getReadPosition() const
+{
+    return _read.load(std::memory_order_acquire);
+}
+
+template <class T>
+uint64_t SampleRing<T>::getUnread() const
+{
+    // read _read first: _written only grows, so the difference cannot wrap around
+    uint64_t read = _read.load(std::memory_order_acquire);
+    return _written.load(std::memory_order_acquire) - read;
+}
+
+template class SampleRing<float>;
+template class SampleRing<int32_t>;
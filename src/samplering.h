@@ -0,0 +1,137 @@
+#pragma once
+
+#include "qpitchannotations.h"
+
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+
+/// A wait-free single-producer, single-consumer ring of samples.
+///
+/// The producer (the audio callback) never waits: when the ring is full, the oldest samples are
+/// overwritten, like CyclicBuffer.  The consumer reads the last samples and validates them
+/// afterwards, seqlock-style: the producer announces the end of the samples it is about to write
+/// before writing them, so the consumer can tell whether any sample it read was overwritten in
+/// the meantime, and reads them again if so.  With a capacity of at least twice the longest read
+/// this practically never happens.
+///
+/// The storage is mirrored: the sample at index i is also at index i + storage size, so the last
+/// samples are always contiguous and the consumer can read them in place through a View.  On
+/// Linux the second half is a second mapping of the same memory (memfd_create() and two adjacent
+/// mmap()s); elsewhere the producer writes each sample twice.
+///
+/// The reads in place through a View are a deliberate, benign race with the producer: they are
+/// plain loads, and may see torn or newer samples.  The consumer must not use what it read before
+/// isIntact() validates it, which orders the reads before its check with an acquire fence.
+///
+/// Positions are counts of samples since the ring was created.  The indices owned by the producer
+/// and the one owned by the consumer live on separate cache lines.
+template <class T>
+class SampleRing
+{
+public: // ** TYPES ** //
+    /// The last samples of the ring, in place.
+    struct View
+    {
+        /// The samples, contiguous
+        const T *data;
+
+        /// The number of samples
+        size_t size;
+
+        /// The position of the first sample
+        uint64_t first;
+
+        /// The position just after the last sample
+        uint64_t end;
+    };
+
+public: // ** CONSTANTS ** //
+    /// Size of a cache line, to keep the indices of the two threads apart
+    static constexpr size_t CACHE_LINE_SIZE = 64;
+
+public: // ** PUBLIC METHODS ** //
+    /// Constructor.
+    ///
+    /// \param[in] capacity the minimum number of samples kept, rounded up to a power of two
+    explicit SampleRing(size_t capacity);
+    ~SampleRing();
+
+    SampleRing(const SampleRing &) = delete;
+    SampleRing &operator=(const SampleRing &) = delete;
+
+    /// Number of samples kept.
+    size_t getCapacity() const;
+
+    /// Whether the storage is mirrored by the memory mapping rather than by the producer.
+    bool isMirroredByMapping() const;
+
+    // ** PRODUCER ** //
+
+    /// Append count samples from src, overwriting the oldest ones.  Wait-free.
+    void write(const T *src, size_t count);
+
+    // ** CONSUMER ** //
+
+    /// View the last count samples, or fewer if fewer were written or kept.
+    ///
+    /// The samples may be overwritten while they are read: check isIntact() once they are, and
+    /// only then use them.
+    View viewLast(size_t count) const;
+
+    /// Whether none of the samples of the view were overwritten so far.  Call after reading
+    /// them: an acquire fence orders the reads before the check.
+    bool isIntact(const View &view) const;
+
+    /// Copy the last count samples to dst, or fewer if fewer were written or kept.
+    ///
+    /// \param[out] end if not null, the position just after the last copied sample
+    /// \return the actual number of samples copied
+    size_t copyLast(T *dst, size_t count, uint64_t *end = nullptr) const;
+
+    /// Mark the samples before position as read.
+    void markRead(uint64_t position);
+
+    // ** BOTH THREADS ** //
+
+    /// Position just after the last sample written.
+    uint64_t getWritePosition() const;
+
+    /// Position just after the last sample marked read.
+    uint64_t getReadPosition() const;
+
+    /// Number of samples written since the last markRead().
+    uint64_t getUnread() const;
+
+private:
+    /// Map the storage twice in a row.  Return false if the platform cannot.
+    bool mapMirroredStorage();
+
+    /// The samples, twice in a row.  The producer writes them through std::atomic_ref.
+    T *_samples QPITCH_BENIGN_RACE("read in place through a View, validated by isIntact()");
+
+    /// The memory mapping of _samples, or nullptr if they are on the heap
+    void *_mapping;
+
+    /// _samples when they are on the heap
+    std::unique_ptr<T[]> _heapSamples;
+
+    /// The number of samples kept
+    size_t _capacity;
+
+    /// The number of samples in each half of _samples: _capacity, or a page if it is larger
+    size_t _storageSize;
+
+    /// _storageSize - 1
+    size_t _mask;
+
+    /// End of the samples being written (producer)
+    alignas(CACHE_LINE_SIZE) std::atomic<uint64_t> _claimed;
+
+    /// End of the samples written (producer)
+    std::atomic<uint64_t> _written;
+
+    /// End of the samples read (consumer)
+    alignas(CACHE_LINE_SIZE) std::atomic<uint64_t> _read;
+};
@@ -0,0 +1,306 @@
+#include "signalgenerator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+
+// ** PARAMETERS ** //
+
+namespace {
+
+/// Split a string at each separator.
+std::vector<std::string> split(const std::string &text, char separator)
+{
+    std::vector<std::string> parts;
+    std::stringstream stream(text);
+    std::string part;
+    while (std::getline(stream, part, separator)) {
+        parts.push_back(part);
+    }
+    return parts;
+}
+
+/// Parse a number, or throw std::invalid_argument.
+double parseNumber(const std::string &text)
+{
+    size_t end = 0;
+    double value = std::stod(text, &end);
+    if (end != text.size()) {
+        throw std::invalid_argument(text);
+    }
+    return value;
+}
+
+} // namespace
+
+std::optional<SignalParameters> SignalParameters::parse(const std::string &spec,
+                                                        std::string *error)
+{
+    SignalParameters parameters;
+    if (spec.empty()) {
+        return parameters;
+    }
+
+    for (const std::string &item : split(spec, ',')) {
+        size_t equals = item.find('=');
+        std::string key = item.substr(0, equals);
+        std::string value = (equals == std::string::npos) ? "" : item.substr(equals + 1);
+        std::vector<std::string> values = split(value, ':');
+
+        try {
+            if (key == "freq") {
+                parameters.frequency = parseNumber(value);
+            } else if (key == "amp") {
+                parameters.amplitude = parseNumber(value);
+            } else if (key == "harmonics") {
+                parameters.numHarmonics = (int)parseNumber(value);
+            } else if (key == "rolloff") {
+                parameters.harmonicRolloff = parseNumber(value);
+            } else if (key == "inharmonicity") {
+                parameters.inharmonicity = parseNumber(value);
+            } else if (key == "sweep" && values.size() == 2) {
+                parameters.sweepFrequency = parseNumber(values[0]);
+                parameters.sweepDuration = parseNumber(values[1]);
+            } else if (key == "vibrato" && values.size() == 2) {
+                parameters.vibratoRate = parseNumber(values[0]);
+                parameters.vibratoDepth = parseNumber(values[1]);
+            } else if (key == "decay") {
+                parameters.decayTime = parseNumber(value);
+            } else if (key == "pluck") {
+                parameters.pluckInterval = parseNumber(value);
+            } else if (key == "noise" && (values.size() == 1 || values.size() == 2)) {
+                if (values[0] == "white") {
+                    parameters.noise = NoiseKind::White;
+                } else if (values[0] == "pink") {
+                    parameters.noise = NoiseKind::Pink;
+                } else {
+                    throw std::invalid_argument(values[0]);
+                }
+                parameters.snr = (values.size() == 2) ? parseNumber(values[1]) : 0.0;
+            } else if (key == "seed") {
+                parameters.seed = std::stoull(value);
+            } else {
+                throw std::invalid_argument(key);
+            }
+        } catch (const std::logic_error &) {
+            // std::invalid_argument and std::out_of_range
+            if (error != nullptr) {
+                *error = "invalid signal parameter: " + item;
+            }
+            return std::nullopt;
+        }
+    }
+
+    if (parameters.frequency <= 0.0 || parameters.numHarmonics < 1
+        || parameters.numHarmonics > SignalGenerator::MAX_HARMONICS
+        || parameters.inharmonicity < 0.0 || parameters.sweepFrequency < 0.0
+        || (parameters.sweepFrequency > 0.0 && parameters.sweepDuration <= 0.0)
+        || parameters.decayTime < 0.0 || parameters.pluckInterval < 0.0) {
+        if (error != nullptr) {
+            *error = "signal parameters out of range: " + spec;
+        }
+        return std::nullopt;
+    }
+    return parameters;
+}
+
+// ** PINK NOISE FILTER ** //
+
+// Paul Kellet's refined filter: six one-pole filters of the white noise, plus the white noise
+// and its previous sample.  Within 0.05 dB of 1/f above 9 Hz at 44.1 kHz.
+static const double PINK_POLES[6] = { 0.99886, 0.99332, 0.96900, 0.86650, 0.55000, -0.7616 };
+static const double PINK_GAINS[6] = { 0.0555179, 0.0750759, 0.1538520,
+                                      0.3104856, 0.5329522, -0.0168980 };
+static const double PINK_DIRECT_GAIN = 0.5362;
+static const double PINK_DELAYED_GAIN = 0.115926;
+
+/// Variance of the stationary output of the pink noise filter fed with unit white noise.
+static double pinkVariance()
+{
+    double variance = PINK_DIRECT_GAIN * PINK_DIRECT_GAIN + PINK_DELAYED_GAIN * PINK_DELAYED_GAIN;
+    for (int i = 0; i < 6; ++i) {
+        for (int j = 0; j < 6; ++j) {
+            variance += PINK_GAINS[i] * PINK_GAINS[j] / (1.0 - PINK_POLES[i] * PINK_POLES[j]);
+        }
+        // the one-pole filters are correlated with the current and the previous white sample
+        variance += 2.0 * PINK_GAINS[i] * (PINK_DIRECT_GAIN + PINK_POLES[i] * PINK_DELAYED_GAIN);
+    }
+    return variance;
+}
+
+// ** GENERATOR ** //
+
+SignalGenerator::SignalGenerator(const SignalParameters &parameters, uint32_t sampleFrequency)
+    : _parameters(parameters),
+      _sampleFrequency(sampleFrequency),
+      _numHarmonics(std::clamp(parameters.numHarmonics, 1, MAX_HARMONICS)),
+      _partialRatio{},
+      _partialAmplitude{},
+      _noiseLevel(0.0),
+      _pinkNormalization(1.0 / sqrt(pinkVariance()))
+{
+    double signalPower = 0.0;
+    for (int k = 0; k < _numHarmonics; ++k) {
+        double harmonic = k + 1;
+        _partialRatio[k] = harmonic * sqrt(1.0 + _parameters.inharmonicity * harmonic * harmonic);
+        _partialAmplitude[k] =
+                _parameters.amplitude / pow(harmonic, _parameters.harmonicRolloff);
+        if (_parameters.frequency * _partialRatio[k] < 0.5 * _sampleFrequency) {
+            signalPower += 0.5 * _partialAmplitude[k] * _partialAmplitude[k];
+        }
+    }
+
+    if (_parameters.noise != NoiseKind::None && std::isfinite(_parameters.snr)) {
+        _noiseLevel = sqrt(signalPower / pow(10.0, _parameters.snr / 10.0));
+    }
+
+    reset();
+}
+
+void SignalGenerator::reset()
+{
+    _position = 0;
+    _partialPhase.fill(0.0);
+    _pinkState.fill(0.0);
+    _hasSpareGaussian = false;
+    _spareGaussian = 0.0;
+
+    // seed xoshiro256** with splitmix64, as its authors recommend
+    uint64_t seed = _parameters.seed;
+    for (uint64_t &state : _randomState) {
+        seed += 0x9E3779B97F4A7C15ull;
+        uint64_t z = seed;
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        state = z ^ (z >> 31);
+    }
+}
+
+uint64_t SignalGenerator::getPosition() const
+{
+    return _position;
+}
+
+double SignalGenerator::getFrequencyAt(uint64_t position) const
+{
+    double t = (double)position / _sampleFrequency;
+
+    double frequency = _parameters.frequency;
+    if (_parameters.sweepFrequency > 0.0) {
+        double progress = std::min(t / _parameters.sweepDuration, 1.0);
+        frequency *= pow(_parameters.sweepFrequency / _parameters.frequency, progress);
+    }
+    if (_parameters.vibratoRate > 0.0) {
+        frequency *= pow(2.0,
+                         _parameters.vibratoDepth * sin(2 * M_PI * _parameters.vibratoRate * t)
+                                 / 1200.0);
+    }
+
+    return frequency * _partialRatio[0];
+}
+
+double SignalGenerator::getNoiseLevel() const
+{
+    return _noiseLevel;
+}
+
+const SignalParameters &SignalGenerator::getParameters() const
+{
+    return _parameters;
+}
+
+uint32_t SignalGenerator::getSampleFrequency() const
+{
+    return _sampleFrequency;
+}
+
+void SignalGenerator::generate(float *dst, size_t count)
+{
+    const double nyquist = 0.5 * _sampleFrequency;
+    const double fundamentalRatio = _partialRatio[0];
+
+    for (size_t i = 0; i < count; ++i, ++_position) {
+        // the frequency of the fundamental as if it were harmonic
+        double frequency = getFrequencyAt(_position) / fundamentalRatio;
+
+        // partial k decays k times as fast as the fundamental
+        double decay = 1.0;
+        if (_parameters.decayTime > 0.0) {
+            double t = (double)_position / _sampleFrequency;
+            if (_parameters.pluckInterval > 0.0) {
+                t = fmod(t, _parameters.pluckInterval);
+            }
+            decay = exp(-t / _parameters.decayTime);
+        }
+
+        double sample = 0.0;
+        double envelope = decay;
+        for (int k = 0; k < _numHarmonics; ++k) {
+            double partialFrequency = frequency * _partialRatio[k];
+            // partials above the Nyquist frequency would alias; they keep their phase running
+            // in case a sweep brings them back
+            if (partialFrequency < nyquist) {
+                sample += _partialAmplitude[k] * envelope * sin(2 * M_PI * _partialPhase[k]);
+            }
+            _partialPhase[k] += partialFrequency / _sampleFrequency;
+            _partialPhase[k] -= floor(_partialPhase[k]);
+            envelope *= decay;
+        }
+
+        if (_noiseLevel > 0.0) {
+            sample += _noiseLevel * nextNoise();
+        }
+
+        dst[i] = (float)sample;
+    }
+}
+
+uint64_t SignalGenerator::nextRandom()
+{
+    auto rotl = [](uint64_t x, int k) { return (x << k) | (x >> (64 - k)); };
+
+    std::array<uint64_t, 4> &s = _randomState;
+    uint64_t result = rotl(s[1] * 5, 7) * 9;
+    uint64_t t = s[1] << 17;
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = rotl(s[3], 45);
+    return result;
+}
+
+double SignalGenerator::nextGaussian()
+{
+    if (_hasSpareGaussian) {
+        _hasSpareGaussian = false;
+        return _spareGaussian;
+    }
+
+    // uniform numbers in (0, 1], so that the logarithm is finite
+    double u1 = ((nextRandom() >> 11) + 1) * 0x1.0p-53;
+    double u2 = (nextRandom() >> 11) * 0x1.0p-53;
+    double radius = sqrt(-2.0 * log(u1));
+    _spareGaussian = radius * sin(2 * M_PI * u2);
+    _hasSpareGaussian = true;
+    return radius * cos(2 * M_PI * u2);
+}
+
+double SignalGenerator::nextNoise()
+{
+    double white = nextGaussian();
+    if (_parameters.noise != NoiseKind::Pink) {
+        return white;
+    }
+
+    double pink = _pinkState[6] + PINK_DIRECT_GAIN * white;
+    for (int i = 0; i < 6; ++i) {
+        _pinkState[i] = PINK_POLES[i] * _pinkState[i] + PINK_GAINS[i] * white;
+        pink += _pinkState[i];
+    }
+    _pinkState[6] = PINK_DELAYED_GAIN * white;
+    return pink * _pinkNormalization;
+}
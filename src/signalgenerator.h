@@ -0,0 +1,146 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <cstdlib>
+#include <limits>
+#include <optional>
+#include <string>
+
+/// Noise added by SignalGenerator.
+enum class NoiseKind {
+    None = 0,
+    /// Gaussian white noise
+    White,
+    /// Gaussian noise with a 1/f power spectrum
+    Pink,
+};
+
+/// What SignalGenerator synthesizes.  The defaults are a pure 440 Hz sine.
+struct SignalParameters
+{
+    /// Frequency of the fundamental at the start, in Hz
+    double frequency = 440.0;
+
+    /// Peak amplitude of the fundamental
+    double amplitude = 0.5;
+
+    /// Number of partials, the fundamental included (1 for a sine)
+    int numHarmonics = 1;
+
+    /// The amplitude of partial k is amplitude / k^harmonicRolloff
+    double harmonicRolloff = 1.0;
+
+    /// Inharmonicity coefficient B of a stiff string: partial k is at k f sqrt(1 + B k^2)
+    double inharmonicity = 0.0;
+
+    /// Frequency at the end of the sweep, or 0 for no sweep.  The sweep is exponential (at a
+    /// constant rate in cents per second) and the frequency stays there afterwards.
+    double sweepFrequency = 0.0;
+
+    /// Duration of the sweep, in seconds
+    double sweepDuration = 0.0;
+
+    /// Vibrato rate, in Hz
+    double vibratoRate = 0.0;
+
+    /// Vibrato depth (peak deviation), in cents
+    double vibratoDepth = 0.0;
+
+    /// Time constant of the decay of the fundamental of a plucked string, in seconds, or 0 for a
+    /// sustained tone.  Partial k decays k times as fast.
+    double decayTime = 0.0;
+
+    /// Seconds between two plucks, or 0 to pluck only once
+    double pluckInterval = 0.0;
+
+    NoiseKind noise = NoiseKind::None;
+
+    /// Signal-to-noise ratio, in dB, relative to the power of the undecayed partials
+    double snr = std::numeric_limits<double>::infinity();
+
+    /// Seed of the noise
+    uint64_t seed = 1;
+
+    /// Parse a comma-separated list of key=value pairs, for the command line: freq, amp,
+    /// harmonics, rolloff, inharmonicity, sweep=<end Hz>:<seconds>, vibrato=<Hz>:<cents>,
+    /// decay=<seconds>, pluck=<seconds>, noise=<white|pink>:<snr dB> and seed.  The keys that are
+    /// not given keep their default value.
+    ///
+    /// \param[out] error why the spec was rejected
+    static std::optional<SignalParameters> parse(const std::string &spec, std::string *error);
+};
+
+/// Deterministic synthetic signals with a known pitch, for tests, benchmarks and load tests.
+///
+/// The samples only depend on the parameters, the sample rate and the seed: the same signal is
+/// generated whatever the block sizes, on every platform (the noise uses its own generator rather
+/// than the unspecified distributions of <random>).  generate() does not allocate.
+class SignalGenerator
+{
+public:
+    /// Maximum number of partials
+    static constexpr int MAX_HARMONICS = 64;
+
+public:
+    SignalGenerator(const SignalParameters &parameters, uint32_t sampleFrequency);
+
+    /// Generate the next count samples.
+    void generate(float *dst, size_t count);
+
+    /// Start over from the first sample.
+    void reset();
+
+    /// Number of samples generated since the start.
+    uint64_t getPosition() const;
+
+    /// The ground truth: the frequency of the fundamental partial at a sample position, in Hz.
+    /// Partials above the Nyquist frequency are not generated, but the fundamental always is.
+    double getFrequencyAt(uint64_t position) const;
+
+    /// Standard deviation of the noise.
+    double getNoiseLevel() const;
+
+    const SignalParameters &getParameters() const;
+    uint32_t getSampleFrequency() const;
+
+private:
+    /// Uniform 64-bit integers (xoshiro256**).
+    uint64_t nextRandom();
+
+    /// A standard normal number (Box-Muller, caching the second one).
+    double nextGaussian();
+
+    /// The next noise sample, before scaling.
+    double nextNoise();
+
+    SignalParameters _parameters;
+    uint32_t _sampleFrequency;
+
+    /// Number of partials below the Nyquist frequency at the start
+    int _numHarmonics;
+
+    /// Ratio of the frequency of each partial to the one of the fundamental (inharmonicity)
+    std::array<double, MAX_HARMONICS> _partialRatio;
+
+    /// Amplitude of each partial
+    std::array<double, MAX_HARMONICS> _partialAmplitude;
+
+    /// Phase of each partial, in turns, in [0, 1)
+    std::array<double, MAX_HARMONICS> _partialPhase;
+
+    /// Standard deviation of the noise
+    double _noiseLevel;
+
+    /// 1 / standard deviation of the unscaled pink noise
+    double _pinkNormalization;
+
+    uint64_t _position;
+
+    std::array<uint64_t, 4> _randomState;
+    bool _hasSpareGaussian;
+    double _spareGaussian;
+
+    /// State of the pink noise filter
+    std::array<double, 7> _pinkState;
+};
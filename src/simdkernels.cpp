@@ -0,0 +1,194 @@
+#include "simdkernels.h"
+#include "simdkernels_impl.h"
+
+#if defined(QPITCH_SIMD_X86) && defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+
+const char *simdLevelName(SimdLevel level)
+{
+    switch (level) {
+    case SimdLevel::Scalar:
+        return "scalar";
+    case SimdLevel::Sse2:
+        return "SSE2";
+    case SimdLevel::Avx2:
+        return "AVX2";
+    case SimdLevel::Avx512:
+        return "AVX-512";
+    case SimdLevel::Neon:
+        return "NEON";
+    }
+    return "unknown";
+}
+
+// ** SCALAR KERNELS ** //
+
+template <class Real>
+static void scalarWindowSamples(const float *samples, const Real *window, Real *out, size_t n)
+{
+    for (size_t i = 0; i < n; i++) {
+        out[i] = samples[i] * window[i];
+    }
+}
+
+template <class Real>
+static void scalarPowerSpectrum(const Real *spectrum, Real *power, size_t n)
+{
+    for (size_t k = 0; k < n; ++k) {
+        power[2 * k] = (spectrum[2 * k] * spectrum[2 * k])
+                + (spectrum[2 * k + 1] * spectrum[2 * k + 1]);
+        power[2 * k + 1] = 0.0;
+    }
+}
+
+template <class Real>
+static size_t scalarFindDescentEnd(const Real *r, size_t begin, size_t end)
+{
+    size_t l;
+    for (l = begin; (l < end) && ((r[l + 1] < r[l]) || (r[l + 1] > 0.0)); ++l) { };
+    return l;
+}
+
+template <class Real>
+static size_t scalarFindMaximum(const Real *r, size_t begin, size_t end)
+{
+    double maximum = 0.0;
+    size_t index = 0;
+    for (size_t l = begin; l < end; ++l) {
+        if (r[l] > maximum) {
+            maximum = r[l];
+            index = l;
+        }
+    }
+    return index;
+}
+
+template <class Real>
+static size_t scalarFindLocalMaximum(const Real *r, size_t begin, size_t end)
+{
+    size_t l;
+    for (l = begin; l < end; ++l) {
+        if (r[l] > 0.0 && r[l] >= r[l - 1] && r[l] > r[l + 1]) {
+            break;
+        }
+    }
+    return l;
+}
+
+template <class Real>
+static void scalarFindMinMax(const Real *r, size_t n, Real *minimum, Real *maximum)
+{
+    Real lo = r[0];
+    Real hi = r[0];
+    for (size_t i = 1; i < n; ++i) {
+        lo = r[i] < lo ? r[i] : lo;
+        hi = r[i] > hi ? r[i] : hi;
+    }
+    *minimum = lo;
+    *maximum = hi;
+}
+
+template <class Real>
+static const SimdKernels<Real> scalarKernels = {
+    SimdLevel::Scalar,          &scalarWindowSamples<Real>, &scalarPowerSpectrum<Real>,
+    &scalarFindDescentEnd<Real>, &scalarFindMaximum<Real>,   &scalarFindLocalMaximum<Real>,
+    &scalarFindMinMax<Real>,
+};
+
+// ** DISPATCH ** //
+
+/// Whether the processor (and the operating system, for the wider registers) supports an
+/// instruction set.
+static bool isSupported(SimdLevel level)
+{
+    switch (level) {
+    case SimdLevel::Scalar:
+        return true;
+
+#if defined(QPITCH_SIMD_X86) && defined(_MSC_VER) && !defined(__clang__)
+    case SimdLevel::Sse2:
+        // part of x86-64, and of every x86 processor Windows still runs on
+        return true;
+    case SimdLevel::Avx2:
+    case SimdLevel::Avx512: {
+        int info[4];
+        __cpuid(info, 0);
+        const int maxLeaf = info[0];
+        __cpuid(info, 1);
+        const bool osxsave = (info[2] & (1 << 27)) != 0;
+        const bool avx = (info[2] & (1 << 28)) != 0;
+        if (!osxsave || !avx || maxLeaf < 7) {
+            return false;
+        }
+        const unsigned long long xcr0 = _xgetbv(0);
+        __cpuidex(info, 7, 0);
+        if (level == SimdLevel::Avx2) {
+            // the YMM registers are saved by the operating system
+            return (info[1] & (1 << 5)) != 0 && (xcr0 & 0x06) == 0x06;
+        }
+        // and the ZMM registers and the opmasks
+        return (info[1] & (1 << 16)) != 0 && (xcr0 & 0xe6) == 0xe6;
+    }
+#elif defined(QPITCH_SIMD_X86)
+    case SimdLevel::Sse2:
+        return __builtin_cpu_supports("sse2");
+    case SimdLevel::Avx2:
+        return __builtin_cpu_supports("avx2");
+    case SimdLevel::Avx512:
+        return __builtin_cpu_supports("avx512f");
+#elif defined(QPITCH_SIMD_NEON)
+    case SimdLevel::Neon:
+        // part of AArch64
+        return true;
+#endif
+
+    default:
+        return false;
+    }
+}
+
+template <class Real>
+const SimdKernels<Real> *SimdKernels<Real>::forLevel(SimdLevel level)
+{
+    if (!isSupported(level)) {
+        return nullptr;
+    }
+
+    switch (level) {
+    case SimdLevel::Scalar:
+        return &scalarKernels<Real>;
+#if defined(QPITCH_SIMD_X86)
+    case SimdLevel::Sse2:
+        return sse2Kernels<Real>();
+    case SimdLevel::Avx2:
+        return avx2Kernels<Real>();
+    case SimdLevel::Avx512:
+        return avx512Kernels<Real>();
+#elif defined(QPITCH_SIMD_NEON)
+    case SimdLevel::Neon:
+        return neonKernels<Real>();
+#endif
+    default:
+        return nullptr;
+    }
+}
+
+template <class Real>
+const SimdKernels<Real> &SimdKernels<Real>::best()
+{
+    static const SimdKernels<Real> *kernels = []() {
+        static const SimdLevel fastestFirst[] = { SimdLevel::Avx512, SimdLevel::Avx2,
+                                                  SimdLevel::Sse2, SimdLevel::Neon };
+        for (SimdLevel level : fastestFirst) {
+            if (const SimdKernels<Real> *candidate = forLevel(level)) {
+                return candidate;
+            }
+        }
+        return &scalarKernels<Real>;
+    }();
+    return *kernels;
+}
+
+template struct SimdKernels<double>;
+template struct SimdKernels<float>;
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstddef>
+
+/// Instruction sets that the kernels of the autocorrelation are built for.
+enum class SimdLevel {
+    Scalar,
+    Sse2,
+    Avx2,
+    Avx512,
+    Neon,
+};
+
+/// Name of an instruction set, for logs and benchmarks.
+const char *simdLevelName(SimdLevel level);
+
+/// The inner loops of the autocorrelation detectors and of the plots, vectorized for an
+/// instruction set.
+///
+/// Every kernel gives exactly the result of the plain loop it replaces, whatever the instruction
+/// set: the vectors only find the block of samples where the answer is, and the comparisons and
+/// the arithmetic are the same operations in the same order.  The kernels are picked at run time
+/// from the features of the processor, so the binary runs on any processor of the architecture.
+template <class Real>
+struct SimdKernels
+{
+    /// The instruction set of the kernels
+    SimdLevel level;
+
+    /// out[i] = samples[i] * window[i] for i in [0, n).
+    void (*windowSamples)(const float *samples, const Real *window, Real *out, size_t n);
+
+    /// |X[k]|^2 of n complex numbers interleaved like fftw_complex, with a zero imaginary part.
+    void (*powerSpectrum)(const Real *spectrum, Real *power, size_t n);
+
+    /// The first lag l in [begin, end) where the autocorrelation stops falling from its peak at
+    /// the zero lag (r[l + 1] >= r[l] and r[l + 1] <= 0), or end.  Reads r[end].
+    size_t (*findDescentEnd)(const Real *r, size_t begin, size_t end);
+
+    /// The first lag of the maximum of r in [begin, end), or 0 if no sample is positive.
+    size_t (*findMaximum)(const Real *r, size_t begin, size_t end);
+
+    /// The first lag l in [begin, end) where r has a positive local maximum (r[l] > 0,
+    /// r[l] >= r[l - 1] and r[l] > r[l + 1]), or end.  begin must be at least 1; reads r[end].
+    size_t (*findLocalMaximum)(const Real *r, size_t begin, size_t end);
+
+    /// The minimum and the maximum of r in [0, n).  n must be at least 1, and r must not hold
+    /// any NaN.  A zero may come back with the other sign.
+    void (*findMinMax)(const Real *r, size_t n, Real *minimum, Real *maximum);
+
+    /// The kernels of the best instruction set of the processor, detected by the first call.
+    static const SimdKernels<Real> &best();
+
+    /// The kernels of an instruction set.
+    ///
+    /// \return the kernels, or nullptr if they are not built for this architecture or the
+    ///         processor does not support the instruction set
+    static const SimdKernels<Real> *forLevel(SimdLevel level);
+};
@@ -0,0 +1,88 @@
+#include "simdkernels_impl.h"
+
+#include <immintrin.h>
+
+namespace {
+
+struct Avx2Double
+{
+    using Real = double;
+    using Vec = __m256d;
+    using Mask = __m256d;
+    static constexpr size_t width = 4;
+
+    static Vec load(const double *p) { return _mm256_loadu_pd(p); }
+    static Vec loadFloats(const float *p) { return _mm256_cvtps_pd(_mm_loadu_ps(p)); }
+    static void store(double *p, Vec v) { _mm256_storeu_pd(p, v); }
+    static Vec set1(double x) { return _mm256_set1_pd(x); }
+    static Vec mul(Vec a, Vec b) { return _mm256_mul_pd(a, b); }
+    static Vec max(Vec a, Vec acc) { return _mm256_max_pd(a, acc); }
+    static Vec min(Vec a, Vec acc) { return _mm256_min_pd(a, acc); }
+    static Vec power(Vec v)
+    {
+        Vec squares = _mm256_mul_pd(v, v);
+        Vec sum = _mm256_add_pd(squares, _mm256_permute_pd(squares, 0x5));
+        return _mm256_blend_pd(sum, _mm256_setzero_pd(), 0xa);
+    }
+    static Mask lt(Vec a, Vec b) { return _mm256_cmp_pd(a, b, _CMP_LT_OQ); }
+    static Mask gt(Vec a, Vec b) { return _mm256_cmp_pd(a, b, _CMP_GT_OQ); }
+    static Mask ge(Vec a, Vec b) { return _mm256_cmp_pd(a, b, _CMP_GE_OQ); }
+    static Mask eq(Vec a, Vec b) { return _mm256_cmp_pd(a, b, _CMP_EQ_OQ); }
+    static Mask andMask(Mask a, Mask b) { return _mm256_and_pd(a, b); }
+    static Mask orMask(Mask a, Mask b) { return _mm256_or_pd(a, b); }
+    static Mask notMask(Mask m)
+    {
+        return _mm256_xor_pd(m, _mm256_castsi256_pd(_mm256_set1_epi32(-1)));
+    }
+    static bool any(Mask m) { return _mm256_movemask_pd(m) != 0; }
+};
+
+struct Avx2Float
+{
+    using Real = float;
+    using Vec = __m256;
+    using Mask = __m256;
+    static constexpr size_t width = 8;
+
+    static Vec load(const float *p) { return _mm256_loadu_ps(p); }
+    static Vec loadFloats(const float *p) { return _mm256_loadu_ps(p); }
+    static void store(float *p, Vec v) { _mm256_storeu_ps(p, v); }
+    static Vec set1(float x) { return _mm256_set1_ps(x); }
+    static Vec mul(Vec a, Vec b) { return _mm256_mul_ps(a, b); }
+    static Vec max(Vec a, Vec acc) { return _mm256_max_ps(a, acc); }
+    static Vec min(Vec a, Vec acc) { return _mm256_min_ps(a, acc); }
+    static Vec power(Vec v)
+    {
+        Vec squares = _mm256_mul_ps(v, v);
+        Vec sum = _mm256_add_ps(squares, _mm256_permute_ps(squares, _MM_SHUFFLE(2, 3, 0, 1)));
+        return _mm256_blend_ps(sum, _mm256_setzero_ps(), 0xaa);
+    }
+    static Mask lt(Vec a, Vec b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+    static Mask gt(Vec a, Vec b) { return _mm256_cmp_ps(a, b, _CMP_GT_OQ); }
+    static Mask ge(Vec a, Vec b) { return _mm256_cmp_ps(a, b, _CMP_GE_OQ); }
+    static Mask eq(Vec a, Vec b) { return _mm256_cmp_ps(a, b, _CMP_EQ_OQ); }
+    static Mask andMask(Mask a, Mask b) { return _mm256_and_ps(a, b); }
+    static Mask orMask(Mask a, Mask b) { return _mm256_or_ps(a, b); }
+    static Mask notMask(Mask m)
+    {
+        return _mm256_xor_ps(m, _mm256_castsi256_ps(_mm256_set1_epi32(-1)));
+    }
+    static bool any(Mask m) { return _mm256_movemask_ps(m) != 0; }
+};
+
+} // namespace
+
+template <>
+const SimdKernels<double> *avx2Kernels<double>()
+{
+    static const SimdKernels<double> kernels =
+            SimdKernelsImpl<Avx2Double>::table(SimdLevel::Avx2);
+    return &kernels;
+}
+
+template <>
+const SimdKernels<float> *avx2Kernels<float>()
+{
+    static const SimdKernels<float> kernels = SimdKernelsImpl<Avx2Float>::table(SimdLevel::Avx2);
+    return &kernels;
+}
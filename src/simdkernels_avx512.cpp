@@ -0,0 +1,83 @@
+#include "simdkernels_impl.h"
+
+#include <immintrin.h>
+
+namespace {
+
+struct Avx512Double
+{
+    using Real = double;
+    using Vec = __m512d;
+    using Mask = __mmask8;
+    static constexpr size_t width = 8;
+
+    static Vec load(const double *p) { return _mm512_loadu_pd(p); }
+    static Vec loadFloats(const float *p) { return _mm512_cvtps_pd(_mm256_loadu_ps(p)); }
+    static void store(double *p, Vec v) { _mm512_storeu_pd(p, v); }
+    static Vec set1(double x) { return _mm512_set1_pd(x); }
+    static Vec mul(Vec a, Vec b) { return _mm512_mul_pd(a, b); }
+    static Vec max(Vec a, Vec acc) { return _mm512_max_pd(a, acc); }
+    static Vec min(Vec a, Vec acc) { return _mm512_min_pd(a, acc); }
+    static Vec power(Vec v)
+    {
+        Vec squares = _mm512_mul_pd(v, v);
+        Vec sum = _mm512_add_pd(squares, _mm512_permute_pd(squares, 0x55));
+        return _mm512_maskz_mov_pd(0x55, sum);
+    }
+    static Mask lt(Vec a, Vec b) { return _mm512_cmp_pd_mask(a, b, _CMP_LT_OQ); }
+    static Mask gt(Vec a, Vec b) { return _mm512_cmp_pd_mask(a, b, _CMP_GT_OQ); }
+    static Mask ge(Vec a, Vec b) { return _mm512_cmp_pd_mask(a, b, _CMP_GE_OQ); }
+    static Mask eq(Vec a, Vec b) { return _mm512_cmp_pd_mask(a, b, _CMP_EQ_OQ); }
+    static Mask andMask(Mask a, Mask b) { return a & b; }
+    static Mask orMask(Mask a, Mask b) { return a | b; }
+    static Mask notMask(Mask m) { return (Mask)~m; }
+    static bool any(Mask m) { return m != 0; }
+};
+
+struct Avx512Float
+{
+    using Real = float;
+    using Vec = __m512;
+    using Mask = __mmask16;
+    static constexpr size_t width = 16;
+
+    static Vec load(const float *p) { return _mm512_loadu_ps(p); }
+    static Vec loadFloats(const float *p) { return _mm512_loadu_ps(p); }
+    static void store(float *p, Vec v) { _mm512_storeu_ps(p, v); }
+    static Vec set1(float x) { return _mm512_set1_ps(x); }
+    static Vec mul(Vec a, Vec b) { return _mm512_mul_ps(a, b); }
+    static Vec max(Vec a, Vec acc) { return _mm512_max_ps(a, acc); }
+    static Vec min(Vec a, Vec acc) { return _mm512_min_ps(a, acc); }
+    static Vec power(Vec v)
+    {
+        Vec squares = _mm512_mul_ps(v, v);
+        Vec sum = _mm512_add_ps(squares, _mm512_permute_ps(squares, _MM_SHUFFLE(2, 3, 0, 1)));
+        return _mm512_maskz_mov_ps(0x5555, sum);
+    }
+    static Mask lt(Vec a, Vec b) { return _mm512_cmp_ps_mask(a, b, _CMP_LT_OQ); }
+    static Mask gt(Vec a, Vec b) { return _mm512_cmp_ps_mask(a, b, _CMP_GT_OQ); }
+    static Mask ge(Vec a, Vec b) { return _mm512_cmp_ps_mask(a, b, _CMP_GE_OQ); }
+    static Mask eq(Vec a, Vec b) { return _mm512_cmp_ps_mask(a, b, _CMP_EQ_OQ); }
+    static Mask andMask(Mask a, Mask b) { return a & b; }
+    static Mask orMask(Mask a, Mask b) { return a | b; }
+    static Mask notMask(Mask m) { return (Mask)~m; }
+    static bool any(Mask m) { return m != 0; }
+};
+
+} // namespace
+
+template <>
+const SimdKernels<double> *avx512Kernels<double>()
+{
+    static const SimdKernels<double> kernels =
+            SimdKernelsImpl<Avx512Double>::table(SimdLevel::Avx512);
+    return &kernels;
+}
+
+template <>
+const SimdKernels<float> *avx512Kernels<float>()
+{
+    static const SimdKernels<float> kernels =
+            SimdKernelsImpl<Avx512Float>::table(SimdLevel::Avx512);
+    return &kernels;
+}
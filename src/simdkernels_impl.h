@@ -0,0 +1,177 @@
+#pragma once
+
+/// The kernels of simdkernels.h written once for all the instruction sets.
+///
+/// Each simdkernels_<isa>.cpp is compiled for its instruction set and instantiates
+/// SimdKernelsImpl with the vector operations of that set (V below), in an anonymous namespace so
+/// that no function compiled for a newer instruction set can be shared with the rest of the
+/// program.  For the same reason this header includes nothing but simdkernels.h.
+///
+/// V provides:
+///
+///     using Real; using Vec; using Mask; static const size_t width;
+///     Vec load(const Real *p);                  // unaligned
+///     Vec loadFloats(const float *p);           // width floats, converted to Real
+///     void store(Real *p, Vec v);               // unaligned
+///     Vec set1(Real x);
+///     Vec mul(Vec a, Vec b);
+///     Vec max(Vec a, Vec acc);                  // acc where a is not a number
+///     Vec min(Vec a, Vec acc);                  // acc where a is not a number
+///     Vec power(Vec v);                         // |.|^2 of width / 2 interleaved complex numbers
+///     Mask lt(Vec a, Vec b), gt(...), ge(...), eq(...);     // false where not a number
+///     Mask andMask(Mask a, Mask b), orMask(Mask a, Mask b), notMask(Mask m);
+///     bool any(Mask m);
+
+#include "simdkernels.h"
+
+template <class V>
+struct SimdKernelsImpl
+{
+    using Real = typename V::Real;
+    using Vec = typename V::Vec;
+    using Mask = typename V::Mask;
+    static constexpr size_t W = V::width;
+
+    static void windowSamples(const float *samples, const Real *window, Real *out, size_t n)
+    {
+        size_t i = 0;
+        for (; i + W <= n; i += W) {
+            V::store(out + i, V::mul(V::loadFloats(samples + i), V::load(window + i)));
+        }
+        for (; i < n; ++i) {
+            out[i] = samples[i] * window[i];
+        }
+    }
+
+    static void powerSpectrum(const Real *spectrum, Real *power, size_t n)
+    {
+        size_t k = 0;
+        for (; k + W / 2 <= n; k += W / 2) {
+            V::store(power + 2 * k, V::power(V::load(spectrum + 2 * k)));
+        }
+        for (; k < n; ++k) {
+            power[2 * k] = (spectrum[2 * k] * spectrum[2 * k])
+                    + (spectrum[2 * k + 1] * spectrum[2 * k + 1]);
+            power[2 * k + 1] = 0.0;
+        }
+    }
+
+    static size_t findDescentEnd(const Real *r, size_t begin, size_t end)
+    {
+        const Vec zero = V::set1(0.0);
+        size_t l = begin;
+        for (; l + W <= end; l += W) {
+            Vec current = V::load(r + l);
+            Vec next = V::load(r + l + 1);
+            if (V::any(V::notMask(V::orMask(V::lt(next, current), V::gt(next, zero))))) {
+                break;
+            }
+        }
+        for (; (l < end) && ((r[l + 1] < r[l]) || (r[l + 1] > 0.0)); ++l) { };
+        return l;
+    }
+
+    static size_t findMaximum(const Real *r, size_t begin, size_t end)
+    {
+        // find the maximum, then its first lag
+        Vec acc = V::set1(0.0);
+        size_t l = begin;
+        for (; l + W <= end; l += W) {
+            acc = V::max(V::load(r + l), acc);
+        }
+        Real lanes[W];
+        V::store(lanes, acc);
+        Real maximum = 0.0;
+        for (size_t i = 0; i < W; ++i) {
+            if (lanes[i] > maximum) {
+                maximum = lanes[i];
+            }
+        }
+        for (; l < end; ++l) {
+            if (r[l] > maximum) {
+                maximum = r[l];
+            }
+        }
+        if (!(maximum > 0.0)) {
+            return 0;
+        }
+
+        const Vec maximumVec = V::set1(maximum);
+        for (l = begin; l + W <= end; l += W) {
+            if (V::any(V::eq(V::load(r + l), maximumVec))) {
+                break;
+            }
+        }
+        for (; r[l] != maximum; ++l) { };
+        return l;
+    }
+
+    static size_t findLocalMaximum(const Real *r, size_t begin, size_t end)
+    {
+        const Vec zero = V::set1(0.0);
+        size_t l = begin;
+        for (; l + W <= end; l += W) {
+            Vec left = V::load(r + l - 1);
+            Vec center = V::load(r + l);
+            Vec right = V::load(r + l + 1);
+            Mask peak = V::andMask(V::andMask(V::gt(center, zero), V::ge(center, left)),
+                                   V::gt(center, right));
+            if (V::any(peak)) {
+                break;
+            }
+        }
+        for (; l < end; ++l) {
+            if (r[l] > 0.0 && r[l] >= r[l - 1] && r[l] > r[l + 1]) {
+                break;
+            }
+        }
+        return l;
+    }
+
+    static void findMinMax(const Real *r, size_t n, Real *minimum, Real *maximum)
+    {
+        Real lo = r[0];
+        Real hi = r[0];
+        size_t i = 0;
+        if (n >= W) {
+            Vec loVec = V::load(r);
+            Vec hiVec = loVec;
+            for (i = W; i + W <= n; i += W) {
+                Vec v = V::load(r + i);
+                loVec = V::min(v, loVec);
+                hiVec = V::max(v, hiVec);
+            }
+            Real loLanes[W], hiLanes[W];
+            V::store(loLanes, loVec);
+            V::store(hiLanes, hiVec);
+            for (size_t k = 0; k < W; ++k) {
+                lo = loLanes[k] < lo ? loLanes[k] : lo;
+                hi = hiLanes[k] > hi ? hiLanes[k] : hi;
+            }
+        }
+        for (; i < n; ++i) {
+            lo = r[i] < lo ? r[i] : lo;
+            hi = r[i] > hi ? r[i] : hi;
+        }
+        *minimum = lo;
+        *maximum = hi;
+    }
+
+    static SimdKernels<Real> table(SimdLevel level)
+    {
+        return SimdKernels<Real>{ level,           &windowSamples, &powerSpectrum,
+                                  &findDescentEnd, &findMaximum,   &findLocalMaximum,
+                                  &findMinMax };
+    }
+};
+
+/// The kernels of each instruction set, defined by simdkernels_<isa>.cpp for float and double.
+/// Only call them if the processor supports the instruction set.
+template <class Real>
+const SimdKernels<Real> *sse2Kernels();
+template <class Real>
+const SimdKernels<Real> *avx2Kernels();
+template <class Real>
+const SimdKernels<Real> *avx512Kernels();
+template <class Real>
+const SimdKernels<Real> *neonKernels();
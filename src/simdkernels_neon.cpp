@@ -0,0 +1,84 @@
+#include "simdkernels_impl.h"
+
+#include <arm_neon.h>
+
+namespace {
+
+struct NeonDouble
+{
+    using Real = double;
+    using Vec = float64x2_t;
+    using Mask = uint64x2_t;
+    static constexpr size_t width = 2;
+
+    static Vec load(const double *p) { return vld1q_f64(p); }
+    static Vec loadFloats(const float *p) { return vcvt_f64_f32(vld1_f32(p)); }
+    static void store(double *p, Vec v) { vst1q_f64(p, v); }
+    static Vec set1(double x) { return vdupq_n_f64(x); }
+    static Vec mul(Vec a, Vec b) { return vmulq_f64(a, b); }
+    // vmaxnm returns the number when the other operand is not one
+    static Vec max(Vec a, Vec acc) { return vmaxnmq_f64(a, acc); }
+    static Vec min(Vec a, Vec acc) { return vminnmq_f64(a, acc); }
+    static Vec power(Vec v)
+    {
+        Vec squares = vmulq_f64(v, v);
+        return vsetq_lane_f64(0.0, vpaddq_f64(squares, squares), 1);
+    }
+    static Mask lt(Vec a, Vec b) { return vcltq_f64(a, b); }
+    static Mask gt(Vec a, Vec b) { return vcgtq_f64(a, b); }
+    static Mask ge(Vec a, Vec b) { return vcgeq_f64(a, b); }
+    static Mask eq(Vec a, Vec b) { return vceqq_f64(a, b); }
+    static Mask andMask(Mask a, Mask b) { return vandq_u64(a, b); }
+    static Mask orMask(Mask a, Mask b) { return vorrq_u64(a, b); }
+    static Mask notMask(Mask m)
+    {
+        return vreinterpretq_u64_u32(vmvnq_u32(vreinterpretq_u32_u64(m)));
+    }
+    static bool any(Mask m) { return vmaxvq_u32(vreinterpretq_u32_u64(m)) != 0; }
+};
+
+struct NeonFloat
+{
+    using Real = float;
+    using Vec = float32x4_t;
+    using Mask = uint32x4_t;
+    static constexpr size_t width = 4;
+
+    static Vec load(const float *p) { return vld1q_f32(p); }
+    static Vec loadFloats(const float *p) { return vld1q_f32(p); }
+    static void store(float *p, Vec v) { vst1q_f32(p, v); }
+    static Vec set1(float x) { return vdupq_n_f32(x); }
+    static Vec mul(Vec a, Vec b) { return vmulq_f32(a, b); }
+    static Vec max(Vec a, Vec acc) { return vmaxnmq_f32(a, acc); }
+    static Vec min(Vec a, Vec acc) { return vminnmq_f32(a, acc); }
+    static Vec power(Vec v)
+    {
+        Vec squares = vmulq_f32(v, v);
+        return vzip1q_f32(vpaddq_f32(squares, squares), vdupq_n_f32(0.0f));
+    }
+    static Mask lt(Vec a, Vec b) { return vcltq_f32(a, b); }
+    static Mask gt(Vec a, Vec b) { return vcgtq_f32(a, b); }
+    static Mask ge(Vec a, Vec b) { return vcgeq_f32(a, b); }
+    static Mask eq(Vec a, Vec b) { return vceqq_f32(a, b); }
+    static Mask andMask(Mask a, Mask b) { return vandq_u32(a, b); }
+    static Mask orMask(Mask a, Mask b) { return vorrq_u32(a, b); }
+    static Mask notMask(Mask m) { return vmvnq_u32(m); }
+    static bool any(Mask m) { return vmaxvq_u32(m) != 0; }
+};
+
+} // namespace
+
+template <>
+const SimdKernels<double> *neonKernels<double>()
+{
+    static const SimdKernels<double> kernels =
+            SimdKernelsImpl<NeonDouble>::table(SimdLevel::Neon);
+    return &kernels;
+}
+
+template <>
+const SimdKernels<float> *neonKernels<float>()
+{
+    static const SimdKernels<float> kernels = SimdKernelsImpl<NeonFloat>::table(SimdLevel::Neon);
+    return &kernels;
+}
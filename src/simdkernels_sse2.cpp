@@ -0,0 +1,85 @@
+#include "simdkernels_impl.h"
+
+#include <emmintrin.h>
+
+namespace {
+
+struct Sse2Double
+{
+    using Real = double;
+    using Vec = __m128d;
+    using Mask = __m128d;
+    static constexpr size_t width = 2;
+
+    static Vec load(const double *p) { return _mm_loadu_pd(p); }
+    static Vec loadFloats(const float *p)
+    {
+        return _mm_cvtps_pd(_mm_castsi128_ps(_mm_loadl_epi64((const __m128i *)p)));
+    }
+    static void store(double *p, Vec v) { _mm_storeu_pd(p, v); }
+    static Vec set1(double x) { return _mm_set1_pd(x); }
+    static Vec mul(Vec a, Vec b) { return _mm_mul_pd(a, b); }
+    static Vec max(Vec a, Vec acc) { return _mm_max_pd(a, acc); }
+    static Vec min(Vec a, Vec acc) { return _mm_min_pd(a, acc); }
+    static Vec power(Vec v)
+    {
+        Vec squares = _mm_mul_pd(v, v);
+        Vec sum = _mm_add_pd(squares, _mm_shuffle_pd(squares, squares, 1));
+        return _mm_move_sd(_mm_setzero_pd(), sum);
+    }
+    static Mask lt(Vec a, Vec b) { return _mm_cmplt_pd(a, b); }
+    static Mask gt(Vec a, Vec b) { return _mm_cmpgt_pd(a, b); }
+    static Mask ge(Vec a, Vec b) { return _mm_cmpge_pd(a, b); }
+    static Mask eq(Vec a, Vec b) { return _mm_cmpeq_pd(a, b); }
+    static Mask andMask(Mask a, Mask b) { return _mm_and_pd(a, b); }
+    static Mask orMask(Mask a, Mask b) { return _mm_or_pd(a, b); }
+    static Mask notMask(Mask m) { return _mm_xor_pd(m, _mm_castsi128_pd(_mm_set1_epi32(-1))); }
+    static bool any(Mask m) { return _mm_movemask_pd(m) != 0; }
+};
+
+struct Sse2Float
+{
+    using Real = float;
+    using Vec = __m128;
+    using Mask = __m128;
+    static constexpr size_t width = 4;
+
+    static Vec load(const float *p) { return _mm_loadu_ps(p); }
+    static Vec loadFloats(const float *p) { return _mm_loadu_ps(p); }
+    static void store(float *p, Vec v) { _mm_storeu_ps(p, v); }
+    static Vec set1(float x) { return _mm_set1_ps(x); }
+    static Vec mul(Vec a, Vec b) { return _mm_mul_ps(a, b); }
+    static Vec max(Vec a, Vec acc) { return _mm_max_ps(a, acc); }
+    static Vec min(Vec a, Vec acc) { return _mm_min_ps(a, acc); }
+    static Vec power(Vec v)
+    {
+        Vec squares = _mm_mul_ps(v, v);
+        Vec sum = _mm_add_ps(squares, _mm_shuffle_ps(squares, squares, _MM_SHUFFLE(2, 3, 0, 1)));
+        return _mm_and_ps(sum, _mm_castsi128_ps(_mm_set_epi32(0, -1, 0, -1)));
+    }
+    static Mask lt(Vec a, Vec b) { return _mm_cmplt_ps(a, b); }
+    static Mask gt(Vec a, Vec b) { return _mm_cmpgt_ps(a, b); }
+    static Mask ge(Vec a, Vec b) { return _mm_cmpge_ps(a, b); }
+    static Mask eq(Vec a, Vec b) { return _mm_cmpeq_ps(a, b); }
+    static Mask andMask(Mask a, Mask b) { return _mm_and_ps(a, b); }
+    static Mask orMask(Mask a, Mask b) { return _mm_or_ps(a, b); }
+    static Mask notMask(Mask m) { return _mm_xor_ps(m, _mm_castsi128_ps(_mm_set1_epi32(-1))); }
+    static bool any(Mask m) { return _mm_movemask_ps(m) != 0; }
+};
+
+} // namespace
+
+template <>
+const SimdKernels<double> *sse2Kernels<double>()
+{
+    static const SimdKernels<double> kernels =
+            SimdKernelsImpl<Sse2Double>::table(SimdLevel::Sse2);
+    return &kernels;
+}
+
+template <>
+const SimdKernels<float> *sse2Kernels<float>()
+{
+    static const SimdKernels<float> kernels = SimdKernelsImpl<Sse2Float>::table(SimdLevel::Sse2);
+    return &kernels;
+}
@@ -0,0 +1,272 @@
+#include "slidingdft.h"
+
+#include <cassert>
+#include <algorithm>
+#include <cmath>
+
+template <class Real>
+const double SlidingDftDetector<Real>::MAX_FREQUENCY = 2000.0;
+template <class Real>
+const size_t SlidingDftDetector<Real>::GUARD_BINS = 2;
+template <class Real>
+const size_t SlidingDftDetector<Real>::SAMPLES_PER_PERIOD = 8;
+template <class Real>
+const size_t SlidingDftDetector<Real>::RESYNC_INTERVAL = 16;
+
+template <class Real>
+SlidingDftDetector<Real>::SlidingDftDetector(uint32_t sampleFrequency, size_t fftFrameSize)
+{
+    _sampleFrequency = sampleFrequency;
+    _fftFrameSize = fftFrameSize;
+    _numBins = std::min<size_t>(ceil(MAX_FREQUENCY * fftFrameSize / _sampleFrequency)
+                                        + GUARD_BINS + 1,
+                                fftFrameSize / 2);
+
+    // the highest kept frequency gets SAMPLES_PER_PERIOD samples per period, which is enough to
+    // locate the peaks before refining them
+    _outFrameSize = 1;
+    while (_outFrameSize < SAMPLES_PER_PERIOD * _numBins && _outFrameSize < fftFrameSize) {
+        _outFrameSize *= 2;
+    }
+
+    _bins.assign(_numBins + 1, 0.0);
+    _twiddles.resize(_numBins + 1);
+    for (size_t k = 0; k <= _numBins; ++k) {
+        _twiddles[k] = std::polar(1.0, 2.0 * M_PI * k / fftFrameSize);
+    }
+    _history.assign(fftFrameSize, 0);
+    _historyPosition = 0;
+    _synchronized = false;
+    _samplesSinceResync = 0;
+    _resyncCount = 0;
+    _power.assign(_numBins, 0.0);
+
+    // ** INITIALIZE FFT STRUCTURES ** //
+    _fftwInTime = Traits::allocReal(fftFrameSize);
+    _fftwMidFreq = Traits::allocComplex(fftFrameSize / 2 + 1);
+    _fftwMidFreq2 = Traits::allocComplex(_outFrameSize / 2 + 1);
+    _fftwPowerSpectrum = Traits::allocComplex(fftFrameSize / 2 + 1);
+    _fftwOutTimeAutocorr = Traits::allocReal(_outFrameSize);
+
+    for (size_t k = 0; k < fftFrameSize / 2 + 1; ++k) {
+        _fftwPowerSpectrum[k][0] = 0.0;
+        _fftwPowerSpectrum[k][1] = 0.0;
+    }
+    std::fill(&_fftwOutTimeAutocorr[0], &_fftwOutTimeAutocorr[_outFrameSize], 0);
+
+    _plans = PitchDetectionPlans<Real>::create(fftFrameSize, _outFrameSize, PlanSource::Estimate);
+    _planSlot = std::make_shared<PitchDetectionPlanSlot<Real>>();
+}
+
+template <class Real>
+SlidingDftDetector<Real>::~SlidingDftDetector()
+{
+    // ** DESTROY FFTW STRUCTURES ** //
+    _plans.reset();
+    Traits::free(_fftwInTime);
+    Traits::free(_fftwMidFreq);
+    Traits::free(_fftwMidFreq2);
+    Traits::free(_fftwPowerSpectrum);
+    Traits::free(_fftwOutTimeAutocorr);
+}
+
+template <class Real>
+PitchDetectorEngine SlidingDftDetector<Real>::getEngine() const
+{
+    return PitchDetectorEngine::SlidingDft;
+}
+
+template <class Real>
+size_t SlidingDftDetector<Real>::getFFTFrameSize() const
+{
+    return _fftFrameSize;
+}
+
+template <class Real>
+size_t SlidingDftDetector<Real>::getOutFrameSize() const
+{
+    return _outFrameSize;
+}
+
+template <class Real>
+bool SlidingDftDetector<Real>::hasPlans() const
+{
+    return _plans != nullptr;
+}
+
+template <class Real>
+PlanSource SlidingDftDetector<Real>::getPlanSource() const
+{
+    return _plans->source;
+}
+
+template <class Real>
+double SlidingDftDetector<Real>::getPlanningTime() const
+{
+    return _plans->planningTime;
+}
+
+template <class Real>
+std::shared_ptr<PitchDetectionPlanSlot<Real>> SlidingDftDetector<Real>::getPlanSlot() const
+{
+    return _planSlot;
+}
+
+template <class Real>
+size_t SlidingDftDetector<Real>::getNumBins() const
+{
+    return _numBins;
+}
+
+template <class Real>
+uint64_t SlidingDftDetector<Real>::getResyncCount() const
+{
+    return _resyncCount;
+}
+
+template <class Real>
+typename SlidingDftDetector<Real>::Complex *SlidingDftDetector<Real>::getFreq2Buffer()
+{
+    return _fftwPowerSpectrum;
+}
+
+template <class Real>
+Real *SlidingDftDetector<Real>::getAutoCorrBuffer()
+{
+    return _fftwOutTimeAutocorr;
+}
+
+template <class Real>
+void SlidingDftDetector<Real>::loadSamples(const float *inputSamples, size_t inputSize)
+{
+    resync(inputSamples, inputSize);
+}
+
+template <class Real>
+void SlidingDftDetector<Real>::reset()
+{
+    _synchronized = false;
+}
+
+template <class Real>
+void SlidingDftDetector<Real>::slideSamples(const float *inputSamples, size_t inputSize,
+                                            size_t newSamples)
+{
+    newSamples = std::min(newSamples, inputSize);
+    if (!_synchronized || newSamples >= _fftFrameSize
+        || _samplesSinceResync + newSamples >= RESYNC_INTERVAL * _fftFrameSize) {
+        resync(inputSamples, inputSize);
+        return;
+    }
+
+    const size_t numBins = _numBins + 1;
+    std::complex<double> *bins = _bins.data();
+    const std::complex<double> *twiddles = _twiddles.data();
+
+    for (size_t i = inputSize - newSamples; i < inputSize; ++i) {
+        // replace the oldest sample with the new one
+        Real entering = inputSamples[i];
+        double delta = (double)entering - _history[_historyPosition];
+        _history[_historyPosition] = entering;
+        _historyPosition = (_historyPosition + 1) % _fftFrameSize;
+
+        for (size_t k = 0; k < numBins; ++k) {
+            bins[k] = (bins[k] + delta) * twiddles[k];
+        }
+    }
+
+    _samplesSinceResync += newSamples;
+}
+
+template <class Real>
+void SlidingDftDetector<Real>::resync(const float *inputSamples, size_t inputSize)
+{
+    // ** SWITCH TO BETTER PLANS BETWEEN FRAMES ** //
+    if (std::unique_ptr<PitchDetectionPlans<Real>> newPlans = _planSlot->take()) {
+        _plans.swap(newPlans);
+        _planSlot->retire(std::move(newPlans));
+    }
+
+    // the window holds the last samples of the frame, preceded by zeros if there are too few
+    size_t numCopy = std::min(inputSize, _fftFrameSize);
+    size_t numZeros = _fftFrameSize - numCopy;
+    std::fill(&_fftwInTime[0], &_fftwInTime[numZeros], 0);
+    std::copy(&inputSamples[inputSize - numCopy], &inputSamples[inputSize],
+              &_fftwInTime[numZeros]);
+
+    std::copy(&_fftwInTime[0], &_fftwInTime[_fftFrameSize], _history.begin());
+    _historyPosition = 0;
+
+    Traits::executeR2C(_plans->fft, _fftwInTime, _fftwMidFreq);
+    for (size_t k = 0; k <= _numBins; ++k) {
+        _bins[k] = std::complex<double>(_fftwMidFreq[k][0], _fftwMidFreq[k][1]);
+    }
+
+    _synchronized = true;
+    _samplesSinceResync = 0;
+    _resyncCount++;
+}
+
+template <class Real>
+double SlidingDftDetector<Real>::runPitchDetectionAlgorithm()
+{
+    // ** SWITCH TO BETTER PLANS BETWEEN FRAMES ** //
+    if (std::unique_ptr<PitchDetectionPlans<Real>> newPlans = _planSlot->take()) {
+        _plans.swap(newPlans);
+        _planSlot->retire(std::move(newPlans));
+    }
+
+    assert(_plans);
+
+    // ** APPLY THE HANN WINDOW AND COMPUTE THE POWER ** //
+    /*
+     * the periodic Hann window is 1/2 - e^(j * w * n) / 4 - e^(-j * w * n) / 4, so windowing
+     * convolves the bins with [-1/4, 1/2, -1/4] (the bin below the DC is the conjugate of the
+     * first one for a real signal)
+     */
+    for (size_t k = 0; k < _numBins; ++k) {
+        std::complex<double> below = (k == 0) ? std::conj(_bins[1]) : _bins[k - 1];
+        std::complex<double> windowed = 0.5 * _bins[k] - 0.25 * (below + _bins[k + 1]);
+        double power = std::norm(windowed);
+        _power[k] = power;
+        _fftwMidFreq2[k][0] = power;
+        _fftwMidFreq2[k][1] = 0.0;
+        _fftwPowerSpectrum[k][0] = power;
+    }
+
+    // the bins above the kept ones are zero
+    for (size_t k = _numBins; k < _outFrameSize / 2 + 1; ++k) {
+        _fftwMidFreq2[k][0] = 0.0;
+        _fftwMidFreq2[k][1] = 0.0;
+    }
+
+    // ** COMPUTE THE AUTOCORRELATION ** //
+    // the short IFFT samples the band-limited autocorrelation every N / M lags, exactly
+    Traits::executeC2R(_plans->ifft, _fftwMidFreq2, _fftwOutTimeAutocorr);
+
+    const Real *r = _fftwOutTimeAutocorr;
+    const size_t searchEnd = _outFrameSize / 2;
+
+    // search for a minimum in the autocorrelation to reject the peak centered around 0
+    size_t l = SimdKernels<Real>::best().findDescentEnd(r, 0, searchEnd);
+
+    size_t index = findFirstAutocorrelationPeak(
+            r, l, searchEnd, PitchDetectionContext<Real>::PEAK_HEIGHT_THRESHOLD);
+    if (index == 0) {
+        // silence
+        return 0.0;
+    }
+
+    // ** REFINE THE PEAK ** //
+    const double lagsPerSample = (double)_fftFrameSize / _outFrameSize;
+    double t = refineBandLimitedPeak(
+            [this](size_t k) { return _power[k]; }, _numBins, _fftFrameSize, _fftFrameSize,
+            (index + parabolicPeakOffset(r[index - 1], r[index], r[index + 1])) * lagsPerSample,
+            (index - 1) * lagsPerSample, (index + 1) * lagsPerSample,
+            PitchDetectionContext<Real>::SINC_NEWTON_ITERATIONS);
+
+    return _sampleFrequency / t;
+}
+
+template class SlidingDftDetector<double>;
+template class SlidingDftDetector<float>;
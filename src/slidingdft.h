@@ -0,0 +1,147 @@
+#pragma once
+
+#include "pitchdetection.h"
+
+#include <complex>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+/// Autocorrelation-based pitch detection on a spectrum updated sample by sample.
+///
+/// A sliding DFT keeps the bins of the last fftFrameSize samples up to the highest detectable
+/// frequency, and every new sample updates them in O(1) per bin:
+///
+/// S[k] <- (S[k] + x[new] - x[old]) * e^(j * 2 * pi * k / N)
+///
+/// The Hann window is applied in the frequency domain (X[k] = S[k] / 2 - (S[k-1] + S[k+1]) / 4),
+/// and the autocorrelation is the IFFT of the power of these few bins, so a short IFFT is enough
+/// to locate its first peak, which is then refined exactly as PeakInterpolation::Sinc does.  The
+/// cost of a frame is proportional to the number of new samples, plus that short IFFT.
+///
+/// The bins are recomputed with a full FFT every RESYNC_INTERVAL frames worth of samples to stop
+/// rounding errors from accumulating, and whenever more than a frame of samples is new.
+template <class Real>
+class SlidingDftDetector : public PitchDetector<Real>
+{
+public: // ** TYPES ** //
+    using Traits = FFTWTraits<Real>;
+    using Complex = typename Traits::Complex;
+
+public: // ** CONSTANTS ** //
+    /// Highest frequency kept in the spectrum, in Hz
+    static const double MAX_FREQUENCY;
+
+    /// Number of bins kept beyond MAX_FREQUENCY (the main lobe of the Hann window)
+    static const size_t GUARD_BINS;
+
+    /// Minimum number of samples of the IFFT per period of MAX_FREQUENCY
+    static const size_t SAMPLES_PER_PERIOD;
+
+    /// Number of frames worth of samples between two full FFTs
+    static const size_t RESYNC_INTERVAL;
+
+public: // ** PUBLIC METHODS ** //
+    /// Constructor.
+    ///
+    /// \param[in] sampleFrequency the sample rate of the input signal
+    /// \param[in] fftFrameSize the number of samples analysed in each frame
+    SlidingDftDetector(uint32_t sampleFrequency, size_t fftFrameSize);
+    ~SlidingDftDetector() override;
+
+    PitchDetectorEngine getEngine() const override;
+    size_t getFFTFrameSize() const override;
+    size_t getOutFrameSize() const override;
+
+    bool hasPlans() const override;
+    PlanSource getPlanSource() const override;
+    double getPlanningTime() const override;
+    std::shared_ptr<PitchDetectionPlanSlot<Real>> getPlanSlot() const override;
+
+    /// Recompute the bins from the given frame.
+    void loadSamples(const float *inputSamples, size_t inputSize) override;
+
+    /// Update the bins with the new samples at the end of the given frame.
+    void slideSamples(const float *inputSamples, size_t inputSize, size_t newSamples) override;
+
+    /// Recompute the bins from the next frame.
+    void reset() override;
+
+    Complex *getFreq2Buffer() override;
+    Real *getAutoCorrBuffer() override;
+
+    double runPitchDetectionAlgorithm() override;
+
+    /// Number of bins kept by the sliding DFT.
+    size_t getNumBins() const;
+
+    /// Number of times the bins were recomputed with a full FFT.
+    uint64_t getResyncCount() const;
+
+private:
+    /// Recompute the bins with a full FFT of the last fftFrameSize samples of the frame.
+    void resync(const float *inputSamples, size_t inputSize);
+
+    // ** PITCH DETECTION PARAMETERS ** //
+
+    /// Sample rate of the input signal
+    double _sampleFrequency;
+
+    /// Number of samples in the sliding window
+    size_t _fftFrameSize;
+
+    /// Number of bins kept, from the DC up to MAX_FREQUENCY and the guard bins
+    size_t _numBins;
+
+    /// Size of the IFFT computing the autocorrelation
+    size_t _outFrameSize;
+
+    // ** SLIDING DFT STATE ** //
+
+    /// The bins of the window, plus one above for the frequency-domain Hann window
+    std::vector<std::complex<double>> _bins;
+
+    /// e^(j * 2 * pi * k / N) for each bin
+    std::vector<std::complex<double>> _twiddles;
+
+    /// The samples in the window, oldest at _historyPosition
+    std::vector<Real> _history;
+
+    /// Position of the oldest sample in _history
+    size_t _historyPosition;
+
+    /// Set to true once the bins have been computed
+    bool _synchronized;
+
+    /// Number of samples slid in since the last full FFT
+    size_t _samplesSinceResync;
+
+    /// Number of full FFTs
+    uint64_t _resyncCount;
+
+    /// The power of the windowed bins, used to refine the peak
+    std::vector<double> _power;
+
+    // ** FFTW STRUCTURES ** //
+
+    /// Plans to compute the full FFT and the short IFFT
+    std::unique_ptr<PitchDetectionPlans<Real>> _plans;
+
+    /// Slot for replacement plans built on another thread
+    std::shared_ptr<PitchDetectionPlanSlot<Real>> _planSlot;
+
+    /// The window in the time domain, for the full FFT
+    Real *_fftwInTime;
+
+    /// The window in the frequency domain, from the full FFT
+    Complex *_fftwMidFreq;
+
+    /// The power of the kept bins, zero-padded to the IFFT size
+    Complex *_fftwMidFreq2;
+
+    /// The power spectrum, for visualization
+    Complex *_fftwPowerSpectrum;
+
+    /// The autocorrelation, with _outFrameSize / _fftFrameSize samples per lag
+    Real *_fftwOutTimeAutocorr;
+};
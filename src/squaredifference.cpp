@@ -0,0 +1,366 @@
+#include "squaredifference.h"
+
+#include <cassert>
+#include <algorithm>
+#include <cmath>
+
+template <class Real>
+const double SquareDifferenceDetector<Real>::MIN_FREQUENCY = 40.0;
+template <class Real>
+const double SquareDifferenceDetector<Real>::MAX_FREQUENCY = 2000.0;
+template <class Real>
+const double YinDetector<Real>::YIN_THRESHOLD = 0.1;
+template <class Real>
+const double McLeodDetector<Real>::KEY_MAXIMUM_CUTOFF = 0.9;
+
+template <class Real>
+SquareDifferenceDetector<Real>::SquareDifferenceDetector(uint32_t sampleFrequency,
+                                                         size_t fftFrameSize)
+{
+    _sampleFrequency = sampleFrequency;
+    _fftFrameSize = fftFrameSize;
+
+    // one more lag on each side of the band, so that the peaks at its edges can be interpolated,
+    // and at least half of the frame left for the window
+    _maxLag = std::min<size_t>(ceil(_sampleFrequency / MIN_FREQUENCY) + 1, fftFrameSize / 2);
+    _minLag = std::max<size_t>(floor(_sampleFrequency / MAX_FREQUENCY) - 1, 2);
+    _windowSize = fftFrameSize - _maxLag;
+
+    _correlation.resize(_maxLag + 1);
+    _energy.resize(_maxLag + 1);
+
+    // ** INITIALIZE FFT STRUCTURES ** //
+    _fftwInTime = Traits::allocReal(fftFrameSize);
+    _fftwInWindow = Traits::allocReal(fftFrameSize);
+    _fftwMidFreq = Traits::allocComplex(fftFrameSize / 2 + 1);
+    _fftwMidFreqWindow = Traits::allocComplex(fftFrameSize / 2 + 1);
+    _fftwMidFreqCross = Traits::allocComplex(fftFrameSize / 2 + 1);
+    _fftwPowerSpectrum = Traits::allocComplex(fftFrameSize / 2 + 1);
+    _fftwOutTimeCorr = Traits::allocReal(fftFrameSize);
+
+    std::fill(&_fftwInTime[0], &_fftwInTime[fftFrameSize], 0);
+    // the samples after the window stay zero
+    std::fill(&_fftwInWindow[0], &_fftwInWindow[fftFrameSize], 0);
+    std::fill(&_fftwOutTimeCorr[0], &_fftwOutTimeCorr[fftFrameSize], 0);
+    for (size_t k = 0; k < fftFrameSize / 2 + 1; ++k) {
+        _fftwPowerSpectrum[k][0] = 0.0;
+        _fftwPowerSpectrum[k][1] = 0.0;
+    }
+
+    // the IFFT has the size of the frame, which is the shape of the plans of an unpadded
+    // autocorrelation, so PlanRefiner can measure them like those of PitchDetectionContext
+    _plans = PitchDetectionPlans<Real>::create(fftFrameSize, fftFrameSize, PlanSource::Estimate);
+    _planSlot = std::make_shared<PitchDetectionPlanSlot<Real>>();
+}
+
+template <class Real>
+SquareDifferenceDetector<Real>::~SquareDifferenceDetector()
+{
+    // ** DESTROY FFTW STRUCTURES ** //
+    _plans.reset();
+    Traits::free(_fftwInTime);
+    Traits::free(_fftwInWindow);
+    Traits::free(_fftwMidFreq);
+    Traits::free(_fftwMidFreqWindow);
+    Traits::free(_fftwMidFreqCross);
+    Traits::free(_fftwPowerSpectrum);
+    Traits::free(_fftwOutTimeCorr);
+}
+
+template <class Real>
+size_t SquareDifferenceDetector<Real>::getFFTFrameSize() const
+{
+    return _fftFrameSize;
+}
+
+template <class Real>
+size_t SquareDifferenceDetector<Real>::getOutFrameSize() const
+{
+    return _fftFrameSize;
+}
+
+template <class Real>
+bool SquareDifferenceDetector<Real>::hasPlans() const
+{
+    return _plans != nullptr;
+}
+
+template <class Real>
+PlanSource SquareDifferenceDetector<Real>::getPlanSource() const
+{
+    return _plans->source;
+}
+
+template <class Real>
+double SquareDifferenceDetector<Real>::getPlanningTime() const
+{
+    return _plans->planningTime;
+}
+
+template <class Real>
+std::shared_ptr<PitchDetectionPlanSlot<Real>> SquareDifferenceDetector<Real>::getPlanSlot() const
+{
+    return _planSlot;
+}
+
+template <class Real>
+void SquareDifferenceDetector<Real>::loadSamples(const float *samples, size_t inputSize)
+{
+    size_t numCopy = std::min(inputSize, _fftFrameSize);
+    std::copy(&samples[0], &samples[numCopy], &_fftwInTime[0]);
+    std::fill(&_fftwInTime[numCopy], &_fftwInTime[_fftFrameSize], 0);
+}
+
+template <class Real>
+typename SquareDifferenceDetector<Real>::Complex *SquareDifferenceDetector<Real>::getFreq2Buffer()
+{
+    return _fftwPowerSpectrum;
+}
+
+template <class Real>
+Real *SquareDifferenceDetector<Real>::getAutoCorrBuffer()
+{
+    return _fftwOutTimeCorr;
+}
+
+template <class Real>
+size_t SquareDifferenceDetector<Real>::getWindowSize() const
+{
+    return _windowSize;
+}
+
+template <class Real>
+size_t SquareDifferenceDetector<Real>::getMinLag() const
+{
+    return _minLag;
+}
+
+template <class Real>
+size_t SquareDifferenceDetector<Real>::getMaxLag() const
+{
+    return _maxLag;
+}
+
+template <class Real>
+void SquareDifferenceDetector<Real>::computeSquareDifference()
+{
+    // ** SWITCH TO BETTER PLANS BETWEEN FRAMES ** //
+    if (std::unique_ptr<PitchDetectionPlans<Real>> newPlans = _planSlot->take()) {
+        _plans.swap(newPlans);
+        _planSlot->retire(std::move(newPlans));
+    }
+
+    assert(_plans);
+
+    // ** COMPUTE r[t] ** //
+    std::copy(&_fftwInTime[0], &_fftwInTime[_windowSize], &_fftwInWindow[0]);
+    Traits::executeR2C(_plans->fft, _fftwInTime, _fftwMidFreq);
+    Traits::executeR2C(_plans->fft, _fftwInWindow, _fftwMidFreqWindow);
+
+    /*
+     * the cross-correlation of the window w and the frame x is
+     *
+     *        j=W-1
+     * r[t] = sum( w[j] * x[j+t] )   <->   R[f] = W[f]' * X[f]
+     *         0
+     *
+     * and it does not wrap around for t <= N - W, which is the longest lag
+     */
+    for (size_t k = 0; k < _fftFrameSize / 2 + 1; ++k) {
+        double xRe = _fftwMidFreq[k][0];
+        double xIm = _fftwMidFreq[k][1];
+        double wRe = _fftwMidFreqWindow[k][0];
+        double wIm = _fftwMidFreqWindow[k][1];
+        _fftwMidFreqCross[k][0] = wRe * xRe + wIm * xIm;
+        _fftwMidFreqCross[k][1] = wRe * xIm - wIm * xRe;
+        _fftwPowerSpectrum[k][0] = xRe * xRe + xIm * xIm;
+    }
+
+    Traits::executeC2R(_plans->ifft, _fftwMidFreqCross, _fftwOutTimeCorr);
+
+    // the c2r IFFT is not normalized
+    const double scale = 1.0 / _fftFrameSize;
+    for (size_t t = 0; t <= _maxLag; ++t) {
+        _correlation[t] = _fftwOutTimeCorr[t] * scale;
+    }
+
+    // ** COMPUTE m[t] ** //
+    double windowEnergy = 0.0;
+    for (size_t j = 0; j < _windowSize; ++j) {
+        windowEnergy += (double)_fftwInTime[j] * _fftwInTime[j];
+    }
+
+    // slide the window of the delayed signal along the frame
+    double delayedEnergy = windowEnergy;
+    for (size_t t = 0; t <= _maxLag; ++t) {
+        _energy[t] = windowEnergy + delayedEnergy;
+        // the window at the longest lag ends with the frame: nothing enters after it
+        if (t == _maxLag) {
+            break;
+        }
+        double leaving = _fftwInTime[t];
+        double entering = _fftwInTime[t + _windowSize];
+        delayedEnergy = std::max(delayedEnergy - leaving * leaving + entering * entering, 0.0);
+    }
+}
+
+template <class Real>
+YinDetector<Real>::YinDetector(uint32_t sampleFrequency, size_t fftFrameSize)
+    : SquareDifferenceDetector<Real>(sampleFrequency, fftFrameSize)
+{
+    _difference.resize(this->_maxLag + 1);
+    _normalizedDifference.resize(this->_maxLag + 1);
+}
+
+template <class Real>
+PitchDetectorEngine YinDetector<Real>::getEngine() const
+{
+    return PitchDetectorEngine::Yin;
+}
+
+template <class Real>
+double YinDetector<Real>::runPitchDetectionAlgorithm()
+{
+    this->computeSquareDifference();
+
+    const size_t minLag = this->_minLag;
+    const size_t maxLag = this->_maxLag;
+    if (!(this->_energy[0] > 0.0)) {
+        // silence
+        return 0.0;
+    }
+
+    // ** CUMULATIVE MEAN NORMALIZED DIFFERENCE FUNCTION ** //
+    _difference[0] = 0.0;
+    _normalizedDifference[0] = 1.0;
+    double cumulativeDifference = 0.0;
+    for (size_t t = 1; t <= maxLag; ++t) {
+        // d[t] >= 0, but rounding may take it slightly below
+        _difference[t] = std::max(this->_energy[t] - 2.0 * this->_correlation[t], 0.0);
+        cumulativeDifference += _difference[t];
+        _normalizedDifference[t] = cumulativeDifference > 0.0
+                ? _difference[t] * t / cumulativeDifference
+                : 1.0;
+    }
+
+    // ** ABSOLUTE THRESHOLD ** //
+    // take the bottom of the first dip below the threshold
+    size_t period = 0;
+    for (size_t t = minLag; t <= maxLag; ++t) {
+        if (_normalizedDifference[t] < YIN_THRESHOLD) {
+            while (t + 1 <= maxLag && _normalizedDifference[t + 1] < _normalizedDifference[t]) {
+                ++t;
+            }
+            period = t;
+            break;
+        }
+    }
+
+    // fall back to the global minimum
+    if (period == 0) {
+        period = std::min_element(&_normalizedDifference[minLag],
+                                  &_normalizedDifference[maxLag + 1])
+                - &_normalizedDifference[0];
+    }
+
+    // ** PARABOLIC INTERPOLATION ** //
+    // interpolate d[t] rather than the normalized function, which is skewed by the normalization
+    double lag = period;
+    if (period < maxLag) {
+        lag += parabolicPeakOffset(-_difference[period - 1], -_difference[period],
+                                   -_difference[period + 1]);
+    }
+
+    return this->_sampleFrequency / lag;
+}
+
+template <class Real>
+McLeodDetector<Real>::McLeodDetector(uint32_t sampleFrequency, size_t fftFrameSize)
+    : SquareDifferenceDetector<Real>(sampleFrequency, fftFrameSize)
+{
+    _nsdf.resize(this->_maxLag + 1);
+    _keyMaxima.reserve(this->_maxLag + 1);
+}
+
+template <class Real>
+PitchDetectorEngine McLeodDetector<Real>::getEngine() const
+{
+    return PitchDetectorEngine::McLeod;
+}
+
+template <class Real>
+double McLeodDetector<Real>::runPitchDetectionAlgorithm()
+{
+    this->computeSquareDifference();
+
+    const size_t minLag = this->_minLag;
+    const size_t maxLag = this->_maxLag;
+    if (!(this->_energy[0] > 0.0)) {
+        // silence
+        return 0.0;
+    }
+
+    // ** NORMALIZED SQUARE DIFFERENCE FUNCTION ** //
+    for (size_t t = 0; t <= maxLag; ++t) {
+        double energy = this->_energy[t];
+        _nsdf[t] = energy > 0.0 ? 2.0 * this->_correlation[t] / energy : 0.0;
+    }
+
+    // ** KEY MAXIMA ** //
+    _keyMaxima.clear();
+    double highestKeyMaximum = 0.0;
+
+    // skip the lobe around the zero lag
+    size_t t = 1;
+    while (t <= maxLag && _nsdf[t] > 0.0) {
+        ++t;
+    }
+
+    while (t <= maxLag) {
+        // find the next positive-going zero crossing
+        while (t <= maxLag && _nsdf[t] <= 0.0) {
+            ++t;
+        }
+
+        // and the highest point before the next negative-going one
+        size_t keyMaximum = 0;
+        while (t <= maxLag && _nsdf[t] > 0.0) {
+            if (keyMaximum == 0 || _nsdf[t] > _nsdf[keyMaximum]) {
+                keyMaximum = t;
+            }
+            ++t;
+        }
+
+        // a lobe cut by the end of the search may still be rising
+        if (keyMaximum >= minLag && keyMaximum < maxLag) {
+            _keyMaxima.push_back(keyMaximum);
+            highestKeyMaximum = std::max(highestKeyMaximum, _nsdf[keyMaximum]);
+        }
+    }
+
+    if (_keyMaxima.empty()) {
+        return 0.0;
+    }
+
+    // ** CHOOSE THE PERIOD ** //
+    size_t period = _keyMaxima.front();
+    for (size_t keyMaximum : _keyMaxima) {
+        if (_nsdf[keyMaximum] >= KEY_MAXIMUM_CUTOFF * highestKeyMaximum) {
+            period = keyMaximum;
+            break;
+        }
+    }
+
+    // ** PARABOLIC INTERPOLATION ** //
+    double lag = period
+            + parabolicPeakOffset(_nsdf[period - 1], _nsdf[period], _nsdf[period + 1]);
+
+    return this->_sampleFrequency / lag;
+}
+
+template class SquareDifferenceDetector<double>;
+template class SquareDifferenceDetector<float>;
+template class YinDetector<double>;
+template class YinDetector<float>;
+template class McLeodDetector<double>;
+template class McLeodDetector<float>;
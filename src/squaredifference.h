@@ -0,0 +1,175 @@
+#pragma once
+
+#include "pitchdetection.h"
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+/// Base of the pitch detection engines working on the squared difference function.
+///
+/// Over a window of W samples at the beginning of the frame, the squared difference function is
+///
+///        j=W-1
+/// d[t] = sum( (x[j] - x[j+t])^2 ) = m[t] - 2 * r[t]
+///         0
+///
+/// with r[t] = sum( x[j] * x[j+t] ) and m[t] = sum( x[j]^2 + x[j+t]^2 ).  Only the lags of the
+/// notes accepted by TuningParameters::estimateNote are needed, so the window is the frame minus
+/// the longest of them, and r[t] is the circular cross-correlation of the window with the frame:
+/// two FFTs and one IFFT of the frame size, without zero-padding.  m[t] is a sliding sum.
+///
+/// The samples are not windowed: the normalization of the derived engines takes care of the
+/// edges of the frame.
+template <class Real>
+class SquareDifferenceDetector : public PitchDetector<Real>
+{
+public: // ** TYPES ** //
+    using Traits = FFTWTraits<Real>;
+    using Complex = typename Traits::Complex;
+
+public: // ** CONSTANTS ** //
+    /// Lowest frequency that can be detected, in Hz
+    static const double MIN_FREQUENCY;
+
+    /// Highest frequency that can be detected, in Hz
+    static const double MAX_FREQUENCY;
+
+public: // ** PUBLIC METHODS ** //
+    /// Constructor.
+    ///
+    /// \param[in] sampleFrequency the sample rate of the input signal
+    /// \param[in] fftFrameSize the number of samples analysed in each frame
+    SquareDifferenceDetector(uint32_t sampleFrequency, size_t fftFrameSize);
+    ~SquareDifferenceDetector() override;
+
+    size_t getFFTFrameSize() const override;
+    size_t getOutFrameSize() const override;
+
+    bool hasPlans() const override;
+    PlanSource getPlanSource() const override;
+    double getPlanningTime() const override;
+    std::shared_ptr<PitchDetectionPlanSlot<Real>> getPlanSlot() const override;
+
+    void loadSamples(const float *inputSamples, size_t inputSize) override;
+
+    Complex *getFreq2Buffer() override;
+    Real *getAutoCorrBuffer() override;
+
+    /// Number of samples in the window.
+    size_t getWindowSize() const;
+
+    /// Shortest lag searched for a period, in samples.
+    size_t getMinLag() const;
+
+    /// Longest lag for which r[t] and m[t] are computed, in samples.
+    size_t getMaxLag() const;
+
+protected:
+    /// Compute r[t] and m[t] of the loaded samples for t in [0, getMaxLag()].
+    void computeSquareDifference();
+
+    /// Sample rate of the input signal
+    double _sampleFrequency;
+
+    /// Number of frames in the time-domain input
+    size_t _fftFrameSize;
+
+    /// Number of samples in the window
+    size_t _windowSize;
+
+    /// Shortest lag searched for a period
+    size_t _minLag;
+
+    /// Longest lag for which r[t] and m[t] are computed
+    size_t _maxLag;
+
+    /// r[t] for t in [0, _maxLag]
+    std::vector<double> _correlation;
+
+    /// m[t] for t in [0, _maxLag]
+    std::vector<double> _energy;
+
+private:
+    // ** FFTW STRUCTURES ** //
+
+    /// Plans to compute the FFTs and the IFFT, all of the frame size
+    std::unique_ptr<PitchDetectionPlans<Real>> _plans;
+
+    /// Slot for replacement plans built on another thread
+    std::shared_ptr<PitchDetectionPlanSlot<Real>> _planSlot;
+
+    /// The input signal in the time domain
+    Real *_fftwInTime;
+
+    /// The window of the input signal, zero-padded to the frame size
+    Real *_fftwInWindow;
+
+    /// The input signal in the frequency domain
+    Complex *_fftwMidFreq;
+
+    /// The window in the frequency domain
+    Complex *_fftwMidFreqWindow;
+
+    /// The cross-spectrum of the window and the input signal
+    Complex *_fftwMidFreqCross;
+
+    /// The power spectrum of the input signal, for visualization
+    Complex *_fftwPowerSpectrum;
+
+    /// The cross-correlation of the window and the input signal (not normalized)
+    Real *_fftwOutTimeCorr;
+};
+
+/// The YIN pitch detection engine (de Cheveigné and Kawahara, 2002).
+///
+/// The squared difference function is normalized by its cumulative mean, and the period is the
+/// first dip of the normalized function below an absolute threshold (or its global minimum if
+/// there is none), refined by parabolic interpolation of d[t].
+template <class Real>
+class YinDetector : public SquareDifferenceDetector<Real>
+{
+public: // ** CONSTANTS ** //
+    /// Absolute threshold of the cumulative mean normalized difference function
+    static const double YIN_THRESHOLD;
+
+public: // ** PUBLIC METHODS ** //
+    YinDetector(uint32_t sampleFrequency, size_t fftFrameSize);
+
+    PitchDetectorEngine getEngine() const override;
+    double runPitchDetectionAlgorithm() override;
+
+private:
+    /// d[t] for t in [0, _maxLag]
+    std::vector<double> _difference;
+
+    /// The cumulative mean normalized difference function for t in [0, _maxLag]
+    std::vector<double> _normalizedDifference;
+};
+
+/// The McLeod Pitch Method (McLeod and Wyvill, 2005).
+///
+/// The normalized square difference function n[t] = 2 * r[t] / m[t] lies in [-1, 1].  The period
+/// is the first "key maximum" (the highest point between a positive-going and a negative-going
+/// zero crossing) that reaches a fraction of the highest key maximum, refined by parabolic
+/// interpolation.
+template <class Real>
+class McLeodDetector : public SquareDifferenceDetector<Real>
+{
+public: // ** CONSTANTS ** //
+    /// Fraction of the highest key maximum that the chosen key maximum must reach
+    static const double KEY_MAXIMUM_CUTOFF;
+
+public: // ** PUBLIC METHODS ** //
+    McLeodDetector(uint32_t sampleFrequency, size_t fftFrameSize);
+
+    PitchDetectorEngine getEngine() const override;
+    double runPitchDetectionAlgorithm() override;
+
+private:
+    /// n[t] for t in [0, _maxLag]
+    std::vector<double> _nsdf;
+
+    /// Lags of the key maxima of the last frame
+    std::vector<size_t> _keyMaxima;
+};
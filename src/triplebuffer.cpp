@@ -0,0 +1,6 @@
+#include "triplebuffer.h"
+#include "triplebuffer_impl.h"
+
+#include "visualization_data.h"
+
+template class TripleBuffer<VisualizationData>;
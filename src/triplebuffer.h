@@ -0,0 +1,74 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+
+/// A wait-free single-producer, single-consumer exchange of snapshots.
+///
+/// Three copies of T are allocated once.  The producer fills its back buffer in place and
+/// publishes it, which swaps it with the middle one; the consumer takes the middle one as its
+/// front buffer whenever a newer snapshot was published, and reads it in place for as long as it
+/// wants.  Neither thread ever waits for the other, nor copies a snapshot: if the producer
+/// publishes faster than the consumer takes them, the older snapshots are simply overwritten.
+///
+/// The middle index and the flag telling whether it holds an unread snapshot are one atomic, so
+/// each swap is a single exchange.
+template <class T>
+class TripleBuffer
+{
+public: // ** CONSTANTS ** //
+    /// Size of a cache line, to keep the snapshots and the indices apart
+    static constexpr size_t CACHE_LINE_SIZE = 64;
+
+public: // ** PUBLIC METHODS ** //
+    /// Constructor.
+    ///
+    /// \param[in] initial copied to the three buffers, which is also the first front buffer
+    explicit TripleBuffer(const T &initial);
+
+    TripleBuffer(const TripleBuffer &) = delete;
+    TripleBuffer &operator=(const TripleBuffer &) = delete;
+
+    // ** PRODUCER ** //
+
+    /// The buffer to fill.  Still holds the snapshot published two or three times before.
+    T &getBackBuffer();
+
+    /// Publish the back buffer, and get a new one.  Wait-free.
+    void publish();
+
+    // ** CONSUMER ** //
+
+    /// Take the last published snapshot as the front buffer, if there is one not taken yet.
+    ///
+    /// \return true if the front buffer changed
+    bool update();
+
+    /// The snapshot taken by the last update().  It stays valid and unchanged until the next one.
+    const T &getFrontBuffer() const;
+
+private:
+    /// Set in _middle when it holds a snapshot not taken by the consumer yet
+    static constexpr uint32_t FRESH = 4;
+
+    /// Mask of the index in _middle
+    static constexpr uint32_t INDEX_MASK = 3;
+
+    struct alignas(CACHE_LINE_SIZE) Slot
+    {
+        T value;
+    };
+
+    /// The three buffers
+    Slot _slots[3];
+
+    /// Index of the buffer of the producer
+    alignas(CACHE_LINE_SIZE) uint32_t _back;
+
+    /// Index of the buffer in between, with FRESH
+    alignas(CACHE_LINE_SIZE) std::atomic<uint32_t> _middle;
+
+    /// Index of the buffer of the consumer
+    alignas(CACHE_LINE_SIZE) uint32_t _front;
+};
@@ -0,0 +1,44 @@
+#pragma once
+
+/// The definitions of the methods of TripleBuffer.
+///
+/// triplebuffer.cpp instantiates it for the snapshots of the core library; a target that
+/// publishes its own snapshots includes this header in one of its files and instantiates it there.
+
+#include "triplebuffer.h"
+
+template <class T>
+TripleBuffer<T>::TripleBuffer(const T &initial)
+    : _slots{ { initial }, { initial }, { initial } }, _back(0), _middle(1), _front(2)
+{
+}
+
+template <class T>
+T &TripleBuffer<T>::getBackBuffer()
+{
+    return _slots[_back].value;
+}
+
+template <class T>
+void TripleBuffer<T>::publish()
+{
+    // release the writes to the back buffer, and acquire the consumer's reads of the buffer we
+    // get back, which it may have just given up
+    _back = _middle.exchange(_back | FRESH, std::memory_order_acq_rel) & INDEX_MASK;
+}
+
+template <class T>
+bool TripleBuffer<T>::update()
+{
+    if ((_middle.load(std::memory_order_relaxed) & FRESH) == 0) {
+        return false;
+    }
+    _front = _middle.exchange(_front, std::memory_order_acq_rel) & INDEX_MASK;
+    return true;
+}
+
+template <class T>
+const T &TripleBuffer<T>::getFrontBuffer() const
+{
+    return _slots[_front].value;
+}
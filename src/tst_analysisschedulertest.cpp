@@ -0,0 +1,104 @@
+#include "tst_analysisschedulertest.h"
+
+#include "analysisscheduler.h"
+
+#include <chrono>
+
+QTEST_MAIN(TestAnalysisScheduler)
+
+using namespace std::chrono_literals;
+
+/// 100 analyses per second, for periods of exactly 10 ms.
+static const double RATE = 100.0;
+static const AnalysisScheduler::ClockType::duration PERIOD = 10ms;
+
+/// An arbitrary start, as the scheduler must not depend on the epoch of the clock.
+static const AnalysisScheduler::TimePointType START = AnalysisScheduler::TimePointType(1h);
+
+void TestAnalysisScheduler::testFixedRate()
+{
+    AnalysisScheduler scheduler(RATE);
+    QVERIFY(!scheduler.isSampleDriven());
+    QCOMPARE(scheduler.getPeriod(), PERIOD);
+
+    // the first analysis is due one period after the start, whatever the number of samples
+    scheduler.start(START);
+    QCOMPARE(scheduler.getDeadline(), START + PERIOD);
+    QVERIFY(!scheduler.isDue(START, 100000));
+    QVERIFY(!scheduler.isDue(START + PERIOD - 1ns, 100000));
+    QVERIFY(scheduler.isDue(START + PERIOD, 0));
+
+    // an analysis started on time is followed by one a period later
+    for (int i = 1; i <= 5; ++i) {
+        scheduler.advance(START + i * PERIOD);
+        QCOMPARE(scheduler.getDeadline(), START + (i + 1) * PERIOD);
+    }
+    QCOMPARE(scheduler.getSkippedPeriods(), uint64_t(0));
+}
+
+void TestAnalysisScheduler::testLateAnalysisKeepsPhase()
+{
+    AnalysisScheduler scheduler(RATE);
+    scheduler.start(START);
+
+    // an analysis started late within its period does not shift the following deadlines
+    scheduler.advance(START + PERIOD + 7ms);
+    QCOMPARE(scheduler.getDeadline(), START + 2 * PERIOD);
+    QCOMPARE(scheduler.getSkippedPeriods(), uint64_t(0));
+
+    // one started exactly on the next deadline misses that one
+    scheduler.advance(START + 3 * PERIOD);
+    QCOMPARE(scheduler.getDeadline(), START + 4 * PERIOD);
+    QCOMPARE(scheduler.getSkippedPeriods(), uint64_t(1));
+}
+
+void TestAnalysisScheduler::testOverrunSkipsPeriods()
+{
+    AnalysisScheduler scheduler(RATE);
+    scheduler.start(START);
+
+    // an analysis started 3.5 periods late drops the three deadlines already passed, instead of
+    // catching up with a burst of analyses, and stays in phase
+    scheduler.advance(START + PERIOD + 35ms);
+    QCOMPARE(scheduler.getDeadline(), START + 5 * PERIOD);
+    QCOMPARE(scheduler.getSkippedPeriods(), uint64_t(3));
+    QVERIFY(!scheduler.isDue(START + 5 * PERIOD - 1ns, 0));
+    QVERIFY(scheduler.isDue(START + 5 * PERIOD, 0));
+
+    // the skipped periods accumulate
+    scheduler.advance(START + 5 * PERIOD + 2 * PERIOD);
+    QCOMPARE(scheduler.getDeadline(), START + 8 * PERIOD);
+    QCOMPARE(scheduler.getSkippedPeriods(), uint64_t(5));
+}
+
+void TestAnalysisScheduler::testRestart()
+{
+    AnalysisScheduler scheduler(RATE);
+    scheduler.start(START);
+    scheduler.advance(START + 10 * PERIOD);
+    QVERIFY(scheduler.getSkippedPeriods() > 0);
+
+    // a restart takes the phase of the new start and forgets the skipped periods
+    AnalysisScheduler::TimePointType restart = START + 1s + 3ms;
+    scheduler.start(restart);
+    QCOMPARE(scheduler.getDeadline(), restart + PERIOD);
+    QCOMPARE(scheduler.getSkippedPeriods(), uint64_t(0));
+}
+
+void TestAnalysisScheduler::testHop()
+{
+    AnalysisScheduler scheduler(RATE, 512);
+    QVERIFY(scheduler.isSampleDriven());
+    QCOMPARE(scheduler.getHop(), size_t(512));
+
+    // only the number of new samples matters, never the time
+    scheduler.start(START);
+    QVERIFY(!scheduler.isDue(START, 0));
+    QVERIFY(!scheduler.isDue(START + 1h, 511));
+    QVERIFY(scheduler.isDue(START, 512));
+    QVERIFY(scheduler.isDue(START, 4096));
+
+    // and nothing is ever skipped
+    scheduler.advance(START + 1h);
+    QCOMPARE(scheduler.getSkippedPeriods(), uint64_t(0));
+}
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <QTest>
+#include <QObject>
+
+class TestAnalysisScheduler : public QObject
+{
+    Q_OBJECT
+private slots:
+    void testFixedRate();
+    void testLateAnalysisKeepsPhase();
+    void testOverrunSkipsPeriods();
+    void testRestart();
+    void testHop();
+};
@@ -0,0 +1,229 @@
+#include "tst_audiosourcetest.h"
+
+#include "audiosource.h"
+
+#include <QElapsedTimer>
+#include <QTemporaryFile>
+#include <QtEndian>
+#include <mutex>
+#include <vector>
+
+QTEST_MAIN(TestAudioSource)
+
+/// Collects what an audio source delivers.
+struct Collector
+{
+    std::mutex mutex;
+    std::vector<float> samples;
+    size_t callbacks = 0;
+    size_t largestBlock = 0;
+
+    static int callback(const float *input, unsigned long frameCount,
+                        const PaStreamCallbackTimeInfo * /*timeInfo*/,
+                        PaStreamCallbackFlags /*statusFlags*/, void *userData)
+    {
+        Collector *collector = static_cast<Collector *>(userData);
+        std::lock_guard<std::mutex> locker(collector->mutex);
+        collector->samples.insert(collector->samples.end(), input, input + frameCount);
+        collector->callbacks++;
+        collector->largestBlock = std::max<size_t>(collector->largestBlock, frameCount);
+        return paContinue;
+    }
+
+    size_t size()
+    {
+        std::lock_guard<std::mutex> locker(mutex);
+        return samples.size();
+    }
+};
+
+static void appendLE16(QByteArray &bytes, uint16_t value)
+{
+    char data[2];
+    qToLittleEndian<quint16>(value, data);
+    bytes.append(data, 2);
+}
+
+static void appendLE32(QByteArray &bytes, uint32_t value)
+{
+    char data[4];
+    qToLittleEndian<quint32>(value, data);
+    bytes.append(data, 4);
+}
+
+/// A WAV file with the given fmt chunk body and samples, plus an odd-sized chunk before the data.
+static QByteArray makeWav(const QByteArray &format, const QByteArray &samples)
+{
+    QByteArray chunks;
+    chunks.append("fmt ");
+    appendLE32(chunks, format.size());
+    chunks.append(format);
+    chunks.append("LIST");
+    appendLE32(chunks, 3);
+    chunks.append("abc");
+    chunks.append('\0'); // padding
+    chunks.append("data");
+    appendLE32(chunks, samples.size());
+    chunks.append(samples);
+
+    QByteArray wav("RIFF");
+    appendLE32(wav, 4 + chunks.size());
+    wav.append("WAVE");
+    wav.append(chunks);
+    return wav;
+}
+
+static QByteArray makePcmFormat(uint16_t formatTag, uint16_t channels, uint32_t sampleFrequency,
+                                uint16_t bitsPerSample)
+{
+    QByteArray format;
+    appendLE16(format, formatTag);
+    appendLE16(format, channels);
+    appendLE32(format, sampleFrequency);
+    appendLE32(format, sampleFrequency * channels * bitsPerSample / 8);
+    appendLE16(format, channels * bitsPerSample / 8);
+    appendLE16(format, bitsPerSample);
+    return format;
+}
+
+static void writeFile(QTemporaryFile &file, const QByteArray &contents)
+{
+    QVERIFY(file.open());
+    QCOMPARE(file.write(contents), contents.size());
+    file.close();
+}
+
+void TestAudioSource::testWav16BitStereo()
+{
+    const size_t numFrames = 1000;
+    QByteArray samples;
+    for (size_t i = 0; i < numFrames; ++i) {
+        appendLE16(samples, (uint16_t)(int16_t)(32 * i - 16000)); // left
+        appendLE16(samples, 0x7FFF); // right, ignored
+    }
+    QTemporaryFile file;
+    writeFile(file, makeWav(makePcmFormat(0x0001, 2, 22050, 16), samples));
+
+    WavFileSource source(file.fileName(), false, false);
+    QCOMPARE(source.getNumFrames(), numFrames);
+    QCOMPARE(source.getSampleFrequency(44100), uint32_t(22050));
+
+    Collector collector;
+    source.start(22050, Collector::callback, &collector);
+    QTRY_COMPARE(collector.size(), numFrames);
+    source.stop();
+    QVERIFY(!source.isStarted());
+
+    for (size_t i = 0; i < numFrames; ++i) {
+        QCOMPARE(collector.samples[i], (float)(32 * (int)i - 16000) / 32768.0f);
+    }
+    QVERIFY(collector.largestBlock <= BlockAudioSource::BLOCK_FRAMES);
+}
+
+void TestAudioSource::testWavExtensibleFloat()
+{
+    // WAVE_FORMAT_EXTENSIBLE with the KSDATAFORMAT_SUBTYPE_IEEE_FLOAT sub-format
+    QByteArray format = makePcmFormat(0xFFFE, 1, 44100, 32);
+    appendLE16(format, 22); // cbSize
+    appendLE16(format, 32); // valid bits
+    appendLE32(format, 0x4); // channel mask
+    appendLE16(format, 0x0003);
+    format.append("\x00\x00\x00\x00\x10\x00\x80\x00\x00\xAA\x00\x38\x9B\x71", 14);
+
+    const size_t numFrames = 600;
+    QByteArray samples;
+    for (size_t i = 0; i < numFrames; ++i) {
+        char data[4];
+        qToLittleEndian<float>(sinf(0.01f * i), data);
+        samples.append(data, 4);
+    }
+    QTemporaryFile file;
+    writeFile(file, makeWav(format, samples));
+
+    WavFileSource source(file.fileName(), false, false);
+    Collector collector;
+    source.start(44100, Collector::callback, &collector);
+    QTRY_COMPARE(collector.size(), numFrames);
+    source.stop();
+
+    for (size_t i = 0; i < numFrames; ++i) {
+        QCOMPARE(collector.samples[i], sinf(0.01f * i));
+    }
+}
+
+void TestAudioSource::testWavLoop()
+{
+    QByteArray samples;
+    for (int i = 0; i < 100; ++i) {
+        samples.append((char)(128 + i)); // 8-bit samples are unsigned
+    }
+    QTemporaryFile file;
+    writeFile(file, makeWav(makePcmFormat(0x0001, 1, 8000, 8), samples));
+
+    WavFileSource source(file.fileName(), false, true);
+    Collector collector;
+    source.start(8000, Collector::callback, &collector);
+    QTRY_VERIFY(collector.size() >= 1000);
+    source.stop();
+
+    // the file starts over after its last sample
+    for (size_t i = 0; i < 1000; ++i) {
+        QCOMPARE(collector.samples[i], (i % 100) / 128.0f);
+    }
+
+    // and the source can be started again
+    size_t delivered = collector.size();
+    source.start(8000, Collector::callback, &collector);
+    QTRY_VERIFY(collector.size() > delivered);
+    source.stop();
+}
+
+void TestAudioSource::testWavRealTime()
+{
+    // 0.1 s of silence
+    QByteArray samples(2 * 4410, '\0');
+    QTemporaryFile file;
+    writeFile(file, makeWav(makePcmFormat(0x0001, 1, 44100, 16), samples));
+
+    WavFileSource source(file.fileName(), true, false);
+    Collector collector;
+    QElapsedTimer timer;
+    timer.start();
+    source.start(44100, Collector::callback, &collector);
+    QTRY_COMPARE(collector.size(), size_t(4410));
+    qint64 elapsed = timer.elapsed();
+    source.stop();
+
+    QVERIFY2(elapsed >= 95, qPrintable(QString("played in %1 ms").arg(elapsed)));
+}
+
+void TestAudioSource::testInvalidWav()
+{
+    QTemporaryFile notWav;
+    writeFile(notWav, QByteArray("this is not a WAV file"));
+    QVERIFY_THROWS_EXCEPTION(AudioSourceException,
+                             WavFileSource(notWav.fileName(), false, false));
+
+    // 12-bit samples are not supported
+    QTemporaryFile unsupported;
+    writeFile(unsupported, makeWav(makePcmFormat(0x0001, 1, 44100, 12), QByteArray(4, '\0')));
+    QVERIFY_THROWS_EXCEPTION(AudioSourceException,
+                             WavFileSource(unsupported.fileName(), false, false));
+
+    // a chunk size that wraps the offset around in 32 bits must not loop forever
+    QByteArray wrapping("RIFF");
+    appendLE32(wrapping, 4 + 8 + 16 + 8);
+    wrapping.append("WAVE");
+    wrapping.append("fmt ");
+    appendLE32(wrapping, 16);
+    wrapping.append(makePcmFormat(0x0001, 1, 44100, 16));
+    wrapping.append("LIST");
+    appendLE32(wrapping, 0xFFFFFFF8);
+    QTemporaryFile wrappingFile;
+    writeFile(wrappingFile, wrapping);
+    QVERIFY_THROWS_EXCEPTION(AudioSourceException,
+                             WavFileSource(wrappingFile.fileName(), false, false));
+
+    QVERIFY_THROWS_EXCEPTION(AudioSourceException,
+                             WavFileSource("/nonexistent/file.wav", false, false));
+}
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <QTest>
+#include <QObject>
+
+class TestAudioSource : public QObject
+{
+    Q_OBJECT
+private slots:
+    void testWav16BitStereo();
+    void testWavExtensibleFloat();
+    void testWavLoop();
+    void testWavRealTime();
+    void testInvalidWav();
+};
@@ -0,0 +1,169 @@
+#include "tst_callbacktelemetrytest.h"
+
+#include "callbacktelemetry.h"
+
+#include <cmath>
+#include <thread>
+#include <portaudio.h>
+#include <QString>
+
+QTEST_MAIN(TestCallbackTelemetry)
+
+static CallbackRecord makeRecord(double callbackTime, uint32_t frameCount)
+{
+    CallbackRecord record{};
+    record.callbackTime = callbackTime;
+    record.adcTime = callbackTime;
+    record.frameCount = frameCount;
+    record.coreKeptUp = true;
+    return record;
+}
+
+void TestCallbackTelemetry::testQueueOrder()
+{
+    CallbackTelemetryQueue queue(4);
+    CallbackRecord record;
+    QVERIFY(!queue.pop(record));
+
+    for (uint32_t round = 0; round < 3; ++round) {
+        for (uint32_t i = 0; i < 3; ++i) {
+            QVERIFY(queue.push(makeRecord(0.0, round * 3 + i)));
+        }
+        for (uint32_t i = 0; i < 3; ++i) {
+            QVERIFY(queue.pop(record));
+            QCOMPARE(record.frameCount, round * 3 + i);
+        }
+        QVERIFY(!queue.pop(record));
+    }
+    QCOMPARE(queue.getDropped(), uint64_t(0));
+}
+
+void TestCallbackTelemetry::testQueueDropsWhenFull()
+{
+    CallbackTelemetryQueue queue(3);
+    QCOMPARE(queue.getCapacity(), size_t(4));
+
+    for (uint32_t i = 0; i < 6; ++i) {
+        QCOMPARE(queue.push(makeRecord(0.0, i)), i < 4);
+    }
+    QCOMPARE(queue.getDropped(), uint64_t(2));
+
+    // the oldest records are kept
+    CallbackRecord record;
+    for (uint32_t i = 0; i < 4; ++i) {
+        QVERIFY(queue.pop(record));
+        QCOMPARE(record.frameCount, i);
+    }
+    QVERIFY(!queue.pop(record));
+}
+
+void TestCallbackTelemetry::testConcurrentQueue()
+{
+    // Every record that is not dropped must come out once, in order, intact.
+    const uint32_t totalRecords = 2'000'000;
+    CallbackTelemetryQueue queue(64);
+
+    std::thread producer([&]() {
+        for (uint32_t i = 0; i < totalRecords; ++i) {
+            CallbackRecord record = makeRecord(i, i);
+            record.pendingFrames = i;
+            queue.push(record);
+        }
+    });
+
+    uint64_t received = 0;
+    int64_t last = -1;
+    bool intact = true;
+    CallbackRecord record;
+    auto drain = [&]() {
+        while (queue.pop(record)) {
+            if ((int64_t)record.frameCount <= last || record.pendingFrames != record.frameCount
+                || record.callbackTime != record.frameCount) {
+                intact = false;
+            }
+            last = record.frameCount;
+            received++;
+        }
+    };
+    while (last + 1 < (int64_t)totalRecords && intact) {
+        drain();
+        if (received + queue.getDropped() == totalRecords) {
+            break;
+        }
+    }
+    producer.join();
+    drain();
+
+    QVERIFY(intact);
+    QCOMPARE(received + queue.getDropped(), uint64_t(totalRecords));
+}
+
+void TestCallbackTelemetry::testHistogram()
+{
+    Histogram histogram(0.0, 10.0, 10);
+    QCOMPARE(histogram.getQuantile(0.5), 0.0);
+
+    for (int i = 0; i < 100; ++i) {
+        histogram.add(i * 0.1);
+    }
+    histogram.add(-1.0);
+    histogram.add(25.0);
+
+    QCOMPARE(histogram.getCount(), uint64_t(102));
+    QCOMPARE(histogram.getBelow(), uint64_t(1));
+    QCOMPARE(histogram.getAbove(), uint64_t(1));
+    QCOMPARE(histogram.getBinCount(0), uint64_t(10));
+    QCOMPARE(histogram.getMin(), -1.0);
+    QCOMPARE(histogram.getMax(), 25.0);
+
+    // quantiles are bounded by the upper edge of their bin
+    QCOMPARE(histogram.getQuantile(0.0), 0.0);
+    QCOMPARE(histogram.getQuantile(0.5), 5.0);
+    QCOMPARE(histogram.getQuantile(0.98), 10.0);
+    QCOMPARE(histogram.getQuantile(1.0), 25.0);
+
+    histogram.reset();
+    QCOMPARE(histogram.getCount(), uint64_t(0));
+    QCOMPARE(histogram.getBinCount(0), uint64_t(0));
+}
+
+void TestCallbackTelemetry::testStatistics()
+{
+    const double sampleFrequency = 48000.0;
+    CallbackStatistics statistics(sampleFrequency);
+
+    // callbacks of 480 frames, due every 10 ms, the third one 2 ms late
+    const double times[] = { 0.0, 0.010, 0.022, 0.030 };
+    for (int i = 0; i < 4; ++i) {
+        CallbackRecord record = makeRecord(times[i], 480);
+        record.duration = 20e-6;
+        if (i == 1) {
+            record.statusFlags = paInputOverflow;
+        }
+        if (i == 3) {
+            record.coreKeptUp = false;
+        }
+        statistics.add(record);
+    }
+    statistics.addSkippedFrames(100);
+
+    QCOMPARE(statistics.getCallbacks(), uint64_t(4));
+    QCOMPARE(statistics.getFrames(), uint64_t(4 * 480));
+    QCOMPARE(statistics.getInputOverflows(), uint64_t(1));
+    QCOMPARE(statistics.getInputUnderflows(), uint64_t(0));
+    QCOMPARE(statistics.getLateCallbacks(), uint64_t(1));
+    QCOMPARE(statistics.getSkippedFrames(), uint64_t(100));
+
+    // three intervals: on time, 2 ms late, 2 ms early
+    const Histogram &jitter = statistics.getJitter();
+    QCOMPARE(jitter.getCount(), uint64_t(3));
+    QVERIFY(std::fabs(jitter.getMax() - 2e-3) < 1e-9);
+    QVERIFY(std::fabs(jitter.getMin() + 2e-3) < 1e-9);
+    QCOMPARE(statistics.getDuration().getCount(), uint64_t(4));
+
+    // the interval to the next callback is still measured after a reset
+    statistics.reset();
+    statistics.add(makeRecord(0.040, 480));
+    QCOMPARE(statistics.getCallbacks(), uint64_t(1));
+    QCOMPARE(statistics.getJitter().getCount(), uint64_t(1));
+}
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <QTest>
+#include <QObject>
+
+class TestCallbackTelemetry : public QObject
+{
+    Q_OBJECT
+private slots:
+    void testQueueOrder();
+    void testQueueDropsWhenFull();
+    void testConcurrentQueue();
+    void testHistogram();
+    void testStatistics();
+};
@@ -0,0 +1,166 @@
+#include "tst_capitest.h"
+
+#include "qpitch_capi.h"
+#include "signalgenerator.h"
+
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <vector>
+
+QTEST_MAIN(TestCApi)
+
+static const uint32_t SAMPLE_FREQUENCY = 44100;
+
+/// A configuration of small frames, for the tests to run fast.
+static qpitch_config makeConfig()
+{
+    qpitch_config config;
+    qpitch_config_init(&config, sizeof(config));
+    config.sample_frequency = SAMPLE_FREQUENCY;
+    config.frame_size = 2048;
+    config.hop = 512;
+    return config;
+}
+
+static std::vector<float> generate(double frequency, size_t count)
+{
+    SignalParameters parameters;
+    parameters.frequency = frequency;
+    parameters.numHarmonics = 4;
+    SignalGenerator generator(parameters, SAMPLE_FREQUENCY);
+    std::vector<float> samples(count);
+    generator.generate(samples.data(), samples.size());
+    return samples;
+}
+
+void TestCApi::testInvalidConfig()
+{
+    qpitch_config config = makeConfig();
+    config.frame_size = 0;
+    QVERIFY(qpitch_create(&config) == nullptr);
+
+    config = makeConfig();
+    config.engine = (qpitch_engine)4;
+    QVERIFY(qpitch_create(&config) == nullptr);
+
+    config = makeConfig();
+    config.reference_frequency = 0.0;
+    QVERIFY(qpitch_create(&config) == nullptr);
+
+    // a configuration smaller than the first version, or from a later version
+    config = makeConfig();
+    config.struct_size = offsetof(qpitch_config, notation);
+    QVERIFY(qpitch_create(&config) == nullptr);
+    config.struct_size = sizeof(qpitch_config) + sizeof(double);
+    QVERIFY(qpitch_create(&config) == nullptr);
+
+    QVERIFY(qpitch_create(nullptr) == nullptr);
+    qpitch_destroy(nullptr);
+}
+
+void TestCApi::testConfigSize()
+{
+    // the initialization of a smaller struct does not write past its end
+    const size_t v1Size = offsetof(qpitch_config, notation) + sizeof(qpitch_config::notation);
+    const size_t partialSize = offsetof(qpitch_config, reference_frequency);
+    qpitch_config config;
+    memset(&config, 0xa5, sizeof(config));
+    qpitch_config_init(&config, partialSize);
+    QCOMPARE(config.struct_size, partialSize);
+    QCOMPARE(config.interpolation, QPITCH_INTERPOLATION_SINC);
+    const unsigned char *bytes = reinterpret_cast<const unsigned char *>(&config);
+    for (size_t i = partialSize; i < sizeof(config); ++i) {
+        QCOMPARE(bytes[i], (unsigned char)0xa5);
+    }
+
+    // a caller of the first version is accepted
+    config = makeConfig();
+    config.struct_size = v1Size;
+    qpitch_detector *detector = qpitch_create(&config);
+    QVERIFY(detector != nullptr);
+    qpitch_destroy(detector);
+}
+
+void TestCApi::testPushAndPull()
+{
+    qpitch_config config = makeConfig();
+    qpitch_detector *detector = qpitch_create(&config);
+    QVERIFY(detector != nullptr);
+
+    qpitch_estimate estimate;
+    QCOMPARE(qpitch_pull(detector, &estimate), 0);
+
+    // nothing to analyse before the first full frame
+    std::vector<float> samples = generate(196.0, 2048 + 3 * 512);
+    QCOMPARE(qpitch_push(detector, samples.data(), 2047), size_t(0));
+    QCOMPARE(qpitch_pull(detector, &estimate), 0);
+
+    // then a frame every hop
+    QCOMPARE(qpitch_push(detector, samples.data() + 2047, samples.size() - 2047), size_t(4));
+    QCOMPARE(qpitch_pull(detector, &estimate), 1);
+    QCOMPARE(qpitch_pull(detector, &estimate), 0);
+
+    QCOMPARE(estimate.position, uint64_t(samples.size()));
+    QVERIFY(estimate.has_note);
+    QCOMPARE(estimate.note, 10); // G
+    QCOMPARE(estimate.octave, 3);
+    QVERIFY2(std::fabs(estimate.frequency - 196.0) < 0.5,
+             qPrintable(QString::number(estimate.frequency)));
+    QVERIFY(std::fabs(estimate.cents) < 5.0);
+    QCOMPARE(std::round(estimate.note_frequency * 100.0) / 100.0, 196.0);
+
+    // after a reset, a whole frame is needed again
+    qpitch_reset(detector);
+    QCOMPARE(qpitch_push(detector, samples.data(), 2047), size_t(0));
+    QCOMPARE(qpitch_push(detector, samples.data() + 2047, 1), size_t(1));
+    QCOMPARE(qpitch_pull(detector, &estimate), 1);
+    QCOMPARE(estimate.position, uint64_t(2048));
+
+    qpitch_destroy(detector);
+}
+
+void TestCApi::testBlockSizeIndependence()
+{
+    for (qpitch_engine engine : { QPITCH_ENGINE_AUTOCORRELATION, QPITCH_ENGINE_YIN,
+                                  QPITCH_ENGINE_MCLEOD, QPITCH_ENGINE_SLIDING_DFT }) {
+        qpitch_config config = makeConfig();
+        config.engine = engine;
+        qpitch_detector *whole = qpitch_create(&config);
+        qpitch_detector *blocks = qpitch_create(&config);
+
+        std::vector<float> samples = generate(330.0, 20000);
+        qpitch_push(whole, samples.data(), samples.size());
+        for (size_t i = 0; i < samples.size();) {
+            size_t count = std::min<size_t>(1 + i % 701, samples.size() - i);
+            qpitch_push(blocks, samples.data() + i, count);
+            i += count;
+        }
+
+        qpitch_estimate expected;
+        qpitch_estimate actual;
+        QCOMPARE(qpitch_pull(whole, &expected), 1);
+        QCOMPARE(qpitch_pull(blocks, &actual), 1);
+        QCOMPARE(actual.position, expected.position);
+        QCOMPARE(actual.frequency, expected.frequency);
+        QVERIFY(std::fabs(actual.frequency - 330.0) < 1.0);
+
+        qpitch_destroy(whole);
+        qpitch_destroy(blocks);
+    }
+}
+
+void TestCApi::testNoteNames()
+{
+    qpitch_config config = makeConfig();
+    config.notation = QPITCH_NOTATION_GERMAN;
+    qpitch_detector *detector = qpitch_create(&config);
+
+    QCOMPARE(qpitch_note_name(detector, 2, 0), "H");
+    QCOMPARE(qpitch_note_name(detector, 4, 0), "C♯");
+    QCOMPARE(qpitch_note_name(detector, 4, 1), "D♭");
+    QVERIFY(qpitch_note_name(detector, 12, 0) == nullptr);
+    QVERIFY(std::strlen(qpitch_version()) > 0);
+
+    qpitch_destroy(detector);
+}
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <QTest>
+#include <QObject>
+
+class TestCApi : public QObject
+{
+    Q_OBJECT
+private slots:
+    void testInvalidConfig();
+    void testConfigSize();
+    void testPushAndPull();
+    void testBlockSizeIndependence();
+    void testNoteNames();
+};
@@ -0,0 +1,144 @@
+#include "tst_detectorpooltest.h"
+
+#include "bufferarena.h"
+#include "detectorpool.h"
+#include "signalgenerator.h"
+
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+QTEST_MAIN(TestDetectorPool)
+
+static const uint32_t SAMPLE_FREQUENCY = 44100;
+
+static PitchDetectorConfig makeConfig(PitchDetectorEngine engine, size_t fftFrameSize,
+                                      int zeroPaddingFactor)
+{
+    return PitchDetectorConfig{ engine, SAMPLE_FREQUENCY, fftFrameSize, zeroPaddingFactor,
+                                PeakInterpolation::Sinc };
+}
+
+static std::vector<float> makeTone(double frequency, size_t size)
+{
+    SignalParameters parameters;
+    parameters.frequency = frequency;
+    SignalGenerator generator(parameters, SAMPLE_FREQUENCY);
+    std::vector<float> samples(size);
+    generator.generate(samples.data(), samples.size());
+    return samples;
+}
+
+void TestDetectorPool::testArena()
+{
+    // buffers of odd sizes are still aligned, one after the other
+    BufferArena arena(BufferArena::alignedSize(3 * sizeof(float))
+                      + BufferArena::alignedSize(100 * sizeof(double))
+                      + BufferArena::alignedSize(1 * sizeof(char)));
+    float *a = arena.allocate<float>(3);
+    double *b = arena.allocate<double>(100);
+    char *c = arena.allocate<char>(1);
+
+    for (uintptr_t address : { (uintptr_t)a, (uintptr_t)b, (uintptr_t)c }) {
+        QCOMPARE(address % BufferArena::ALIGNMENT, (uintptr_t)0);
+    }
+    QVERIFY((char *)b >= (char *)(a + 3));
+    QVERIFY(c >= (char *)(b + 100));
+    QCOMPARE(arena.getCapacity(), (size_t)((char *)c - (char *)a) + BufferArena::ALIGNMENT);
+    QVERIFY(!arena.usesHugePages());
+}
+
+void TestDetectorPool::testHugePages()
+{
+    BufferArena::setHugePages(true);
+    BufferArena large(BufferArena::HUGE_PAGE_SIZE + 1);
+    BufferArena small(BufferArena::HUGE_PAGE_SIZE / 2);
+    BufferArena::setHugePages(false);
+
+    // whether the system has huge pages is not ours to decide, but small arenas never ask
+    QVERIFY(!small.usesHugePages());
+    double *buffer = large.allocate<double>((BufferArena::HUGE_PAGE_SIZE + 1) / sizeof(double));
+    buffer[0] = 1.0;
+    QCOMPARE((uintptr_t)buffer % BufferArena::ALIGNMENT, (uintptr_t)0);
+    qDebug("huge pages: %s", large.usesHugePages() ? "yes" : "no");
+
+    // a context on huge pages estimates like any other
+    BufferArena::setHugePages(true);
+    PitchDetectionContext<double> context(SAMPLE_FREQUENCY, 8192, 80, PeakInterpolation::Sinc);
+    BufferArena::setHugePages(false);
+    std::vector<float> tone = makeTone(440.0, 8192);
+    context.loadSamples(tone.data(), tone.size());
+    QVERIFY(std::fabs(context.runPitchDetectionAlgorithm() - 440.0) < 0.5);
+}
+
+void TestDetectorPool::testReuse()
+{
+    PitchDetectorPool<double> pool;
+    PitchDetectorConfig config = makeConfig(PitchDetectorEngine::Autocorrelation, 4096, 2);
+
+    bool reused = true;
+    std::unique_ptr<PitchDetector<double>> detector = pool.acquire(config, &reused);
+    QVERIFY(!reused);
+    PitchDetector<double> *first = detector.get();
+
+    pool.release(config, std::move(detector));
+    QCOMPARE(pool.getIdleCount(), (size_t)1);
+
+    // another configuration gets another detector
+    std::unique_ptr<PitchDetector<double>> other =
+            pool.acquire(makeConfig(PitchDetectorEngine::Autocorrelation, 4096, 4), &reused);
+    QVERIFY(!reused);
+    QCOMPARE(other->getOutFrameSize(), (size_t)4096 * 4);
+
+    // and the first configuration its own again
+    detector = pool.acquire(config, &reused);
+    QVERIFY(reused);
+    QCOMPARE(detector.get(), first);
+    QCOMPARE(pool.getIdleCount(), (size_t)0);
+}
+
+void TestDetectorPool::testEviction()
+{
+    PitchDetectorPool<double> pool;
+    const size_t numConfigs = PitchDetectorPool<double>::MAX_IDLE_DETECTORS + 1;
+    for (size_t i = 0; i < numConfigs; ++i) {
+        PitchDetectorConfig config =
+                makeConfig(PitchDetectorEngine::Autocorrelation, 1024, 1 + (int)i);
+        pool.release(config, pool.acquire(config));
+    }
+    QCOMPARE(pool.getIdleCount(), PitchDetectorPool<double>::MAX_IDLE_DETECTORS);
+
+    // the least recently released one was freed
+    bool reused = true;
+    pool.acquire(makeConfig(PitchDetectorEngine::Autocorrelation, 1024, 1), &reused);
+    QVERIFY(!reused);
+    pool.acquire(makeConfig(PitchDetectorEngine::Autocorrelation, 1024, (int)numConfigs),
+                 &reused);
+    QVERIFY(reused);
+
+    pool.clear();
+    QCOMPARE(pool.getIdleCount(), (size_t)0);
+}
+
+void TestDetectorPool::testResetOnReuse()
+{
+    // the sliding DFT keeps its bins between frames: a reused one must not slide from the bins
+    // of its previous stream
+    const size_t fftFrameSize = 4096;
+    const size_t hop = 512;
+    PitchDetectorPool<double> pool;
+    PitchDetectorConfig config = makeConfig(PitchDetectorEngine::SlidingDft, fftFrameSize, 1);
+
+    std::unique_ptr<PitchDetector<double>> detector = pool.acquire(config);
+    std::vector<float> low = makeTone(220.0, fftFrameSize);
+    detector->loadSamples(low.data(), low.size());
+    QVERIFY(std::fabs(detector->runPitchDetectionAlgorithm() - 220.0) < 1.0);
+    pool.release(config, std::move(detector));
+
+    bool reused = false;
+    detector = pool.acquire(config, &reused);
+    QVERIFY(reused);
+    std::vector<float> high = makeTone(330.0, fftFrameSize);
+    detector->slideSamples(high.data(), high.size(), hop);
+    QVERIFY(std::fabs(detector->runPitchDetectionAlgorithm() - 330.0) < 1.0);
+}
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <QTest>
+#include <QObject>
+
+class TestDetectorPool : public QObject
+{
+    Q_OBJECT
+private slots:
+    void testArena();
+    void testHugePages();
+    void testReuse();
+    void testEviction();
+    void testResetOnReuse();
+};
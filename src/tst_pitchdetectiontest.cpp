@@ -0,0 +1,451 @@
+#include "tst_pitchdetectiontest.h"
+
+#include "pitchdetection.h"
+#include "signalgenerator.h"
+
+#include <cmath>
+#include <vector>
+#include <QString>
+
+QTEST_MAIN(TestPitchDetection)
+
+static const uint32_t SAMPLE_FREQUENCY = 44100;
+
+/// Frequencies spanning the range accepted by TuningParameters::estimateNote.
+static const double TEST_FREQUENCIES[] = { 41.2, 82.41, 110.0, 196.0, 329.63,
+                                           440.0, 445.3, 880.0, 1318.5, 1975.5 };
+
+/// A tone with three harmonics of decreasing amplitude.
+static std::vector<float> makeTone(double frequency, size_t size)
+{
+    std::vector<float> samples(size);
+    for (size_t i = 0; i < size; i++) {
+        double t = (double)i / SAMPLE_FREQUENCY;
+        samples[i] = 0.5 * sin(2 * M_PI * frequency * t)
+                + 0.25 * sin(2 * M_PI * 2 * frequency * t + 0.3)
+                + 0.125 * sin(2 * M_PI * 3 * frequency * t + 1.1);
+    }
+    return samples;
+}
+
+template <class Real = double>
+static double estimate(double frequency, size_t fftFrameSize, int zeroPaddingFactor,
+                       PeakInterpolation peakInterpolation)
+{
+    PitchDetectionContext<Real> context(SAMPLE_FREQUENCY, fftFrameSize, zeroPaddingFactor,
+                                        peakInterpolation);
+    std::vector<float> samples = makeTone(frequency, fftFrameSize);
+    context.loadSamples(samples.data(), samples.size());
+    return context.runPitchDetectionAlgorithm();
+}
+
+static double cents(double estimated, double expected)
+{
+    return 1200.0 * log2(estimated / expected);
+}
+
+static void addFrequencyRows(int fftFrameSize)
+{
+    for (double frequency : TEST_FREQUENCIES) {
+        QTest::newRow(qPrintable(QString("%1 Hz, %2 frames").arg(frequency).arg(fftFrameSize)))
+                << frequency << fftFrameSize;
+    }
+}
+
+void TestPitchDetection::testReferenceAccuracy_data()
+{
+    QTest::addColumn<double>("frequency");
+    QTest::addColumn<int>("fftFrameSize");
+    addFrequencyRows(4096);
+    addFrequencyRows(8192);
+}
+
+void TestPitchDetection::testReferenceAccuracy()
+{
+    QFETCH(double, frequency);
+    QFETCH(int, fftFrameSize);
+
+    // The Hann window biases the autocorrelation peak towards shorter lags, so low notes with few
+    // periods in the frame read sharp.  This documents the accuracy of the original 80x padding:
+    // about 20 cents at 41 Hz with 4096 frames, within 3 cents from 110 Hz up.
+    double error = cents(estimate(frequency, fftFrameSize, 80, PeakInterpolation::None), frequency);
+    double tolerance = frequency < 100.0 ? 25.0 : 3.0;
+    QVERIFY2(std::fabs(error) < tolerance, qPrintable(QString("error: %1 cents").arg(error)));
+}
+
+void TestPitchDetection::testRefinedAccuracy_data()
+{
+    QTest::addColumn<double>("frequency");
+    QTest::addColumn<int>("fftFrameSize");
+    QTest::addColumn<int>("zeroPaddingFactor");
+    QTest::addColumn<int>("peakInterpolation");
+
+    const std::pair<PeakInterpolation, const char *> methods[] = {
+        { PeakInterpolation::Parabolic, "parabolic" },
+        { PeakInterpolation::Gaussian, "gaussian" },
+        { PeakInterpolation::Sinc, "sinc" },
+    };
+
+    for (int zeroPaddingFactor : { 1, 2 }) {
+        for (const auto &[method, name] : methods) {
+            for (double frequency : TEST_FREQUENCIES) {
+                QTest::newRow(qPrintable(
+                        QString("%1 Hz, %2x, %3").arg(frequency).arg(zeroPaddingFactor).arg(name)))
+                        << frequency << 4096 << zeroPaddingFactor << (int)method;
+            }
+        }
+    }
+}
+
+void TestPitchDetection::testRefinedAccuracy()
+{
+    QFETCH(double, frequency);
+    QFETCH(int, fftFrameSize);
+    QFETCH(int, zeroPaddingFactor);
+    QFETCH(int, peakInterpolation);
+
+    // A refined estimate at 1x or 2x must be as accurate as the 80x zero-padded one, give or take
+    // half a cent (the lag quantization of 80x alone is worth up to 0.3 cents at 2000 Hz).
+    double referenceError =
+            cents(estimate(frequency, fftFrameSize, 80, PeakInterpolation::None), frequency);
+    double refinedError = cents(
+            estimate(frequency, fftFrameSize, zeroPaddingFactor,
+                     (PeakInterpolation)peakInterpolation),
+            frequency);
+    QVERIFY2(std::fabs(refinedError) <= std::fabs(referenceError) + 0.5,
+             qPrintable(QString("refined error: %1 cents, reference error: %2 cents")
+                                .arg(refinedError)
+                                .arg(referenceError)));
+}
+
+void TestPitchDetection::testNoOctaveErrors_data()
+{
+    QTest::addColumn<double>("frequency");
+    QTest::addColumn<int>("fftFrameSize");
+    addFrequencyRows(4096);
+    addFrequencyRows(8192);
+}
+
+void TestPitchDetection::testNoOctaveErrors()
+{
+    QFETCH(double, frequency);
+    QFETCH(int, fftFrameSize);
+
+    // At 1x the sample nearest to a later peak of the autocorrelation may be higher than the one
+    // nearest to the first peak.  Comparing interpolated heights must still pick the first one.
+    for (PeakInterpolation method : { PeakInterpolation::Parabolic, PeakInterpolation::Sinc }) {
+        double error = cents(estimate(frequency, fftFrameSize, 1, method), frequency);
+        QVERIFY2(std::fabs(error) < 50.0, qPrintable(QString("error: %1 cents").arg(error)));
+    }
+}
+
+void TestPitchDetection::testSinglePrecision_data()
+{
+    QTest::addColumn<double>("frequency");
+    QTest::addColumn<int>("fftFrameSize");
+    addFrequencyRows(4096);
+    addFrequencyRows(16384);
+}
+
+void TestPitchDetection::testSinglePrecision()
+{
+    QFETCH(double, frequency);
+    QFETCH(int, fftFrameSize);
+
+    // The float path must agree with the double one well below what a tuner can show.  The 80x
+    // reference is the most sensitive configuration: its peak is the flattest, so rounding noise
+    // in the autocorrelation moves it the most.
+    const struct {
+        int zeroPaddingFactor;
+        PeakInterpolation peakInterpolation;
+        double tolerance;
+    } configurations[] = {
+        { 80, PeakInterpolation::None, 1.0 },
+        { 2, PeakInterpolation::Parabolic, 0.5 },
+        { 2, PeakInterpolation::Sinc, 0.5 },
+    };
+
+    for (const auto &c : configurations) {
+        double doubleEstimate =
+                estimate<double>(frequency, fftFrameSize, c.zeroPaddingFactor, c.peakInterpolation);
+        double floatEstimate =
+                estimate<float>(frequency, fftFrameSize, c.zeroPaddingFactor, c.peakInterpolation);
+        double difference = cents(floatEstimate, doubleEstimate);
+        QVERIFY2(std::fabs(difference) <= c.tolerance,
+                 qPrintable(QString("%1x, method %2: float differs by %3 cents")
+                                    .arg(c.zeroPaddingFactor)
+                                    .arg((int)c.peakInterpolation)
+                                    .arg(difference)));
+    }
+}
+
+void TestPitchDetection::testEngineAccuracy_data()
+{
+    QTest::addColumn<double>("frequency");
+    QTest::addColumn<int>("fftFrameSize");
+    QTest::addColumn<int>("engine");
+
+    for (PitchDetectorEngine engine : { PitchDetectorEngine::Yin, PitchDetectorEngine::McLeod }) {
+        for (int fftFrameSize : { 4096, 8192 }) {
+            for (double frequency : TEST_FREQUENCIES) {
+                QTest::newRow(qPrintable(QString("%1 Hz, %2 frames, %3")
+                                                 .arg(frequency)
+                                                 .arg(fftFrameSize)
+                                                 .arg(pitchDetectorEngineName(engine))))
+                        << frequency << fftFrameSize << (int)engine;
+            }
+        }
+    }
+}
+
+void TestPitchDetection::testEngineAccuracy()
+{
+    QFETCH(double, frequency);
+    QFETCH(int, fftFrameSize);
+    QFETCH(int, engine);
+
+    // The squared difference function is not windowed, so the low notes are not biased like with
+    // the autocorrelation.  The parabolic interpolation is the limit: about 0.4 cents at 2000 Hz.
+    std::unique_ptr<PitchDetector<double>> detector =
+            PitchDetector<double>::create((PitchDetectorEngine)engine, SAMPLE_FREQUENCY,
+                                          fftFrameSize, 1, PeakInterpolation::None);
+    QCOMPARE((int)detector->getEngine(), engine);
+
+    std::vector<float> samples = makeTone(frequency, fftFrameSize);
+    detector->loadSamples(samples.data(), samples.size());
+    double error = cents(detector->runPitchDetectionAlgorithm(), frequency);
+    QVERIFY2(std::fabs(error) < 1.0, qPrintable(QString("error: %1 cents").arg(error)));
+
+    // silence has no pitch
+    std::vector<float> silence(fftFrameSize, 0.0f);
+    detector->loadSamples(silence.data(), silence.size());
+    QCOMPARE(detector->runPitchDetectionAlgorithm(), 0.0);
+}
+
+void TestPitchDetection::testSquareDifferenceBounds_data()
+{
+    QTest::addColumn<int>("fftFrameSize");
+    QTest::addColumn<int>("engine");
+    QTest::addColumn<bool>("singlePrecision");
+
+    // With 1024 samples the longest lag is half the frame, elsewhere the lag of 40 Hz.
+    for (PitchDetectorEngine engine : { PitchDetectorEngine::Yin, PitchDetectorEngine::McLeod }) {
+        for (int fftFrameSize : { 1024, 4096, 8192 }) {
+            for (bool singlePrecision : { false, true }) {
+                QTest::newRow(qPrintable(QString("%1 frames, %2, %3")
+                                                 .arg(fftFrameSize)
+                                                 .arg(pitchDetectorEngineName(engine))
+                                                 .arg(singlePrecision ? "float" : "double")))
+                        << fftFrameSize << (int)engine << singlePrecision;
+            }
+        }
+    }
+}
+
+template <class Real>
+static double estimateWithEngine(PitchDetectorEngine engine, const std::vector<float> &samples)
+{
+    std::unique_ptr<PitchDetector<Real>> detector = PitchDetector<Real>::create(
+            engine, SAMPLE_FREQUENCY, samples.size(), 1, PeakInterpolation::None);
+    detector->loadSamples(samples.data(), samples.size());
+    return detector->runPitchDetectionAlgorithm();
+}
+
+void TestPitchDetection::testSquareDifferenceBounds()
+{
+    QFETCH(int, fftFrameSize);
+    QFETCH(int, engine);
+    QFETCH(bool, singlePrecision);
+
+    // The energy of the delayed window slides up to the end of the frame, and not one sample
+    // further: a read past the frame fails this test under AddressSanitizer.
+    std::vector<float> samples = makeTone(440.0, fftFrameSize);
+    double estimated = singlePrecision
+            ? estimateWithEngine<float>((PitchDetectorEngine)engine, samples)
+            : estimateWithEngine<double>((PitchDetectorEngine)engine, samples);
+    QVERIFY2(std::fabs(cents(estimated, 440.0)) < 5.0,
+             qPrintable(QString("estimated: %1 Hz").arg(estimated)));
+}
+
+void TestPitchDetection::testSlidingDft_data()
+{
+    QTest::addColumn<double>("frequency");
+    QTest::addColumn<int>("fftFrameSize");
+    addFrequencyRows(4096);
+}
+
+void TestPitchDetection::testSlidingDft()
+{
+    QFETCH(double, frequency);
+    QFETCH(int, fftFrameSize);
+
+    const size_t hop = 512;
+    const size_t numHops = 40;
+    std::vector<float> tone = makeTone(frequency, fftFrameSize + hop * numHops);
+
+    std::unique_ptr<PitchDetector<double>> sliding = PitchDetector<double>::create(
+            PitchDetectorEngine::SlidingDft, SAMPLE_FREQUENCY, fftFrameSize, 1,
+            PeakInterpolation::None);
+    QCOMPARE(sliding->getEngine(), PitchDetectorEngine::SlidingDft);
+
+    sliding->loadSamples(tone.data(), fftFrameSize);
+    for (size_t i = 1; i <= numHops; ++i) {
+        sliding->slideSamples(tone.data() + i * hop, fftFrameSize, hop);
+    }
+    double slidingEstimate = sliding->runPitchDetectionAlgorithm();
+
+    // Sliding the spectrum hop by hop must give the spectrum of the last frame.
+    std::unique_ptr<PitchDetector<double>> fresh = PitchDetector<double>::create(
+            PitchDetectorEngine::SlidingDft, SAMPLE_FREQUENCY, fftFrameSize, 1,
+            PeakInterpolation::None);
+    fresh->loadSamples(tone.data() + numHops * hop, fftFrameSize);
+    double freshEstimate = fresh->runPitchDetectionAlgorithm();
+    QVERIFY2(std::fabs(cents(slidingEstimate, freshEstimate)) < 1e-3,
+             qPrintable(QString("sliding: %1 Hz, fresh: %2 Hz")
+                                .arg(slidingEstimate, 0, 'f', 6)
+                                .arg(freshEstimate, 0, 'f', 6)));
+
+    // It is the windowed autocorrelation of the frame, so it is as accurate as the 80x reference.
+    double referenceError =
+            cents(estimate(frequency, fftFrameSize, 80, PeakInterpolation::None), frequency);
+    double slidingError = cents(freshEstimate, frequency);
+    QVERIFY2(std::fabs(slidingError) <= std::fabs(referenceError) + 0.5,
+             qPrintable(QString("sliding DFT error: %1 cents, reference error: %2 cents")
+                                .arg(slidingError)
+                                .arg(referenceError)));
+
+    // silence has no pitch
+    std::vector<float> silence(fftFrameSize, 0.0f);
+    fresh->loadSamples(silence.data(), silence.size());
+    QCOMPARE(fresh->runPitchDetectionAlgorithm(), 0.0);
+}
+
+void TestPitchDetection::testSyntheticSignals_data()
+{
+    QTest::addColumn<int>("engine");
+    QTest::addColumn<QString>("signal");
+
+    // Stiff strings, vibrato, noise and glides: the estimate is compared with the frequency of
+    // the fundamental partial in the middle of the frame.
+    const char *specs[] = {
+        "freq=110,harmonics=12,inharmonicity=0.0004,decay=3",
+        "freq=329.63,harmonics=4,vibrato=5:15",
+        "freq=196,harmonics=6,noise=pink:10",
+        "freq=220,harmonics=3,sweep=440:2",
+    };
+    for (PitchDetectorEngine engine :
+         { PitchDetectorEngine::Autocorrelation, PitchDetectorEngine::Yin,
+           PitchDetectorEngine::McLeod, PitchDetectorEngine::SlidingDft }) {
+        for (const char *signal : specs) {
+            QTest::newRow(qPrintable(
+                    QString("%1, %2").arg(pitchDetectorEngineName(engine)).arg(signal)))
+                    << (int)engine << QString(signal);
+        }
+    }
+}
+
+void TestPitchDetection::testSyntheticSignals()
+{
+    QFETCH(int, engine);
+    QFETCH(QString, signal);
+
+    std::string error;
+    std::optional<SignalParameters> parameters =
+            SignalParameters::parse(signal.toStdString(), &error);
+    QVERIFY2(parameters.has_value(), error.c_str());
+
+    // the frame ends half a second into the signal
+    const size_t fftFrameSize = 4096;
+    SignalGenerator generator(*parameters, SAMPLE_FREQUENCY);
+    std::vector<float> samples(SAMPLE_FREQUENCY / 2 + fftFrameSize);
+    generator.generate(samples.data(), samples.size());
+    double expected = generator.getFrequencyAt(samples.size() - fftFrameSize / 2);
+
+    std::unique_ptr<PitchDetector<double>> detector =
+            PitchDetector<double>::create((PitchDetectorEngine)engine, SAMPLE_FREQUENCY,
+                                          fftFrameSize, 2, PeakInterpolation::Sinc);
+    detector->loadSamples(samples.data() + samples.size() - fftFrameSize, fftFrameSize);
+    double estimated = detector->runPitchDetectionAlgorithm();
+
+    QVERIFY2(std::fabs(cents(estimated, expected)) < 10.0,
+             qPrintable(QString("estimated %1 Hz, expected %2 Hz")
+                                .arg(estimated, 0, 'f', 3)
+                                .arg(expected, 0, 'f', 3)));
+}
+
+void TestPitchDetection::testBatch_data()
+{
+    QTest::addColumn<int>("zeroPaddingFactor");
+    QTest::addColumn<int>("peakInterpolation");
+
+    // with 80x padding the frames are too large to be transformed more than one at a time
+    for (int zeroPaddingFactor : { 1, 2, 80 }) {
+        for (PeakInterpolation peakInterpolation :
+             { PeakInterpolation::None, PeakInterpolation::Parabolic, PeakInterpolation::Sinc }) {
+            QTest::newRow(qPrintable(QString("%1x, interpolation %2")
+                                             .arg(zeroPaddingFactor)
+                                             .arg((int)peakInterpolation)))
+                    << zeroPaddingFactor << (int)peakInterpolation;
+        }
+    }
+}
+
+void TestPitchDetection::testBatch()
+{
+    QFETCH(int, zeroPaddingFactor);
+    QFETCH(int, peakInterpolation);
+
+    // a glide, so that every frame has its own pitch, and a number of frames that is not a
+    // multiple of the batches
+    const size_t fftFrameSize = 4096;
+    const size_t hop = 700;
+    const size_t numFrames = 37;
+    std::optional<SignalParameters> parameters =
+            SignalParameters::parse("freq=196,harmonics=4,sweep=392:1", nullptr);
+    QVERIFY(parameters.has_value());
+    SignalGenerator generator(*parameters, SAMPLE_FREQUENCY);
+    std::vector<float> samples((numFrames - 1) * hop + fftFrameSize);
+    generator.generate(samples.data(), samples.size());
+
+    PitchDetectionContext<double> context(SAMPLE_FREQUENCY, fftFrameSize, zeroPaddingFactor,
+                                          (PeakInterpolation)peakInterpolation);
+    std::vector<double> frequencies(numFrames);
+    context.runBatch(samples.data(), hop, numFrames, frequencies.data());
+    QVERIFY(context.getBatchFrames() >= 1);
+
+    // the batches must give the estimates of the frames analysed one by one
+    for (size_t i = 0; i < numFrames; ++i) {
+        context.loadSamples(samples.data() + i * hop, fftFrameSize);
+        double expected = context.runPitchDetectionAlgorithm();
+        QVERIFY2(std::fabs(cents(frequencies[i], expected)) < 1e-6,
+                 qPrintable(QString("frame %1: batch %2 Hz, single %3 Hz")
+                                    .arg(i)
+                                    .arg(frequencies[i], 0, 'f', 6)
+                                    .arg(expected, 0, 'f', 6)));
+    }
+}
+
+void TestPitchDetection::testPlanSlot()
+{
+    const size_t fftFrameSize = 4096;
+    std::vector<float> samples = makeTone(440.0, fftFrameSize);
+    PitchDetectionContext<double> context(SAMPLE_FREQUENCY, fftFrameSize, 2,
+                                          PeakInterpolation::Parabolic);
+    std::shared_ptr<PitchDetectionPlanSlot<double>> slot = context.getPlanSlot();
+
+    // the plans replaced by the context come back through the slot
+    slot->offer(PitchDetectionPlans<double>::create(fftFrameSize, context.getOutFrameSize(),
+                                                    PlanSource::Measure));
+    context.loadSamples(samples.data(), fftFrameSize);
+    QVERIFY(std::fabs(cents(context.runPitchDetectionAlgorithm(), 440.0)) < 5.0);
+    QVERIFY(slot->pending.load() == nullptr);
+    QVERIFY(slot->retired.load() != nullptr);
+
+    // and are destroyed by the thread offering the next ones
+    slot->offer(PitchDetectionPlans<double>::create(fftFrameSize, context.getOutFrameSize(),
+                                                    PlanSource::Measure));
+    QVERIFY(slot->retired.load() == nullptr);
+    QVERIFY(std::fabs(cents(context.runPitchDetectionAlgorithm(), 440.0)) < 5.0);
+    QVERIFY(slot->pending.load() == nullptr);
+    QVERIFY(slot->retired.load() != nullptr);
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <QTest>
+#include <QObject>
+
+class TestPitchDetection : public QObject
+{
+    Q_OBJECT
+private slots:
+    void testReferenceAccuracy_data();
+    void testReferenceAccuracy();
+    void testRefinedAccuracy_data();
+    void testRefinedAccuracy();
+    void testNoOctaveErrors_data();
+    void testNoOctaveErrors();
+    void testSinglePrecision_data();
+    void testSinglePrecision();
+    void testEngineAccuracy_data();
+    void testEngineAccuracy();
+    void testSquareDifferenceBounds_data();
+    void testSquareDifferenceBounds();
+    void testSlidingDft_data();
+    void testSlidingDft();
+    void testSyntheticSignals_data();
+    void testSyntheticSignals();
+    void testBatch_data();
+    void testBatch();
+    void testPlanSlot();
+};
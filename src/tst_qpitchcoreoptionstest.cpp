@@ -0,0 +1,102 @@
+#include "tst_qpitchcoreoptionstest.h"
+
+#include "qpitchcoreoptions.h"
+
+QTEST_MAIN(TestQPitchCoreOptions)
+
+static const uint32_t SAMPLE_FREQUENCY = 44100;
+
+/// The ring of a stream started with frames of up to 8192 samples.
+static const size_t RING_CAPACITY = 16384;
+
+/// The defaults of the settings.
+static QPitchCoreOptions makeOptions()
+{
+    return QPitchCoreOptions{ SAMPLE_FREQUENCY,
+                              4096,
+                              PitchDetectorEngine::Autocorrelation,
+                              2,
+                              PeakInterpolation::Sinc,
+                              60.0,
+                              0,
+                              TuningParameters(440.0, TuningNotation::US) };
+}
+
+void TestQPitchCoreOptions::testClassifyOptionsChange_data()
+{
+    QTest::addColumn<uint>("sampleFrequency");
+    QTest::addColumn<uint>("sourceFrequency");
+    QTest::addColumn<int>("fftFrameSize");
+    QTest::addColumn<int>("engine");
+    QTest::addColumn<int>("zeroPaddingFactor");
+    QTest::addColumn<int>("peakInterpolation");
+    QTest::addColumn<double>("analysisRate");
+    QTest::addColumn<int>("analysisHop");
+    QTest::addColumn<double>("referenceFrequency");
+    QTest::addColumn<int>("expected");
+
+    const int autocorrelation = (int)PitchDetectorEngine::Autocorrelation;
+    const int sinc = (int)PeakInterpolation::Sinc;
+    const int tuning = (int)QPitchCoreOptionsChange::Tuning;
+    const int analysis = (int)QPitchCoreOptionsChange::Analysis;
+    const int stream = (int)QPitchCoreOptionsChange::Stream;
+
+    QTest::newRow("nothing") << 44100u << 44100u << 4096 << autocorrelation << 2 << sinc << 60.0
+                             << 0 << 440.0 << tuning;
+    QTest::newRow("reference") << 44100u << 44100u << 4096 << autocorrelation << 2 << sinc
+                               << 60.0 << 0 << 442.0 << tuning;
+    QTest::newRow("smaller frame") << 44100u << 44100u << 2048 << autocorrelation << 2 << sinc
+                                   << 60.0 << 0 << 440.0 << analysis;
+    QTest::newRow("frame of half the ring")
+            << 44100u << 44100u << 8192 << autocorrelation << 2 << sinc << 60.0 << 0 << 440.0
+            << analysis;
+    QTest::newRow("engine") << 44100u << 44100u << 4096 << (int)PitchDetectorEngine::Yin << 2
+                            << sinc << 60.0 << 0 << 440.0 << analysis;
+    QTest::newRow("zero padding") << 44100u << 44100u << 4096 << autocorrelation << 8 << sinc
+                                  << 60.0 << 0 << 440.0 << analysis;
+    QTest::newRow("interpolation")
+            << 44100u << 44100u << 4096 << autocorrelation << 2
+            << (int)PeakInterpolation::Parabolic << 60.0 << 0 << 440.0 << analysis;
+    QTest::newRow("analysis rate") << 44100u << 44100u << 4096 << autocorrelation << 2 << sinc
+                                   << 30.0 << 0 << 440.0 << analysis;
+    QTest::newRow("hop") << 44100u << 44100u << 4096 << autocorrelation << 2 << sinc << 60.0
+                         << 512 << 440.0 << analysis;
+    QTest::newRow("sample rate") << 48000u << 48000u << 4096 << autocorrelation << 2 << sinc
+                                 << 60.0 << 0 << 440.0 << stream;
+    // a file keeps its own sample rate, whatever the settings say
+    QTest::newRow("sample rate of a file")
+            << 48000u << 44100u << 4096 << autocorrelation << 2 << sinc << 60.0 << 0 << 440.0
+            << tuning;
+    QTest::newRow("frame larger than the ring")
+            << 44100u << 44100u << 16384 << autocorrelation << 2 << sinc << 60.0 << 0 << 440.0
+            << stream;
+    QTest::newRow("sample rate and frame")
+            << 48000u << 48000u << 2048 << autocorrelation << 2 << sinc << 60.0 << 0 << 440.0
+            << stream;
+}
+
+void TestQPitchCoreOptions::testClassifyOptionsChange()
+{
+    QFETCH(uint, sampleFrequency);
+    QFETCH(uint, sourceFrequency);
+    QFETCH(int, fftFrameSize);
+    QFETCH(int, engine);
+    QFETCH(int, zeroPaddingFactor);
+    QFETCH(int, peakInterpolation);
+    QFETCH(double, analysisRate);
+    QFETCH(int, analysisHop);
+    QFETCH(double, referenceFrequency);
+    QFETCH(int, expected);
+
+    QPitchCoreOptions from = makeOptions();
+    QPitchCoreOptions to{ sampleFrequency,
+                          (size_t)fftFrameSize,
+                          (PitchDetectorEngine)engine,
+                          zeroPaddingFactor,
+                          (PeakInterpolation)peakInterpolation,
+                          analysisRate,
+                          (size_t)analysisHop,
+                          TuningParameters(referenceFrequency, TuningNotation::US) };
+
+    QCOMPARE((int)classifyOptionsChange(from, to, sourceFrequency, RING_CAPACITY), expected);
+}
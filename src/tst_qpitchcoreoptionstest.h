@@ -0,0 +1,12 @@
+#pragma once
+
+#include <QTest>
+#include <QObject>
+
+class TestQPitchCoreOptions : public QObject
+{
+    Q_OBJECT
+private slots:
+    void testClassifyOptionsChange_data();
+    void testClassifyOptionsChange();
+};
@@ -0,0 +1,204 @@
+#include "tst_sampleringtest.h"
+
+#include "samplering.h"
+
+#include <algorithm>
+#include <atomic>
+#include <numeric>
+#include <random>
+#include <thread>
+#include <vector>
+#include <QString>
+
+QTEST_MAIN(TestSampleRing)
+
+static int32_t iotaBuffer[256];
+
+static void checkLast(const SampleRing<int32_t> &ring, size_t count, size_t actualCount,
+                      int32_t iotaStart)
+{
+    int32_t resultBuffer[256]{ 0 };
+    uint64_t end = 0;
+    size_t actualCopied = ring.copyLast(resultBuffer, count, &end);
+    QCOMPARE(actualCopied, actualCount);
+    QCOMPARE(end, ring.getWritePosition());
+
+    for (size_t i = 0; i < actualCount; i++) {
+        QVERIFY2(resultBuffer[i] == iotaStart + (int32_t)i,
+                 qPrintable(QString("different at buffer %1: %2 != %3, count: %4, actualCount: %5")
+                                    .arg(i)
+                                    .arg(resultBuffer[i])
+                                    .arg(iotaStart + (int32_t)i)
+                                    .arg(count)
+                                    .arg(actualCount)));
+    }
+}
+
+void TestSampleRing::initTestCase()
+{
+    std::iota(iotaBuffer, iotaBuffer + 256, 0);
+}
+
+void TestSampleRing::testCapacity()
+{
+    QCOMPARE(SampleRing<int32_t>(0).getCapacity(), size_t(1));
+    QCOMPARE(SampleRing<int32_t>(47).getCapacity(), size_t(64));
+    QCOMPARE(SampleRing<int32_t>(64).getCapacity(), size_t(64));
+}
+
+void TestSampleRing::testShortWrite()
+{
+    SampleRing<int32_t> ring(64);
+    ring.write(iotaBuffer, 30);
+
+    checkLast(ring, 10, 10, 30 - 10);
+    checkLast(ring, 30, 30, 0);
+    checkLast(ring, 50, 30, 0);
+}
+
+void TestSampleRing::testOverwriteOldest()
+{
+    SampleRing<int32_t> ring(64);
+    ring.write(iotaBuffer, 30);
+    ring.write(iotaBuffer + 30, 34);
+    ring.write(iotaBuffer + 64, 13);
+
+    checkLast(ring, 10, 10, 77 - 10);
+    checkLast(ring, 64, 64, 77 - 64);
+    checkLast(ring, 70, 64, 77 - 64);
+}
+
+void TestSampleRing::testLongWrite()
+{
+    SampleRing<int32_t> ring(64);
+    ring.write(iotaBuffer, 30);
+    ring.write(iotaBuffer + 30, 150);
+
+    QCOMPARE(ring.getWritePosition(), uint64_t(180));
+    checkLast(ring, 10, 10, 180 - 10);
+    checkLast(ring, 64, 64, 180 - 64);
+    checkLast(ring, 99, 64, 180 - 64);
+}
+
+void TestSampleRing::testReadPosition()
+{
+    SampleRing<int32_t> ring(64);
+    QCOMPARE(ring.getUnread(), uint64_t(0));
+
+    ring.write(iotaBuffer, 30);
+    QCOMPARE(ring.getUnread(), uint64_t(30));
+
+    int32_t resultBuffer[64];
+    uint64_t end = 0;
+    ring.copyLast(resultBuffer, 16, &end);
+    ring.markRead(end);
+    QCOMPARE(ring.getReadPosition(), uint64_t(30));
+    QCOMPARE(ring.getUnread(), uint64_t(0));
+
+    // the unread count goes on past the capacity
+    ring.write(iotaBuffer, 100);
+    QCOMPARE(ring.getUnread(), uint64_t(100));
+}
+
+void TestSampleRing::testViewIsContiguous()
+{
+    SampleRing<int32_t> ring(1024);
+    std::vector<int32_t> samples(3000);
+    std::iota(samples.begin(), samples.end(), 0);
+
+    // wrap around the end of the storage, whatever its size, several times
+    for (size_t written = 0; written < samples.size(); written += 300) {
+        ring.write(samples.data() + written, 300);
+
+        SampleRing<int32_t>::View view = ring.viewLast(1000);
+        uint64_t end = written + 300;
+        QCOMPARE(view.end, end);
+        QCOMPARE(view.size, std::min<size_t>(1000, end));
+        QCOMPARE(view.first, view.end - view.size);
+        for (size_t i = 0; i < view.size; ++i) {
+            QCOMPARE(view.data[i], (int32_t)(view.first + i));
+        }
+        QVERIFY(ring.isIntact(view));
+    }
+}
+
+void TestSampleRing::testConcurrentStress()
+{
+    // The producer writes consecutive integers in blocks of random sizes, as fast as it can, while
+    // the consumer reads the last samples with random sizes, alternately copying them and reading
+    // them in place.  Every copy, and every view found intact after reading it, must be a run of
+    // consecutive integers ending just before its position, even though the producer laps the
+    // consumer all the time.
+    const size_t capacity = 1024;
+    const size_t maxWrite = 256;
+    const size_t maxCopy = 512;
+    const int32_t totalSamples = 50'000'000;
+
+    SampleRing<int32_t> ring(capacity);
+    std::atomic<bool> producerDone(false);
+
+    std::thread producer([&]() {
+        std::mt19937 random(1);
+        std::uniform_int_distribution<size_t> sizes(1, maxWrite);
+        std::vector<int32_t> block(maxWrite);
+        int32_t next = 0;
+        while (next < totalSamples) {
+            size_t count = std::min<size_t>(sizes(random), totalSamples - next);
+            std::iota(block.begin(), block.begin() + count, next);
+            ring.write(block.data(), count);
+            next += count;
+        }
+        producerDone = true;
+    });
+
+    std::mt19937 random(2);
+    std::uniform_int_distribution<size_t> sizes(1, maxCopy);
+    std::vector<int32_t> copy(maxCopy);
+    uint64_t copies = 0;
+    uint64_t lastEnd = 0;
+    bool intact = true;
+    QString failure;
+    while (intact && !producerDone) {
+        uint64_t end = 0;
+        size_t count = 0;
+        if (copies % 2 == 0) {
+            count = ring.copyLast(copy.data(), sizes(random), &end);
+        } else {
+            SampleRing<int32_t>::View view = ring.viewLast(sizes(random));
+            std::copy(view.data, view.data + view.size, copy.begin());
+            if (!ring.isIntact(view)) {
+                continue;
+            }
+            count = view.size;
+            end = view.end;
+        }
+        if (end < lastEnd || count > end) {
+            intact = false;
+            failure = QString("position went from %1 to %2").arg(lastEnd).arg(end);
+            break;
+        }
+        for (size_t i = 0; i < count; ++i) {
+            int32_t expected = (int32_t)(end - count + i);
+            if (copy[i] != expected) {
+                intact = false;
+                failure = QString("copy %1 ending at %2: sample %3 is %4 instead of %5")
+                                  .arg(copies)
+                                  .arg(end)
+                                  .arg(i)
+                                  .arg(copy[i])
+                                  .arg(expected);
+                break;
+            }
+        }
+        ring.markRead(end);
+        lastEnd = end;
+        copies++;
+    }
+
+    producer.join();
+
+    QVERIFY2(intact, qPrintable(failure));
+    QVERIFY(copies > 0);
+    QCOMPARE(ring.getWritePosition(), uint64_t(totalSamples));
+    checkLast(ring, 256, 256, totalSamples - 256);
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <QTest>
+#include <QObject>
+
+class TestSampleRing : public QObject
+{
+    Q_OBJECT
+private slots:
+    void initTestCase();
+    void testCapacity();
+    void testShortWrite();
+    void testOverwriteOldest();
+    void testLongWrite();
+    void testReadPosition();
+    void testViewIsContiguous();
+    void testConcurrentStress();
+};
@@ -0,0 +1,169 @@
+#include "tst_signalgeneratortest.h"
+
+#include "signalgenerator.h"
+
+#include <cmath>
+#include <vector>
+#include <QString>
+
+QTEST_MAIN(TestSignalGenerator)
+
+static const uint32_t SAMPLE_FREQUENCY = 44100;
+
+static std::vector<float> generate(const std::string &spec, size_t count)
+{
+    std::string error;
+    std::optional<SignalParameters> parameters = SignalParameters::parse(spec, &error);
+    if (!parameters) {
+        qFatal("%s", error.c_str());
+    }
+    SignalGenerator generator(*parameters, SAMPLE_FREQUENCY);
+    std::vector<float> samples(count);
+    generator.generate(samples.data(), samples.size());
+    return samples;
+}
+
+void TestSignalGenerator::testSine()
+{
+    std::vector<float> samples = generate("freq=440,amp=0.8", 10000);
+    for (size_t i = 0; i < samples.size(); ++i) {
+        float expected = 0.8 * sin(2 * M_PI * 440.0 * i / SAMPLE_FREQUENCY);
+        QVERIFY2(std::fabs(samples[i] - expected) < 1e-5,
+                 qPrintable(QString("sample %1: %2 != %3").arg(i).arg(samples[i]).arg(expected)));
+    }
+}
+
+void TestSignalGenerator::testBlockSizeIndependence()
+{
+    const std::string spec = "freq=110,harmonics=8,inharmonicity=0.0002,vibrato=5:20,decay=1.5,"
+                             "pluck=2,noise=pink:20,seed=7";
+    std::vector<float> whole = generate(spec, 100000);
+
+    std::string error;
+    SignalGenerator generator(*SignalParameters::parse(spec, &error), SAMPLE_FREQUENCY);
+    std::vector<float> blocks(whole.size());
+    for (size_t i = 0; i < blocks.size();) {
+        size_t count = std::min<size_t>(1 + i % 997, blocks.size() - i);
+        generator.generate(blocks.data() + i, count);
+        i += count;
+    }
+    QCOMPARE(generator.getPosition(), uint64_t(whole.size()));
+    QVERIFY(blocks == whole);
+
+    // and again after a reset
+    generator.reset();
+    generator.generate(blocks.data(), blocks.size());
+    QVERIFY(blocks == whole);
+}
+
+void TestSignalGenerator::testSeed()
+{
+    std::vector<float> first = generate("noise=white:0,seed=1", 1000);
+    QVERIFY(first == generate("noise=white:0,seed=1", 1000));
+    QVERIFY(first != generate("noise=white:0,seed=2", 1000));
+}
+
+void TestSignalGenerator::testSignalToNoiseRatio_data()
+{
+    QTest::addColumn<QString>("noise");
+    QTest::addColumn<double>("snr");
+    QTest::newRow("white, 10 dB") << "white" << 10.0;
+    QTest::newRow("white, 30 dB") << "white" << 30.0;
+    QTest::newRow("pink, 10 dB") << "pink" << 10.0;
+    QTest::newRow("pink, 0 dB") << "pink" << 0.0;
+}
+
+void TestSignalGenerator::testSignalToNoiseRatio()
+{
+    QFETCH(QString, noise);
+    QFETCH(double, snr);
+
+    // the noise is the difference from the same signal without noise
+    const size_t count = 1 << 20;
+    const std::string spec = "freq=220,harmonics=4";
+    std::vector<float> clean = generate(spec, count);
+    std::vector<float> noisy = generate(
+            spec + QString(",noise=%1:%2").arg(noise).arg(snr).toStdString(), count);
+
+    double signalPower = 0.0;
+    double noisePower = 0.0;
+    for (size_t i = 0; i < count; ++i) {
+        signalPower += (double)clean[i] * clean[i];
+        noisePower += ((double)noisy[i] - clean[i]) * ((double)noisy[i] - clean[i]);
+    }
+    double measured = 10.0 * log10(signalPower / noisePower);
+    QVERIFY2(std::fabs(measured - snr) < 0.1,
+             qPrintable(QString("measured SNR: %1 dB").arg(measured)));
+}
+
+void TestSignalGenerator::testGroundTruth()
+{
+    std::string error;
+
+    // the fundamental partial of a stiff string is sharp
+    SignalGenerator stiff(*SignalParameters::parse("freq=100,inharmonicity=0.01", &error),
+                          SAMPLE_FREQUENCY);
+    QCOMPARE(stiff.getFrequencyAt(0), 100.0 * sqrt(1.01));
+
+    // an exponential sweep is halfway in cents halfway through
+    SignalGenerator sweep(*SignalParameters::parse("freq=220,sweep=880:2", &error),
+                          SAMPLE_FREQUENCY);
+    QCOMPARE(sweep.getFrequencyAt(0), 220.0);
+    QCOMPARE(sweep.getFrequencyAt(SAMPLE_FREQUENCY), 440.0);
+    QCOMPARE(sweep.getFrequencyAt(4 * SAMPLE_FREQUENCY), 880.0);
+
+    // the vibrato peaks a quarter of its period in
+    SignalGenerator vibrato(*SignalParameters::parse("freq=440,vibrato=5:50", &error),
+                            SAMPLE_FREQUENCY);
+    QCOMPARE(vibrato.getFrequencyAt(SAMPLE_FREQUENCY / 20), 440.0 * pow(2.0, 50.0 / 1200.0));
+
+    // the zero crossings follow the ground truth of a sweep
+    std::vector<float> samples = generate("freq=220,sweep=880:2", 2 * SAMPLE_FREQUENCY);
+    int crossings = 0;
+    for (size_t i = 1; i < samples.size(); ++i) {
+        if (samples[i - 1] < 0.0f && samples[i] >= 0.0f) {
+            crossings++;
+        }
+    }
+    // the number of periods is the integral of the frequency: 660 / ln(4) Hz over 2 s
+    double periods = 2.0 * 660.0 / log(4.0);
+    QVERIFY2(std::fabs(crossings - periods) <= 1.0,
+             qPrintable(QString("%1 crossings, %2 periods").arg(crossings).arg(periods)));
+}
+
+void TestSignalGenerator::testParse()
+{
+    std::string error;
+    std::optional<SignalParameters> parameters = SignalParameters::parse(
+            "freq=82.41,amp=0.3,harmonics=8,rolloff=0.5,inharmonicity=0.0001,sweep=110:3,"
+            "vibrato=6:25,decay=2,pluck=4,noise=pink:20,seed=42",
+            &error);
+    QVERIFY2(parameters.has_value(), error.c_str());
+    QCOMPARE(parameters->frequency, 82.41);
+    QCOMPARE(parameters->amplitude, 0.3);
+    QCOMPARE(parameters->numHarmonics, 8);
+    QCOMPARE(parameters->harmonicRolloff, 0.5);
+    QCOMPARE(parameters->inharmonicity, 0.0001);
+    QCOMPARE(parameters->sweepFrequency, 110.0);
+    QCOMPARE(parameters->sweepDuration, 3.0);
+    QCOMPARE(parameters->vibratoRate, 6.0);
+    QCOMPARE(parameters->vibratoDepth, 25.0);
+    QCOMPARE(parameters->decayTime, 2.0);
+    QCOMPARE(parameters->pluckInterval, 4.0);
+    QCOMPARE(parameters->noise, NoiseKind::Pink);
+    QCOMPARE(parameters->snr, 20.0);
+    QCOMPARE(parameters->seed, uint64_t(42));
+
+    // the defaults
+    parameters = SignalParameters::parse("", &error);
+    QVERIFY(parameters.has_value());
+    QCOMPARE(parameters->frequency, 440.0);
+    QCOMPARE(parameters->noise, NoiseKind::None);
+
+    for (const char *invalid : { "freq=abc", "freq=440Hz", "sweep=3", "noise=brown:10",
+                                 "unknown=1", "harmonics=0", "freq=-1" }) {
+        error.clear();
+        QVERIFY2(!SignalParameters::parse(invalid, &error).has_value(), invalid);
+        QVERIFY(!error.empty());
+    }
+}
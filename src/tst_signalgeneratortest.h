@@ -0,0 +1,17 @@
+#pragma once
+
+#include <QTest>
+#include <QObject>
+
+class TestSignalGenerator : public QObject
+{
+    Q_OBJECT
+private slots:
+    void testSine();
+    void testBlockSizeIndependence();
+    void testSeed();
+    void testSignalToNoiseRatio_data();
+    void testSignalToNoiseRatio();
+    void testGroundTruth();
+    void testParse();
+};
@@ -0,0 +1,261 @@
+#include "tst_simdkernelstest.h"
+
+#include "simdkernels.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <vector>
+#include <QString>
+
+QTEST_MAIN(TestSimdKernels)
+
+/// Lengths around the widths of the vectors, and a frame
+static const size_t LENGTHS[] = { 1, 2, 3, 7, 8, 9, 15, 16, 17, 31, 33, 100, 4096 };
+
+/// One row per instruction set that this processor runs, in single and double precision; the
+/// kernels are compared with the scalar ones.
+static void addLevelRows()
+{
+    QTest::addColumn<int>("level");
+    QTest::addColumn<bool>("singlePrecision");
+
+    for (SimdLevel level : { SimdLevel::Scalar, SimdLevel::Sse2, SimdLevel::Avx2,
+                             SimdLevel::Avx512, SimdLevel::Neon }) {
+        if (SimdKernels<double>::forLevel(level) == nullptr) {
+            continue;
+        }
+        for (bool singlePrecision : { false, true }) {
+            QTest::newRow(qPrintable(QString("%1, %2")
+                                             .arg(simdLevelName(level))
+                                             .arg(singlePrecision ? "float" : "double")))
+                    << (int)level << singlePrecision;
+        }
+    }
+}
+
+template <class Real>
+static bool sameBits(const std::vector<Real> &a, const std::vector<Real> &b)
+{
+    return a.size() == b.size() && memcmp(a.data(), b.data(), a.size() * sizeof(Real)) == 0;
+}
+
+template <class Real>
+static void checkWindow(SimdLevel level)
+{
+    const SimdKernels<Real> &scalar = *SimdKernels<Real>::forLevel(SimdLevel::Scalar);
+    const SimdKernels<Real> &kernels = *SimdKernels<Real>::forLevel(level);
+    std::mt19937 random(1);
+    std::uniform_real_distribution<float> uniform(-1.0f, 1.0f);
+
+    for (size_t n : LENGTHS) {
+        std::vector<float> samples(n);
+        std::vector<Real> window(n);
+        for (size_t i = 0; i < n; ++i) {
+            samples[i] = uniform(random);
+            window[i] = uniform(random);
+        }
+        std::vector<Real> expected(n), actual(n);
+        scalar.windowSamples(samples.data(), window.data(), expected.data(), n);
+        kernels.windowSamples(samples.data(), window.data(), actual.data(), n);
+        QVERIFY2(sameBits(expected, actual), qPrintable(QString("length %1").arg(n)));
+    }
+}
+
+template <class Real>
+static void checkPowerSpectrum(SimdLevel level)
+{
+    const SimdKernels<Real> &scalar = *SimdKernels<Real>::forLevel(SimdLevel::Scalar);
+    const SimdKernels<Real> &kernels = *SimdKernels<Real>::forLevel(level);
+    std::mt19937 random(2);
+    std::uniform_real_distribution<Real> uniform(-100.0, 100.0);
+
+    for (size_t n : LENGTHS) {
+        std::vector<Real> spectrum(2 * n);
+        for (Real &x : spectrum) {
+            x = uniform(random);
+        }
+        // the imaginary parts are written too
+        std::vector<Real> expected(2 * n, 1.0), actual(2 * n, 1.0);
+        scalar.powerSpectrum(spectrum.data(), expected.data(), n);
+        kernels.powerSpectrum(spectrum.data(), actual.data(), n);
+
+        // the same operations in the same order, unless the compiler fused them
+        for (size_t i = 0; i < 2 * n; ++i) {
+            Real tolerance = 2 * std::numeric_limits<Real>::epsilon() * std::fabs(expected[i]);
+            QVERIFY2(std::fabs(expected[i] - actual[i]) <= tolerance,
+                     qPrintable(QString("length %1, index %2: %3 != %4")
+                                        .arg(n)
+                                        .arg(i)
+                                        .arg(actual[i])
+                                        .arg(expected[i])));
+        }
+    }
+}
+
+/// Autocorrelation-like signals: decaying cosines, with plateaus (ties), noise and NaNs.
+template <class Real>
+static std::vector<Real> makeAutocorrelation(std::mt19937 &random, size_t n, int kind)
+{
+    std::uniform_real_distribution<double> uniform(-1.0, 1.0);
+    const double period = 3 + random() % 60;
+    const double decay = 50 + random() % 500;
+    std::vector<Real> r(n + 1);
+    for (size_t i = 0; i <= n; ++i) {
+        double x = cos(2 * M_PI * i / period) * exp(-(double)i / decay);
+        switch (kind) {
+        case 1:
+            x = std::round(x * 8) / 8;
+            break;
+        case 2:
+            x = uniform(random);
+            break;
+        case 3:
+            if (random() % 50 == 0) {
+                x = std::numeric_limits<double>::quiet_NaN();
+            }
+            break;
+        }
+        r[i] = x;
+    }
+    return r;
+}
+
+template <class Real>
+static void checkPeakSearch(SimdLevel level)
+{
+    const SimdKernels<Real> &scalar = *SimdKernels<Real>::forLevel(SimdLevel::Scalar);
+    const SimdKernels<Real> &kernels = *SimdKernels<Real>::forLevel(level);
+    std::mt19937 random(3);
+
+    for (size_t n : LENGTHS) {
+        for (int kind = 0; kind < 4; ++kind) {
+            for (int repeat = 0; repeat < 20; ++repeat) {
+                std::vector<Real> r = makeAutocorrelation<Real>(random, n, kind);
+                const size_t begin = std::min<size_t>(1 + random() % 4, n);
+                QString where =
+                        QString("length %1, kind %2, repeat %3").arg(n).arg(kind).arg(repeat);
+
+                QVERIFY2(kernels.findDescentEnd(r.data(), 0, n)
+                                 == scalar.findDescentEnd(r.data(), 0, n),
+                         qPrintable(where));
+                QVERIFY2(kernels.findMaximum(r.data(), begin, n)
+                                 == scalar.findMaximum(r.data(), begin, n),
+                         qPrintable(where));
+
+                // every local maximum, as findFirstAutocorrelationPeak walks them
+                size_t expected = scalar.findLocalMaximum(r.data(), begin, n);
+                size_t actual = kernels.findLocalMaximum(r.data(), begin, n);
+                QVERIFY2(actual == expected, qPrintable(where));
+                while (expected < n) {
+                    expected = scalar.findLocalMaximum(r.data(), expected + 1, n);
+                    actual = kernels.findLocalMaximum(r.data(), actual + 1, n);
+                    QVERIFY2(actual == expected, qPrintable(where));
+                }
+            }
+        }
+    }
+}
+
+template <class Real>
+static void checkMinMax(SimdLevel level)
+{
+    const SimdKernels<Real> &scalar = *SimdKernels<Real>::forLevel(SimdLevel::Scalar);
+    const SimdKernels<Real> &kernels = *SimdKernels<Real>::forLevel(level);
+    std::mt19937 random(4);
+
+    for (size_t n : LENGTHS) {
+        for (int kind = 0; kind < 3; ++kind) {
+            std::vector<Real> r = makeAutocorrelation<Real>(random, n, kind);
+            Real expectedMinimum, expectedMaximum, actualMinimum, actualMaximum;
+            scalar.findMinMax(r.data(), n, &expectedMinimum, &expectedMaximum);
+            kernels.findMinMax(r.data(), n, &actualMinimum, &actualMaximum);
+            QString where = QString("length %1, kind %2").arg(n).arg(kind);
+            QVERIFY2(actualMinimum == expectedMinimum, qPrintable(where));
+            QVERIFY2(actualMaximum == expectedMaximum, qPrintable(where));
+            QVERIFY2(expectedMinimum == *std::min_element(r.begin(), r.begin() + n),
+                     qPrintable(where));
+            QVERIFY2(expectedMaximum == *std::max_element(r.begin(), r.begin() + n),
+                     qPrintable(where));
+        }
+    }
+}
+
+void TestSimdKernels::testBest()
+{
+    const SimdKernels<double> &best = SimdKernels<double>::best();
+    QCOMPARE(SimdKernels<double>::forLevel(best.level), &best);
+    QCOMPARE(SimdKernels<float>::best().level, best.level);
+    QVERIFY(SimdKernels<double>::forLevel(SimdLevel::Scalar) != nullptr);
+    qInfo("kernels: %s", simdLevelName(best.level));
+}
+
+void TestSimdKernels::testWindow_data()
+{
+    addLevelRows();
+}
+
+void TestSimdKernels::testWindow()
+{
+    QFETCH(int, level);
+    QFETCH(bool, singlePrecision);
+
+    if (singlePrecision) {
+        checkWindow<float>((SimdLevel)level);
+    } else {
+        checkWindow<double>((SimdLevel)level);
+    }
+}
+
+void TestSimdKernels::testPowerSpectrum_data()
+{
+    addLevelRows();
+}
+
+void TestSimdKernels::testPowerSpectrum()
+{
+    QFETCH(int, level);
+    QFETCH(bool, singlePrecision);
+
+    if (singlePrecision) {
+        checkPowerSpectrum<float>((SimdLevel)level);
+    } else {
+        checkPowerSpectrum<double>((SimdLevel)level);
+    }
+}
+
+void TestSimdKernels::testPeakSearch_data()
+{
+    addLevelRows();
+}
+
+void TestSimdKernels::testPeakSearch()
+{
+    QFETCH(int, level);
+    QFETCH(bool, singlePrecision);
+
+    if (singlePrecision) {
+        checkPeakSearch<float>((SimdLevel)level);
+    } else {
+        checkPeakSearch<double>((SimdLevel)level);
+    }
+}
+
+void TestSimdKernels::testMinMax_data()
+{
+    addLevelRows();
+}
+
+void TestSimdKernels::testMinMax()
+{
+    QFETCH(int, level);
+    QFETCH(bool, singlePrecision);
+
+    if (singlePrecision) {
+        checkMinMax<float>((SimdLevel)level);
+    } else {
+        checkMinMax<double>((SimdLevel)level);
+    }
+}
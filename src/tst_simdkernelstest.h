@@ -0,0 +1,19 @@
+#pragma once
+
+#include <QTest>
+#include <QObject>
+
+class TestSimdKernels : public QObject
+{
+    Q_OBJECT
+private slots:
+    void testBest();
+    void testWindow_data();
+    void testWindow();
+    void testPowerSpectrum_data();
+    void testPowerSpectrum();
+    void testPeakSearch_data();
+    void testPeakSearch();
+    void testMinMax_data();
+    void testMinMax();
+};
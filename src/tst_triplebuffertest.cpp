@@ -0,0 +1,107 @@
+#include "tst_triplebuffertest.h"
+
+#include "triplebuffer.h"
+#include "triplebuffer_impl.h"
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <QString>
+
+QTEST_MAIN(TestTripleBuffer)
+
+using Snapshot = std::vector<uint64_t>;
+
+template class TripleBuffer<Snapshot>;
+
+void TestTripleBuffer::testInitial()
+{
+    TripleBuffer<Snapshot> buffer(Snapshot(4, 7));
+    QCOMPARE(buffer.getFrontBuffer(), Snapshot(4, 7));
+    QVERIFY(!buffer.update());
+    QCOMPARE(buffer.getBackBuffer(), Snapshot(4, 7));
+}
+
+void TestTripleBuffer::testLatestWins()
+{
+    TripleBuffer<Snapshot> buffer(Snapshot(1, 0));
+    for (uint64_t i = 1; i <= 5; ++i) {
+        buffer.getBackBuffer()[0] = i;
+        buffer.publish();
+    }
+
+    // the older snapshots were overwritten, and the last one is only taken once
+    QVERIFY(buffer.update());
+    QCOMPARE(buffer.getFrontBuffer()[0], uint64_t(5));
+    QVERIFY(!buffer.update());
+    QCOMPARE(buffer.getFrontBuffer()[0], uint64_t(5));
+}
+
+void TestTripleBuffer::testFrontIsStable()
+{
+    TripleBuffer<Snapshot> buffer(Snapshot(1, 0));
+    buffer.getBackBuffer()[0] = 1;
+    buffer.publish();
+    QVERIFY(buffer.update());
+    const Snapshot *front = &buffer.getFrontBuffer();
+
+    // the producer never gets the front buffer, however many snapshots it publishes
+    for (uint64_t i = 2; i <= 10; ++i) {
+        QVERIFY(&buffer.getBackBuffer() != front);
+        buffer.getBackBuffer()[0] = i;
+        buffer.publish();
+        QCOMPARE((*front)[0], uint64_t(1));
+    }
+
+    QVERIFY(buffer.update());
+    QCOMPARE(buffer.getFrontBuffer()[0], uint64_t(10));
+}
+
+void TestTripleBuffer::testConcurrentStress()
+{
+    // The producer fills whole snapshots with consecutive numbers as fast as it can, while the
+    // consumer takes them and checks them in place.  Every snapshot taken must be whole, and newer
+    // than the previous one.
+    const size_t snapshotSize = 1024;
+    const uint64_t totalSnapshots = 200'000;
+
+    TripleBuffer<Snapshot> buffer(Snapshot(snapshotSize, 0));
+    std::atomic<bool> producerDone(false);
+
+    std::thread producer([&]() {
+        for (uint64_t i = 1; i <= totalSnapshots; ++i) {
+            Snapshot &snapshot = buffer.getBackBuffer();
+            std::fill(snapshot.begin(), snapshot.end(), i);
+            buffer.publish();
+        }
+        producerDone = true;
+    });
+
+    uint64_t last = 0;
+    uint64_t taken = 0;
+    bool consistent = true;
+    QString failure;
+    while (consistent) {
+        bool done = producerDone;
+        if (buffer.update()) {
+            const Snapshot &snapshot = buffer.getFrontBuffer();
+            uint64_t first = snapshot.front();
+            if (first <= last
+                || !std::all_of(snapshot.begin(), snapshot.end(),
+                                [first](uint64_t v) { return v == first; })) {
+                consistent = false;
+                failure = QString("snapshot %1 after %2 is torn or stale").arg(first).arg(last);
+            }
+            last = first;
+            ++taken;
+        } else if (done) {
+            break;
+        }
+    }
+
+    producer.join();
+    QVERIFY2(consistent, qPrintable(failure));
+    QCOMPARE(last, totalSnapshots);
+    QVERIFY(taken > 0);
+}
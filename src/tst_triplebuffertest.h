@@ -0,0 +1,14 @@
+#pragma once
+
+#include <QTest>
+#include <QObject>
+
+class TestTripleBuffer : public QObject
+{
+    Q_OBJECT
+private slots:
+    void testInitial();
+    void testLatestWins();
+    void testFrontIsStable();
+    void testConcurrentStress();
+};
@@ -4,84 +4,75 @@
 
 VisualizationData::VisualizationData(size_t plotData_size)
     : plotData_size(plotData_size),
-      plotSample(plotData_size),
-      plotSpectrum(plotData_size),
-      plotAutoCorr(plotData_size),
       plotSampleRange(0.0),
-      estimatedFrequency(0.0)
+      plotSpectrumRange(0.0),
+      plotAutoCorr(plotData_size),
+      plotAutoCorrRange(0.0),
+      estimatedFrequency(0.0),
+      frameNumber(0)
 {
 }
 
-void VisualizationData::popluateSamples(float *srcSamples, size_t srcNumSamples,
+void VisualizationData::popluateSamples(const float *srcSamples, size_t srcNumSamples,
                                         uint32_t sampleFrequency)
 {
-    // Bail out for extreme cases.
-    if (srcNumSamples == 0) {
-        std::fill(plotSample.begin(), plotSample.end(), 0.0);
-        return;
-    }
-
-    // Find the first rising edge that crosses the zero point.
-    double lastSample = srcSamples[0];
-    std::optional<size_t> risingEdgeIndex;
-    size_t plotSampleCursor = 0;
+    // Find the first rising edge that crosses the zero point, so that a steady note stands still.
+    size_t copyFrom = 0;
     for (size_t k = 1; k < srcNumSamples; k++) {
-        double currentSample = srcSamples[k];
-        if (lastSample < 0.0 && currentSample >= 0.0) {
-            risingEdgeIndex = k;
+        if (srcSamples[k - 1] < 0.0f && srcSamples[k] >= 0.0f) {
+            copyFrom = k;
             break;
         }
-        lastSample = currentSample;
     }
 
-    size_t copyFrom = risingEdgeIndex.value_or(0);
-    size_t availableSamples = srcNumSamples - copyFrom;
-    size_t copyLen = std::min(plotData_size, availableSamples);
-
-    // We don't do down-sampling.  Our oscilator view shows the actual samples.
-    size_t dstCursor = 0;
-    for (size_t i = copyFrom; i < copyFrom + copyLen; i++) {
-        plotSample[dstCursor] = srcSamples[i];
-        dstCursor++;
-    }
-
-    while (dstCursor < plotData_size) {
-        plotSample[dstCursor] = 0.0;
-        dstCursor++;
-    }
+    // No down-sampling: PlotRenderer shows the envelope of the rest of the frame, and the scale
+    // keeps the length of the whole frame.
+    plotSample.assign(srcSamples + copyFrom, srcSamples + srcNumSamples);
+    plotSample.resize(srcNumSamples, 0.0);
 
-    plotSampleRange = 1000.0 * plotData_size / sampleFrequency;
+    plotSampleRange = 1000.0 * srcNumSamples / sampleFrequency;
 }
-void VisualizationData::popluateSpectrum(fftw_complex *freqDomain, size_t srcSize,
-                                         uint32_t sampleFrequency)
+
+template <class Real>
+void VisualizationData::popluateSpectrum(typename FFTWTraits<Real>::Complex *freqDomain,
+                                         size_t srcSize, uint32_t sampleFrequency)
 {
     size_t available = srcSize / 2;
-    size_t copyLen = std::min(plotData_size, available);
+    plotSpectrum.resize(available);
 
-    for (size_t i = 0; i < copyLen; i++) {
+    for (size_t i = 0; i < available; i++) {
         plotSpectrum[i] = freqDomain[i][0];
     }
 
-    if (copyLen < plotData_size) {
-        std::fill_n(&plotSpectrum[copyLen], plotData_size - copyLen, 0.0);
-    }
-
-    plotSpectrumRange = (double)sampleFrequency * plotData_size / srcSize;
+    plotSpectrumRange = (double)sampleFrequency * available / srcSize;
 }
 
-void VisualizationData::popluateAutoCorr(double *timeDomain, size_t srcSize,
-                                         uint32_t sampleFrequency, size_t multiplier)
+template <class Real>
+void VisualizationData::popluateAutoCorr(Real *timeDomain, size_t srcSize,
+                                         uint32_t sampleFrequency, double samplesPerLag)
 {
-    size_t available = srcSize / multiplier;
+    // with fewer samples than lags (a truncated IFFT) the nearest sample is repeated
+    size_t available = srcSize / samplesPerLag;
     size_t copyLen = std::min(plotData_size, available);
 
     for (size_t i = 0; i < copyLen; i++) {
-        plotAutoCorr[i] = timeDomain[i * multiplier];
+        plotAutoCorr[i] = timeDomain[(size_t)(i * samplesPerLag + 0.5) % srcSize];
     }
 
     if (copyLen < plotData_size) {
-        std::fill_n(&plotSpectrum[copyLen], plotData_size - copyLen, 0.0);
+        std::fill_n(&plotAutoCorr[copyLen], plotData_size - copyLen, 0.0);
     }
 
     plotAutoCorrRange = 1000.0 * plotData_size / sampleFrequency;
 }
+
+template void VisualizationData::popluateSpectrum<double>(fftw_complex *freqDomain, size_t srcSize,
+                                                          uint32_t sampleFrequency);
+template void VisualizationData::popluateSpectrum<float>(fftwf_complex *freqDomain, size_t srcSize,
+                                                         uint32_t sampleFrequency);
+template void VisualizationData::popluateAutoCorr<double>(double *timeDomain, size_t srcSize,
+                                                          uint32_t sampleFrequency,
+                                                          double samplesPerLag);
+template void VisualizationData::popluateAutoCorr<float>(float *timeDomain, size_t srcSize,
+                                                         uint32_t sampleFrequency,
+                                                         double samplesPerLag);
@@ -2,37 +2,42 @@
 
 #include "notes.h"
 
-#include <QMutex>
+#include <chrono>
 #include <cstdint>
 #include <vector>
 
-#include "fftw3.h"
+#include "fftwtraits.h"
 
 /// A data structure that contains buffers used for visualization.
+///
+/// QPitchCore fills one in place for each frame and publishes it through a TripleBuffer, and the
+/// widgets draw straight from the last published one.
 class VisualizationData
 {
 public:
     VisualizationData(size_t plotData_size);
 
-    /// Try to obtain enough samples from a source to populate the plotSample array.
-    void popluateSamples(float *srcSamples, size_t srcNumSamples, uint32_t sampleFrequency);
-    void popluateSpectrum(fftw_complex *freqDomain, size_t srcSize, uint32_t sampleFrequency);
-    void popluateAutoCorr(double *timeDomain, size_t srcSize, uint32_t sampleFrequency,
-                          size_t multiplier);
+    /// Copy the frame to the plotSample array, from its first rising zero crossing.
+    void popluateSamples(const float *srcSamples, size_t srcNumSamples, uint32_t sampleFrequency);
+    template <class Real>
+    void popluateSpectrum(typename FFTWTraits<Real>::Complex *freqDomain, size_t srcSize,
+                          uint32_t sampleFrequency);
+    template <class Real>
+    void popluateAutoCorr(Real *timeDomain, size_t srcSize, uint32_t sampleFrequency,
+                          double samplesPerLag);
 
-    /// Ensure the QPitchCore thread doesn't write to the buffers when the UI thread is drawing
-    QMutex mutex;
-
-    /// Total number of samples used for visualization
+    /// Number of lags of the autocorrelation used for visualization
     size_t plotData_size;
 
-    /// Buffer used to store time samples used for visualization
+    /// Buffer used to store time samples used for visualization: the whole frame, which
+    /// PlotRenderer reduces to the width of the plot.  The buffers grow to the frame size with the
+    /// first frames, and are reused afterwards.
     std::vector<double> plotSample;
 
     /// The time range of the plotSample array, in milliseconds
     double plotSampleRange;
 
-    /// Buffer used to store frequency spectrum used for visualization
+    /// Buffer used to store frequency spectrum used for visualization, up to the Nyquist frequency
     std::vector<double> plotSpectrum;
 
     /// The frequency range of the plotSpectrum array, in Hz
@@ -49,4 +54,10 @@ public:
 
     /// Estimated note
     std::optional<EstimatedNote> estimatedNote;
+
+    /// Number of frames analysed up to this one, included
+    uint64_t frameNumber;
+
+    /// When the samples of the frame were read, to tell the age of the frame when it is displayed
+    std::chrono::steady_clock::time_point analysisTime;
 };